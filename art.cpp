@@ -4,14 +4,26 @@
 
 #include "art.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <tuple>
 #include <type_traits>  // IWYU pragma: keep
-#include <utility>      // IWYU pragma: keep
+#include <unordered_map>
+#include <utility>  // IWYU pragma: keep
 
 #include "art_internal_impl.hpp"
 #include "assert.hpp"
+#include "compact_art.hpp"
+#include "frozen_art.hpp"
 #include "in_fake_critical_section.hpp"
 #include "node_type.hpp"
+#include "snapshot.hpp"
+#include "wal.hpp"
 
 namespace unodb::detail {
 
@@ -19,6 +31,46 @@ struct [[nodiscard]] node_header {};
 
 static_assert(std::is_empty_v<node_header>);
 
+// The reference counts of the nodes shared by a tree and its copies. A node
+// referenced once, by its parent or a tree root, is not stored, thus the table
+// holds only the shared nodes, and nothing once all the copies but one are
+// gone. The node functions must be called with the mutex locked.
+class [[nodiscard]] shared_node_refs final {
+ public:
+  void add_ref(const void *node) {
+    ++extra_refs[node];
+    shared_count.store(extra_refs.size(), std::memory_order_release);
+  }
+
+  // Return whether the dropped reference was the last one
+  [[nodiscard]] bool drop_ref(const void *node) noexcept {
+    const auto itr{extra_refs.find(node)};
+    if (itr == extra_refs.end()) return true;
+    if (--itr->second == 0) {
+      extra_refs.erase(itr);
+      shared_count.store(extra_refs.size(), std::memory_order_release);
+    }
+    return false;
+  }
+
+  [[nodiscard]] bool is_shared(const void *node) const noexcept {
+    return extra_refs.find(node) != extra_refs.end();
+  }
+
+  // May be called without the mutex. Once all the copies but one are gone,
+  // the remaining tree sees true and may change its nodes in place, thus the
+  // acquire pairs with the release of the last drop_ref.
+  [[nodiscard]] bool empty() const noexcept {
+    return shared_count.load(std::memory_order_acquire) == 0;
+  }
+
+  std::mutex mutex;
+
+ private:
+  std::unordered_map<const void *, std::uint32_t> extra_refs;
+  std::atomic<std::size_t> shared_count{0};
+};
+
 }  // namespace unodb::detail
 
 namespace {
@@ -26,11 +78,13 @@ namespace {
 class inode;
 class inode_4;
 class inode_16;
+class inode_32;
 class inode_48;
 class inode_256;
 
-using inode_defs = unodb::detail::basic_inode_def<inode, inode_4, inode_16,
-                                                  inode_48, inode_256>;
+using inode_defs =
+    unodb::detail::basic_inode_def<unodb::detail::node_header, inode, inode_4,
+                                   inode_16, inode_32, inode_48, inode_256>;
 
 template <class INode>
 using db_inode_deleter =
@@ -46,6 +100,9 @@ using leaf = unodb::detail::basic_leaf<unodb::detail::node_header>;
 
 class inode : public inode_base {};
 
+using sorted_tree_builder =
+    unodb::detail::basic_sorted_tree_builder<art_policy>;
+
 }  // namespace
 
 namespace unodb::detail {
@@ -92,7 +149,9 @@ class [[nodiscard]] inode_4 final
   }
 };
 
-#ifndef _MSC_VER
+#ifdef UNODB_DETAIL_COMPRESSED_NODE_PTRS
+static_assert(sizeof(inode_4) == 32);
+#elif !defined(_MSC_VER)
 static_assert(sizeof(inode_4) == 48);
 #else
 // MSVC pads the first field to 8 byte boundary even though its natural
@@ -118,7 +177,35 @@ class [[nodiscard]] inode_16 final
   }
 };
 
+#ifdef UNODB_DETAIL_COMPRESSED_NODE_PTRS
+static_assert(sizeof(inode_16) == 96);
+#else
 static_assert(sizeof(inode_16) == 160);
+#endif
+
+class [[nodiscard]] inode_32 final
+    : public unodb::detail::basic_inode_32<art_policy> {
+ public:
+  using basic_inode_32::basic_inode_32;
+
+  template <typename... Args>
+  [[nodiscard]] auto add_or_choose_subtree(Args &&...args) {
+    return unodb::detail::impl_helpers::add_or_choose_subtree(
+        *this, std::forward<Args>(args)...);
+  }
+
+  template <typename... Args>
+  [[nodiscard]] auto remove_or_choose_subtree(Args &&...args) {
+    return unodb::detail::impl_helpers::remove_or_choose_subtree(
+        *this, std::forward<Args>(args)...);
+  }
+};
+
+#ifdef UNODB_DETAIL_COMPRESSED_NODE_PTRS
+static_assert(sizeof(inode_32) == 176);
+#else
+static_assert(sizeof(inode_32) == 304);
+#endif
 
 class [[nodiscard]] inode_48 final
     : public unodb::detail::basic_inode_48<art_policy> {
@@ -138,10 +225,10 @@ class [[nodiscard]] inode_48 final
   }
 };
 
-#ifdef UNODB_DETAIL_AVX2
-static_assert(sizeof(inode_48) == 672);
+#ifdef UNODB_DETAIL_COMPRESSED_NODE_PTRS
+static_assert(sizeof(inode_48) == 472);
 #else
-static_assert(sizeof(inode_48) == 656);
+static_assert(sizeof(inode_48) == 664);
 #endif
 
 class [[nodiscard]] inode_256 final
@@ -162,7 +249,11 @@ class [[nodiscard]] inode_256 final
   }
 };
 
-static_assert(sizeof(inode_256) == 2064);
+#ifdef UNODB_DETAIL_COMPRESSED_NODE_PTRS
+static_assert(sizeof(inode_256) == 1072);
+#else
+static_assert(sizeof(inode_256) == 2096);
+#endif
 
 // Because we cannot dereference, load(), & take address of - it is a temporary
 // by then
@@ -173,6 +264,157 @@ inline auto *unwrap_fake_critical_section(
 }
 UNODB_DETAIL_RESTORE_MSVC_WARNINGS()
 
+// The key of any leaf below node, shifted to depth. It has all the key prefix
+// bytes of node, including the ones that are not stored.
+[[nodiscard]] unodb::detail::art_key shifted_leaf_key_below(
+    unodb::detail::node_ptr node, unodb::detail::tree_depth depth) noexcept {
+  while (node.type() != unodb::node_type::LEAF)
+    node = node.ptr<inode *>()->any_child(node.type());
+  auto result{node.ptr<leaf *>()->get_key()};
+  result.shift_right(depth);
+  return result;
+}
+
+// Call func with the key byte and the pointer of every child of node, if it is
+// an inode
+template <typename Function>
+void for_each_child_of(unodb::detail::node_ptr node, Function func) {
+  switch (node.type()) {
+    case unodb::node_type::LEAF:
+      return;
+    case unodb::node_type::I4:
+      node.ptr<const inode_4 *>()->for_each_child(func);
+      return;
+    case unodb::node_type::I16:
+      node.ptr<const inode_16 *>()->for_each_child(func);
+      return;
+    case unodb::node_type::I32:
+      node.ptr<const inode_32 *>()->for_each_child(func);
+      return;
+    case unodb::node_type::I48:
+      node.ptr<const inode_48 *>()->for_each_child(func);
+      return;
+    case unodb::node_type::I256:
+      node.ptr<const inode_256 *>()->for_each_child(func);
+      return;
+  }
+  UNODB_DETAIL_CANNOT_HAPPEN();  // LCOV_EXCL_LINE
+}
+
+[[nodiscard]] std::size_t node_memory_use(
+    unodb::detail::node_ptr node) noexcept {
+  switch (node.type()) {
+    case unodb::node_type::LEAF:
+      return node.ptr<const leaf *>()->get_size();
+    case unodb::node_type::I4:
+      return sizeof(inode_4);
+    case unodb::node_type::I16:
+      return sizeof(inode_16);
+    case unodb::node_type::I32:
+      return sizeof(inode_32);
+    case unodb::node_type::I48:
+      return sizeof(inode_48);
+    case unodb::node_type::I256:
+      return sizeof(inode_256);
+  }
+  UNODB_DETAIL_CANNOT_HAPPEN();  // LCOV_EXCL_LINE
+}
+
+// The copies below take the place of the originals in one tree, thus the
+// node counts and memory use of the tree stay the same.
+template <class INode>
+[[nodiscard]] unodb::detail::node_ptr copy_inode(
+    unodb::detail::node_ptr node) {
+  auto *const inode_mem{unodb::detail::allocate_node(
+      sizeof(INode), art_policy::inode_alignment<INode>())};
+  return unodb::detail::node_ptr{new (inode_mem) INode{*node.ptr<INode *>()},
+                                 INode::type};
+}
+
+[[nodiscard]] unodb::detail::node_ptr copy_node(unodb::detail::node_ptr node) {
+  switch (node.type()) {
+    case unodb::node_type::LEAF: {
+      const auto *const source{node.ptr<const leaf *>()};
+      auto *const leaf_mem{unodb::detail::allocate_node(
+          source->get_size(), unodb::detail::alignment_for_new<leaf>())};
+      return unodb::detail::node_ptr{
+          new (leaf_mem) leaf{source->get_key(), source->get_value_view()},
+          unodb::node_type::LEAF};
+    }
+    case unodb::node_type::I4:
+      return copy_inode<inode_4>(node);
+    case unodb::node_type::I16:
+      return copy_inode<inode_16>(node);
+    case unodb::node_type::I32:
+      return copy_inode<inode_32>(node);
+    case unodb::node_type::I48:
+      return copy_inode<inode_48>(node);
+    case unodb::node_type::I256:
+      return copy_inode<inode_256>(node);
+  }
+  UNODB_DETAIL_CANNOT_HAPPEN();  // LCOV_EXCL_LINE
+}
+
+// If the node at slot is shared, replace it there with a copy that references
+// the same children
+void unshare_node(unodb::detail::shared_node_refs &refs,
+                  unodb::detail::node_ptr &slot) {
+  const auto node{slot};
+  if (!refs.is_shared(node.ptr<void *>())) return;
+
+  const auto copy{copy_node(node)};
+  std::size_t added_refs = 0;
+  try {
+    for_each_child_of(copy, [&refs, &added_refs](unsigned,
+                                                 unodb::detail::node_ptr c) {
+      refs.add_ref(c.ptr<void *>());
+      ++added_refs;
+    });
+  } catch (...) {
+    for_each_child_of(copy, [&refs, &added_refs](unsigned,
+                                                 unodb::detail::node_ptr c) {
+      if (added_refs == 0) return;
+      std::ignore = refs.drop_ref(c.ptr<void *>());
+      --added_refs;
+    });
+    unodb::detail::free_node(copy.ptr<void *>());
+    throw;
+  }
+
+  const auto last_ref{refs.drop_ref(node.ptr<void *>())};
+  UNODB_DETAIL_ASSERT(!last_ref);
+  std::ignore = last_ref;
+  slot = copy;
+}
+
+// Drop a reference to node, freeing it and releasing its children if it was
+// the last one
+void release_subtree(unodb::detail::shared_node_refs &refs,
+                     unodb::detail::node_ptr node) noexcept {
+  if (!refs.drop_ref(node.ptr<void *>())) return;
+
+  for_each_child_of(node,
+                    [&refs](unsigned, unodb::detail::node_ptr child) noexcept {
+                      release_subtree(refs, child);
+                    });
+  unodb::detail::free_node(node.ptr<void *>());
+}
+
+// The memory use of the nodes of the subtree at node that are not shared
+[[nodiscard]] std::size_t exclusive_memory_use(
+    const unodb::detail::shared_node_refs &refs,
+    unodb::detail::node_ptr node) noexcept {
+  if (refs.is_shared(node.ptr<void *>())) return 0;
+
+  auto result{node_memory_use(node)};
+  const auto add_child = [&refs, &result](
+                             unsigned, unodb::detail::node_ptr child) noexcept {
+    result += exclusive_memory_use(refs, child);
+  };
+  for_each_child_of(node, add_child);
+  return result;
+}
+
 }  // namespace
 
 namespace unodb::detail {
@@ -219,7 +461,8 @@ std::optional<detail::node_ptr *> impl_helpers::remove_or_choose_subtree(
   const auto *const leaf{child_ptr_val.template ptr<::leaf *>()};
   if (!leaf->matches(k)) return {};
 
-  if (UNODB_DETAIL_UNLIKELY(inode.is_min_size())) {
+  if (UNODB_DETAIL_UNLIKELY(
+          inode.is_min_size(db_instance.node_shrink_policy))) {
     if constexpr (std::is_same_v<INode, inode_4>) {
       auto current_node{
           art_policy::make_db_inode_unique_ptr(&inode, db_instance)};
@@ -242,8 +485,97 @@ std::optional<detail::node_ptr *> impl_helpers::remove_or_choose_subtree(
 
 namespace unodb {
 
+db::db(unsigned direct_mapped_key_bytes_)
+    : direct_mapped_key_bytes{
+          detail::checked_direct_mapped_key_bytes(direct_mapped_key_bytes_)},
+      direct_map{direct_mapped_key_bytes == 0
+                     ? nullptr
+                     : std::make_unique<detail::node_ptr[]>(
+                           detail::direct_map_size(direct_mapped_key_bytes))} {
+  if (direct_map == nullptr) return;
+  std::fill_n(direct_map.get(),
+              detail::direct_map_size(direct_mapped_key_bytes),
+              detail::node_ptr{nullptr});
+}
+
+db::db(shrink_policy policy) noexcept : node_shrink_policy{policy} {}
+
+db::db(const db &other)
+    : root{other.root},
+      direct_mapped_key_bytes{other.direct_mapped_key_bytes},
+      node_shrink_policy{other.node_shrink_policy},
+      direct_map{other.direct_map == nullptr
+                     ? nullptr
+                     : std::make_unique<detail::node_ptr[]>(
+                           detail::direct_map_size(direct_mapped_key_bytes))},
+      current_memory_use{other.current_memory_use},
+      node_counts{other.node_counts},
+      growing_inode_counts{other.growing_inode_counts},
+      shrinking_inode_counts{other.shrinking_inode_counts},
+      key_prefix_splits{other.key_prefix_splits} {
+  if (other.node_refs == nullptr)
+    other.node_refs = std::make_shared<detail::shared_node_refs>();
+  node_refs = other.node_refs;
+
+  const auto size{direct_map == nullptr
+                      ? 0
+                      : detail::direct_map_size(direct_mapped_key_bytes)};
+  if (size != 0) std::copy_n(other.direct_map.get(), size, direct_map.get());
+
+  const std::lock_guard guard{node_refs->mutex};
+  if (root != nullptr) node_refs->add_ref(root.ptr<void *>());
+  std::size_t i = 0;
+  try {
+    for (; i < size; ++i) {
+      if (direct_map[i] == nullptr) continue;
+      node_refs->add_ref(direct_map[i].ptr<void *>());
+    }
+  } catch (...) {
+    for (std::size_t j = 0; j < i; ++j) {
+      if (direct_map[j] == nullptr) continue;
+      std::ignore = node_refs->drop_ref(direct_map[j].ptr<void *>());
+    }
+    throw;
+  }
+}
+
+db::db(db &&other) noexcept { swap(other); }
+
 db::~db() noexcept { delete_root_subtree(); }
 
+db &db::operator=(const db &other) {
+  if (this == &other) return *this;
+  db copy{other};
+  swap(copy);
+  return *this;
+}
+
+db &db::operator=(db &&other) noexcept {
+  db taken{std::move(other)};
+  swap(taken);
+  return *this;
+}
+
+void db::swap(db &other) noexcept {
+  using std::swap;
+
+  // The insert hints may point to the root pointer fields themselves
+  reset_insert_hint();
+  other.reset_insert_hint();
+
+  swap(root, other.root);
+  swap(direct_mapped_key_bytes, other.direct_mapped_key_bytes);
+  swap(node_shrink_policy, other.node_shrink_policy);
+  swap(direct_map, other.direct_map);
+  swap(current_memory_use, other.current_memory_use);
+  swap(node_counts, other.node_counts);
+  swap(growing_inode_counts, other.growing_inode_counts);
+  swap(shrinking_inode_counts, other.shrinking_inode_counts);
+  swap(key_prefix_splits, other.key_prefix_splits);
+  swap(log, other.log);
+  swap(node_refs, other.node_refs);
+}
+
 template <class INode>
 constexpr void db::increment_inode_count() noexcept {
   static_assert(inode_defs::is_inode<INode>());
@@ -279,12 +611,82 @@ constexpr void db::account_shrinking_inode() noexcept {
                       growing_inode_counts[internal_as_i<NodeType>]);
 }
 
-db::get_result db::get(key search_key) const noexcept {
-  if (UNODB_DETAIL_UNLIKELY(root == nullptr)) return {};
+bool db::may_share_nodes() const noexcept {
+  return node_refs != nullptr && !node_refs->empty();
+}
+
+void db::unshare_path(detail::art_key k, bool for_remove) {
+  const std::lock_guard guard{node_refs->mutex};
+
+  auto *node{&root_for(k)};
+  if (*node == nullptr) return;
+
+  auto remaining_key{k};
+  remaining_key.shift_right(direct_mapped_key_bytes);
+
+  while (true) {
+    if (node->type() == node_type::LEAF) {
+      if (for_remove) unshare_node(*node_refs, *node);
+      return;
+    }
+
+    unshare_node(*node_refs, *node);
+    const auto node_type = node->type();
+    auto *const inode{node->ptr<::inode *>()};
+    const auto &key_prefix{inode->get_key_prefix()};
+    if (key_prefix.get_shared_length(remaining_key) <
+        key_prefix.stored_length())
+      return;
+    remaining_key.shift_right(key_prefix.length());
+
+    auto *const child{unwrap_fake_critical_section(
+        inode->find_child(node_type, remaining_key[0]).second)};
+    if (child == nullptr) return;
+
+    if (for_remove && node_type == node_type::I4 &&
+        child->type() == node_type::LEAF &&
+        node->ptr<inode_4 *>()->is_min_size()) {
+      // Removing the leaf leaves the other child in place of the parent, with
+      // the parent key prefix prepended to its own
+      auto *const i4{node->ptr<inode_4 *>()};
+      i4->for_each_child(
+          [this, i4](unsigned key_byte, detail::node_ptr sibling) {
+            if (sibling.type() == node_type::LEAF) return;
+            unshare_node(*node_refs,
+                         *unwrap_fake_critical_section(
+                             i4->find_child(static_cast<std::byte>(key_byte))
+                                 .second));
+          });
+    }
+
+    node = child;
+    remaining_key.shift_right(1);
+  }
+}
+
+std::size_t db::get_exclusive_memory_use() const {
+  if (!may_share_nodes()) return current_memory_use;
+
+  const std::lock_guard guard{node_refs->mutex};
+  if (root != nullptr) return exclusive_memory_use(*node_refs, root);
+  std::size_t result = 0;
+  if (direct_map != nullptr) {
+    const auto size{detail::direct_map_size(direct_mapped_key_bytes)};
+    for (std::size_t i = 0; i < size; ++i) {
+      if (direct_map[i] == nullptr) continue;
+      result += exclusive_memory_use(*node_refs, direct_map[i]);
+    }
+  }
+  return result;
+}
 
-  auto node{root};
+db::get_result db::get(key search_key) const noexcept {
   const detail::art_key k{search_key};
+  auto node{root_for(k)};
+  if (UNODB_DETAIL_UNLIKELY(node == nullptr)) return {};
+
   auto remaining_key{k};
+  remaining_key.shift_right(direct_mapped_key_bytes);
 
   while (true) {
     const auto node_type = node.type();
@@ -299,11 +701,19 @@ db::get_result db::get(key search_key) const noexcept {
     auto *const inode{node.ptr<::inode *>()};
     const auto &key_prefix{inode->get_key_prefix()};
     const auto key_prefix_length{key_prefix.length()};
-    if (key_prefix.get_shared_length(remaining_key) < key_prefix_length)
-      return {};
+    // Look up the child before checking the key prefix, so that its cache
+    // lines, if prefetched, are in flight during the check. The result is
+    // not used on a prefix mismatch. Only the stored key prefix bytes are
+    // checked, the leaf key check covers the rest.
+    const auto prefix_key{remaining_key};
     remaining_key.shift_right(key_prefix_length);
     const auto *const child{
         inode->find_child(node_type, remaining_key[0]).second};
+#ifdef UNODB_DETAIL_PREFETCH_CHILDREN
+    if (child != nullptr) inode::prefetch_for_lookup(*child, remaining_key[1]);
+#endif
+    if (key_prefix.get_shared_length(prefix_key) < key_prefix.stored_length())
+      return {};
     if (child == nullptr) return {};
 
     node = *child;
@@ -313,17 +723,38 @@ db::get_result db::get(key search_key) const noexcept {
 
 UNODB_DETAIL_DISABLE_MSVC_WARNING(26430)
 bool db::insert(key insert_key, value_view v) {
-  const auto k = detail::art_key{insert_key};
+  if (!insert_internal(detail::art_key{insert_key}, v)) return false;
+  if (UNODB_DETAIL_UNLIKELY(log != nullptr))
+    log->commit(log->append_insert(insert_key, v));
+  return true;
+}
+
+bool db::insert_internal(detail::art_key k, value_view v) {
+  if (UNODB_DETAIL_UNLIKELY(may_share_nodes())) {
+    if (get(k.original_key())) return false;
+    unshare_path(k, false);
+    reset_insert_hint();
+  }
 
-  if (UNODB_DETAIL_UNLIKELY(root == nullptr)) {
+  auto &subtree_root{root_for(k)};
+
+  if (UNODB_DETAIL_UNLIKELY(subtree_root == nullptr)) {
     auto leaf = art_policy::make_db_leaf_ptr(k, v, *this);
-    root = detail::node_ptr{leaf.release(), node_type::LEAF};
+    subtree_root = detail::node_ptr{leaf.release(), node_type::LEAF};
+    set_insert_hint(&subtree_root, detail::tree_depth{direct_mapped_key_bytes},
+                    k);
     return true;
   }
 
-  auto *node = &root;
-  detail::tree_depth depth{};
+  auto *node = &subtree_root;
+  detail::tree_depth depth{direct_mapped_key_bytes};
+  if (insert_hint != nullptr &&
+      k.shares_leading_bytes(insert_hint_key, insert_hint_depth)) {
+    node = insert_hint;
+    depth = insert_hint_depth;
+  }
   auto remaining_key{k};
+  remaining_key.shift_right(depth);
 
   while (true) {
     const auto node_type = node->type();
@@ -337,6 +768,7 @@ bool db::insert(key insert_key, value_view v) {
                                     leaf, std::move(new_leaf))};
       *node = detail::node_ptr{new_node.release(), node_type::I4};
       account_growing_inode<node_type::I4>();
+      set_insert_hint(node, depth, k);
       return true;
     }
 
@@ -346,27 +778,42 @@ bool db::insert(key insert_key, value_view v) {
     auto *const inode{node->ptr<::inode *>()};
     const auto &key_prefix{inode->get_key_prefix()};
     const auto key_prefix_length{key_prefix.length()};
-    const auto shared_prefix_len{key_prefix.get_shared_length(remaining_key)};
-    if (shared_prefix_len < key_prefix_length) {
-      auto leaf = art_policy::make_db_leaf_ptr(k, v, *this);
-      auto new_node = inode_4::create(*this, *node, shared_prefix_len, depth,
-                                      std::move(leaf));
-      *node = detail::node_ptr{new_node.release(), node_type::I4};
-      account_growing_inode<node_type::I4>();
-      ++key_prefix_splits;
-      UNODB_DETAIL_ASSERT(growing_inode_counts[internal_as_i<node_type::I4>] >
-                          key_prefix_splits);
-      return true;
+    auto shared_prefix_len{key_prefix.get_shared_length(remaining_key)};
+    if (!key_prefix.is_complete() || shared_prefix_len < key_prefix_length) {
+      // The key of any leaf below has the key prefix bytes that are not
+      // stored, and the ones past the split
+      const auto shifted_leaf_key{shifted_leaf_key_below(*node, depth)};
+      shared_prefix_len =
+          key_prefix.get_shared_length(remaining_key, shifted_leaf_key);
+      if (shared_prefix_len < key_prefix_length) {
+        auto leaf = art_policy::make_db_leaf_ptr(k, v, *this);
+        auto new_node = inode_4::create(*this, *node, shared_prefix_len, depth,
+                                        std::move(leaf), shifted_leaf_key);
+        *node = detail::node_ptr{new_node.release(), node_type::I4};
+        account_growing_inode<node_type::I4>();
+        ++key_prefix_splits;
+        UNODB_DETAIL_ASSERT(
+            growing_inode_counts[internal_as_i<node_type::I4>] >
+            key_prefix_splits);
+        set_insert_hint(node, depth, k);
+        return true;
+      }
     }
 
     UNODB_DETAIL_ASSERT(shared_prefix_len == key_prefix_length);
+    const auto node_depth{depth};
     depth += key_prefix_length;
     remaining_key.shift_right(key_prefix_length);
 
-    node = inode->add_or_choose_subtree<detail::node_ptr *>(
+    auto *const child = inode->add_or_choose_subtree<detail::node_ptr *>(
         node_type, remaining_key[0], k, v, *this, depth, node);
 
-    if (node == nullptr) return true;
+    if (child == nullptr) {
+      set_insert_hint(node, node_depth, k);
+      return true;
+    }
+
+    node = child;
 
     ++depth;
     remaining_key.shift_right(1);
@@ -375,23 +822,37 @@ bool db::insert(key insert_key, value_view v) {
 UNODB_DETAIL_RESTORE_MSVC_WARNINGS()
 
 bool db::remove(key remove_key) {
-  const auto k = detail::art_key{remove_key};
+  if (!remove_internal(detail::art_key{remove_key})) return false;
+  if (UNODB_DETAIL_UNLIKELY(log != nullptr))
+    log->commit(log->append_remove(remove_key));
+  return true;
+}
 
-  if (UNODB_DETAIL_UNLIKELY(root == nullptr)) return false;
+bool db::remove_internal(detail::art_key k) {
+  if (UNODB_DETAIL_UNLIKELY(may_share_nodes())) {
+    if (!get(k.original_key())) return false;
+    unshare_path(k, true);
+  }
+
+  auto &subtree_root{root_for(k)};
+
+  if (UNODB_DETAIL_UNLIKELY(subtree_root == nullptr)) return false;
 
-  if (root.type() == node_type::LEAF) {
-    auto *const root_leaf{root.ptr<leaf *>()};
+  if (subtree_root.type() == node_type::LEAF) {
+    auto *const root_leaf{subtree_root.ptr<leaf *>()};
     if (root_leaf->matches(k)) {
       const auto r{art_policy::reclaim_leaf_on_scope_exit(root_leaf, *this)};
-      root = nullptr;
+      subtree_root = nullptr;
+      reset_insert_hint();
       return true;
     }
     return false;
   }
 
-  auto *node = &root;
-  detail::tree_depth depth{};
+  auto *node = &subtree_root;
+  detail::tree_depth depth{direct_mapped_key_bytes};
   auto remaining_key{k};
+  remaining_key.shift_right(direct_mapped_key_bytes);
 
   while (true) {
     const auto node_type = node->type();
@@ -401,10 +862,11 @@ bool db::remove(key remove_key) {
     auto *const inode{node->ptr<::inode *>()};
     const auto &key_prefix{inode->get_key_prefix()};
     const auto key_prefix_length{key_prefix.length()};
+    // As in get, the leaf key check covers the key prefix bytes that are not
+    // stored
     const auto shared_prefix_len{key_prefix.get_shared_length(remaining_key)};
-    if (shared_prefix_len < key_prefix_length) return false;
+    if (shared_prefix_len < key_prefix.stored_length()) return false;
 
-    UNODB_DETAIL_ASSERT(shared_prefix_len == key_prefix_length);
     depth += key_prefix_length;
     remaining_key.shift_right(key_prefix_length);
 
@@ -414,7 +876,10 @@ bool db::remove(key remove_key) {
     if (UNODB_DETAIL_UNLIKELY(!remove_result)) return false;
 
     auto *const child_ptr{*remove_result};
-    if (child_ptr == nullptr) return true;
+    if (child_ptr == nullptr) {
+      reset_insert_hint();
+      return true;
+    }
 
     node = child_ptr;
     ++depth;
@@ -423,8 +888,34 @@ bool db::remove(key remove_key) {
 }
 
 void db::delete_root_subtree() noexcept {
+  if (UNODB_DETAIL_UNLIKELY(may_share_nodes())) {
+    // The nodes still shared stay with the copies, thus the node counts no
+    // longer match the freed nodes and are reset by the caller, if needed
+    const std::lock_guard guard{node_refs->mutex};
+    if (root != nullptr) release_subtree(*node_refs, root);
+    if (direct_map != nullptr) {
+      const auto size{detail::direct_map_size(direct_mapped_key_bytes)};
+      for (std::size_t i = 0; i < size; ++i) {
+        if (direct_map[i] == nullptr) continue;
+        release_subtree(*node_refs, direct_map[i]);
+        direct_map[i] = nullptr;
+      }
+    }
+    node_counts[as_i<node_type::LEAF>] = 0;
+    return;
+  }
+
   if (root != nullptr) art_policy::delete_subtree(root, *this);
 
+  if (direct_map != nullptr) {
+    const auto size{detail::direct_map_size(direct_mapped_key_bytes)};
+    for (std::size_t i = 0; i < size; ++i) {
+      if (direct_map[i] == nullptr) continue;
+      art_policy::delete_subtree(direct_map[i], *this);
+      direct_map[i] = nullptr;
+    }
+  }
+
   // It is possible to reset the counter to zero instead of decrementing it for
   // each leaf, but not sure the savings will be significant.
   UNODB_DETAIL_ASSERT(node_counts[as_i<node_type::LEAF>] == 0);
@@ -432,18 +923,124 @@ void db::delete_root_subtree() noexcept {
 
 void db::clear() noexcept {
   delete_root_subtree();
+  reset_insert_hint();
 
   root = nullptr;
   current_memory_use = 0;
   node_counts[as_i<node_type::I4>] = 0;
   node_counts[as_i<node_type::I16>] = 0;
+  node_counts[as_i<node_type::I32>] = 0;
   node_counts[as_i<node_type::I48>] = 0;
   node_counts[as_i<node_type::I256>] = 0;
 }
 
+template <class Visitor>
+void db::for_each_key_value(Visitor &visitor) const {
+  const auto visit_leaf = [&visitor](const leaf &l) {
+    visitor.add(l.get_key().original_key(), l.get_value_view());
+  };
+
+  if (direct_map == nullptr) {
+    if (root != nullptr) art_policy::for_each_leaf(root, visit_leaf);
+    return;
+  }
+
+  const auto size{detail::direct_map_size(direct_mapped_key_bytes)};
+  for (std::size_t i = 0; i < size; ++i) {
+    if (direct_map[i] == nullptr) continue;
+    art_policy::for_each_leaf(direct_map[i], visit_leaf);
+  }
+}
+
+template void db::for_each_key_value<detail::frozen_image_writer>(
+    detail::frozen_image_writer &) const;
+
+template void db::for_each_key_value<detail::compact_tree_source>(
+    detail::compact_tree_source &) const;
+
+void db::save(std::ostream &os) const {
+  detail::snapshot_writer writer{os, node_counts[as_i<node_type::LEAF>]};
+  for_each_key_value(writer);
+}
+
+template <class Reader>
+void db::build_from(Reader &reader) {
+  sorted_tree_builder builder{*this,
+                              detail::tree_depth{direct_mapped_key_bytes}};
+
+  if (direct_map == nullptr) {
+    while (reader.next())
+      builder.add(detail::art_key{reader.get_key()}, reader.get_value());
+    root = builder.finish();
+    return;
+  }
+
+  // The keys of each direct-mapped table slot are consecutive
+  std::size_t slot = 0;
+  while (reader.next()) {
+    const detail::art_key k{reader.get_key()};
+    const auto key_slot = detail::direct_map_index(k, direct_mapped_key_bytes);
+    if (key_slot != slot) {
+      direct_map[slot] = builder.finish();
+      slot = key_slot;
+    }
+    builder.add(k, reader.get_value());
+  }
+  direct_map[slot] = builder.finish();
+}
+
+void db::load(std::istream &is) {
+  clear();
+
+  try {
+    detail::snapshot_reader reader{is};
+    build_from(reader);
+  } catch (...) {
+    clear();
+    throw;
+  }
+}
+
+void db::replay(std::istream &log_is) {
+  clear();
+
+  try {
+    detail::wal_replay_reader reader{log_is};
+    build_from(reader);
+  } catch (...) {
+    clear();
+    throw;
+  }
+}
+
+void db::replay(std::istream &checkpoint_is, std::istream &log_is,
+                std::uint64_t start_lsn) {
+  clear();
+
+  try {
+    detail::wal_replay_reader reader{checkpoint_is, log_is, start_lsn};
+    build_from(reader);
+  } catch (...) {
+    clear();
+    throw;
+  }
+}
+
 void db::dump(std::ostream &os) const {
   os << "db dump, current memory use = " << get_current_memory_use() << '\n';
-  art_policy::dump_node(os, root);
+  if (direct_map == nullptr) {
+    art_policy::dump_node(os, root);
+    return;
+  }
+
+  os << "direct-mapped top-level table, key bytes = " << direct_mapped_key_bytes
+     << '\n';
+  const auto size{detail::direct_map_size(direct_mapped_key_bytes)};
+  for (std::size_t i = 0; i < size; ++i) {
+    if (direct_map[i] == nullptr) continue;
+    os << "slot " << i << ": ";
+    art_policy::dump_node(os, direct_map[i]);
+  }
 }
 
 }  // namespace unodb
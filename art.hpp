@@ -7,6 +7,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <iostream>
+#include <memory>
 #include <optional>
 
 #include "art_common.hpp"
@@ -29,10 +30,25 @@ using node_ptr = basic_node_ptr<node_header>;
 template <class Header, class Db>
 [[nodiscard]] auto make_db_leaf_ptr(art_key, value_view, Db &);
 
+template <class>
+class basic_sorted_tree_builder;  // IWYU pragma: keep
+
 struct impl_helpers;
 
+class shared_node_refs;
+
+class frozen_image_writer;  // IWYU pragma: keep
+
+class compact_tree_source;  // IWYU pragma: keep
+
 }  // namespace detail
 
+class frozen_db;  // IWYU pragma: keep
+
+class compact_db;  // IWYU pragma: keep
+
+class write_ahead_log;  // IWYU pragma: keep
+
 class db final {
  public:
   using get_result = std::optional<value_view>;
@@ -40,29 +56,95 @@ class db final {
   // Creation and destruction
   db() noexcept = default;
 
+  // Create a tree whose top direct_mapped_key_bytes key bytes (at most two)
+  // index a flat table of subtree roots instead of tree nodes, which is
+  // beneficial for dense key spaces. Zero disables the table. The table is not
+  // included in the memory use stats.
+  explicit db(unsigned direct_mapped_key_bytes);
+
+  // Create a tree whose inodes shrink on deletes according to policy
+  explicit db(shrink_policy policy) noexcept;
+
+  // Create a copy of other in time independent of its size, sharing all its
+  // nodes. Afterwards, an insert or remove copies the shared nodes on the path
+  // to the changed key first, so that the trees never see each other's
+  // changes. Afterwards, each tree may be used by a different thread than the
+  // others, as the node sharing state is synchronized, but the copying itself
+  // must not run concurrently with any other use of other. The direct-mapped
+  // top-level table, if any, is copied in full. The log attachment is not
+  // copied.
+  db(const db &other);
+
+  // Take over the tree of other, together with its stats, direct-mapped
+  // top-level table, and log attachment, in constant time. Other is left empty
+  // and without the table.
+  db(db &&other) noexcept;
+
   ~db() noexcept;
 
-  // TODO(laurynas): implement copy and move operations
-  db(const db &) = delete;
-  db(db &&) = delete;
-  db &operator=(const db &) = delete;
-  db &operator=(db &&) = delete;
+  // Replace the tree with a copy of other, as the copy constructor
+  db &operator=(const db &other);
+
+  // Replace the tree with the one of other, as the move constructor
+  db &operator=(db &&other) noexcept;
+
+  // Exchange the trees, together with their stats, direct-mapped top-level
+  // tables, and log attachments, in constant time
+  void swap(db &other) noexcept;
 
   // Querying
   [[nodiscard, gnu::pure]] get_result get(key search_key) const noexcept;
 
   [[nodiscard, gnu::pure]] auto empty() const noexcept {
-    return root == nullptr;
+    return UNODB_DETAIL_LIKELY(direct_map == nullptr)
+               ? root == nullptr
+               : node_counts[as_i<node_type::LEAF>] == 0;
   }
 
   // Modifying
   // Cannot be called during stack unwinding with std::uncaught_exceptions() > 0
+  // If a log is attached, the successful inserts and removes are logged, and
+  // they return once durable as requested by the log. If logging throws, the
+  // operation has been applied to the tree, but not logged.
   [[nodiscard]] bool insert(key insert_key, value_view v);
 
   [[nodiscard]] bool remove(key remove_key);
 
+  // Not logged
   void clear() noexcept;
 
+  // Logging
+
+  // Log all the following successful inserts and removes to log, or stop
+  // logging if it is nullptr. The log must outlive the tree or be detached.
+  constexpr void attach_log(write_ahead_log *log_) noexcept { log = log_; }
+
+  // Snapshots
+
+  // Write all the keys and values to os in a compact binary format, in key
+  // order. Stream errors are left in the stream state.
+  void save(std::ostream &os) const;
+
+  // Replace the tree contents with a snapshot written by save of any ART
+  // class. The tree is built bottom-up from the ordered keys, with every inode
+  // allocated once at its final size. Throws std::runtime_error on a truncated
+  // or invalid snapshot, leaving the tree empty.
+  void load(std::istream &is);
+
+  // Replace the tree contents with the result of applying all the operations
+  // of a write-ahead log to an empty tree. The final contents are computed
+  // first, and the tree is built as by load. Throws std::runtime_error on an
+  // invalid log, leaving the tree empty. A record cut short by a crash ends
+  // the log.
+  void replay(std::istream &log_is);
+
+  // Replace the tree contents with a snapshot or an olc_db checkpoint, with
+  // the operations of the log records after start_lsn applied to it. Throws
+  // std::runtime_error as load and replay, and if the log ends before
+  // start_lsn.
+  void replay(std::istream &checkpoint_is, std::istream &log_is,
+              std::uint64_t start_lsn);
+
   // Stats
 
   // Return current memory use by tree nodes in bytes.
@@ -71,6 +153,18 @@ class db final {
     return current_memory_use;
   }
 
+  // Return the part of the current memory use in nodes that are not shared
+  // with any copy of this tree. The nodes below a shared one are shared too,
+  // thus only the rest of the tree is walked. Other threads modifying copies
+  // meanwhile may make the result out of date.
+  [[nodiscard]] std::size_t get_exclusive_memory_use() const;
+
+  // Return the part of the current memory use in nodes shared with copies of
+  // this tree, walking the tree as get_exclusive_memory_use
+  [[nodiscard]] std::size_t get_shared_memory_use() const {
+    return current_memory_use - get_exclusive_memory_use();
+  }
+
   template <node_type NodeType>
   [[nodiscard, gnu::pure]] constexpr auto get_node_count() const noexcept {
     return node_counts[as_i<NodeType>];
@@ -117,8 +211,45 @@ class db final {
   [[gnu::cold]] UNODB_DETAIL_NOINLINE void dump(std::ostream &os) const;
 
  private:
+  [[nodiscard]] const detail::node_ptr &root_for(
+      detail::art_key k) const noexcept {
+    return UNODB_DETAIL_LIKELY(direct_map == nullptr)
+               ? root
+               : direct_map[detail::direct_map_index(
+                     k, direct_mapped_key_bytes)];
+  }
+
+  [[nodiscard]] detail::node_ptr &root_for(detail::art_key k) noexcept {
+    return UNODB_DETAIL_LIKELY(direct_map == nullptr)
+               ? root
+               : direct_map[detail::direct_map_index(
+                     k, direct_mapped_key_bytes)];
+  }
+
   void delete_root_subtree() noexcept;
 
+  // Whether any node of this tree may be shared with its copies
+  [[nodiscard]] bool may_share_nodes() const noexcept;
+
+  // Copy the nodes shared with copies of this tree on the path to k, so that
+  // the following insert or remove of k changes only the nodes of this tree.
+  // For a remove, also copy the leaf of k and, if its parent will be merged
+  // with its other child, that child, whose key prefix is then extended.
+  void unshare_path(detail::art_key k, bool for_remove);
+
+  [[nodiscard]] bool insert_internal(detail::art_key k, value_view v);
+
+  [[nodiscard]] bool remove_internal(detail::art_key k);
+
+  // Build the tree bottom-up from the keys and values of reader, given in
+  // increasing key order
+  template <class Reader>
+  void build_from(Reader &reader);
+
+  // Call visitor.add with every key and value, in increasing key order
+  template <class Visitor>
+  void for_each_key_value(Visitor &visitor) const;
+
   constexpr void increase_memory_use(std::size_t delta) noexcept {
     UNODB_DETAIL_ASSERT(delta > 0);
 
@@ -156,8 +287,35 @@ class db final {
   template <node_type NodeType>
   constexpr void account_shrinking_inode() noexcept;
 
+  // Forget the last insert position, must be called on any tree change other
+  // than an insert.
+  constexpr void reset_insert_hint() noexcept { insert_hint = nullptr; }
+
+  constexpr void set_insert_hint(detail::node_ptr *node,
+                                 detail::tree_depth depth,
+                                 detail::art_key k) noexcept {
+    insert_hint = node;
+    insert_hint_depth = depth;
+    insert_hint_key = k;
+  }
+
   detail::node_ptr root{nullptr};
 
+  // The node pointer where the last insert modified the tree, its tree depth,
+  // and the inserted key. An insert sharing the first insert_hint_depth bytes
+  // with insert_hint_key takes the same path down to insert_hint, so it starts
+  // there instead of at the root. This makes increasing key inserts skip the
+  // upper tree levels.
+  detail::node_ptr *insert_hint{nullptr};
+  detail::tree_depth insert_hint_depth{};
+  detail::art_key insert_hint_key{};
+
+  unsigned direct_mapped_key_bytes{0};
+
+  shrink_policy node_shrink_policy{shrink_policy::EAGER};
+
+  std::unique_ptr<detail::node_ptr[]> direct_map;
+
   std::size_t current_memory_use{0};
 
   node_type_counter_array node_counts{};
@@ -166,6 +324,13 @@ class db final {
 
   std::uint64_t key_prefix_splits{0};
 
+  write_ahead_log *log{nullptr};
+
+  // The reference counts of the nodes shared by this tree and its copies, if
+  // it has ever been copied or is a copy. Mutable, because copying a tree
+  // creates them.
+  mutable std::shared_ptr<detail::shared_node_refs> node_refs;
+
   friend auto detail::make_db_leaf_ptr<detail::node_header, db>(detail::art_key,
                                                                 value_view,
                                                                 db &);
@@ -180,9 +345,18 @@ class db final {
   template <class, class>
   friend class detail::basic_db_inode_deleter;
 
+  template <class>
+  friend class detail::basic_sorted_tree_builder;
+
   friend struct detail::impl_helpers;
+
+  friend class frozen_db;
+
+  friend class compact_db;
 };
 
+inline void swap(db &a, db &b) noexcept { a.swap(b); }
+
 }  // namespace unodb
 
 #endif  // UNODB_DETAIL_ART_HPP
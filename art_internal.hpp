@@ -9,11 +9,14 @@
 #include <cstdint>
 #include <cstring>
 #include <iosfwd>
+#include <limits>
 #include <memory>       // IWYU pragma: keep
+#include <stdexcept>
 #include <type_traits>  // IWYU pragma: keep
 
 #include "art_common.hpp"
 #include "assert.hpp"
+#include "node_arena.hpp"
 #include "node_type.hpp"
 
 namespace unodb::detail {
@@ -52,6 +55,22 @@ struct [[nodiscard]] basic_art_key final {
     return key;
   }
 
+  // The key this was made from, as make_binary_comparable is its own inverse
+  [[nodiscard, gnu::pure]] UNODB_DETAIL_CONSTEXPR_NOT_MSVC KeyType
+  original_key() const noexcept {
+    return make_binary_comparable(key);
+  }
+
+  [[nodiscard, gnu::pure]] constexpr bool shares_leading_bytes(
+      basic_art_key<KeyType> key2, std::size_t num_bytes) const noexcept {
+    UNODB_DETAIL_ASSERT(num_bytes <= size);
+    // Like shift_right, the leading key bytes are the low-order ones
+    const auto mask = UNODB_DETAIL_UNLIKELY(num_bytes == size)
+                          ? ~KeyType{0}
+                          : (KeyType{1} << (num_bytes * 8)) - 1;
+    return ((key ^ key2.key) & mask) == 0;
+  }
+
   constexpr void shift_right(const std::size_t num_bytes) noexcept {
     UNODB_DETAIL_ASSERT(num_bytes <= size);
     key >>= (num_bytes * 8);
@@ -108,6 +127,37 @@ class [[nodiscard]] tree_depth final {
   value_type value;
 };
 
+// A direct-mapped top-level table replaces the first tree levels with an array
+// of subtree roots, indexed by the most significant key bytes. The subtrees
+// start at the tree depth of the direct-mapped key byte count.
+inline constexpr unsigned max_direct_mapped_key_bytes = 2;
+
+[[nodiscard]] inline unsigned checked_direct_mapped_key_bytes(
+    unsigned key_bytes) {
+  if (UNODB_DETAIL_UNLIKELY(key_bytes > max_direct_mapped_key_bytes)) {
+    throw std::invalid_argument(
+        "Direct-mapped top-level table may index at most two key bytes");
+  }
+  return key_bytes;
+}
+
+[[nodiscard, gnu::const]] constexpr std::size_t direct_map_size(
+    unsigned key_bytes) noexcept {
+  UNODB_DETAIL_ASSERT(key_bytes > 0);
+  UNODB_DETAIL_ASSERT(key_bytes <= max_direct_mapped_key_bytes);
+  return std::size_t{1} << (key_bytes * 8U);
+}
+
+[[nodiscard, gnu::const]] constexpr std::size_t direct_map_index(
+    art_key k, unsigned key_bytes) noexcept {
+  UNODB_DETAIL_ASSERT(key_bytes > 0);
+  UNODB_DETAIL_ASSERT(key_bytes <= max_direct_mapped_key_bytes);
+  std::size_t result = 0;
+  for (unsigned i = 0; i < key_bytes; ++i)
+    result = (result << 8U) | static_cast<std::uint8_t>(k[i]);
+  return result;
+}
+
 template <class Header, class Db>
 class basic_db_leaf_deleter {
  public:
@@ -157,14 +207,13 @@ class [[nodiscard]] basic_node_ptr {
   // cppcheck-suppress uninitMemberVar
   constexpr basic_node_ptr() noexcept = default;
 
-  explicit basic_node_ptr(std::nullptr_t) noexcept
-      : tagged_ptr{reinterpret_cast<std::uintptr_t>(nullptr)} {}
+  explicit basic_node_ptr(std::nullptr_t) noexcept : tagged_ptr{null_val} {}
 
   basic_node_ptr(header_type *ptr, unodb::node_type type) noexcept
       : tagged_ptr{tag_ptr(ptr, type)} {}
 
   basic_node_ptr<Header> &operator=(std::nullptr_t) noexcept {
-    tagged_ptr = reinterpret_cast<std::uintptr_t>(nullptr);
+    tagged_ptr = null_val;
     return *this;
   }
 
@@ -178,26 +227,61 @@ class [[nodiscard]] basic_node_ptr {
 
   template <class T>
   [[nodiscard, gnu::pure]] auto *ptr() const noexcept {
+#ifdef UNODB_DETAIL_COMPRESSED_NODE_PTRS
+    const auto offset = std::uint64_t{tagged_ptr & ptr_bit_mask}
+                        << offset_shift;
+    // Masking instead of branching on null keeps the decoding branch-free, and
+    // keeps GCC from warning about a null pointer path through dereferences
+    const auto base_mask = std::uintptr_t{0} - std::uintptr_t{offset != 0};
+    return reinterpret_cast<T>(
+        (reinterpret_cast<std::uintptr_t>(node_arena::base) & base_mask) +
+        offset);
+#else
     return reinterpret_cast<T>(tagged_ptr & ptr_bit_mask);
+#endif
   }
 
   [[nodiscard, gnu::pure]] auto operator==(std::nullptr_t) const noexcept {
-    return tagged_ptr == reinterpret_cast<std::uintptr_t>(nullptr);
+    return tagged_ptr == null_val;
   }
 
   [[nodiscard, gnu::pure]] auto operator!=(std::nullptr_t) const noexcept {
-    return tagged_ptr != reinterpret_cast<std::uintptr_t>(nullptr);
+    return tagged_ptr != null_val;
   }
 
  private:
-  std::uintptr_t tagged_ptr;
+#ifdef UNODB_DETAIL_COMPRESSED_NODE_PTRS
+  // The node offset in the node arena, shifted right by offset_shift. The
+  // shift leaves the low bits, which are zero for node_arena::granule aligned
+  // offsets, for the tag.
+  using value_type = std::uint32_t;
+
+  static constexpr auto offset_shift = 2U;
+
+  static constexpr value_type null_val = 0;
+#else
+  using value_type = std::uintptr_t;
+
+  static constexpr value_type null_val = 0;
+#endif
+
+  value_type tagged_ptr;
 
-  [[nodiscard, gnu::const]] static std::uintptr_t tag_ptr(
+  [[nodiscard, gnu::const]] static value_type tag_ptr(
       Header *ptr_, unodb::node_type tag) noexcept {
-    const auto uintptr = reinterpret_cast<std::uintptr_t>(ptr_);
+#ifdef UNODB_DETAIL_COMPRESSED_NODE_PTRS
+    UNODB_DETAIL_ASSERT(node_arena::contains(ptr_));
+    const auto offset = static_cast<std::uint64_t>(
+        reinterpret_cast<std::byte *>(ptr_) - node_arena::base);
+    UNODB_DETAIL_ASSERT(offset % node_arena::granule == 0);
+    const auto shifted_offset = static_cast<value_type>(offset >> offset_shift);
+#else
+    const auto shifted_offset = reinterpret_cast<value_type>(ptr_);
+#endif
     const auto result =
-        uintptr | static_cast<std::underlying_type_t<decltype(tag)>>(tag);
-    UNODB_DETAIL_ASSERT((result & ptr_bit_mask) == uintptr);
+        shifted_offset |
+        static_cast<std::underlying_type_t<decltype(tag)>>(tag);
+    UNODB_DETAIL_ASSERT((result & ptr_bit_mask) == shifted_offset);
     return result;
   }
 
@@ -206,13 +290,20 @@ class [[nodiscard]] basic_node_ptr {
     return count < 2 ? 1 : 1 + mask_bits_needed(count >> 1U);
   }
 
-  static constexpr auto lowest_non_tag_bit =
-      1ULL << mask_bits_needed(node_type_count);
-  static constexpr auto tag_bit_mask = lowest_non_tag_bit - 1;
-  static constexpr auto ptr_bit_mask = ~tag_bit_mask;
+  static constexpr value_type lowest_non_tag_bit =
+      value_type{1} << mask_bits_needed(node_type_count);
+  static constexpr value_type tag_bit_mask = lowest_non_tag_bit - 1;
+  static constexpr value_type ptr_bit_mask = ~tag_bit_mask;
 
   static auto static_asserts() {
+#ifdef UNODB_DETAIL_COMPRESSED_NODE_PTRS
+    static_assert(sizeof(basic_node_ptr<Header>) == sizeof(std::uint32_t));
+    static_assert((node_arena::granule >> offset_shift) >= lowest_non_tag_bit);
+    static_assert((node_arena::capacity >> offset_shift) - 1 <=
+                  std::numeric_limits<value_type>::max());
+#else
     static_assert(sizeof(basic_node_ptr<Header>) == sizeof(void *));
+#endif
     static_assert(alignof(header_type) - 1 > lowest_non_tag_bit);
   }
 };
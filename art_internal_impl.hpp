@@ -8,6 +8,7 @@
 #include <array>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <iostream>
 #include <limits>
 #include <memory>
@@ -17,11 +18,6 @@
 
 #ifdef UNODB_DETAIL_X86_64
 #include <emmintrin.h>
-#ifdef UNODB_DETAIL_AVX2
-#include <immintrin.h>
-#elif defined(UNODB_DETAIL_SSE4_2)
-#include <smmintrin.h>
-#endif
 #elif defined(__aarch64__)
 #include <arm_neon.h>
 #endif
@@ -32,8 +28,11 @@
 #include "art_internal.hpp"
 #include "assert.hpp"
 #include "heap.hpp"
+#include "node_arena.hpp"
 #include "node_type.hpp"
+#include "portability_arch.hpp"
 #include "portability_builtins.hpp"
+#include "simd_kernels.hpp"
 
 namespace unodb {
 class db;
@@ -52,15 +51,7 @@ basic_art_key<std::uint64_t>::make_binary_comparable(std::uint64_t k) noexcept {
 #endif
 }
 
-#ifdef UNODB_DETAIL_X86_64
-
-// Idea from https://stackoverflow.com/a/32945715/80458
-[[nodiscard, gnu::const]] inline auto _mm_cmple_epu8(__m128i x,
-                                                     __m128i y) noexcept {
-  return _mm_cmpeq_epi8(_mm_max_epu8(y, x), y);
-}
-
-#elif !defined(__aarch64__)
+#if !defined(UNODB_DETAIL_X86_64) && !defined(__aarch64__)
 
 // From public domain
 // https://graphics.stanford.edu/~seander/bithacks.html
@@ -74,7 +65,7 @@ basic_art_key<std::uint64_t>::make_binary_comparable(std::uint64_t k) noexcept {
   return has_zero_byte(v ^ (~0U / 255 * static_cast<std::uint8_t>(b)));
 }
 
-#endif  // #ifdef UNODB_DETAIL_X86_64
+#endif  // #if !defined(UNODB_DETAIL_X86_64) && !defined(__aarch64__)
 
 template <class Header>
 class [[nodiscard]] basic_leaf final : public Header {
@@ -137,7 +128,7 @@ template <class Header, class Db>
       gsl::narrow_cast<typename leaf_type::value_size_type>(v.size()));
 
   auto *const leaf_mem = static_cast<std::byte *>(
-      allocate_aligned(size, alignment_for_new<leaf_type>()));
+      allocate_node(size, alignment_for_new<leaf_type>()));
 
   db.increment_leaf_count(size);
 
@@ -145,18 +136,22 @@ template <class Header, class Db>
       new (leaf_mem) leaf_type{k, v}, basic_db_leaf_deleter<Header, Db>{db}};
 }
 
-template <class INode, class Node4, class Node16, class Node48, class Node256>
+template <class INodeHeader, class INode, class Node4, class Node16,
+          class Node32, class Node48, class Node256>
 struct basic_inode_def final {
+  using header_type = INodeHeader;
   using inode = INode;
   using n4 = Node4;
   using n16 = Node16;
+  using n32 = Node32;
   using n48 = Node48;
   using n256 = Node256;
 
   template <class Node>
   [[nodiscard]] static constexpr bool is_inode() noexcept {
     return std::is_same_v<Node, n4> || std::is_same_v<Node, n16> ||
-           std::is_same_v<Node, n48> || std::is_same_v<Node, n256>;
+           std::is_same_v<Node, n32> || std::is_same_v<Node, n48> ||
+           std::is_same_v<Node, n256>;
   }
 
   basic_inode_def() = delete;
@@ -168,7 +163,7 @@ inline void basic_db_leaf_deleter<Header, Db>::operator()(
     leaf_type *to_delete) const noexcept {
   const auto leaf_size = to_delete->get_size();
 
-  free_aligned(to_delete);
+  free_node(to_delete);
 
   db.decrement_leaf_count(leaf_size);
 }
@@ -178,7 +173,7 @@ inline void basic_db_inode_deleter<INode, Db>::operator()(
     INode *inode_ptr) noexcept {
   static_assert(std::is_trivially_destructible_v<INode>);
 
-  free_aligned(inode_ptr);
+  free_node(inode_ptr);
 
   db.template decrement_inode_count<INode>();
 }
@@ -191,9 +186,15 @@ struct basic_art_policy final {
   using header_type = typename NodePtr::header_type;
 
   using inode_defs = INodeDefs;
+  // Internal nodes may have a larger header than leaves, i.e. if they need a
+  // lock. It must still convert to the common node pointer header.
+  using inode_header_type = typename inode_defs::header_type;
+  static_assert(std::is_base_of_v<header_type, inode_header_type>);
+
   using inode = typename inode_defs::inode;
   using inode4_type = typename inode_defs::n4;
   using inode16_type = typename inode_defs::n16;
+  using inode32_type = typename inode_defs::n32;
   using inode48_type = typename inode_defs::n48;
   using inode256_type = typename inode_defs::n256;
 
@@ -217,6 +218,7 @@ struct basic_art_policy final {
 
   using db_inode4_unique_ptr = db_inode_unique_ptr<inode4_type>;
   using db_inode16_unique_ptr = db_inode_unique_ptr<inode16_type>;
+  using db_inode32_unique_ptr = db_inode_unique_ptr<inode32_type>;
   using db_inode48_unique_ptr = db_inode_unique_ptr<inode48_type>;
   using db_inode256_unique_ptr = db_inode_unique_ptr<inode256_type>;
 
@@ -240,11 +242,20 @@ struct basic_art_policy final {
 
   UNODB_DETAIL_DISABLE_GCC_11_WARNING("-Wmismatched-new-delete")
   UNODB_DETAIL_DISABLE_MSVC_WARNING(26409)
+  // Internal nodes larger than a cache line start at one, so that their
+  // layouts map the lookup fields to a fixed cache line, see find_child.
+  template <class INode>
+  [[nodiscard]] static constexpr std::size_t inode_alignment() noexcept {
+    return (sizeof(INode) > hardware_constructive_interference_size)
+               ? hardware_constructive_interference_size
+               : alignment_for_new<INode>();
+  }
+
   template <class INode, class... Args>
   [[nodiscard]] static auto make_db_inode_unique_ptr(Db &db_instance,
                                                      Args &&...args) {
     auto *const inode_mem = static_cast<std::byte *>(
-        allocate_aligned(sizeof(INode), alignment_for_new<INode>()));
+        allocate_node(sizeof(INode), inode_alignment<INode>()));
 
     db_instance.template increment_inode_count<INode>();
 
@@ -298,6 +309,11 @@ struct basic_art_policy final {
               node_ptr.template ptr<inode16_type *>(), db)};
           return;
         }
+        case node_type::I32: {
+          const auto r{make_db_inode_unique_ptr(
+              node_ptr.template ptr<inode32_type *>(), db)};
+          return;
+        }
         case node_type::I48: {
           const auto r{make_db_inode_unique_ptr(
               node_ptr.template ptr<inode48_type *>(), db)};
@@ -341,6 +357,11 @@ struct basic_art_policy final {
         subtree_ptr->delete_subtree(db_instance);
         return;
       }
+      case node_type::I32: {
+        auto *const subtree_ptr{node.template ptr<inode32_type *>()};
+        subtree_ptr->delete_subtree(db_instance);
+        return;
+      }
       case node_type::I48: {
         auto *const subtree_ptr{node.template ptr<inode48_type *>()};
         subtree_ptr->delete_subtree(db_instance);
@@ -354,6 +375,38 @@ struct basic_art_policy final {
     }
   }
 
+  // Call func with every leaf below node, in increasing key order. Not for use
+  // concurrently with tree modifications.
+  template <typename Function>
+  static void for_each_leaf(NodePtr node, Function &func) {
+    const auto visit_child = [&func](unsigned, NodePtr child) {
+      for_each_leaf(child, func);
+    };
+
+    switch (node.type()) {
+      case node_type::LEAF:
+        func(*node.template ptr<const leaf_type *>());
+        return;
+      case node_type::I4:
+        node.template ptr<const inode4_type *>()->for_each_child(visit_child);
+        return;
+      case node_type::I16:
+        node.template ptr<const inode16_type *>()->for_each_child(visit_child);
+        return;
+      case node_type::I32:
+        node.template ptr<const inode32_type *>()->for_each_child(visit_child);
+        return;
+      case node_type::I48:
+        node.template ptr<const inode48_type *>()->for_each_child(visit_child);
+        return;
+      case node_type::I256:
+        node.template ptr<const inode256_type *>()->for_each_child(
+            visit_child);
+        return;
+    }
+    UNODB_DETAIL_CANNOT_HAPPEN();  // LCOV_EXCL_LINE
+  }
+
   [[gnu::cold]] UNODB_DETAIL_NOINLINE static void dump_node(
       std::ostream &os, const NodePtr &node) {
     os << "node at: " << node.template ptr<void *>() << ", tagged ptr = 0x"
@@ -376,6 +429,10 @@ struct basic_art_policy final {
         os << "I16";
         node.template ptr<inode16_type *>()->dump(os);
         break;
+      case node_type::I32:
+        os << "I32";
+        node.template ptr<inode32_type *>()->dump(os);
+        break;
       case node_type::I48:
         os << "I48";
         node.template ptr<inode48_type *>()->dump(os);
@@ -390,6 +447,11 @@ struct basic_art_policy final {
   basic_art_policy() = delete;
 };
 
+// An inode key prefix of up to max_length bytes. Only the first
+// key_prefix_capacity bytes of it are stored, together with the full length.
+// The rest, if any, are in the keys of every leaf below the node. Lookups skip
+// the bytes that are not stored and verify them against the leaf key at the
+// end, and inserts read them from the key of any leaf below.
 template <template <class> class CriticalSectionPolicy>
 union [[nodiscard]] key_prefix {
  private:
@@ -398,10 +460,22 @@ union [[nodiscard]] key_prefix {
 
   using key_prefix_size = std::uint8_t;
 
-  static constexpr key_prefix_size key_prefix_capacity = 7;
+ public:
+  // Every key byte but the last one, which selects a child
+  static constexpr key_prefix_size max_length = art_key::size - 1;
+
+#ifdef UNODB_DETAIL_KEY_PREFIX_CAPACITY
+  static constexpr key_prefix_size key_prefix_capacity =
+      UNODB_DETAIL_KEY_PREFIX_CAPACITY;
+#else
+  static constexpr key_prefix_size key_prefix_capacity = max_length;
+#endif
+  static_assert(key_prefix_capacity > 0);
+  static_assert(key_prefix_capacity <= max_length);
 
+ private:
   using key_prefix_data =
-      std::array<critical_section_policy<std::byte>, key_prefix_capacity>;
+      std::array<critical_section_policy<std::byte>, max_length>;
 
   struct [[nodiscard]] inode_fields {
     key_prefix_data key_prefix;
@@ -410,44 +484,90 @@ union [[nodiscard]] key_prefix {
   critical_section_policy<std::uint64_t> u64;
 
  public:
+  // Empty key prefix
+  key_prefix() noexcept : u64{0} {}
+
   key_prefix(art_key k1, art_key shifted_k2, tree_depth depth) noexcept
       : u64{make_u64(k1, shifted_k2, depth)} {}
 
   key_prefix(unsigned key_prefix_len,
              const key_prefix &source_key_prefix) noexcept
-      : u64{(source_key_prefix.u64 & key_bytes_mask) |
+      : u64{(source_key_prefix.u64 & stored_bytes_mask(key_prefix_len)) |
             length_to_word(key_prefix_len)} {
-    UNODB_DETAIL_ASSERT(key_prefix_len <= key_prefix_capacity);
+    UNODB_DETAIL_ASSERT(key_prefix_len <= source_key_prefix.length());
   }
 
   key_prefix(const key_prefix &other) noexcept : u64{other.u64.load()} {}
 
+  // The first key_prefix_len bytes of shifted_key
+  key_prefix(art_key shifted_key, unsigned key_prefix_len) noexcept
+      : u64{(static_cast<std::uint64_t>(shifted_key) &
+             stored_bytes_mask(key_prefix_len)) |
+            length_to_word(key_prefix_len)} {}
+
   ~key_prefix() noexcept = default;
 
+  // Compare the stored key prefix bytes only. If all of them match and the key
+  // prefix is not complete, the rest is unknown.
   [[nodiscard]] constexpr auto get_shared_length(
       unodb::detail::art_key shifted_key) const noexcept {
-    return shared_len(static_cast<std::uint64_t>(shifted_key), u64, length());
+    return shared_len(static_cast<std::uint64_t>(shifted_key), u64,
+                      stored_length());
+  }
+
+  // Compare the full key prefix, taking it from shifted_leaf_key, the key of
+  // any leaf below this node shifted to its depth.
+  [[nodiscard]] constexpr auto get_shared_length(
+      unodb::detail::art_key shifted_key,
+      unodb::detail::art_key shifted_leaf_key) const noexcept {
+    return shared_len(static_cast<std::uint64_t>(shifted_key),
+                      static_cast<std::uint64_t>(shifted_leaf_key), length());
   }
 
   [[nodiscard]] constexpr unsigned length() const noexcept {
     const auto result = f.key_prefix_length.load();
-    UNODB_DETAIL_ASSERT(result <= key_prefix_capacity);
+    UNODB_DETAIL_ASSERT(result <= max_length);
     return result;
   }
 
-  constexpr void cut(unsigned cut_len) noexcept {
+  [[nodiscard]] constexpr unsigned stored_length() const noexcept {
+    if constexpr (key_prefix_capacity == max_length) {
+      return length();
+    } else {
+      const auto result = length();
+      return (result < key_prefix_capacity) ? result : key_prefix_capacity;
+    }
+  }
+
+  // Whether all the key prefix bytes are stored in the node
+  [[nodiscard]] constexpr bool is_complete() const noexcept {
+    if constexpr (key_prefix_capacity == max_length) {
+      return true;
+    } else {
+      return length() <= key_prefix_capacity;
+    }
+  }
+
+  // Remove the first cut_len bytes, taking the ones that become stored from
+  // shifted_leaf_key, the key of any leaf below this node shifted to its depth
+  constexpr void cut(unsigned cut_len,
+                     unodb::detail::art_key shifted_leaf_key) noexcept {
     UNODB_DETAIL_ASSERT(cut_len > 0);
     UNODB_DETAIL_ASSERT(cut_len <= length());
+    UNODB_DETAIL_ASSERT(get_shared_length(shifted_leaf_key) ==
+                        stored_length());
 
-    u64 = ((u64 >> (cut_len * 8)) & key_bytes_mask) |
-          length_to_word(length() - cut_len);
-
-    UNODB_DETAIL_ASSERT(f.key_prefix_length.load() <= key_prefix_capacity);
+    const auto new_length = length() - cut_len;
+    u64 = ((static_cast<std::uint64_t>(shifted_leaf_key) >> (cut_len * 8)) &
+           stored_bytes_mask(new_length)) |
+          length_to_word(new_length);
   }
 
+  // Prepend prefix1 and prefix2 to this key prefix. All the stored bytes of the
+  // result are in the stored bytes of the parts.
   constexpr void prepend(const key_prefix &prefix1,
                          std::byte prefix2) noexcept {
-    UNODB_DETAIL_ASSERT(length() + prefix1.length() < key_prefix_capacity);
+    UNODB_DETAIL_ASSERT(length() + prefix1.length() < max_length);
 
     const auto prefix1_bit_length = prefix1.length() * 8U;
     const auto prefix1_mask = (1ULL << prefix1_bit_length) - 1;
@@ -458,24 +578,22 @@ union [[nodiscard]] key_prefix {
     const auto shifted_prefix2 = static_cast<std::uint64_t>(prefix2)
                                  << prefix1_bit_length;
     const auto masked_prefix1 = prefix1.u64 & prefix1_mask;
+    const auto new_length = length() + prefix1.length() + 1;
 
-    u64 = shifted_prefix3 | shifted_prefix2 | masked_prefix1 |
-          length_to_word(length() + prefix1.length() + 1);
-
-    UNODB_DETAIL_ASSERT(f.key_prefix_length.load() <= key_prefix_capacity);
-  }
-
-  [[nodiscard]] constexpr auto byte_at(std::size_t i) const noexcept {
-    UNODB_DETAIL_ASSERT(i < length());
-    return f.key_prefix[i].load();
+    u64 = ((shifted_prefix3 | shifted_prefix2 | masked_prefix1) &
+           stored_bytes_mask(new_length)) |
+          length_to_word(new_length);
   }
 
   [[gnu::cold]] UNODB_DETAIL_NOINLINE void dump(std::ostream &os) const {
     const auto len = length();
     os << ", key prefix len = " << len;
-    if (len > 0) {
+    const auto stored_len = stored_length();
+    if (stored_len > 0) {
       os << ", key prefix =";
-      for (std::size_t i = 0; i < len; ++i) dump_byte(os, f.key_prefix[i]);
+      for (std::size_t i = 0; i < stored_len; ++i)
+        dump_byte(os, f.key_prefix[i]);
+      if (stored_len < len) os << " ...";
     }
   }
 
@@ -484,14 +602,21 @@ union [[nodiscard]] key_prefix {
   key_prefix &operator=(key_prefix &&) = delete;
 
  private:
-  static constexpr auto key_bytes_mask = 0x00FF'FFFF'FFFF'FFFFULL;
-
   [[nodiscard, gnu::const]] static constexpr std::uint64_t length_to_word(
       unsigned length) {
-    UNODB_DETAIL_ASSERT(length <= key_prefix_capacity);
+    UNODB_DETAIL_ASSERT(length <= max_length);
     return static_cast<std::uint64_t>(length) << 56U;
   }
 
+  // The mask of the stored key bytes of a key prefix of length bytes
+  [[nodiscard, gnu::const]] static constexpr std::uint64_t stored_bytes_mask(
+      unsigned length) {
+    UNODB_DETAIL_ASSERT(length <= max_length);
+    const auto stored_len =
+        (length < key_prefix_capacity) ? length : key_prefix_capacity;
+    return (1ULL << (stored_len * 8U)) - 1;
+  }
+
   [[nodiscard, gnu::const]] static constexpr unsigned shared_len(
       std::uint64_t k1, std::uint64_t k2, unsigned clamp_byte_pos) noexcept {
     UNODB_DETAIL_ASSERT(clamp_byte_pos < 8);
@@ -505,11 +630,11 @@ union [[nodiscard]] key_prefix {
       art_key k1, art_key shifted_k2, tree_depth depth) noexcept {
     k1.shift_right(depth);
 
-    const auto k1_u64 = static_cast<std::uint64_t>(k1) & key_bytes_mask;
+    const auto k1_u64 = static_cast<std::uint64_t>(k1);
+    const auto length =
+        shared_len(k1_u64, static_cast<std::uint64_t>(shifted_k2), max_length);
 
-    return k1_u64 | length_to_word(shared_len(
-                        k1_u64, static_cast<std::uint64_t>(shifted_k2),
-                        key_prefix_capacity));
+    return (k1_u64 & stored_bytes_mask(length)) | length_to_word(length);
   }
 };
 
@@ -522,7 +647,7 @@ class fake_inode final {
 };
 
 template <class ArtPolicy>
-class basic_inode_impl : public ArtPolicy::header_type {
+class basic_inode_impl : public ArtPolicy::inode_header_type {
  public:
   using node_ptr = typename ArtPolicy::node_ptr;
 
@@ -544,12 +669,14 @@ class basic_inode_impl : public ArtPolicy::header_type {
   using inode_type = typename ArtPolicy::inode;
   using db_inode4_unique_ptr = typename ArtPolicy::db_inode4_unique_ptr;
   using db_inode16_unique_ptr = typename ArtPolicy::db_inode16_unique_ptr;
+  using db_inode32_unique_ptr = typename ArtPolicy::db_inode32_unique_ptr;
   using db_inode48_unique_ptr = typename ArtPolicy::db_inode48_unique_ptr;
 
  private:
   using header_type = typename ArtPolicy::header_type;
   using inode4_type = typename ArtPolicy::inode4_type;
   using inode16_type = typename ArtPolicy::inode16_type;
+  using inode32_type = typename ArtPolicy::inode32_type;
   using inode48_type = typename ArtPolicy::inode48_type;
   using inode256_type = typename ArtPolicy::inode256_type;
 
@@ -577,6 +704,9 @@ class basic_inode_impl : public ArtPolicy::header_type {
       case node_type::I16:
         return static_cast<inode16_type *>(this)->add_or_choose_subtree(
             std::forward<Args>(args)...);
+      case node_type::I32:
+        return static_cast<inode32_type *>(this)->add_or_choose_subtree(
+            std::forward<Args>(args)...);
       case node_type::I48:
         return static_cast<inode48_type *>(this)->add_or_choose_subtree(
             std::forward<Args>(args)...);
@@ -601,6 +731,9 @@ class basic_inode_impl : public ArtPolicy::header_type {
       case node_type::I16:
         return static_cast<inode16_type *>(this)->remove_or_choose_subtree(
             std::forward<Args>(args)...);
+      case node_type::I32:
+        return static_cast<inode32_type *>(this)->remove_or_choose_subtree(
+            std::forward<Args>(args)...);
       case node_type::I48:
         return static_cast<inode48_type *>(this)->remove_or_choose_subtree(
             std::forward<Args>(args)...);
@@ -628,6 +761,8 @@ class basic_inode_impl : public ArtPolicy::header_type {
         return static_cast<inode4_type *>(this)->find_child(key_byte);
       case node_type::I16:
         return static_cast<inode16_type *>(this)->find_child(key_byte);
+      case node_type::I32:
+        return static_cast<inode32_type *>(this)->find_child(key_byte);
       case node_type::I48:
         return static_cast<inode48_type *>(this)->find_child(key_byte);
       case node_type::I256:
@@ -640,8 +775,57 @@ class basic_inode_impl : public ArtPolicy::header_type {
     // LCOV_EXCL_STOP
   }
 
+  [[nodiscard]] constexpr node_ptr any_child(node_type type) const noexcept {
+    UNODB_DETAIL_ASSERT(type != node_type::LEAF);
+
+    switch (type) {
+      case node_type::I4:
+        return static_cast<const inode4_type *>(this)->any_child();
+      case node_type::I16:
+        return static_cast<const inode16_type *>(this)->any_child();
+      case node_type::I32:
+        return static_cast<const inode32_type *>(this)->any_child();
+      case node_type::I48:
+        return static_cast<const inode48_type *>(this)->any_child();
+      case node_type::I256:
+        return static_cast<const inode256_type *>(this)->any_child();
+        // LCOV_EXCL_START
+      case node_type::LEAF:
+        UNODB_DETAIL_CANNOT_HAPPEN();
+    }
+    UNODB_DETAIL_CANNOT_HAPPEN();
+    // LCOV_EXCL_STOP
+  }
+
+  // Prefetch the first cache lines a lookup of key_byte at node would read,
+  // without dereferencing it: the header, and for Node48 and Node256 the line
+  // for key_byte, assuming the node has no key prefix.
+  static void prefetch_for_lookup(node_ptr node, std::byte key_byte) noexcept {
+    const auto type = node.type();
+    detail::prefetch(node.template ptr<const void *>());
+    switch (type) {
+      case node_type::I48:
+        node.template ptr<const inode48_type *>()->prefetch_lookup_line(
+            key_byte);
+        return;
+      case node_type::I256:
+        node.template ptr<const inode256_type *>()->prefetch_lookup_line(
+            key_byte);
+        return;
+      case node_type::LEAF:
+      case node_type::I4:
+      case node_type::I16:
+      case node_type::I32:
+        return;
+    }
+    UNODB_DETAIL_CANNOT_HAPPEN();  // LCOV_EXCL_LINE
+  }
+
   UNODB_DETAIL_RESTORE_MSVC_WARNINGS()
 
+  // Empty node without key prefix
+  constexpr basic_inode_impl() noexcept : children_count{0} {}
+
   constexpr basic_inode_impl(unsigned children_count_, art_key k1,
                              art_key shifted_k2, tree_depth depth) noexcept
       : k_prefix{k1, shifted_k2, depth},
@@ -657,6 +841,11 @@ class basic_inode_impl : public ArtPolicy::header_type {
       : k_prefix{other.k_prefix},
         children_count{gsl::narrow_cast<std::uint8_t>(children_count_)} {}
 
+  constexpr basic_inode_impl(unsigned children_count_, art_key shifted_key,
+                             unsigned key_prefix_len) noexcept
+      : k_prefix{shifted_key, key_prefix_len},
+        children_count{gsl::narrow_cast<std::uint8_t>(children_count_)} {}
+
  protected:
   [[gnu::cold]] UNODB_DETAIL_NOINLINE void dump(std::ostream &os) const {
     k_prefix.dump(os);
@@ -691,6 +880,9 @@ class basic_inode_impl : public ArtPolicy::header_type {
   template <class>
   friend class basic_inode_16;
 
+  template <class>
+  friend class basic_inode_32;
+
   template <class>
   friend class basic_inode_48;
 
@@ -731,7 +923,24 @@ class [[nodiscard]] basic_inode : public basic_inode_impl<ArtPolicy> {
     return this->children_count == min_size;
   }
 
+  // Whether a delete from this node should shrink it
+  [[nodiscard]] constexpr bool is_min_size(
+      shrink_policy policy) const noexcept {
+    // Node4 is left with a single child in either case
+    if constexpr (NodeType == node_type::I4) {
+      return is_min_size();
+    } else {
+      return this->children_count == ((policy == shrink_policy::EAGER)
+                                          ? min_size
+                                          : hysteresis_min_size);
+    }
+  }
+
   static constexpr auto min_size = MinSize;
+  // The least children count under shrink_policy::HYSTERESIS, where MinSize - 1
+  // is the capacity of the smaller type
+  static constexpr unsigned hysteresis_min_size =
+      (NodeType == node_type::I4) ? MinSize : (MinSize - 1) * 3 / 4 + 1;
   static constexpr auto capacity = Capacity;
   static constexpr auto type = NodeType;
 
@@ -740,6 +949,8 @@ class [[nodiscard]] basic_inode : public basic_inode_impl<ArtPolicy> {
   using inode_type = typename basic_inode_impl<ArtPolicy>::inode_type;
 
  protected:
+  constexpr basic_inode() noexcept = default;
+
   constexpr basic_inode(art_key k1, art_key shifted_k2,
                         tree_depth depth) noexcept
       : basic_inode_impl<ArtPolicy>{MinSize, k1, shifted_k2, depth} {
@@ -760,12 +971,36 @@ class [[nodiscard]] basic_inode : public basic_inode_impl<ArtPolicy> {
     UNODB_DETAIL_ASSERT(is_min_size());
   }
 
+  // The children count is set by init, which runs after the source node has
+  // been locked in the case of OLC. Under shrink_policy::HYSTERESIS, the
+  // source node may have fewer children than min_size.
   explicit constexpr basic_inode(const LargerDerived &source_node) noexcept
-      : basic_inode_impl<ArtPolicy>{Capacity, source_node} {
-    // Cannot assert that source_node.is_min_size because we are creating this
-    // node optimistically in the case of OLC.
-    UNODB_DETAIL_ASSERT(is_full_for_add());
+      : basic_inode_impl<ArtPolicy>{0, source_node} {}
+
+  constexpr basic_inode(art_key shifted_key, unsigned key_prefix_len,
+                        unsigned children_count_) noexcept
+      : basic_inode_impl<ArtPolicy>{children_count_, shifted_key,
+                                    key_prefix_len} {
+    UNODB_DETAIL_ASSERT(children_count_ <= Capacity);
+  }
+};
+
+// The children of an inode that is created directly at its final size, in
+// increasing key byte order
+template <class NodePtr>
+struct [[nodiscard]] sorted_children final {
+  constexpr void append(std::byte key_byte, NodePtr child) noexcept {
+    UNODB_DETAIL_ASSERT(count < key_bytes.size());
+    UNODB_DETAIL_ASSERT(count == 0 || key_bytes[count - 1] < key_byte);
+
+    key_bytes[count] = key_byte;
+    children[count] = child;
+    ++count;
   }
+
+  unsigned count{0};
+  std::array<std::byte, 256> key_bytes;
+  std::array<NodePtr, 256> children;
 };
 
 template <class ArtPolicy>
@@ -812,10 +1047,10 @@ class basic_inode_4 : public basic_inode_4_parent<ArtPolicy> {
       : parent_class{len, *source_node.template ptr<inode_type *>()} {}
 
   constexpr basic_inode_4(db &, node_ptr source_node, unsigned len,
-                          tree_depth depth,
-                          db_leaf_unique_ptr &&child1) noexcept
+                          tree_depth depth, db_leaf_unique_ptr &&child1,
+                          art_key shifted_leaf_key) noexcept
       : parent_class{len, *source_node.template ptr<inode_type *>()} {
-    init(source_node, len, depth, std::move(child1));
+    init(source_node, len, depth, std::move(child1), shifted_leaf_key);
   }
 
   constexpr basic_inode_4(db &, const inode16_type &source_node) noexcept
@@ -827,10 +1062,19 @@ class basic_inode_4 : public basic_inode_4_parent<ArtPolicy> {
     init(db_instance, source_node, child_to_delete);
   }
 
+  constexpr basic_inode_4(db &, art_key shifted_key, unsigned key_prefix_len,
+                          const sorted_children<node_ptr> &source) noexcept
+      : parent_class{shifted_key, key_prefix_len, source.count} {
+    init(source);
+  }
+
   UNODB_DETAIL_RESTORE_MSVC_WARNINGS()
 
+  // Split the key prefix of source_node at len. shifted_leaf_key is the key of
+  // any leaf below source_node shifted to depth, which has the key prefix bytes
+  // that are not stored.
   constexpr void init(node_ptr source_node, unsigned len, tree_depth depth,
-                      db_leaf_unique_ptr &&child1) {
+                      db_leaf_unique_ptr &&child1, art_key shifted_leaf_key) {
     auto *const source_inode{source_node.template ptr<inode_type *>()};
     auto &source_key_prefix = source_inode->get_key_prefix();
     UNODB_DETAIL_ASSERT(len < source_key_prefix.length());
@@ -839,8 +1083,8 @@ class basic_inode_4 : public basic_inode_4_parent<ArtPolicy> {
         static_cast<std::remove_cv_t<decltype(art_key::size)>>(depth) + len;
     UNODB_DETAIL_ASSERT(diff_key_byte_i < art_key::size);
 
-    const auto source_node_key_byte = source_key_prefix.byte_at(len);
-    source_key_prefix.cut(len + 1);
+    const auto source_node_key_byte = shifted_leaf_key[len];
+    source_key_prefix.cut(len + 1, shifted_leaf_key);
     const auto new_key_byte = child1->get_key()[diff_key_byte_i];
     add_two_to_empty(source_node_key_byte, source_node, new_key_byte,
                      std::move(child1));
@@ -851,6 +1095,10 @@ class basic_inode_4 : public basic_inode_4_parent<ArtPolicy> {
     const auto reclaim_source_node{
         ArtPolicy::template make_db_inode_reclaimable_ptr(&source_node,
                                                           db_instance)};
+    const auto source_children_count = source_node.children_count.load();
+    this->children_count =
+        gsl::narrow_cast<std::uint8_t>(source_children_count - 1U);
+
     auto source_keys_itr = source_node.keys.byte_array.cbegin();
     auto keys_itr = keys.byte_array.begin();
     auto source_children_itr = source_node.children.cbegin();
@@ -869,15 +1117,16 @@ class basic_inode_4 : public basic_inode_4_parent<ArtPolicy> {
     ++source_children_itr;
 
     while (source_keys_itr !=
-           source_node.keys.byte_array.cbegin() + inode16_type::min_size) {
+           source_node.keys.byte_array.cbegin() + source_children_count) {
       *keys_itr++ = *source_keys_itr++;
       *children_itr++ = *source_children_itr++;
     }
 
-    UNODB_DETAIL_ASSERT(this->children_count == basic_inode_4::capacity);
-    UNODB_DETAIL_ASSERT(
-        std::is_sorted(keys.byte_array.cbegin(),
-                       keys.byte_array.cbegin() + basic_inode_4::capacity));
+    UNODB_DETAIL_ASSERT(this->children_count >= parent_class::min_size);
+    UNODB_DETAIL_ASSERT(this->children_count <= basic_inode_4::capacity);
+    UNODB_DETAIL_ASSERT(std::is_sorted(
+        keys.byte_array.cbegin(),
+        keys.byte_array.cbegin() + this->children_count.load()));
   }
 
   constexpr void init(art_key k1, art_key shifted_k2, tree_depth depth,
@@ -888,6 +1137,19 @@ class basic_inode_4 : public basic_inode_4_parent<ArtPolicy> {
                      shifted_k2[k2_next_byte_depth], std::move(child2));
   }
 
+  constexpr void init(const sorted_children<node_ptr> &source) noexcept {
+    UNODB_DETAIL_ASSERT(source.count >= parent_class::min_size);
+
+    for (unsigned i = 0; i < source.count; ++i) {
+      keys.byte_array[i] = source.key_bytes[i];
+      children[i] = source.children[i];
+    }
+#ifndef UNODB_DETAIL_X86_64
+    for (unsigned i = source.count; i < basic_inode_4::capacity; ++i)
+      keys.byte_array[i] = unused_key_byte;
+#endif
+  }
+
   constexpr void add_to_nonfull(db_leaf_unique_ptr &&child, tree_depth depth,
                                 std::uint8_t children_count_) noexcept {
     UNODB_DETAIL_ASSERT(children_count_ == this->children_count);
@@ -972,6 +1234,11 @@ class basic_inode_4 : public basic_inode_4_parent<ArtPolicy> {
     return child_to_leave_ptr;
   }
 
+  // Any child, which may be inconsistent in the case of OLC
+  [[nodiscard]] constexpr node_ptr any_child() const noexcept {
+    return children[0].load();
+  }
+
   UNODB_DETAIL_DISABLE_MSVC_WARNING(26434)
   [[nodiscard]] find_result find_child(std::byte key_byte) noexcept {
 #ifdef UNODB_DETAIL_X86_64
@@ -1038,6 +1305,18 @@ class basic_inode_4 : public basic_inode_4_parent<ArtPolicy> {
   }
   UNODB_DETAIL_RESTORE_MSVC_WARNINGS()
 
+  // Call func with the key byte and the pointer of every child, in increasing
+  // key byte order
+  template <typename Function>
+  constexpr void for_each_child(Function func) const
+      noexcept(noexcept(func(0, node_ptr{nullptr}))) {
+    const auto children_count_ = this->children_count.load();
+    for (std::uint8_t i = 0; i < children_count_; ++i) {
+      func(static_cast<std::uint8_t>(keys.byte_array[i].load()),
+           children[i].load());
+    }
+  }
+
   constexpr void delete_subtree(db &db_instance) noexcept {
     const auto children_count_ = this->children_count.load();
     for (std::uint8_t i = 0; i < children_count_; ++i) {
@@ -1098,7 +1377,11 @@ class basic_inode_4 : public basic_inode_4_parent<ArtPolicy> {
   std::array<critical_section_policy<node_ptr>, basic_inode_4::capacity>
       children;
 
+#ifdef UNODB_DETAIL_COMPRESSED_NODE_PTRS
+  static_assert(sizeof(children) == 16);
+#else
   static_assert(sizeof(children) == 32);
+#endif
 
  private:
 #ifdef UNODB_DETAIL_X86_64
@@ -1133,14 +1416,14 @@ class basic_inode_4 : public basic_inode_4_parent<ArtPolicy> {
 template <class ArtPolicy>
 using basic_inode_16_parent = basic_inode<
     ArtPolicy, 5, 16, node_type::I16, typename ArtPolicy::inode4_type,
-    typename ArtPolicy::inode48_type, typename ArtPolicy::inode16_type>;
+    typename ArtPolicy::inode32_type, typename ArtPolicy::inode16_type>;
 
 template <class ArtPolicy>
 class basic_inode_16 : public basic_inode_16_parent<ArtPolicy> {
   using parent_class = basic_inode_16_parent<ArtPolicy>;
 
   using typename parent_class::inode16_type;
-  using typename parent_class::inode48_type;
+  using typename parent_class::inode32_type;
   using typename parent_class::inode4_type;
   using typename parent_class::leaf_type;
   using typename parent_class::node_ptr;
@@ -1159,7 +1442,7 @@ class basic_inode_16 : public basic_inode_16_parent<ArtPolicy> {
   constexpr basic_inode_16(db &, const inode4_type &source_node) noexcept
       : parent_class{source_node} {}
 
-  constexpr basic_inode_16(db &, const inode48_type &source_node) noexcept
+  constexpr basic_inode_16(db &, const inode32_type &source_node) noexcept
       : parent_class{source_node} {}
 
   constexpr basic_inode_16(db &db_instance, inode4_type &source_node,
@@ -1170,11 +1453,17 @@ class basic_inode_16 : public basic_inode_16_parent<ArtPolicy> {
   }
 
   UNODB_DETAIL_DISABLE_MSVC_WARNING(26495)
-  constexpr basic_inode_16(db &db_instance, inode48_type &source_node,
+  constexpr basic_inode_16(db &db_instance, inode32_type &source_node,
                            std::uint8_t child_to_delete) noexcept
       : parent_class{source_node} {
     init(db_instance, source_node, child_to_delete);
   }
+
+  constexpr basic_inode_16(db &, art_key shifted_key, unsigned key_prefix_len,
+                           const sorted_children<node_ptr> &source) noexcept
+      : parent_class{shifted_key, key_prefix_len, source.count} {
+    init(source);
+  }
   UNODB_DETAIL_RESTORE_MSVC_WARNINGS()
 
   UNODB_DETAIL_RESTORE_MSVC_WARNINGS()
@@ -1216,36 +1505,39 @@ class basic_inode_16 : public basic_inode_16_parent<ArtPolicy> {
     }
   }
 
-  constexpr void init(db &db_instance, inode48_type &source_node,
+  constexpr void init(db &db_instance, inode32_type &source_node,
                       std::uint8_t child_to_delete) noexcept {
     const auto reclaim_source_node{
         ArtPolicy::template make_db_inode_reclaimable_ptr(&source_node,
                                                           db_instance)};
-    source_node.remove_child_pointer(child_to_delete, db_instance);
-    source_node.child_indexes[child_to_delete] = inode48_type::empty_child;
+    const auto r{ArtPolicy::reclaim_leaf_on_scope_exit(
+        source_node.children[child_to_delete]
+            .load()
+            .template ptr<leaf_type *>(),
+        db_instance)};
 
-    // TODO(laurynas): consider AVX2 gather?
+    const auto source_children_count = source_node.children_count.load();
     unsigned next_child = 0;
-    unsigned i = 0;
-    while (true) {
-      const auto source_child_i = source_node.child_indexes[i].load();
-      if (source_child_i != inode48_type::empty_child) {
-        keys.byte_array[next_child] = gsl::narrow_cast<std::byte>(i);
-        const auto source_child_ptr =
-            source_node.children.pointer_array[source_child_i].load();
-        UNODB_DETAIL_ASSERT(source_child_ptr != nullptr);
-        children[next_child] = source_child_ptr;
-        ++next_child;
-        if (next_child == basic_inode_16::capacity) break;
-      }
-      UNODB_DETAIL_ASSERT(i < 255);
-      ++i;
+    for (unsigned i = 0; i < source_children_count; ++i) {
+      if (i == child_to_delete) continue;
+      keys.byte_array[next_child] = source_node.keys.byte_array[i];
+      children[next_child] = source_node.children[i];
+      ++next_child;
     }
 
-    UNODB_DETAIL_ASSERT(this->children_count == basic_inode_16::capacity);
-    UNODB_DETAIL_ASSERT(
-        std::is_sorted(keys.byte_array.cbegin(),
-                       keys.byte_array.cbegin() + basic_inode_16::capacity));
+    UNODB_DETAIL_ASSERT(next_child <= basic_inode_16::capacity);
+    this->children_count = gsl::narrow_cast<std::uint8_t>(next_child);
+    UNODB_DETAIL_ASSERT(std::is_sorted(keys.byte_array.cbegin(),
+                                       keys.byte_array.cbegin() + next_child));
+  }
+
+  constexpr void init(const sorted_children<node_ptr> &source) noexcept {
+    UNODB_DETAIL_ASSERT(source.count >= parent_class::min_size);
+
+    for (unsigned i = 0; i < source.count; ++i) {
+      keys.byte_array[i] = source.key_bytes[i];
+      children[i] = source.children[i];
+    }
   }
 
   constexpr void add_to_nonfull(db_leaf_unique_ptr &&child, tree_depth depth,
@@ -1290,9 +1582,11 @@ class basic_inode_16 : public basic_inode_16_parent<ArtPolicy> {
     const auto r{ArtPolicy::reclaim_leaf_on_scope_exit(
         children[child_index].load().template ptr<leaf_type *>(), db_instance)};
 
-    for (unsigned i = child_index + 1U; i < children_count_; ++i) {
-      keys.byte_array[i - 1] = keys.byte_array[i];
-      children[i - 1] = children[i];
+    if (!remove_with_simd_kernel(child_index, children_count_)) {
+      for (unsigned i = child_index + 1U; i < children_count_; ++i) {
+        keys.byte_array[i - 1] = keys.byte_array[i];
+        children[i - 1] = children[i];
+      }
     }
 
     --children_count_;
@@ -1302,8 +1596,23 @@ class basic_inode_16 : public basic_inode_16_parent<ArtPolicy> {
         keys.byte_array.cbegin(), keys.byte_array.cbegin() + children_count_));
   }
 
+  // Any child, which may be inconsistent in the case of OLC
+  [[nodiscard]] constexpr node_ptr any_child() const noexcept {
+    return children[0].load();
+  }
+
   UNODB_DETAIL_DISABLE_MSVC_WARNING(26434)
   [[nodiscard]] constexpr find_result find_child(std::byte key_byte) noexcept {
+    // The header and the keys are in the first cache line of the node, and the
+    // matched child pointer is in at most one more.
+    UNODB_DETAIL_DISABLE_GCC_WARNING("-Winvalid-offsetof")
+    UNODB_DETAIL_DISABLE_CLANG_WARNING("-Winvalid-offsetof")
+    static_assert(offsetof(basic_inode_16, keys) + sizeof(keys) <=
+                  hardware_constructive_interference_size);
+    static_assert(offsetof(basic_inode_16, children) % sizeof(node_ptr) == 0);
+    UNODB_DETAIL_RESTORE_CLANG_WARNINGS()
+    UNODB_DETAIL_RESTORE_GCC_WARNINGS()
+
 #ifdef UNODB_DETAIL_X86_64
     const auto replicated_search_key =
         _mm_set1_epi8(static_cast<char>(key_byte));
@@ -1348,6 +1657,18 @@ class basic_inode_16 : public basic_inode_16_parent<ArtPolicy> {
   }
   UNODB_DETAIL_RESTORE_MSVC_WARNINGS()
 
+  // Call func with the key byte and the pointer of every child, in increasing
+  // key byte order
+  template <typename Function>
+  constexpr void for_each_child(Function func) const
+      noexcept(noexcept(func(0, node_ptr{nullptr}))) {
+    const auto children_count_ = this->children_count.load();
+    for (std::uint8_t i = 0; i < children_count_; ++i) {
+      func(static_cast<std::uint8_t>(keys.byte_array[i].load()),
+           children[i].load());
+    }
+  }
+
   constexpr void delete_subtree(db &db_instance) noexcept {
     const auto children_count_ = this->children_count.load();
     for (std::uint8_t i = 0; i < children_count_; ++i)
@@ -1381,16 +1702,15 @@ class basic_inode_16 : public basic_inode_16_parent<ArtPolicy> {
         keys.byte_array.cbegin() + children_count_);
 
 #ifdef UNODB_DETAIL_X86_64
-    const auto replicated_insert_key =
-        _mm_set1_epi8(static_cast<char>(key_byte));
-    const auto lesser_key_positions =
-        _mm_cmple_epu8(replicated_insert_key, keys.byte_vector);
-    const auto mask = (1U << children_count_) - 1;
-    const auto bit_field =
-        static_cast<unsigned>(_mm_movemask_epi8(lesser_key_positions)) & mask;
-    const auto result = (bit_field != 0)
-                            ? detail::ctz(bit_field)
-                            : gsl::narrow_cast<std::uint8_t>(children_count_);
+    const auto insert_pos_kernel = selected_simd_kernels().n16_insert_pos;
+    const auto result =
+        UNODB_DETAIL_LIKELY(insert_pos_kernel == nullptr)
+            ? n16_insert_pos_sse2(&keys.byte_vector,
+                                  static_cast<std::uint8_t>(key_byte),
+                                  children_count_)
+            : insert_pos_kernel(&keys.byte_vector,
+                                static_cast<std::uint8_t>(key_byte),
+                                children_count_);
 #else
     // This is also the best current ARM implementation
     const auto result = static_cast<std::uint8_t>(
@@ -1405,6 +1725,26 @@ class basic_inode_16 : public basic_inode_16_parent<ArtPolicy> {
     return result;
   }
 
+  // Move the keys and children after child_index down with a vector kernel, if
+  // there is one, and the node has no concurrent readers. Return whether it was
+  // done.
+  [[nodiscard]] bool remove_with_simd_kernel(
+      UNODB_DETAIL_UNUSED std::uint8_t child_index,
+      UNODB_DETAIL_UNUSED std::uint8_t children_count_) noexcept {
+#ifdef UNODB_DETAIL_X86_64
+    if constexpr (!critical_section_policy<node_ptr>::concurrent_access) {
+      static_assert(sizeof(children[0]) == sizeof(node_ptr));
+      const auto remove_kernel = selected_simd_kernels().n16_remove;
+      if (remove_kernel != nullptr) {
+        remove_kernel(&keys.byte_vector, &children[0], child_index,
+                      children_count_);
+        return true;
+      }
+    }
+#endif
+    return false;
+  }
+
  protected:
   union key_union {
     std::array<critical_section_policy<std::byte>, basic_inode_16::capacity>
@@ -1427,20 +1767,22 @@ class basic_inode_16 : public basic_inode_16_parent<ArtPolicy> {
   template <class>
   friend class basic_inode_4;
   template <class>
-  friend class basic_inode_48;
+  friend class basic_inode_32;
 };
 
 template <class ArtPolicy>
-using basic_inode_48_parent = basic_inode<
-    ArtPolicy, 17, 48, node_type::I48, typename ArtPolicy::inode16_type,
-    typename ArtPolicy::inode256_type, typename ArtPolicy::inode48_type>;
+using basic_inode_32_parent = basic_inode<
+    ArtPolicy, 17, 32, node_type::I32, typename ArtPolicy::inode16_type,
+    typename ArtPolicy::inode48_type, typename ArtPolicy::inode32_type>;
 
+// Node32 is Node16 with two key vectors, so that 17 to 32 children do not need
+// a Node48, which is more than twice as large.
 template <class ArtPolicy>
-class basic_inode_48 : public basic_inode_48_parent<ArtPolicy> {
-  using parent_class = basic_inode_48_parent<ArtPolicy>;
+class basic_inode_32 : public basic_inode_32_parent<ArtPolicy> {
+  using parent_class = basic_inode_32_parent<ArtPolicy>;
 
   using typename parent_class::inode16_type;
-  using typename parent_class::inode256_type;
+  using typename parent_class::inode32_type;
   using typename parent_class::inode48_type;
   using typename parent_class::leaf_type;
   using typename parent_class::node_ptr;
@@ -1452,244 +1794,551 @@ class basic_inode_48 : public basic_inode_48_parent<ArtPolicy> {
  public:
   using typename parent_class::db;
   using typename parent_class::db_leaf_unique_ptr;
+  using typename parent_class::find_result;
 
   UNODB_DETAIL_DISABLE_MSVC_WARNING(26434)
 
-  constexpr basic_inode_48(db &, const inode16_type &source_node) noexcept
+  constexpr basic_inode_32(db &, const inode16_type &source_node) noexcept
       : parent_class{source_node} {}
 
-  constexpr basic_inode_48(db &, const inode256_type &source_node) noexcept
+  constexpr basic_inode_32(db &, const inode48_type &source_node) noexcept
       : parent_class{source_node} {}
 
-  constexpr basic_inode_48(db &db_instance,
-                           inode16_type &__restrict source_node,
+  constexpr basic_inode_32(db &db_instance, inode16_type &source_node,
                            db_leaf_unique_ptr &&child,
                            tree_depth depth) noexcept
       : parent_class{source_node} {
     init(db_instance, source_node, std::move(child), depth);
   }
 
-  constexpr basic_inode_48(db &db_instance,
-                           inode256_type &__restrict source_node,
+  UNODB_DETAIL_DISABLE_MSVC_WARNING(26495)
+  constexpr basic_inode_32(db &db_instance, inode48_type &source_node,
                            std::uint8_t child_to_delete) noexcept
       : parent_class{source_node} {
     init(db_instance, source_node, child_to_delete);
   }
 
-  constexpr void init(db &db_instance, inode16_type &__restrict source_node,
+  constexpr basic_inode_32(db &, art_key shifted_key, unsigned key_prefix_len,
+                           const sorted_children<node_ptr> &source) noexcept
+      : parent_class{shifted_key, key_prefix_len, source.count} {
+    init(source);
+  }
+  UNODB_DETAIL_RESTORE_MSVC_WARNINGS()
+
+  UNODB_DETAIL_RESTORE_MSVC_WARNINGS()
+
+  constexpr void init(db &db_instance, inode16_type &source_node,
                       db_leaf_unique_ptr child, tree_depth depth) noexcept {
     const auto reclaim_source_node{
         ArtPolicy::template make_db_inode_reclaimable_ptr(&source_node,
                                                           db_instance)};
-    auto *const __restrict child_ptr = child.release();
+    const auto key_byte = child->get_key()[depth];
 
-    // TODO(laurynas): consider AVX512 scatter?
-    std::uint8_t i = 0;
-    for (; i < inode16_type::capacity; ++i) {
-      const auto existing_key_byte = source_node.keys.byte_array[i].load();
-      child_indexes[static_cast<std::uint8_t>(existing_key_byte)] = i;
-    }
-    for (i = 0; i < inode16_type::capacity; ++i) {
-      children.pointer_array[i] = source_node.children[i];
+#ifdef UNODB_DETAIL_X86_64
+    const unsigned insert_pos_index = n16_insert_pos_sse2(
+        &source_node.keys.byte_vector, static_cast<std::uint8_t>(key_byte),
+        inode16_type::capacity);
+#else
+    const auto insert_pos_index = static_cast<unsigned>(
+        std::lower_bound(
+            source_node.keys.byte_array.cbegin(),
+            source_node.keys.byte_array.cbegin() + inode16_type::capacity,
+            key_byte) -
+        source_node.keys.byte_array.cbegin());
+#endif
+
+    unsigned i = 0;
+    for (; i < insert_pos_index; ++i) {
+      keys.byte_array[i] = source_node.keys.byte_array[i];
+      children[i] = source_node.children[i];
     }
 
-    const auto key_byte =
-        static_cast<std::uint8_t>(child_ptr->get_key()[depth]);
+    UNODB_DETAIL_ASSUME(i <= inode16_type::capacity);
 
-    UNODB_DETAIL_ASSERT(child_indexes[key_byte] == empty_child);
-    UNODB_DETAIL_ASSUME(i == inode16_type::capacity);
+    keys.byte_array[i] = key_byte;
+    children[i] = node_ptr{child.release(), node_type::LEAF};
+    ++i;
 
-    child_indexes[key_byte] = i;
-    children.pointer_array[i] = node_ptr{child_ptr, node_type::LEAF};
-    for (i = this->children_count; i < basic_inode_48::capacity; i++) {
-      children.pointer_array[i] = node_ptr{nullptr};
+    for (; i <= inode16_type::capacity; ++i) {
+      keys.byte_array[i] = source_node.keys.byte_array[i - 1];
+      children[i] = source_node.children[i - 1];
     }
-  }
 
-  UNODB_DETAIL_RESTORE_MSVC_WARNINGS()
+    UNODB_DETAIL_ASSERT(this->children_count == parent_class::min_size);
+    UNODB_DETAIL_ASSERT(
+        std::is_sorted(keys.byte_array.cbegin(),
+                       keys.byte_array.cbegin() + parent_class::min_size));
+  }
 
-  constexpr void init(db &db_instance, inode256_type &__restrict source_node,
+  constexpr void init(db &db_instance, inode48_type &source_node,
                       std::uint8_t child_to_delete) noexcept {
     const auto reclaim_source_node{
         ArtPolicy::template make_db_inode_reclaimable_ptr(&source_node,
                                                           db_instance)};
-    const auto r{ArtPolicy::reclaim_leaf_on_scope_exit(
-        source_node.children[child_to_delete]
-            .load()
-            .template ptr<leaf_type *>(),
-        db_instance)};
-
-    source_node.children[child_to_delete] = node_ptr{nullptr};
-
-    std::uint8_t next_child = 0;
-    for (unsigned child_i = 0; child_i < 256; child_i++) {
-      const auto child_ptr = source_node.children[child_i].load();
-      if (child_ptr == nullptr) continue;
-
-      child_indexes[child_i] = next_child;
-      children.pointer_array[next_child] = source_node.children[child_i].load();
-      ++next_child;
-
-      if (next_child == basic_inode_48::capacity) return;
-    }
-  }
+    source_node.remove_child_pointer(child_to_delete, db_instance);
+    source_node.child_indexes[child_to_delete] = inode48_type::empty_child;
 
-  constexpr void add_to_nonfull(db_leaf_unique_ptr &&child, tree_depth depth,
-                                std::uint8_t children_count_) noexcept {
-    UNODB_DETAIL_ASSERT(this->children_count == children_count_);
-    UNODB_DETAIL_ASSERT(children_count_ >= parent_class::min_size);
-    UNODB_DETAIL_ASSERT(children_count_ < parent_class::capacity);
+    const unsigned new_children_count =
+        source_node.children_count.load() - 1U;
+    UNODB_DETAIL_ASSERT(new_children_count <= basic_inode_32::capacity);
+    this->children_count = gsl::narrow_cast<std::uint8_t>(new_children_count);
 
-    const auto key_byte = static_cast<uint8_t>(child->get_key()[depth]);
-    UNODB_DETAIL_ASSERT(child_indexes[key_byte] == empty_child);
-    unsigned i{0};
-#ifdef UNODB_DETAIL_SSE4_2
-    const auto nullptr_vector = _mm_setzero_si128();
+    unsigned next_child = 0;
+    unsigned i = 0;
     while (true) {
-      const auto ptr_vec0 = _mm_load_si128(&children.pointer_vector[i]);
-      const auto ptr_vec1 = _mm_load_si128(&children.pointer_vector[i + 1]);
-      const auto ptr_vec2 = _mm_load_si128(&children.pointer_vector[i + 2]);
-      const auto ptr_vec3 = _mm_load_si128(&children.pointer_vector[i + 3]);
-      const auto vec0_cmp = _mm_cmpeq_epi64(ptr_vec0, nullptr_vector);
-      const auto vec1_cmp = _mm_cmpeq_epi64(ptr_vec1, nullptr_vector);
-      const auto vec2_cmp = _mm_cmpeq_epi64(ptr_vec2, nullptr_vector);
-      const auto vec3_cmp = _mm_cmpeq_epi64(ptr_vec3, nullptr_vector);
-      // OK to treat 64-bit comparison result as 32-bit vector: we need to find
-      // the first 0xFF only.
-      const auto vec01_cmp = _mm_packs_epi32(vec0_cmp, vec1_cmp);
-      const auto vec23_cmp = _mm_packs_epi32(vec2_cmp, vec3_cmp);
-      const auto vec_cmp = _mm_packs_epi32(vec01_cmp, vec23_cmp);
-      const auto cmp_mask =
-          static_cast<std::uint64_t>(_mm_movemask_epi8(vec_cmp));
-      if (cmp_mask != 0) {
-        i = (i << 1U) + (((detail::ctz(cmp_mask)) + 1U) >> 1U);
-        break;
+      const auto source_child_i = source_node.child_indexes[i].load();
+      if (source_child_i != inode48_type::empty_child) {
+        keys.byte_array[next_child] = gsl::narrow_cast<std::byte>(i);
+        const auto source_child_ptr =
+            source_node.children[source_child_i].load();
+        UNODB_DETAIL_ASSERT(source_child_ptr != nullptr);
+        children[next_child] = source_child_ptr;
+        ++next_child;
+        if (next_child == new_children_count) break;
       }
-      i += 4;
+      UNODB_DETAIL_ASSERT(i < 255);
+      ++i;
     }
-#elif defined(UNODB_DETAIL_AVX2)
-    const auto nullptr_vector = _mm256_setzero_si256();
-    while (true) {
-      const auto ptr_vec0 = _mm256_load_si256(&children.pointer_vector[i]);
-      const auto ptr_vec1 = _mm256_load_si256(&children.pointer_vector[i + 1]);
-      const auto ptr_vec2 = _mm256_load_si256(&children.pointer_vector[i + 2]);
-      const auto ptr_vec3 = _mm256_load_si256(&children.pointer_vector[i + 3]);
-      const auto vec0_cmp = _mm256_cmpeq_epi64(ptr_vec0, nullptr_vector);
-      const auto vec1_cmp = _mm256_cmpeq_epi64(ptr_vec1, nullptr_vector);
-      const auto vec2_cmp = _mm256_cmpeq_epi64(ptr_vec2, nullptr_vector);
-      const auto vec3_cmp = _mm256_cmpeq_epi64(ptr_vec3, nullptr_vector);
-      const auto interleaved_vec01_cmp = _mm256_packs_epi32(vec0_cmp, vec1_cmp);
-      const auto interleaved_vec23_cmp = _mm256_packs_epi32(vec2_cmp, vec3_cmp);
-      const auto doubly_interleaved_vec_cmp =
-          _mm256_packs_epi32(interleaved_vec01_cmp, interleaved_vec23_cmp);
-      if (!_mm256_testz_si256(doubly_interleaved_vec_cmp,
-                              doubly_interleaved_vec_cmp)) {
-        const auto vec01_cmp =
-            _mm256_permute4x64_epi64(interleaved_vec01_cmp, 0b11'01'10'00);
-        const auto vec23_cmp =
-            _mm256_permute4x64_epi64(interleaved_vec23_cmp, 0b11'01'10'00);
-        const auto interleaved_vec_cmp =
-            _mm256_packs_epi32(vec01_cmp, vec23_cmp);
-        const auto vec_cmp =
-            _mm256_permute4x64_epi64(interleaved_vec_cmp, 0b11'01'10'00);
-        const auto cmp_mask =
-            static_cast<std::uint64_t>(_mm256_movemask_epi8(vec_cmp));
-        i = (i << 2U) + (detail::ctz(cmp_mask) >> 1U);
-        break;
-      }
-      i += 4;
+
+    UNODB_DETAIL_ASSERT(std::is_sorted(
+        keys.byte_array.cbegin(),
+        keys.byte_array.cbegin() + new_children_count));
+  }
+
+  constexpr void init(const sorted_children<node_ptr> &source) noexcept {
+    UNODB_DETAIL_ASSERT(source.count >= parent_class::min_size);
+
+    for (unsigned i = 0; i < source.count; ++i) {
+      keys.byte_array[i] = source.key_bytes[i];
+      children[i] = source.children[i];
+    }
+  }
+
+  constexpr void add_to_nonfull(db_leaf_unique_ptr &&child, tree_depth depth,
+                                std::uint8_t children_count_) noexcept {
+    UNODB_DETAIL_ASSERT(children_count_ == this->children_count);
+    UNODB_DETAIL_ASSERT(children_count_ < parent_class::capacity);
+    UNODB_DETAIL_ASSERT(std::is_sorted(
+        keys.byte_array.cbegin(), keys.byte_array.cbegin() + children_count_));
+
+    const auto key_byte = child->get_key()[depth];
+
+    const auto insert_pos_index =
+        get_sorted_key_array_insert_position(key_byte);
+
+    for (unsigned i = children_count_; i > insert_pos_index; --i) {
+      keys.byte_array[i] = keys.byte_array[i - 1];
+      children[i] = children[i - 1];
+    }
+
+    keys.byte_array[insert_pos_index] = key_byte;
+    children[insert_pos_index] = node_ptr{child.release(), node_type::LEAF};
+    ++children_count_;
+    this->children_count = children_count_;
+
+    UNODB_DETAIL_ASSERT(std::is_sorted(
+        keys.byte_array.cbegin(), keys.byte_array.cbegin() + children_count_));
+  }
+
+  constexpr void remove(std::uint8_t child_index, db &db_instance) noexcept {
+    auto children_count_ = this->children_count.load();
+    UNODB_DETAIL_ASSERT(child_index < children_count_);
+    UNODB_DETAIL_ASSERT(std::is_sorted(
+        keys.byte_array.cbegin(), keys.byte_array.cbegin() + children_count_));
+
+    const auto r{ArtPolicy::reclaim_leaf_on_scope_exit(
+        children[child_index].load().template ptr<leaf_type *>(), db_instance)};
+
+    for (unsigned i = child_index + 1U; i < children_count_; ++i) {
+      keys.byte_array[i - 1] = keys.byte_array[i];
+      children[i - 1] = children[i];
+    }
+
+    --children_count_;
+    this->children_count = children_count_;
+
+    UNODB_DETAIL_ASSERT(std::is_sorted(
+        keys.byte_array.cbegin(), keys.byte_array.cbegin() + children_count_));
+  }
+
+  // Any child, which may be inconsistent in the case of OLC
+  [[nodiscard]] constexpr node_ptr any_child() const noexcept {
+    return children[0].load();
+  }
+
+  UNODB_DETAIL_DISABLE_MSVC_WARNING(26434)
+  [[nodiscard]] constexpr find_result find_child(std::byte key_byte) noexcept {
+    // The header and the keys are in at most the first two cache lines of the
+    // node, and each key vector is in a single one.
+    UNODB_DETAIL_DISABLE_GCC_WARNING("-Winvalid-offsetof")
+    UNODB_DETAIL_DISABLE_CLANG_WARNING("-Winvalid-offsetof")
+    static_assert(offsetof(basic_inode_32, keys) + sizeof(keys) <=
+                  2 * hardware_constructive_interference_size);
+    static_assert(offsetof(basic_inode_32, children) % sizeof(node_ptr) == 0);
+    UNODB_DETAIL_RESTORE_CLANG_WARNINGS()
+    UNODB_DETAIL_RESTORE_GCC_WARNINGS()
+
+#ifdef UNODB_DETAIL_X86_64
+    const auto replicated_search_key =
+        _mm_set1_epi8(static_cast<char>(key_byte));
+    const auto low_positions = static_cast<unsigned>(_mm_movemask_epi8(
+        _mm_cmpeq_epi8(replicated_search_key, keys.byte_vector[0])));
+    const auto high_positions = static_cast<unsigned>(_mm_movemask_epi8(
+        _mm_cmpeq_epi8(replicated_search_key, keys.byte_vector[1])));
+    const auto mask = (1ULL << this->children_count) - 1;
+    const auto bit_field =
+        ((std::uint64_t{high_positions} << 16U) | low_positions) & mask;
+    if (bit_field != 0) {
+      const auto i = detail::ctz(bit_field);
+      return std::make_pair(
+          i, static_cast<critical_section_policy<node_ptr> *>(&children[i]));
     }
+    return parent_class::child_not_found;
 #elif defined(__aarch64__)
-    const auto nullptr_vector = vdupq_n_u64(0);
-    while (true) {
-      const auto ptr_vec0 = children.pointer_vector[i];
-      const auto ptr_vec1 = children.pointer_vector[i + 1];
-      const auto ptr_vec2 = children.pointer_vector[i + 2];
-      const auto ptr_vec3 = children.pointer_vector[i + 3];
-      const auto vec0_cmp = vceqq_u64(nullptr_vector, ptr_vec0);
-      const auto vec1_cmp = vceqq_u64(nullptr_vector, ptr_vec1);
-      const auto vec2_cmp = vceqq_u64(nullptr_vector, ptr_vec2);
-      const auto vec3_cmp = vceqq_u64(nullptr_vector, ptr_vec3);
-      const auto narrowed_cmp0 = vshrn_n_u64(vec0_cmp, 4);
-      const auto narrowed_cmp1 = vshrn_n_u64(vec1_cmp, 4);
-      const auto narrowed_cmp2 = vshrn_n_u64(vec2_cmp, 4);
-      const auto narrowed_cmp3 = vshrn_n_u64(vec3_cmp, 4);
-      const auto cmp01 = vcombine_u32(narrowed_cmp0, narrowed_cmp1);
-      const auto cmp23 = vcombine_u32(narrowed_cmp2, narrowed_cmp3);
-      // NOLINTNEXTLINE(misc-const-correctness)
-      const auto narrowed_cmp01 = vshrn_n_u32(cmp01, 4);
-      // NOLINTNEXTLINE(misc-const-correctness)
-      const auto narrowed_cmp23 = vshrn_n_u32(cmp23, 4);
-      const auto cmp = vcombine_u16(narrowed_cmp01, narrowed_cmp23);
-      // NOLINTNEXTLINE(misc-const-correctness)
-      const auto narrowed_cmp = vshrn_n_u16(cmp, 4);
+    // The keys are unique and sorted up to the children count, thus the first
+    // match is the only valid one, if it is below the count.
+    const auto replicated_search_key =
+        vdupq_n_u8(static_cast<std::uint8_t>(key_byte));
+    const auto child_count = this->children_count.load();
+    for (unsigned half = 0; half < 2; ++half) {
+      const auto matching_key_positions =
+          vceqq_u8(replicated_search_key, keys.byte_vector[half]);
+      const auto narrowed_positions =
+          vshrn_n_u16(vreinterpretq_u16_u8(matching_key_positions), 4);
       const auto scalar_pos =
           // NOLINTNEXTLINE(misc-const-correctness)
-          vget_lane_u64(vreinterpret_u64_u8(narrowed_cmp), 0);
-      if (scalar_pos != 0) {
-        i = (i << 1U) + static_cast<unsigned>(detail::ctz(scalar_pos) >> 3U);
-        break;
-      }
-      i += 4;
+          vget_lane_u64(vreinterpret_u64_u8(narrowed_positions), 0);
+      if (scalar_pos == 0) continue;
+
+      const auto i =
+          static_cast<unsigned>(half * 16 + (detail::ctz(scalar_pos) >> 2U));
+      if (i >= child_count) break;
+      return std::make_pair(
+          i, static_cast<critical_section_policy<node_ptr> *>(&children[i]));
     }
-#else   // #ifdef UNODB_DETAIL_X86_64
-    node_ptr child_ptr;
-    while (true) {
-      child_ptr = children.pointer_array[i];
-      if (child_ptr == nullptr) break;
-      UNODB_DETAIL_ASSERT(i < 255);
-      ++i;
+    return parent_class::child_not_found;
+#else
+    for (size_t i = 0; i < this->children_count.load(); ++i)
+      if (key_byte == keys.byte_array[i])
+        return std::make_pair(
+            i, static_cast<critical_section_policy<node_ptr> *>(&children[i]));
+    return parent_class::child_not_found;
+#endif
+  }
+  UNODB_DETAIL_RESTORE_MSVC_WARNINGS()
+
+  // Call func with the key byte and the pointer of every child, in increasing
+  // key byte order
+  template <typename Function>
+  constexpr void for_each_child(Function func) const
+      noexcept(noexcept(func(0, node_ptr{nullptr}))) {
+    const auto children_count_ = this->children_count.load();
+    for (std::uint8_t i = 0; i < children_count_; ++i) {
+      func(static_cast<std::uint8_t>(keys.byte_array[i].load()),
+           children[i].load());
     }
-#endif  // #ifdef UNODB_DETAIL_X86_64
+  }
+
+  constexpr void delete_subtree(db &db_instance) noexcept {
+    const auto children_count_ = this->children_count.load();
+    for (std::uint8_t i = 0; i < children_count_; ++i)
+      ArtPolicy::delete_subtree(children[i], db_instance);
+  }
+
+  UNODB_DETAIL_DISABLE_MSVC_WARNING(26434)
+  [[gnu::cold]] UNODB_DETAIL_NOINLINE void dump(std::ostream &os) const {
+    parent_class::dump(os);
+    const auto children_count_ = this->children_count.load();
+    os << ", key bytes =";
+    for (std::uint8_t i = 0; i < children_count_; ++i)
+      dump_byte(os, keys.byte_array[i]);
+    os << ", children:\n";
+    for (std::uint8_t i = 0; i < children_count_; ++i)
+      ArtPolicy::dump_node(os, children[i].load());
+  }
+  UNODB_DETAIL_RESTORE_MSVC_WARNINGS()
+
+ private:
+  [[nodiscard, gnu::pure]] constexpr auto get_sorted_key_array_insert_position(
+      std::byte key_byte) noexcept {
+    const auto children_count_ = this->children_count.load();
+
+    UNODB_DETAIL_ASSERT(children_count_ < basic_inode_32::capacity);
+    UNODB_DETAIL_ASSERT(std::is_sorted(
+        keys.byte_array.cbegin(), keys.byte_array.cbegin() + children_count_));
+    UNODB_DETAIL_ASSERT(
+        std::adjacent_find(keys.byte_array.cbegin(),
+                           keys.byte_array.cbegin() + children_count_) >=
+        keys.byte_array.cbegin() + children_count_);
+
+#ifdef UNODB_DETAIL_X86_64
+    const auto replicated_insert_key =
+        _mm_set1_epi8(static_cast<char>(key_byte));
+    const auto low_positions = static_cast<unsigned>(_mm_movemask_epi8(
+        _mm_cmple_epu8(replicated_insert_key, keys.byte_vector[0])));
+    const auto high_positions = static_cast<unsigned>(_mm_movemask_epi8(
+        _mm_cmple_epu8(replicated_insert_key, keys.byte_vector[1])));
+    const auto mask = (1ULL << children_count_) - 1;
+    const auto bit_field =
+        ((std::uint64_t{high_positions} << 16U) | low_positions) & mask;
+    const auto result = static_cast<std::uint8_t>(
+        (bit_field != 0) ? detail::ctz(bit_field) : children_count_);
+#else
+    const auto result = static_cast<std::uint8_t>(
+        std::lower_bound(keys.byte_array.cbegin(),
+                         keys.byte_array.cbegin() + children_count_, key_byte) -
+        keys.byte_array.cbegin());
+#endif
+
+    UNODB_DETAIL_ASSERT(
+        result == children_count_ ||
+        (result < children_count_ && keys.byte_array[result] != key_byte));
+    return result;
+  }
+
+ protected:
+  union key_union {
+    std::array<critical_section_policy<std::byte>, basic_inode_32::capacity>
+        byte_array;
+#ifdef UNODB_DETAIL_X86_64
+    // NOLINTNEXTLINE(modernize-avoid-c-arrays)
+    __m128i byte_vector[2];
+#elif defined(__aarch64__)
+    // NOLINTNEXTLINE(modernize-avoid-c-arrays)
+    uint8x16_t byte_vector[2];
+#endif
+    UNODB_DETAIL_DISABLE_MSVC_WARNING(26495)
+    key_union() noexcept {}
+    UNODB_DETAIL_RESTORE_MSVC_WARNINGS()
+  } keys;
+  std::array<critical_section_policy<node_ptr>, basic_inode_32::capacity>
+      children;
+
+  template <class>
+  friend class basic_inode_16;
+  template <class>
+  friend class basic_inode_48;
+};
+
+template <class ArtPolicy>
+using basic_inode_48_parent = basic_inode<
+    ArtPolicy, 33, 48, node_type::I48, typename ArtPolicy::inode32_type,
+    typename ArtPolicy::inode256_type, typename ArtPolicy::inode48_type>;
+
+template <class ArtPolicy>
+class basic_inode_48 : public basic_inode_48_parent<ArtPolicy> {
+  using parent_class = basic_inode_48_parent<ArtPolicy>;
+
+  using typename parent_class::inode256_type;
+  using typename parent_class::inode32_type;
+  using typename parent_class::inode48_type;
+  using typename parent_class::leaf_type;
+  using typename parent_class::node_ptr;
+
+  template <typename T>
+  using critical_section_policy =
+      typename ArtPolicy::template critical_section_policy<T>;
+
+ public:
+  using typename parent_class::db;
+  using typename parent_class::db_leaf_unique_ptr;
+
+  UNODB_DETAIL_DISABLE_MSVC_WARNING(26434)
+
+  constexpr basic_inode_48(db &, const inode32_type &source_node) noexcept
+      : parent_class{source_node} {}
+
+  constexpr basic_inode_48(db &, const inode256_type &source_node) noexcept
+      : parent_class{source_node} {}
+
+  constexpr basic_inode_48(db &db_instance,
+                           inode32_type &__restrict source_node,
+                           db_leaf_unique_ptr &&child,
+                           tree_depth depth) noexcept
+      : parent_class{source_node} {
+    init(db_instance, source_node, std::move(child), depth);
+  }
+
+  constexpr basic_inode_48(db &db_instance,
+                           inode256_type &__restrict source_node,
+                           std::uint8_t child_to_delete) noexcept
+      : parent_class{source_node} {
+    init(db_instance, source_node, child_to_delete);
+  }
+
+  constexpr basic_inode_48(db &, art_key shifted_key, unsigned key_prefix_len,
+                           const sorted_children<node_ptr> &source) noexcept
+      : parent_class{shifted_key, key_prefix_len, source.count} {
+    init(source);
+  }
+
+  constexpr void init(db &db_instance, inode32_type &__restrict source_node,
+                      db_leaf_unique_ptr child, tree_depth depth) noexcept {
+    const auto reclaim_source_node{
+        ArtPolicy::template make_db_inode_reclaimable_ptr(&source_node,
+                                                          db_instance)};
+    auto *const __restrict child_ptr = child.release();
+
+    // TODO(laurynas): consider AVX512 scatter?
+    std::uint8_t i = 0;
+    for (; i < inode32_type::capacity; ++i) {
+      const auto existing_key_byte = source_node.keys.byte_array[i].load();
+      child_indexes[static_cast<std::uint8_t>(existing_key_byte)] = i;
+    }
+    for (i = 0; i < inode32_type::capacity; ++i) {
+      children[i] = source_node.children[i];
+    }
+
+    const auto key_byte =
+        static_cast<std::uint8_t>(child_ptr->get_key()[depth]);
+
+    UNODB_DETAIL_ASSERT(child_indexes[key_byte] == empty_child);
+    UNODB_DETAIL_ASSUME(i == inode32_type::capacity);
+
+    child_indexes[key_byte] = i;
+    children[i] = node_ptr{child_ptr, node_type::LEAF};
+    for (i = this->children_count; i < basic_inode_48::capacity; i++) {
+      children[i] = node_ptr{nullptr};
+    }
+    occupied_slots = (1ULL << this->children_count) - 1;
+  }
+
+  UNODB_DETAIL_RESTORE_MSVC_WARNINGS()
+
+  constexpr void init(db &db_instance, inode256_type &__restrict source_node,
+                      std::uint8_t child_to_delete) noexcept {
+    const auto reclaim_source_node{
+        ArtPolicy::template make_db_inode_reclaimable_ptr(&source_node,
+                                                          db_instance)};
+    const auto r{ArtPolicy::reclaim_leaf_on_scope_exit(
+        source_node.children[child_to_delete]
+            .load()
+            .template ptr<leaf_type *>(),
+        db_instance)};
+
+    source_node.children[child_to_delete] = node_ptr{nullptr};
+    source_node.clear_present(child_to_delete);
+
+    std::uint8_t next_child = 0;
+    source_node.for_each_present_index(
+        [this, &source_node, &next_child](unsigned child_i) noexcept {
+          child_indexes[child_i] = next_child;
+          children[next_child] = source_node.children[child_i].load();
+          ++next_child;
+        });
+    UNODB_DETAIL_ASSERT(next_child <= basic_inode_48::capacity);
+    this->children_count = next_child;
+    for (unsigned i = next_child; i < basic_inode_48::capacity; ++i)
+      children[i] = node_ptr{nullptr};
+    occupied_slots = (1ULL << next_child) - 1;
+  }
+
+  constexpr void init(const sorted_children<node_ptr> &source) noexcept {
+    UNODB_DETAIL_ASSERT(source.count >= parent_class::min_size);
+
+    unsigned i = 0;
+    for (; i < source.count; ++i) {
+      child_indexes[static_cast<std::uint8_t>(source.key_bytes[i])] =
+          gsl::narrow_cast<std::uint8_t>(i);
+      children[i] = source.children[i];
+    }
+    for (; i < basic_inode_48::capacity; ++i) children[i] = node_ptr{nullptr};
+    occupied_slots = (1ULL << source.count) - 1;
+  }
+
+  constexpr void add_to_nonfull(db_leaf_unique_ptr &&child, tree_depth depth,
+                                std::uint8_t children_count_) noexcept {
+    UNODB_DETAIL_ASSERT(this->children_count == children_count_);
+    UNODB_DETAIL_ASSERT(children_count_ >= parent_class::hysteresis_min_size);
+    UNODB_DETAIL_ASSERT(children_count_ < parent_class::capacity);
+
+    const auto key_byte = static_cast<uint8_t>(child->get_key()[depth]);
+    UNODB_DETAIL_ASSERT(child_indexes[key_byte] == empty_child);
+    const auto occupied_slots_ = occupied_slots.load();
+    UNODB_DETAIL_ASSERT(occupied_slots_ != all_slots_occupied);
+    const unsigned i = detail::ctz(~occupied_slots_);
 
 #ifndef NDEBUG
     UNODB_DETAIL_ASSERT(i < parent_class::capacity);
-    UNODB_DETAIL_ASSERT(children.pointer_array[i] == nullptr);
+    UNODB_DETAIL_ASSERT(children[i] == nullptr);
     for (unsigned j = 0; j < i; ++j)
-      UNODB_DETAIL_ASSERT(children.pointer_array[j] != nullptr);
+      UNODB_DETAIL_ASSERT(children[j] != nullptr);
 #endif
 
     child_indexes[key_byte] = gsl::narrow_cast<std::uint8_t>(i);
-    children.pointer_array[i] = node_ptr{child.release(), node_type::LEAF};
+    children[i] = node_ptr{child.release(), node_type::LEAF};
+    occupied_slots = occupied_slots_ | (1ULL << i);
     this->children_count = children_count_ + 1U;
   }
 
   constexpr void remove(std::uint8_t child_index, db &db_instance) noexcept {
     remove_child_pointer(child_index, db_instance);
-    children.pointer_array[child_indexes[child_index]] = node_ptr{nullptr};
+    const auto children_i = child_indexes[child_index].load();
+    children[children_i] = node_ptr{nullptr};
+    occupied_slots = occupied_slots.load() & ~(1ULL << children_i);
     child_indexes[child_index] = empty_child;
     --this->children_count;
   }
 
+  // Any child, which may be null or inconsistent in the case of OLC
+  [[nodiscard]] constexpr node_ptr any_child() const noexcept {
+    const auto occupied_slots_ = occupied_slots.load();
+    if (UNODB_DETAIL_UNLIKELY(occupied_slots_ == 0)) return node_ptr{nullptr};
+    return children[detail::ctz(occupied_slots_)].load();
+  }
+
   UNODB_DETAIL_DISABLE_MSVC_WARNING(26434)
   [[nodiscard]] constexpr typename basic_inode_48::find_result find_child(
       std::byte key_byte) noexcept {
+    // The child indexes follow the header directly, so that the first of them
+    // share its cache line. Each child pointer is in a single line.
+    UNODB_DETAIL_DISABLE_GCC_WARNING("-Winvalid-offsetof")
+    UNODB_DETAIL_DISABLE_CLANG_WARNING("-Winvalid-offsetof")
+    static_assert(offsetof(basic_inode_48, child_indexes) <
+                  hardware_constructive_interference_size);
+    static_assert(offsetof(basic_inode_48, children) % sizeof(node_ptr) == 0);
+    UNODB_DETAIL_RESTORE_CLANG_WARNINGS()
+    UNODB_DETAIL_RESTORE_GCC_WARNINGS()
+
     const auto child_i =
         child_indexes[static_cast<std::uint8_t>(key_byte)].load();
     if (child_i != empty_child) {
       return std::make_pair(static_cast<std::uint8_t>(key_byte),
-                            &children.pointer_array[child_i]);
+                            &children[child_i]);
     }
     return parent_class::child_not_found;
   }
   UNODB_DETAIL_RESTORE_MSVC_WARNINGS()
 
+  // The child pointer line depends on the index, which is not known yet
+  void prefetch_lookup_line(std::byte key_byte) const noexcept {
+    detail::prefetch(&child_indexes[static_cast<std::uint8_t>(key_byte)]);
+  }
+
+  // Call func with the key byte and the pointer of every child, in increasing
+  // key byte order
+  template <typename Function>
+  constexpr void for_each_child(Function func) const
+      noexcept(noexcept(func(0, node_ptr{nullptr}))) {
+    for (unsigned i = 0; i < 256; ++i) {
+      const auto children_i = child_indexes[i].load();
+      if (children_i != empty_child) func(i, children[children_i].load());
+    }
+  }
+
   constexpr void delete_subtree(db &db_instance) noexcept {
 #ifndef NDEBUG
     const auto children_count_ = this->children_count.load();
     unsigned actual_children_count = 0;
 #endif
 
-    for (unsigned i = 0; i < this->capacity; ++i) {
-      const auto child = children.pointer_array[i].load();
-      if (child != nullptr) {
-        ArtPolicy::delete_subtree(child, db_instance);
+    for_each_occupied_slot([&](unsigned i) noexcept {
+      ArtPolicy::delete_subtree(children[i].load(), db_instance);
 #ifndef NDEBUG
-        ++actual_children_count;
-        UNODB_DETAIL_ASSERT(actual_children_count <= children_count_);
+      ++actual_children_count;
+      UNODB_DETAIL_ASSERT(actual_children_count <= children_count_);
 #endif
-      }
-    }
+    });
     UNODB_DETAIL_ASSERT(actual_children_count == children_count_);
   }
 
@@ -1708,10 +2357,10 @@ class basic_inode_48 : public basic_inode_48_parent<ArtPolicy> {
         dump_byte(os, gsl::narrow_cast<std::byte>(i));
         os << ", child index = " << static_cast<unsigned>(child_indexes[i])
            << ": ";
-        UNODB_DETAIL_ASSERT(children.pointer_array[child_indexes[i]] !=
+        UNODB_DETAIL_ASSERT(children[child_indexes[i]] !=
                             nullptr);
         ArtPolicy::dump_node(os,
-                             children.pointer_array[child_indexes[i]].load());
+                             children[child_indexes[i]].load());
 #ifndef NDEBUG
         ++actual_children_count;
         UNODB_DETAIL_ASSERT(actual_children_count <= children_count_);
@@ -1723,6 +2372,19 @@ class basic_inode_48 : public basic_inode_48_parent<ArtPolicy> {
   UNODB_DETAIL_RESTORE_MSVC_WARNINGS()
 
  private:
+  // Call func with the index of every occupied children slot, in slot order
+  template <typename Function>
+  constexpr void for_each_occupied_slot(Function func) const
+      noexcept(noexcept(func(0U))) {
+    auto remaining = occupied_slots.load();
+    while (remaining != 0) {
+      const unsigned i = detail::ctz(remaining);
+      UNODB_DETAIL_ASSERT(children[i] != nullptr);
+      func(i);
+      remaining &= remaining - 1;
+    }
+  }
+
   constexpr void remove_child_pointer(std::uint8_t child_index,
                                       db &db_instance) noexcept {
     direct_remove_child_pointer(child_indexes[child_index], db_instance);
@@ -1733,12 +2395,15 @@ class basic_inode_48 : public basic_inode_48_parent<ArtPolicy> {
     UNODB_DETAIL_ASSERT(children_i != empty_child);
 
     const auto r{ArtPolicy::reclaim_leaf_on_scope_exit(
-        children.pointer_array[children_i].load().template ptr<leaf_type *>(),
+        children[children_i].load().template ptr<leaf_type *>(),
         db_instance)};
   }
 
   static constexpr std::uint8_t empty_child = 0xFF;
 
+  static constexpr std::uint64_t all_slots_occupied =
+      (1ULL << basic_inode_48::capacity) - 1;
+
   // The only way I found to initialize this array so that everyone is happy and
   // efficient. In the case of OLC, a std::fill compiles to a loop doing a
   // single byte per iteration. memset is likely an UB, and atomic_ref is not
@@ -1798,34 +2463,15 @@ class basic_inode_48 : public basic_inode_48_parent<ArtPolicy> {
       empty_child, empty_child, empty_child, empty_child, empty_child,
       empty_child};
 
-  union children_union {
-    std::array<critical_section_policy<node_ptr>, basic_inode_48::capacity>
-        pointer_array;
-#ifdef UNODB_DETAIL_SSE4_2
-    static_assert(basic_inode_48::capacity % 8 == 0);
-    // No std::array below because it would ignore the alignment attribute
-    // NOLINTNEXTLINE(modernize-avoid-c-arrays)
-    __m128i
-        pointer_vector[basic_inode_48::capacity / 2];  // NOLINT(runtime/arrays)
-#elif defined(UNODB_DETAIL_AVX2)
-    static_assert(basic_inode_48::capacity % 16 == 0);
-    // NOLINTNEXTLINE(modernize-avoid-c-arrays)
-    __m256i
-        pointer_vector[basic_inode_48::capacity / 4];  // NOLINT(runtime/arrays)
-#elif defined(__aarch64__)
-    static_assert(basic_inode_48::capacity % 8 == 0);
-    // NOLINTNEXTLINE(modernize-avoid-c-arrays)
-    uint64x2_t
-        pointer_vector[basic_inode_48::capacity / 2];  // NOLINT(runtime/arrays)
-#endif
+  // Bit i is set iff children[i] is not null. Only written under the node write
+  // lock, so that the first free slot on insert is a single ctz.
+  critical_section_policy<std::uint64_t> occupied_slots;
 
-    UNODB_DETAIL_DISABLE_MSVC_WARNING(26495)
-    children_union() noexcept {}
-    UNODB_DETAIL_RESTORE_MSVC_WARNINGS()
-  } children;
+  std::array<critical_section_policy<node_ptr>, basic_inode_48::capacity>
+      children;
 
   template <class>
-  friend class basic_inode_16;
+  friend class basic_inode_32;
   template <class>
   friend class basic_inode_256;
 };
@@ -1854,6 +2500,12 @@ class basic_inode_256 : public basic_inode_256_parent<ArtPolicy> {
 
   UNODB_DETAIL_DISABLE_MSVC_WARNING(26434)
 
+  // An empty node without key prefix, only usable as a permanent tree root
+  explicit basic_inode_256(db &) noexcept {
+    for (auto &word : present_children) word = 0;
+    for (auto &child : children) child = node_ptr{nullptr};
+  }
+
   constexpr basic_inode_256(db &, const inode48_type &source_node) noexcept
       : parent_class{source_node} {}
 
@@ -1864,6 +2516,12 @@ class basic_inode_256 : public basic_inode_256_parent<ArtPolicy> {
     init(db_instance, source_node, std::move(child), depth);
   }
 
+  constexpr basic_inode_256(db &, art_key shifted_key, unsigned key_prefix_len,
+                            const sorted_children<node_ptr> &source) noexcept
+      : parent_class{shifted_key, key_prefix_len, source.count} {
+    init(source);
+  }
+
   UNODB_DETAIL_RESTORE_MSVC_WARNINGS()
 
   constexpr void init(db &db_instance, inode48_type &__restrict source_node,
@@ -1871,6 +2529,7 @@ class basic_inode_256 : public basic_inode_256_parent<ArtPolicy> {
     const auto reclaim_source_node{
         ArtPolicy::template make_db_inode_reclaimable_ptr(&source_node,
                                                           db_instance)};
+    std::array<std::uint64_t, present_word_count> present{};
     unsigned children_copied = 0;
     unsigned i = 0;
     while (true) {
@@ -1878,7 +2537,8 @@ class basic_inode_256 : public basic_inode_256_parent<ArtPolicy> {
       if (children_i == inode48_type::empty_child) {
         children[i] = node_ptr{nullptr};
       } else {
-        children[i] = source_node.children.pointer_array[children_i].load();
+        children[i] = source_node.children[children_i].load();
+        present[i / 64] |= 1ULL << (i % 64);
         ++children_copied;
         if (children_copied == inode48_type::capacity) break;
       }
@@ -1891,6 +2551,23 @@ class basic_inode_256 : public basic_inode_256_parent<ArtPolicy> {
     const auto key_byte = static_cast<uint8_t>(child->get_key()[depth]);
     UNODB_DETAIL_ASSERT(children[key_byte] == nullptr);
     children[key_byte] = node_ptr{child.release(), node_type::LEAF};
+    present[key_byte / 64] |= 1ULL << (key_byte % 64);
+
+    for (i = 0; i < present_word_count; ++i) present_children[i] = present[i];
+  }
+
+  constexpr void init(const sorted_children<node_ptr> &source) noexcept {
+    UNODB_DETAIL_ASSERT(source.count >= parent_class::min_size);
+
+    for (auto &child : children) child = node_ptr{nullptr};
+    std::array<std::uint64_t, present_word_count> present{};
+    for (unsigned i = 0; i < source.count; ++i) {
+      const auto key_byte = static_cast<std::uint8_t>(source.key_bytes[i]);
+      children[key_byte] = source.children[i];
+      present[key_byte / 64] |= 1ULL << (key_byte % 64);
+    }
+    for (unsigned i = 0; i < present_word_count; ++i)
+      present_children[i] = present[i];
   }
 
   constexpr void add_to_nonfull(db_leaf_unique_ptr &&child, tree_depth depth,
@@ -1901,6 +2578,7 @@ class basic_inode_256 : public basic_inode_256_parent<ArtPolicy> {
     const auto key_byte = static_cast<std::uint8_t>(child->get_key()[depth]);
     UNODB_DETAIL_ASSERT(children[key_byte] == nullptr);
     children[key_byte] = node_ptr{child.release(), node_type::LEAF};
+    set_present(key_byte);
     this->children_count = children_count_ + 1U;
   }
 
@@ -1909,12 +2587,41 @@ class basic_inode_256 : public basic_inode_256_parent<ArtPolicy> {
         children[child_index].load().template ptr<leaf_type *>(), db_instance)};
 
     children[child_index] = node_ptr{nullptr};
+    clear_present(child_index);
     --this->children_count;
   }
 
+  // Add a child subtree at an absent key byte, for building the subtrees of
+  // the permanent root one by one
+  constexpr void add_subtree(std::uint8_t key_byte, node_ptr child) noexcept {
+    UNODB_DETAIL_ASSERT(children[key_byte] == nullptr);
+    UNODB_DETAIL_ASSERT(child != nullptr);
+
+    children[key_byte] = child;
+    set_present(key_byte);
+    ++this->children_count;
+  }
+
+  // Any child, which may be null or inconsistent in the case of OLC
+  [[nodiscard]] constexpr node_ptr any_child() const noexcept {
+    for (unsigned word_i = 0; word_i < present_word_count; ++word_i) {
+      const auto present = present_children[word_i].load();
+      if (present != 0)
+        return children[word_i * 64 + detail::ctz(present)].load();
+    }
+    return node_ptr{nullptr};
+  }
+
   UNODB_DETAIL_DISABLE_MSVC_WARNING(26434)
   [[nodiscard]] constexpr typename basic_inode_256::find_result find_child(
       std::byte key_byte) noexcept {
+    // The header line and the line of the matched child pointer
+    UNODB_DETAIL_DISABLE_GCC_WARNING("-Winvalid-offsetof")
+    UNODB_DETAIL_DISABLE_CLANG_WARNING("-Winvalid-offsetof")
+    static_assert(offsetof(basic_inode_256, children) % sizeof(node_ptr) == 0);
+    UNODB_DETAIL_RESTORE_CLANG_WARNINGS()
+    UNODB_DETAIL_RESTORE_GCC_WARNINGS()
+
     const auto key_int_byte = static_cast<std::uint8_t>(key_byte);
     if (children[key_int_byte] != nullptr)
       return std::make_pair(key_int_byte, &children[key_int_byte]);
@@ -1922,6 +2629,13 @@ class basic_inode_256 : public basic_inode_256_parent<ArtPolicy> {
   }
   UNODB_DETAIL_RESTORE_MSVC_WARNINGS()
 
+  void prefetch_lookup_line(std::byte key_byte) const noexcept {
+    detail::prefetch(&children[static_cast<std::uint8_t>(key_byte)]);
+  }
+
+  // Call func with the key byte and the pointer of every child, in increasing
+  // key byte order. An optimistic reader may see the node being modified, and
+  // must validate the results with the node version afterwards.
   template <typename Function>
   constexpr void for_each_child(Function func) const
       noexcept(noexcept(func(0, node_ptr{nullptr}))) {
@@ -1930,18 +2644,20 @@ class basic_inode_256 : public basic_inode_256_parent<ArtPolicy> {
     std::uint8_t actual_children_count = 0;
 #endif
 
-    for (unsigned i = 0; i < 256; ++i) {
-      const auto child_ptr = children[i].load();
-      if (child_ptr != nullptr) {
-        func(i, child_ptr);
+    for_each_present_index(
+        [&](unsigned i) noexcept(noexcept(func(0, node_ptr{nullptr}))) {
+          func(i, children[i].load());
 #ifndef NDEBUG
-        ++actual_children_count;
-        UNODB_DETAIL_ASSERT(actual_children_count <= children_count_ ||
-                            children_count_ == 0);
+          ++actual_children_count;
+          if constexpr (!critical_section_policy<node_ptr>::concurrent_access) {
+            UNODB_DETAIL_ASSERT(actual_children_count <= children_count_ ||
+                                children_count_ == 0);
+          }
 #endif
-      }
+        });
+    if constexpr (!critical_section_policy<node_ptr>::concurrent_access) {
+      UNODB_DETAIL_ASSERT(actual_children_count == children_count_);
     }
-    UNODB_DETAIL_ASSERT(actual_children_count == children_count_);
   }
 
   constexpr void delete_subtree(db &db_instance) noexcept {
@@ -1950,6 +2666,14 @@ class basic_inode_256 : public basic_inode_256_parent<ArtPolicy> {
     });
   }
 
+  // Delete all the children, leaving this node empty
+  void delete_children(db &db_instance) noexcept {
+    delete_subtree(db_instance);
+    for (auto &word : present_children) word = 0;
+    for (auto &child : children) child = node_ptr{nullptr};
+    this->children_count = 0;
+  }
+
   UNODB_DETAIL_DISABLE_MSVC_WARNING(26434)
   [[gnu::cold]] UNODB_DETAIL_NOINLINE void dump(std::ostream &os) const {
     parent_class::dump(os);
@@ -1964,6 +2688,41 @@ class basic_inode_256 : public basic_inode_256_parent<ArtPolicy> {
   UNODB_DETAIL_RESTORE_MSVC_WARNINGS()
 
  private:
+  static constexpr unsigned present_word_count = basic_inode_256::capacity / 64;
+
+  constexpr void set_present(std::uint8_t i) noexcept {
+    present_children[i / 64] =
+        present_children[i / 64].load() | (1ULL << (i % 64));
+  }
+
+  constexpr void clear_present(std::uint8_t i) noexcept {
+    present_children[i / 64] =
+        present_children[i / 64].load() & ~(1ULL << (i % 64));
+  }
+
+  // Call func with the key byte of every present child in increasing order,
+  // touching only the children that are present
+  template <typename Function>
+  constexpr void for_each_present_index(Function func) const
+      noexcept(noexcept(func(0U))) {
+    for (unsigned word_i = 0; word_i < present_word_count; ++word_i) {
+      auto remaining = present_children[word_i].load();
+      while (remaining != 0) {
+        const auto i = word_i * 64 + detail::ctz(remaining);
+        if constexpr (!critical_section_policy<node_ptr>::concurrent_access) {
+          UNODB_DETAIL_ASSERT(children[i] != nullptr);
+        }
+        func(i);
+        remaining &= remaining - 1;
+      }
+    }
+  }
+
+  // Bit i % 64 of word i / 64 is set iff children[i] is not null. Only written
+  // under the node write lock.
+  std::array<critical_section_policy<std::uint64_t>, present_word_count>
+      present_children;
+
   std::array<critical_section_policy<node_ptr>, basic_inode_256::capacity>
       children;
 
@@ -1971,6 +2730,172 @@ class basic_inode_256 : public basic_inode_256_parent<ArtPolicy> {
   friend class basic_inode_48;
 };
 
+// Builds a subtree from leaves added in increasing key order, without searching
+// for their positions nor growing inodes. The inodes on the path to the last
+// added leaf are open: their children so far are collected, and the inode is
+// created at its final size once a key shows that no more children follow. The
+// subtree starts at start_depth, and all its keys must share the bytes above.
+template <class ArtPolicy>
+class [[nodiscard]] basic_sorted_tree_builder final {
+ public:
+  using node_ptr = typename ArtPolicy::node_ptr;
+  using db = typename ArtPolicy::db;
+
+  basic_sorted_tree_builder(db &db_instance_, tree_depth start_depth_) noexcept
+      : db_instance{db_instance_}, start_depth{start_depth_} {}
+
+  ~basic_sorted_tree_builder() noexcept {
+    if (last_child != nullptr)
+      ArtPolicy::delete_subtree(last_child, db_instance);
+    for (unsigned i = 0; i < open_inode_count; ++i) {
+      const auto &children = open_inodes[i].children;
+      for (unsigned j = 0; j < children.count; ++j)
+        ArtPolicy::delete_subtree(children.children[j], db_instance);
+    }
+  }
+
+  void add(art_key k, value_view v) {
+    auto leaf{ArtPolicy::make_db_leaf_ptr(k, v, db_instance)};
+
+    if (last_child != nullptr) {
+      UNODB_DETAIL_ASSERT(
+          std::memcmp(&last_key.key_bytes, &k.key_bytes, art_key::size) < 0);
+      UNODB_DETAIL_ASSERT(k.shares_leading_bytes(last_key, start_depth));
+
+      // The first key byte that differs from the last key is where the new
+      // leaf branches off, closing all the open inodes below it
+      unsigned branch_depth = start_depth;
+      while (k[branch_depth] == last_key[branch_depth]) ++branch_depth;
+      UNODB_DETAIL_ASSERT(branch_depth < art_key::size);
+
+      while (open_inode_count > 0 &&
+             open_inodes[open_inode_count - 1].depth > branch_depth) {
+        const auto parent_depth =
+            (open_inode_count > 1 &&
+             open_inodes[open_inode_count - 2].depth > branch_depth)
+                ? open_inodes[open_inode_count - 2].depth + 1
+                : branch_depth + 1;
+        close_last_open_inode(parent_depth);
+      }
+
+      if (open_inode_count == 0 ||
+          open_inodes[open_inode_count - 1].depth < branch_depth) {
+        UNODB_DETAIL_ASSERT(open_inode_count < open_inodes.size());
+        auto &new_inode = open_inodes[open_inode_count];
+        new_inode.depth = branch_depth;
+        new_inode.children.count = 0;
+        ++open_inode_count;
+      }
+      open_inodes[open_inode_count - 1].children.append(
+          last_key[branch_depth], last_child);
+    }
+
+    last_child = node_ptr{leaf.release(), node_type::LEAF};
+    last_key = k;
+  }
+
+  // Return the root of the built subtree, or nullptr if nothing was added. The
+  // builder is then empty and may be reused for the same start depth.
+  [[nodiscard]] node_ptr finish() {
+    while (open_inode_count > 0) {
+      const auto parent_depth =
+          (open_inode_count > 1) ? open_inodes[open_inode_count - 2].depth + 1
+                                 : static_cast<unsigned>(start_depth);
+      close_last_open_inode(parent_depth);
+    }
+    const auto result = last_child;
+    last_child = node_ptr{nullptr};
+    return result;
+  }
+
+  basic_sorted_tree_builder(const basic_sorted_tree_builder &) = delete;
+  basic_sorted_tree_builder(basic_sorted_tree_builder &&) = delete;
+  basic_sorted_tree_builder &operator=(const basic_sorted_tree_builder &) =
+      delete;
+  basic_sorted_tree_builder &operator=(basic_sorted_tree_builder &&) = delete;
+
+ private:
+  using inode4_type = typename ArtPolicy::inode4_type;
+  using inode16_type = typename ArtPolicy::inode16_type;
+  using inode32_type = typename ArtPolicy::inode32_type;
+  using inode48_type = typename ArtPolicy::inode48_type;
+  using inode256_type = typename ArtPolicy::inode256_type;
+
+  struct open_inode final {
+    // The key byte index that selects the children
+    unsigned depth;
+    sorted_children<node_ptr> children;
+  };
+
+  // Make the last open inode, whose key prefix starts at parent_depth, the last
+  // child
+  void close_last_open_inode(unsigned parent_depth) {
+    auto &closing = open_inodes[open_inode_count - 1];
+    UNODB_DETAIL_ASSERT(parent_depth <= closing.depth);
+    closing.children.append(last_key[closing.depth], last_child);
+    last_child = node_ptr{nullptr};
+
+    auto shifted_key{last_key};
+    shifted_key.shift_right(parent_depth);
+    const auto key_prefix_len = closing.depth - parent_depth;
+    const auto children_count = closing.children.count;
+
+    if (children_count <= inode4_type::capacity) {
+      last_child =
+          make_inode<inode4_type>(shifted_key, key_prefix_len, closing);
+    } else if (children_count <= inode16_type::capacity) {
+      last_child =
+          make_inode<inode16_type>(shifted_key, key_prefix_len, closing);
+    } else if (children_count <= inode32_type::capacity) {
+      last_child =
+          make_inode<inode32_type>(shifted_key, key_prefix_len, closing);
+    } else if (children_count <= inode48_type::capacity) {
+      last_child =
+          make_inode<inode48_type>(shifted_key, key_prefix_len, closing);
+    } else {
+      last_child =
+          make_inode<inode256_type>(shifted_key, key_prefix_len, closing);
+    }
+    --open_inode_count;
+  }
+
+  template <class INode>
+  [[nodiscard]] node_ptr make_inode(art_key shifted_key,
+                                    unsigned key_prefix_len,
+                                    const open_inode &source) {
+    auto inode{INode::create(db_instance, shifted_key, key_prefix_len,
+                             source.children)};
+    // Account the inode as grown through all the smaller types, as if the tree
+    // was built by inserts, so that the growing counts stay upper bounds for
+    // the node and shrinking counts
+    db_instance.template account_growing_inode<node_type::I4>();
+    if constexpr (INode::type != node_type::I4)
+      db_instance.template account_growing_inode<node_type::I16>();
+    if constexpr (INode::type == node_type::I32 ||
+                  INode::type == node_type::I48 ||
+                  INode::type == node_type::I256)
+      db_instance.template account_growing_inode<node_type::I32>();
+    if constexpr (INode::type == node_type::I48 ||
+                  INode::type == node_type::I256)
+      db_instance.template account_growing_inode<node_type::I48>();
+    if constexpr (INode::type == node_type::I256)
+      db_instance.template account_growing_inode<node_type::I256>();
+    return node_ptr{inode.release(), INode::type};
+  }
+
+  db &db_instance;
+  const tree_depth start_depth;
+
+  // The last added leaf, or the last closed inode, which is not yet a child of
+  // an open inode
+  node_ptr last_child{nullptr};
+  art_key last_key{};
+
+  // Ordered by depth, each being the last child of the previous one
+  std::array<open_inode, art_key::size> open_inodes;
+  unsigned open_inode_count{0};
+};
+
 }  // namespace unodb::detail
 
 #endif  // UNODB_DETAIL_ART_INTERNAL_IMPL_HPP
@@ -5,6 +5,8 @@
 #include <array>
 #include <cstddef>
 #include <cstdint>
+#include <random>
+#include <vector>
 
 #include <benchmark/benchmark.h>
 
@@ -18,14 +20,14 @@
 
 namespace {
 
-template <class Db>
-void dense_insert(benchmark::State &state) {
+template <class Db, typename... DbArgs>
+void do_dense_insert(benchmark::State &state, DbArgs... db_args) {
   unodb::benchmark::growing_tree_node_stats<Db> growing_tree_stats;
   std::size_t tree_size = 0;
 
   for (const auto _ : state) {
     state.PauseTiming();
-    Db test_db;
+    Db test_db{db_args...};
     benchmark::ClobberMemory();
     state.ResumeTiming();
 
@@ -44,6 +46,17 @@ void dense_insert(benchmark::State &state) {
   unodb::benchmark::set_size_counter(state, "size", tree_size);
 }
 
+template <class Db>
+void dense_insert(benchmark::State &state) {
+  do_dense_insert<Db>(state);
+}
+
+// The second argument is the number of direct-mapped top-level key bytes
+template <class Db>
+void dense_insert_direct_mapped(benchmark::State &state) {
+  do_dense_insert<Db>(state, static_cast<unsigned>(state.range(1)));
+}
+
 template <class Db>
 void sparse_insert_dups_allowed(benchmark::State &state) {
   unodb::benchmark::batched_prng random_keys;
@@ -94,6 +107,35 @@ void dense_full_scan(benchmark::State &state) {
                           full_scan_multiplier);
   unodb::benchmark::set_size_counter(state, "size", tree_size);
 }
+constexpr std::size_t random_get_key_count = 1U << 16U;
+
+// Gets of random existing keys, missing the cache at most tree levels once the
+// tree no longer fits in it
+template <class Db>
+void dense_tree_random_gets(benchmark::State &state) {
+  Db test_db;
+  const auto key_limit = static_cast<unodb::key>(state.range(0));
+
+  for (unodb::key i = 0; i < key_limit; ++i)
+    unodb::benchmark::insert_key(test_db, i,
+                                 unodb::value_view{unodb::benchmark::value1});
+  const auto tree_size = test_db.get_current_memory_use();
+
+  // Generated up front, pausing the timer for refills would dominate the gets
+  std::vector<unodb::key> random_keys(random_get_key_count);
+  std::uniform_int_distribution<unodb::key> random_key_dist{0, key_limit - 1};
+  for (auto &k : random_keys) k = random_key_dist(unodb::benchmark::get_prng());
+  std::size_t i = 0;
+
+  for (const auto _ : state) {
+    unodb::benchmark::get_existing_key(test_db, random_keys[i]);
+    i = (i + 1) % random_get_key_count;
+  }
+
+  state.SetItemsProcessed(state.iterations());
+  unodb::benchmark::set_size_counter(state, "size", tree_size);
+}
+
 void dense_tree_sparse_deletes_args(benchmark::internal::Benchmark *b) {
   for (auto i = 1000; i <= 5000000; i *= 8) {
     b->Args({i, 800});
@@ -229,6 +271,95 @@ void dense_insert_dup_attempts(benchmark::State &state) {
   state.SetItemsProcessed(state.iterations() * state.range(0));
 }
 
+// Time-ordered IDs: a millisecond timestamp in the high bits and a per
+// millisecond sequence number in the low ones, always inserted at the rightmost
+// tree edge.
+template <class Db>
+void time_ordered_id_insert(benchmark::State &state) {
+  constexpr unodb::key ids_per_ms = 64;
+  constexpr unodb::key start_ms = 1'600'000'000'000ULL;
+  std::size_t tree_size = 0;
+
+  for (const auto _ : state) {
+    state.PauseTiming();
+    Db test_db;
+    benchmark::ClobberMemory();
+    state.ResumeTiming();
+
+    for (unodb::key i = 0; i < static_cast<unodb::key>(state.range(0)); ++i) {
+      const auto id = ((start_ms + i / ids_per_ms) << 22U) | (i % ids_per_ms);
+      unodb::benchmark::insert_key(
+          test_db, id, unodb::value_view{unodb::benchmark::value100});
+    }
+
+    state.PauseTiming();
+    tree_size = test_db.get_current_memory_use();
+    unodb::benchmark::destroy_tree(test_db, state);
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  unodb::benchmark::set_size_counter(state, "size", tree_size);
+}
+
+constexpr unodb::key node_capacity_churn_node_count = 4096;
+
+[[nodiscard]] std::uint64_t inode_type_changes(
+    const unodb::inode_type_counter_array &growing,
+    const unodb::inode_type_counter_array &shrinking) noexcept {
+  std::uint64_t result = 0;
+  for (const auto count : growing) result += count;
+  for (const auto count : shrinking) result += count;
+  return result;
+}
+
+// Insert and delete one key in each of the full inodes of the first argument
+// capacity, with the shrink policy given by the second argument. Reports how
+// many inodes are replaced per operation.
+template <class Db>
+void node_capacity_churn(benchmark::State &state) {
+  const auto capacity = static_cast<unodb::key>(state.range(0));
+  const auto policy = static_cast<unodb::shrink_policy>(state.range(1));
+
+  Db test_db{policy};
+  for (unodb::key node_i = 0; node_i < node_capacity_churn_node_count;
+       ++node_i) {
+    for (unodb::key child_i = 0; child_i < capacity; ++child_i) {
+      unodb::benchmark::insert_key(
+          test_db, (node_i << 8U) | child_i,
+          unodb::value_view{unodb::benchmark::value100});
+    }
+  }
+  const auto changes_before = inode_type_changes(
+      test_db.get_growing_inode_counts(), test_db.get_shrinking_inode_counts());
+
+  for (const auto _ : state) {
+    for (unodb::key node_i = 0; node_i < node_capacity_churn_node_count;
+         ++node_i) {
+      const auto k = (node_i << 8U) | capacity;
+      unodb::benchmark::insert_key(
+          test_db, k, unodb::value_view{unodb::benchmark::value100});
+      unodb::benchmark::delete_key(test_db, k);
+    }
+  }
+
+  const auto op_count = static_cast<std::uint64_t>(state.iterations()) *
+                        node_capacity_churn_node_count * 2;
+  const auto changes =
+      inode_type_changes(test_db.get_growing_inode_counts(),
+                         test_db.get_shrinking_inode_counts()) -
+      changes_before;
+  state.SetItemsProcessed(static_cast<std::int64_t>(op_count));
+  state.counters["inodes/op"] =
+      static_cast<double>(changes) / static_cast<double>(op_count);
+}
+
+void node_capacity_churn_args(benchmark::internal::Benchmark *b) {
+  for (const auto capacity : {4, 16, 32, 48}) {
+    b->Args({capacity, static_cast<int>(unodb::shrink_policy::EAGER)});
+    b->Args({capacity, static_cast<int>(unodb::shrink_policy::HYSTERESIS)});
+  }
+}
+
 }  // namespace
 
 UNODB_START_BENCHMARKS()
@@ -244,6 +375,12 @@ BENCHMARK_TEMPLATE(dense_insert, unodb::mutex_db)
 BENCHMARK_TEMPLATE(dense_insert, unodb::olc_db)
     ->Range(100, 30000000)
     ->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(dense_insert_direct_mapped, unodb::db)
+    ->Ranges({{100, 30000000}, {1, 2}})
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(dense_insert_direct_mapped, unodb::olc_db)
+    ->Ranges({{100, 30000000}, {1, 2}})
+    ->Unit(benchmark::kMicrosecond);
 
 BENCHMARK_TEMPLATE(sparse_insert_dups_allowed, unodb::db)
     ->Range(100, 10000000)
@@ -265,6 +402,16 @@ BENCHMARK_TEMPLATE(dense_full_scan, unodb::olc_db)
     ->Range(100, 20000000)
     ->Unit(benchmark::kMicrosecond);
 
+BENCHMARK_TEMPLATE(dense_tree_random_gets, unodb::db)
+    ->Range(10000, 100000000)
+    ->Unit(benchmark::kNanosecond);
+BENCHMARK_TEMPLATE(dense_tree_random_gets, unodb::mutex_db)
+    ->Range(10000, 100000000)
+    ->Unit(benchmark::kNanosecond);
+BENCHMARK_TEMPLATE(dense_tree_random_gets, unodb::olc_db)
+    ->Range(10000, 100000000)
+    ->Unit(benchmark::kNanosecond);
+
 BENCHMARK_TEMPLATE(dense_tree_sparse_deletes, unodb::db)
     ->ArgNames({"", "deletes"})
     ->Apply(dense_tree_sparse_deletes_args)
@@ -311,4 +458,27 @@ BENCHMARK_TEMPLATE(dense_insert_dup_attempts, unodb::olc_db)
     ->Range(100, 30000000)
     ->Unit(benchmark::kMicrosecond);
 
+BENCHMARK_TEMPLATE(time_ordered_id_insert, unodb::db)
+    ->Range(100, 30000000)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(time_ordered_id_insert, unodb::mutex_db)
+    ->Range(100, 30000000)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(time_ordered_id_insert, unodb::olc_db)
+    ->Range(100, 30000000)
+    ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_TEMPLATE(node_capacity_churn, unodb::db)
+    ->ArgNames({"capacity", "hysteresis"})
+    ->Apply(node_capacity_churn_args)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(node_capacity_churn, unodb::mutex_db)
+    ->ArgNames({"capacity", "hysteresis"})
+    ->Apply(node_capacity_churn_args)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(node_capacity_churn, unodb::olc_db)
+    ->ArgNames({"capacity", "hysteresis"})
+    ->Apply(node_capacity_churn_args)
+    ->Unit(benchmark::kMicrosecond);
+
 UNODB_BENCHMARK_MAIN();
@@ -0,0 +1,127 @@
+// Copyright 2022 Laurynas Biveinis
+
+#include "global.hpp"  // IWYU pragma: keep
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "art.hpp"
+#include "art_common.hpp"
+#include "compact_art.hpp"
+#include "micro_benchmark_utils.hpp"
+
+namespace {
+
+constexpr std::size_t random_get_key_count = 1U << 16U;
+
+// The second benchmark argument selects dense keys if zero and keys spread
+// over the whole key space otherwise
+[[nodiscard]] constexpr unodb::key make_key(std::uint64_t i,
+                                            bool sparse) noexcept {
+  return sparse ? i * 0x9E3779B97F4A7C15ULL : i;
+}
+
+void make_source_db(unodb::db &source, std::uint64_t key_count, bool sparse) {
+  for (std::uint64_t i = 0; i < key_count; ++i)
+    unodb::benchmark::insert_key(source, make_key(i, sparse),
+                                 unodb::value_view{unodb::benchmark::value10});
+}
+
+[[nodiscard]] std::vector<unodb::key> make_random_keys(std::uint64_t key_count,
+                                                       bool sparse) {
+  std::vector<unodb::key> result(random_get_key_count);
+  std::uniform_int_distribution<std::uint64_t> random_i{0, key_count - 1};
+  for (auto &k : result)
+    k = make_key(random_i(unodb::benchmark::get_prng()), sparse);
+  return result;
+}
+
+void set_bytes_per_key_counter(benchmark::State &state, const char *label,
+                               std::size_t bytes, std::uint64_t key_count) {
+  state.counters[label] = benchmark::Counter(
+      static_cast<double>(bytes) / static_cast<double>(key_count));
+}
+
+// Builds a compact_db from a db, and reports the memory use of both per key
+void compact_build(benchmark::State &state) {
+  const auto key_count = static_cast<std::uint64_t>(state.range(0));
+  unodb::db source;
+  make_source_db(source, key_count, state.range(1) != 0);
+  std::size_t compact_size = 0;
+
+  for (const auto _ : state) {
+    const unodb::compact_db compact{source};
+
+    state.PauseTiming();
+    compact_size = compact.get_current_memory_use();
+    state.ResumeTiming();
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  set_bytes_per_key_counter(state, "db B/key",
+                            source.get_current_memory_use(), key_count);
+  set_bytes_per_key_counter(state, "compact B/key", compact_size, key_count);
+}
+
+// Gets of random existing keys, the baseline for compact_random_gets
+void db_random_gets(benchmark::State &state) {
+  const auto key_count = static_cast<std::uint64_t>(state.range(0));
+  const auto sparse = state.range(1) != 0;
+  unodb::db test_db;
+  make_source_db(test_db, key_count, sparse);
+  const auto random_keys = make_random_keys(key_count, sparse);
+  std::size_t i = 0;
+
+  for (const auto _ : state) {
+    unodb::benchmark::get_existing_key(test_db, random_keys[i]);
+    i = (i + 1) % random_get_key_count;
+  }
+
+  state.SetItemsProcessed(state.iterations());
+  set_bytes_per_key_counter(state, "B/key", test_db.get_current_memory_use(),
+                            key_count);
+}
+
+void compact_random_gets(benchmark::State &state) {
+  const auto key_count = static_cast<std::uint64_t>(state.range(0));
+  const auto sparse = state.range(1) != 0;
+  unodb::db source;
+  make_source_db(source, key_count, sparse);
+  const unodb::compact_db compact{source};
+  source.clear();
+  const auto random_keys = make_random_keys(key_count, sparse);
+  std::size_t i = 0;
+
+  for (const auto _ : state) {
+    const auto result = compact.get(random_keys[i]);
+    UNODB_DETAIL_ASSERT(unodb::compact_db::key_found(result));
+    benchmark::DoNotOptimize(result);
+    i = (i + 1) % random_get_key_count;
+  }
+
+  state.SetItemsProcessed(state.iterations());
+  set_bytes_per_key_counter(state, "B/key", compact.get_current_memory_use(),
+                            key_count);
+}
+
+void compact_args(benchmark::internal::Benchmark *b) {
+  for (const auto key_count : {10000, 1000000, 10000000})
+    for (const auto sparse : {0, 1}) b->Args({key_count, sparse});
+}
+
+}  // namespace
+
+UNODB_START_BENCHMARKS()
+
+BENCHMARK(compact_build)
+    ->Apply(compact_args)
+    ->ArgNames({"", "sparse"})
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(db_random_gets)->Apply(compact_args)->ArgNames({"", "sparse"});
+BENCHMARK(compact_random_gets)->Apply(compact_args)->ArgNames({"", "sparse"});
+
+UNODB_BENCHMARK_MAIN();
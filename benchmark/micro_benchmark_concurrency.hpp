@@ -56,6 +56,10 @@ class [[nodiscard]] concurrent_benchmark {
 
   virtual void teardown() noexcept {}
 
+  [[nodiscard]] virtual std::unique_ptr<Db> make_db() const {
+    return std::make_unique<Db>();
+  }
+
   UNODB_DETAIL_RESTORE_GCC_WARNINGS()
 
  public:
@@ -66,7 +70,7 @@ class [[nodiscard]] concurrent_benchmark {
     const auto num_of_threads = static_cast<std::size_t>(state.range(0));
     const auto tree_size = static_cast<unodb::key>(state.range(1));
 
-    test_db = std::make_unique<Db>();
+    test_db = make_db();
 
     for (unodb::key i = 0; i < tree_size; ++i)
       insert_key(*test_db, i, values[i % values.size()]);
@@ -87,7 +91,7 @@ class [[nodiscard]] concurrent_benchmark {
 
     for (const auto _ : state) {
       state.PauseTiming();
-      test_db = std::make_unique<Db>();
+      test_db = make_db();
 
       do_parallel_test(*test_db, num_of_threads, tree_size,
                        parallel_insert_worker, state);
@@ -106,7 +110,7 @@ class [[nodiscard]] concurrent_benchmark {
     for (const auto _ : state) {
       state.PauseTiming();
 
-      test_db = std::make_unique<Db>();
+      test_db = make_db();
       for (unodb::key i = 0; i < tree_size; ++i)
         insert_key(*test_db, i, values[i % values.size()]);
 
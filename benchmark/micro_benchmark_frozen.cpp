@@ -0,0 +1,96 @@
+// Copyright 2022 Laurynas Biveinis
+
+#include "global.hpp"  // IWYU pragma: keep
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <sstream>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "art.hpp"
+#include "art_common.hpp"
+#include "frozen_art.hpp"
+#include "micro_benchmark_node_utils.hpp"
+#include "micro_benchmark_utils.hpp"
+
+namespace {
+
+constexpr std::size_t random_get_key_count = 1U << 16U;
+
+// Keys spread over the whole key space, so that the tree has inodes of several
+// types and key prefixes at every level
+[[nodiscard]] constexpr unodb::key spread_key(std::uint64_t i) noexcept {
+  return i * 0x9E3779B97F4A7C15ULL;
+}
+
+void make_source_db(unodb::db &source, std::uint64_t key_count) {
+  for (std::uint64_t i = 0; i < key_count; ++i)
+    unodb::benchmark::insert_key(source, spread_key(i),
+                                 unodb::value_view{unodb::benchmark::value10});
+}
+
+[[nodiscard]] std::vector<unodb::key> make_random_keys(
+    std::uint64_t key_count) {
+  std::vector<unodb::key> result(random_get_key_count);
+  std::uniform_int_distribution<std::uint64_t> random_i{0, key_count - 1};
+  for (auto &k : result) k = spread_key(random_i(unodb::benchmark::get_prng()));
+  return result;
+}
+
+// Gets of random existing keys, the baseline for frozen_random_gets
+void db_random_gets(benchmark::State &state) {
+  const auto key_count = static_cast<std::uint64_t>(state.range(0));
+  unodb::db test_db;
+  make_source_db(test_db, key_count);
+  const auto random_keys = make_random_keys(key_count);
+  std::size_t i = 0;
+
+  for (const auto _ : state) {
+    unodb::benchmark::get_existing_key(test_db, random_keys[i]);
+    i = (i + 1) % random_get_key_count;
+  }
+
+  state.SetItemsProcessed(state.iterations());
+  unodb::benchmark::set_size_counter(state, "size",
+                                     test_db.get_current_memory_use());
+}
+
+void frozen_random_gets(benchmark::State &state) {
+  const auto key_count = static_cast<std::uint64_t>(state.range(0));
+  std::vector<std::byte> image;
+  {
+    unodb::db source;
+    make_source_db(source, key_count);
+    std::ostringstream os;
+    unodb::frozen_db::write(source, os);
+    const auto image_str = os.str();
+    image.resize(image_str.size());
+    std::memcpy(image.data(), image_str.data(), image_str.size());
+  }
+  const unodb::frozen_db frozen{unodb::value_view{image.data(), image.size()}};
+  const auto random_keys = make_random_keys(key_count);
+  std::size_t i = 0;
+
+  for (const auto _ : state) {
+    const auto result = frozen.get(random_keys[i]);
+    UNODB_DETAIL_ASSERT(unodb::frozen_db::key_found(result));
+    benchmark::DoNotOptimize(result);
+    i = (i + 1) % random_get_key_count;
+  }
+
+  state.SetItemsProcessed(state.iterations());
+  unodb::benchmark::set_size_counter(state, "size", frozen.get_image_size());
+}
+
+}  // namespace
+
+UNODB_START_BENCHMARKS()
+
+BENCHMARK(db_random_gets)->Range(10000, 10000000);
+BENCHMARK(frozen_random_gets)->Range(10000, 10000000);
+
+UNODB_BENCHMARK_MAIN();
@@ -98,6 +98,57 @@ void unpredictable_get_shared_length(benchmark::State &state) {
 
 /*
 
+Get keys through the longest possible key prefixes, which are checked
+optimistically if the build stores fewer key prefix bytes:
+
+I256 root keys:
+0x00
+  I4 0x0 0x0 0x0 0x0 0x0 0x0 - prefix, keys:
+                             0x0
+                           L 0x0
+                             0x1
+                           L 0x1
+...
+0xFF
+  I4 0x0 0x0 0x0 0x0 0x0 0x0 - prefix, keys:
+                             0x0
+                           L 0x0
+                             0x1
+                           L 0x1
+
+*/
+
+template <class Db>
+void full_key_prefix_get(benchmark::State &state) {
+  std::vector<unodb::key> search_keys{};
+  search_keys.reserve(256 * 2);
+  Db test_db;
+  for (std::uint64_t top_byte = 0x00; top_byte <= 0xFF; ++top_byte) {
+    const auto first_key = top_byte << 56U;
+    const auto second_key = first_key | 1U;
+    unodb::benchmark::insert_key(test_db, first_key,
+                                 unodb::value_view{unodb::benchmark::value100});
+    unodb::benchmark::insert_key(test_db, second_key,
+                                 unodb::value_view{unodb::benchmark::value100});
+    search_keys.push_back(first_key);
+    search_keys.push_back(second_key);
+  }
+
+  for (const auto _ : state) {
+    state.PauseTiming();
+    std::shuffle(search_keys.begin(), search_keys.end(),
+                 unodb::benchmark::get_prng());
+    state.ResumeTiming();
+    for (const auto k : search_keys)
+      unodb::benchmark::get_existing_key(test_db, k);
+  }
+
+  state.SetItemsProcessed(state.iterations() *
+                          static_cast<std::int64_t>(search_keys.size()));
+}
+
+/*
+
 Make inode_4 two-key constructor too hard for the CPU branch predictor by
 inserting every second key in the above tree, and benchmarking inserting of the
 rest:
@@ -439,6 +490,13 @@ BENCHMARK_TEMPLATE(unpredictable_get_shared_length, unodb::mutex_db)
 BENCHMARK_TEMPLATE(unpredictable_get_shared_length, unodb::olc_db)
     ->Unit(benchmark::kMicrosecond);
 
+BENCHMARK_TEMPLATE(full_key_prefix_get, unodb::db)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(full_key_prefix_get, unodb::mutex_db)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(full_key_prefix_get, unodb::olc_db)
+    ->Unit(benchmark::kMicrosecond);
+
 BENCHMARK_TEMPLATE(unpredictable_leaf_key_prefix_split, unodb::db)
     ->Unit(benchmark::kMicrosecond);
 BENCHMARK_TEMPLATE(unpredictable_leaf_key_prefix_split, unodb::mutex_db)
@@ -2,6 +2,9 @@
 
 #include "global.hpp"  // IWYU pragma: keep
 
+#include <array>
+#include <cstdint>
+
 #include <benchmark/benchmark.h>
 
 #include "art.hpp"
@@ -9,6 +12,7 @@
 #include "micro_benchmark_utils.hpp"
 #include "mutex_art.hpp"
 #include "olc_art.hpp"
+#include "simd_kernels.hpp"
 
 namespace {
 
@@ -63,15 +67,73 @@ void full_n16_tree_random_delete(benchmark::State &state) {
 }
 
 template <class Db>
-void shrink_n48_to_n16_sequentially(benchmark::State &state) {
+void shrink_n32_to_n16_sequentially(benchmark::State &state) {
   unodb::benchmark::shrink_node_sequentially_benchmark<Db, 16>(state);
 }
 
 template <class Db>
-void shrink_n48_to_n16_randomly(benchmark::State &state) {
+void shrink_n32_to_n16_randomly(benchmark::State &state) {
   unodb::benchmark::shrink_node_randomly_benchmark<Db, 16>(state);
 }
 
+#ifdef UNODB_DETAIL_X86_64
+
+// Node16 kernels in isolation, one benchmark argument per SIMD level
+
+[[nodiscard]] bool set_up_kernel_level(benchmark::State &state) {
+  const auto level = static_cast<unodb::detail::simd_level>(state.range(0));
+  if (level > unodb::detail::detect_simd_level()) {
+    state.SkipWithError("SIMD level not supported by this CPU");
+    return false;
+  }
+  state.SetLabel(unodb::detail::simd_level_name(level));
+  return true;
+}
+
+void n16_insert_pos_kernel(benchmark::State &state) {
+  if (!set_up_kernel_level(state)) return;
+  const auto kernels{unodb::detail::get_simd_kernels(
+      static_cast<unodb::detail::simd_level>(state.range(0)))};
+  alignas(16) std::array<std::uint8_t, 16> keys{};
+  for (std::uint8_t i = 0; i < 16; ++i)
+    keys[i] = static_cast<std::uint8_t>(i * 16U + 8U);
+  std::uint8_t key_byte = 0;
+
+  for (const auto _ : state) {
+    const auto pos = (kernels.n16_insert_pos != nullptr)
+                         ? kernels.n16_insert_pos(keys.data(), key_byte, 15)
+                         : unodb::detail::n16_insert_pos_sse2(keys.data(),
+                                                              key_byte, 15);
+    benchmark::DoNotOptimize(pos);
+    key_byte = static_cast<std::uint8_t>(key_byte + 17U);
+  }
+}
+
+void n16_remove_kernel(benchmark::State &state) {
+  if (!set_up_kernel_level(state)) return;
+  const auto kernels{unodb::detail::get_simd_kernels(
+      static_cast<unodb::detail::simd_level>(state.range(0)))};
+  alignas(16) std::array<std::uint8_t, 16> keys{};
+  std::array<std::uint64_t, 16> children{};
+  std::uint8_t child_index = 0;
+
+  for (const auto _ : state) {
+    if (kernels.n16_remove != nullptr) {
+      kernels.n16_remove(keys.data(), children.data(), child_index, 16);
+    } else {
+      // What the nodes do without a vector kernel
+      for (unsigned i = child_index + 1U; i < 16; ++i) {
+        keys[i - 1] = keys[i];
+        children[i - 1] = children[i];
+      }
+    }
+    benchmark::ClobberMemory();
+    child_index = static_cast<std::uint8_t>((child_index + 5U) % 16U);
+  }
+}
+
+#endif  // #ifdef UNODB_DETAIL_X86_64
+
 }  // namespace
 
 UNODB_START_BENCHMARKS()
@@ -176,24 +238,33 @@ BENCHMARK_TEMPLATE(full_n16_tree_random_delete, unodb::olc_db)
     ->Range(64, 246000)
     ->Unit(benchmark::kMicrosecond);
 
-BENCHMARK_TEMPLATE(shrink_n48_to_n16_sequentially, unodb::db)
+BENCHMARK_TEMPLATE(shrink_n32_to_n16_sequentially, unodb::db)
     ->Range(4, 16383)
     ->Unit(benchmark::kMicrosecond);
-BENCHMARK_TEMPLATE(shrink_n48_to_n16_sequentially, unodb::mutex_db)
+BENCHMARK_TEMPLATE(shrink_n32_to_n16_sequentially, unodb::mutex_db)
     ->Range(4, 16383)
     ->Unit(benchmark::kMicrosecond);
-BENCHMARK_TEMPLATE(shrink_n48_to_n16_sequentially, unodb::olc_db)
+BENCHMARK_TEMPLATE(shrink_n32_to_n16_sequentially, unodb::olc_db)
     ->Range(4, 16383)
     ->Unit(benchmark::kMicrosecond);
 
-BENCHMARK_TEMPLATE(shrink_n48_to_n16_randomly, unodb::db)
+BENCHMARK_TEMPLATE(shrink_n32_to_n16_randomly, unodb::db)
     ->Range(4, 16383)
     ->Unit(benchmark::kMicrosecond);
-BENCHMARK_TEMPLATE(shrink_n48_to_n16_randomly, unodb::mutex_db)
+BENCHMARK_TEMPLATE(shrink_n32_to_n16_randomly, unodb::mutex_db)
     ->Range(4, 16383)
     ->Unit(benchmark::kMicrosecond);
-BENCHMARK_TEMPLATE(shrink_n48_to_n16_randomly, unodb::olc_db)
+BENCHMARK_TEMPLATE(shrink_n32_to_n16_randomly, unodb::olc_db)
     ->Range(4, 16383)
     ->Unit(benchmark::kMicrosecond);
 
+#ifdef UNODB_DETAIL_X86_64
+
+BENCHMARK(n16_insert_pos_kernel)
+    ->DenseRange(0, unodb::detail::simd_level_count - 1);
+BENCHMARK(n16_remove_kernel)
+    ->DenseRange(0, unodb::detail::simd_level_count - 1);
+
+#endif  // #ifdef UNODB_DETAIL_X86_64
+
 UNODB_BENCHMARK_MAIN();
@@ -0,0 +1,228 @@
+// Copyright 2022 Laurynas Biveinis
+
+#include "global.hpp"  // IWYU pragma: keep
+
+#include <benchmark/benchmark.h>
+
+#include "art.hpp"
+#include "micro_benchmark_node_utils.hpp"
+#include "micro_benchmark_utils.hpp"
+#include "mutex_art.hpp"
+#include "olc_art.hpp"
+
+namespace {
+
+template <class Db>
+void grow_n16_to_n32_sequentially(benchmark::State &state) {
+  unodb::benchmark::grow_node_sequentially_benchmark<Db, 16>(state);
+}
+
+template <class Db>
+void grow_n16_to_n32_randomly(benchmark::State &state) {
+  unodb::benchmark::grow_node_randomly_benchmark<Db, 16>(state);
+}
+
+template <class Db>
+void n32_sequential_add(benchmark::State &state) {
+  unodb::benchmark::sequential_add_benchmark<Db, 32>(state);
+}
+
+template <class Db>
+void n32_random_add(benchmark::State &state) {
+  unodb::benchmark::random_add_benchmark<Db, 32>(state);
+}
+
+template <class Db>
+void minimal_n32_tree_full_scan(benchmark::State &state) {
+  unodb::benchmark::minimal_tree_full_scan<Db, 32>(state);
+}
+
+template <class Db>
+void minimal_n32_tree_random_gets(benchmark::State &state) {
+  unodb::benchmark::minimal_tree_random_gets<Db, 32>(state);
+}
+
+template <class Db>
+void full_n32_tree_full_scan(benchmark::State &state) {
+  unodb::benchmark::full_node_scan_benchmark<Db, 32>(state);
+}
+
+template <class Db>
+void full_n32_tree_random_gets(benchmark::State &state) {
+  unodb::benchmark::full_node_random_get_benchmark<Db, 32>(state);
+}
+
+template <class Db>
+void full_n32_tree_sequential_delete(benchmark::State &state) {
+  unodb::benchmark::sequential_delete_benchmark<Db, 32>(state);
+}
+
+template <class Db>
+void full_n32_tree_random_delete(benchmark::State &state) {
+  unodb::benchmark::random_delete_benchmark<Db, 32>(state);
+}
+
+template <class Db>
+void shrink_n48_to_n32_sequentially(benchmark::State &state) {
+  unodb::benchmark::shrink_node_sequentially_benchmark<Db, 32>(state);
+}
+
+template <class Db>
+void shrink_n48_to_n32_randomly(benchmark::State &state) {
+  unodb::benchmark::shrink_node_randomly_benchmark<Db, 32>(state);
+}
+
+template <class Db>
+void random_fanout_tree_insert(benchmark::State &state) {
+  unodb::benchmark::random_fanout_tree_insert_benchmark<Db>(state);
+}
+
+}  // namespace
+
+UNODB_START_BENCHMARKS()
+
+BENCHMARK_TEMPLATE(grow_n16_to_n32_sequentially, unodb::db)
+    ->Range(8, 8192)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(grow_n16_to_n32_sequentially, unodb::mutex_db)
+    ->Range(8, 8192)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(grow_n16_to_n32_sequentially, unodb::olc_db)
+    ->Range(8, 8192)
+    ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_TEMPLATE(grow_n16_to_n32_randomly, unodb::db)
+    ->Range(8, 8192)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(grow_n16_to_n32_randomly, unodb::mutex_db)
+    ->Range(8, 8192)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(grow_n16_to_n32_randomly, unodb::olc_db)
+    ->Range(8, 8192)
+    ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_TEMPLATE(n32_sequential_add, unodb::db)
+    ->Range(2, 4096)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(n32_sequential_add, unodb::mutex_db)
+    ->Range(2, 4096)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(n32_sequential_add, unodb::olc_db)
+    ->Range(2, 4096)
+    ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_TEMPLATE(n32_random_add, unodb::db)
+    ->Range(2, 4096)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(n32_random_add, unodb::mutex_db)
+    ->Range(2, 4096)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(n32_random_add, unodb::olc_db)
+    ->Range(2, 4096)
+    ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_TEMPLATE(minimal_n32_tree_full_scan, unodb::db)
+    ->Range(4, 6144)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(minimal_n32_tree_full_scan, unodb::mutex_db)
+    ->Range(4, 6144)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(minimal_n32_tree_full_scan, unodb::olc_db)
+    ->Range(4, 6144)
+    ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_TEMPLATE(minimal_n32_tree_random_gets, unodb::db)
+    ->Range(4, 6144)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(minimal_n32_tree_random_gets, unodb::mutex_db)
+    ->Range(4, 6144)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(minimal_n32_tree_random_gets, unodb::olc_db)
+    ->Range(4, 6144)
+    ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_TEMPLATE(full_n32_tree_full_scan, unodb::db)
+    ->Range(128, 131072)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(full_n32_tree_full_scan, unodb::mutex_db)
+    ->Range(128, 131072)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(full_n32_tree_full_scan, unodb::olc_db)
+    ->Range(128, 131072)
+    ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_TEMPLATE(full_n32_tree_random_gets, unodb::db)
+    ->Range(128, 131072)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(full_n32_tree_random_gets, unodb::mutex_db)
+    ->Range(128, 131072)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(full_n32_tree_random_gets, unodb::olc_db)
+    ->Range(128, 131072)
+    ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_TEMPLATE(full_n32_tree_sequential_delete, unodb::db)
+    ->Range(128, 131072)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(full_n32_tree_sequential_delete, unodb::mutex_db)
+    ->Range(128, 131072)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(full_n32_tree_sequential_delete, unodb::olc_db)
+    ->Range(128, 131072)
+    ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_TEMPLATE(full_n32_tree_random_delete, unodb::db)
+    ->Range(128, 131072)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(full_n32_tree_random_delete, unodb::mutex_db)
+    ->Range(128, 131072)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(full_n32_tree_random_delete, unodb::olc_db)
+    ->Range(128, 131072)
+    ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_TEMPLATE(shrink_n48_to_n32_sequentially, unodb::db)
+    ->Range(4, 2048)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(shrink_n48_to_n32_sequentially, unodb::mutex_db)
+    ->Range(4, 2048)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(shrink_n48_to_n32_sequentially, unodb::olc_db)
+    ->Range(4, 2048)
+    ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_TEMPLATE(shrink_n48_to_n32_randomly, unodb::db)
+    ->Range(4, 2048)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(shrink_n48_to_n32_randomly, unodb::mutex_db)
+    ->Range(4, 2048)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(shrink_n48_to_n32_randomly, unodb::olc_db)
+    ->Range(4, 2048)
+    ->Unit(benchmark::kMicrosecond);
+
+// Fanout ranges within Node16, straddling Node16 and Node32, within Node32,
+// straddling Node32 and Node48, and within Node48
+BENCHMARK_TEMPLATE(random_fanout_tree_insert, unodb::db)
+    ->Args({5, 16})
+    ->Args({12, 24})
+    ->Args({17, 32})
+    ->Args({24, 40})
+    ->Args({33, 48})
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(random_fanout_tree_insert, unodb::mutex_db)
+    ->Args({5, 16})
+    ->Args({12, 24})
+    ->Args({17, 32})
+    ->Args({24, 40})
+    ->Args({33, 48})
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(random_fanout_tree_insert, unodb::olc_db)
+    ->Args({5, 16})
+    ->Args({12, 24})
+    ->Args({17, 32})
+    ->Args({24, 40})
+    ->Args({33, 48})
+    ->Unit(benchmark::kMicrosecond);
+
+UNODB_BENCHMARK_MAIN();
@@ -13,13 +13,13 @@
 namespace {
 
 template <class Db>
-void grow_n16_to_n48_sequentially(benchmark::State &state) {
-  unodb::benchmark::grow_node_sequentially_benchmark<Db, 16>(state);
+void grow_n32_to_n48_sequentially(benchmark::State &state) {
+  unodb::benchmark::grow_node_sequentially_benchmark<Db, 32>(state);
 }
 
 template <class Db>
-void grow_n16_to_n48_randomly(benchmark::State &state) {
-  unodb::benchmark::grow_node_randomly_benchmark<Db, 16>(state);
+void grow_n32_to_n48_randomly(benchmark::State &state) {
+  unodb::benchmark::grow_node_randomly_benchmark<Db, 32>(state);
 }
 
 template <class Db>
@@ -76,23 +76,23 @@ void shrink_n256_to_n48_randomly(benchmark::State &state) {
 
 UNODB_START_BENCHMARKS()
 
-BENCHMARK_TEMPLATE(grow_n16_to_n48_sequentially, unodb::db)
+BENCHMARK_TEMPLATE(grow_n32_to_n48_sequentially, unodb::db)
     ->Range(8, 8192)
     ->Unit(benchmark::kMicrosecond);
-BENCHMARK_TEMPLATE(grow_n16_to_n48_sequentially, unodb::mutex_db)
+BENCHMARK_TEMPLATE(grow_n32_to_n48_sequentially, unodb::mutex_db)
     ->Range(8, 8192)
     ->Unit(benchmark::kMicrosecond);
-BENCHMARK_TEMPLATE(grow_n16_to_n48_sequentially, unodb::olc_db)
+BENCHMARK_TEMPLATE(grow_n32_to_n48_sequentially, unodb::olc_db)
     ->Range(8, 8192)
     ->Unit(benchmark::kMicrosecond);
 
-BENCHMARK_TEMPLATE(grow_n16_to_n48_randomly, unodb::db)
+BENCHMARK_TEMPLATE(grow_n32_to_n48_randomly, unodb::db)
     ->Range(8, 8192)
     ->Unit(benchmark::kMicrosecond);
-BENCHMARK_TEMPLATE(grow_n16_to_n48_randomly, unodb::mutex_db)
+BENCHMARK_TEMPLATE(grow_n32_to_n48_randomly, unodb::mutex_db)
     ->Range(8, 8192)
     ->Unit(benchmark::kMicrosecond);
-BENCHMARK_TEMPLATE(grow_n16_to_n48_randomly, unodb::olc_db)
+BENCHMARK_TEMPLATE(grow_n32_to_n48_randomly, unodb::olc_db)
     ->Range(8, 8192)
     ->Unit(benchmark::kMicrosecond);
 
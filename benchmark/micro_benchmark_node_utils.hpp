@@ -22,6 +22,7 @@
 #include "assert.hpp"
 #include "micro_benchmark_utils.hpp"
 #include "node_type.hpp"
+#include "simd_kernels.hpp"
 
 namespace unodb::benchmark {
 
@@ -30,13 +31,15 @@ namespace unodb::benchmark {
 template <unsigned NodeSize>
 [[nodiscard]] constexpr auto node_size_to_key_zero_bits() noexcept {
   static_assert(NodeSize == 2 || NodeSize == 4 || NodeSize == 16 ||
-                NodeSize == 256);
+                NodeSize == 32 || NodeSize == 256);
   if constexpr (NodeSize == 2) {
     return 0xFEFE'FEFE'FEFE'FEFEULL;
   } else if constexpr (NodeSize == 4) {
     return 0xFCFC'FCFC'FCFC'FCFCULL;
   } else if constexpr (NodeSize == 16) {
     return 0xF0F0'F0F0'F0F0'F0F0ULL;
+  } else if constexpr (NodeSize == 32) {
+    return 0xE0E0'E0E0'E0E0'E0E0ULL;
   } else if constexpr (NodeSize == 256) {
     return 0ULL;
   }
@@ -98,12 +101,14 @@ namespace detail {
 
 template <unsigned NodeCapacity>
 [[nodiscard]] constexpr auto node_capacity_to_minimum_size() noexcept {
-  static_assert(NodeCapacity == 16 || NodeCapacity == 48 ||
-                NodeCapacity == 256);
+  static_assert(NodeCapacity == 16 || NodeCapacity == 32 ||
+                NodeCapacity == 48 || NodeCapacity == 256);
   if constexpr (NodeCapacity == 16) {
     return 5;
-  } else if constexpr (NodeCapacity == 48) {
+  } else if constexpr (NodeCapacity == 32) {
     return 17;
+  } else if constexpr (NodeCapacity == 48) {
+    return 33;
   } else if constexpr (NodeCapacity == 256) {
     return 49;
   }
@@ -111,8 +116,8 @@ template <unsigned NodeCapacity>
 
 template <unsigned NodeCapacity>
 [[nodiscard]] constexpr auto node_capacity_over_minimum() noexcept {
-  static_assert(NodeCapacity == 16 || NodeCapacity == 48 ||
-                NodeCapacity == 256);
+  static_assert(NodeCapacity == 16 || NodeCapacity == 32 ||
+                NodeCapacity == 48 || NodeCapacity == 256);
   return NodeCapacity - node_capacity_to_minimum_size<NodeCapacity>();
 }
 
@@ -125,9 +130,10 @@ template <unsigned NodeSize>
 template <unsigned NodeSize>
 [[nodiscard]] constexpr auto node_size_to_node_type() noexcept {
   static_assert(NodeSize == 2 || NodeSize == 4 || NodeSize == 16 ||
-                NodeSize == 48 || NodeSize == 256);
+                NodeSize == 32 || NodeSize == 48 || NodeSize == 256);
   if constexpr (NodeSize == 2 || NodeSize == 4) return node_type::I4;
   if constexpr (NodeSize == 16) return node_type::I16;
+  if constexpr (NodeSize == 32) return node_type::I32;
   if constexpr (NodeSize == 48) return node_type::I48;
   return node_type::I256;
 }
@@ -137,9 +143,10 @@ template <unsigned NodeSize>
 template <unsigned SmallerNodeSize>
 [[nodiscard]] constexpr auto node_size_to_larger_node_type() noexcept {
   static_assert(SmallerNodeSize == 4 || SmallerNodeSize == 16 ||
-                SmallerNodeSize == 48);
+                SmallerNodeSize == 32 || SmallerNodeSize == 48);
   if constexpr (SmallerNodeSize == 4) return node_type::I16;
-  if constexpr (SmallerNodeSize == 16) return node_type::I48;
+  if constexpr (SmallerNodeSize == 16) return node_type::I32;
+  if constexpr (SmallerNodeSize == 32) return node_type::I48;
   return node_type::I256;
 }
 
@@ -209,7 +216,8 @@ number_to_minimal_leaf_over_smaller_node_tree(std::uint64_t i) noexcept {
 template <unsigned NodeSize>
 [[nodiscard, gnu::const]] constexpr std::uint64_t
 number_to_full_node_tree_with_gaps_key(std::uint64_t i) noexcept {
-  static_assert(NodeSize == 4 || NodeSize == 16 || NodeSize == 48);
+  static_assert(NodeSize == 4 || NodeSize == 16 || NodeSize == 32 ||
+                NodeSize == 48);
   // Full Node4 tree keys with 1, 3, 5, & 7 as the different key byte values
   // so that a new byte could be inserted later at any position:
   // 0x0101010101010101 to ...107
@@ -298,6 +306,13 @@ UNODB_DETAIL_RESTORE_MSVC_WARNINGS()
 
 }  // namespace detail
 
+// Report the node SIMD kernels selected at runtime in the benchmark context
+inline const bool simd_kernels_context_added = [] {
+  ::benchmark::AddCustomContext("node SIMD kernels",
+                                unodb::detail::simd_kernels_name());
+  return true;
+}();
+
 // Stats
 
 UNODB_DETAIL_DISABLE_MSVC_WARNING(26495)
@@ -327,6 +342,8 @@ struct [[nodiscard]] tree_stats final {
                other.node_counts[unodb::as_i<unodb::node_type::I4>] &&
            node_counts[unodb::as_i<unodb::node_type::I16>] ==
                other.node_counts[unodb::as_i<unodb::node_type::I16>] &&
+           node_counts[unodb::as_i<unodb::node_type::I32>] ==
+               other.node_counts[unodb::as_i<unodb::node_type::I32>] &&
            node_counts[unodb::as_i<unodb::node_type::I48>] ==
                other.node_counts[unodb::as_i<unodb::node_type::I48>] &&
            node_counts[unodb::as_i<unodb::node_type::I256>] ==
@@ -360,6 +377,8 @@ class [[nodiscard]] growing_tree_node_stats final {
         stats.node_counts[::unodb::as_i<unodb::node_type::I4>]);
     state.counters["16"] = static_cast<double>(
         stats.node_counts[::unodb::as_i<unodb::node_type::I16>]);
+    state.counters["32"] = static_cast<double>(
+        stats.node_counts[::unodb::as_i<unodb::node_type::I32>]);
     state.counters["48"] = static_cast<double>(
         stats.node_counts[::unodb::as_i<unodb::node_type::I48>]);
     state.counters["256"] = static_cast<double>(
@@ -371,6 +390,9 @@ class [[nodiscard]] growing_tree_node_stats final {
         stats.growing_inode_counts
             [::unodb::internal_as_i<unodb::node_type::I16>]);
     state.counters["16^"] = static_cast<double>(
+        stats.growing_inode_counts
+            [::unodb::internal_as_i<unodb::node_type::I32>]);
+    state.counters["32^"] = static_cast<double>(
         stats.growing_inode_counts
             [::unodb::internal_as_i<unodb::node_type::I48>]);
     state.counters["48^"] = static_cast<double>(
@@ -557,8 +579,8 @@ template <class Db, unsigned NodeSize, typename NumberToKeyFn>
 
 template <class Db, unsigned NodeSize>
 auto make_full_node_size_tree(Db &db, unsigned key_count) {
-  static_assert(NodeSize == 4 || NodeSize == 16 || NodeSize == 48 ||
-                NodeSize == 256);
+  static_assert(NodeSize == 4 || NodeSize == 16 || NodeSize == 32 ||
+                NodeSize == 48 || NodeSize == 256);
 
   if constexpr (node_size_has_key_zero_bits<NodeSize>()) {
     return insert_sequentially<Db, NodeSize>(db, key_count);
@@ -592,7 +614,7 @@ template <class Db, unsigned SmallerNodeSize>
 [[nodiscard]] auto grow_full_node_tree_to_minimal_next_size_leaf_level(
     Db &db, unodb::key key_limit) {
   static_assert(SmallerNodeSize == 4 || SmallerNodeSize == 16 ||
-                SmallerNodeSize == 48);
+                SmallerNodeSize == 32 || SmallerNodeSize == 48);
 
 #ifndef NDEBUG
   assert_dominating_inode_size_tree<Db, SmallerNodeSize>(db);
@@ -724,7 +746,7 @@ void full_node_random_get_benchmark(::benchmark::State &state) {
 // 0x0000000000010004
 // 0x0000000000010104
 // ...
-// Node16 to Node48: insert to full Node16 tree first:
+// Node16 to Node32: insert to full Node16 tree first:
 // 0x0000000000000000 to ...0000F
 // 0x0000000000000100 to ...0010F
 // ...
@@ -736,7 +758,7 @@ void full_node_random_get_benchmark(::benchmark::State &state) {
 // 0x0000000000010200 to ...1020F
 // ...
 // The insert in the gaps a "base-17" value with the last byte being a constant
-// 10 to get a minimal Node48 tree:
+// 10 to get a minimal Node32 tree:
 // 0x0000000000000010
 // 0x0000000000000110
 // ...
@@ -1093,6 +1115,47 @@ void random_delete_benchmark(::benchmark::State &state) {
   set_size_counter(state, "size", tree_size);
 }
 
+// Insert keys so that every bottom internal node gets a uniformly random number
+// of children between the two benchmark arguments, and report the resulting
+// memory use per key. The values are one byte long, so that it is dominated by
+// the internal node sizes the fanouts fall into.
+template <class Db>
+void random_fanout_tree_insert_benchmark(::benchmark::State &state) {
+  static constexpr std::uint64_t bottom_inode_count = 4096;
+  const auto min_fanout = static_cast<unsigned>(state.range(0));
+  const auto max_fanout = static_cast<unsigned>(state.range(1));
+  UNODB_DETAIL_ASSERT(min_fanout >= 2);
+  UNODB_DETAIL_ASSERT(min_fanout <= max_fanout);
+  UNODB_DETAIL_ASSERT(max_fanout <= 256);
+
+  std::uniform_int_distribution<unsigned> fanout_dist{min_fanout, max_fanout};
+  std::vector<unodb::key> keys;
+  for (std::uint64_t node_i = 0; node_i < bottom_inode_count; ++node_i) {
+    const auto fanout = fanout_dist(get_prng());
+    for (std::uint64_t child_i = 0; child_i < fanout; ++child_i)
+      keys.push_back(node_i << 8U | child_i);
+  }
+
+  std::size_t tree_size{0};
+  for (const auto _ : state) {
+    state.PauseTiming();
+    Db test_db;
+    state.ResumeTiming();
+
+    for (const auto k : keys) insert_key(test_db, k, unodb::value_view{value1});
+
+    state.PauseTiming();
+    tree_size = test_db.get_current_memory_use();
+    destroy_tree(test_db, state);
+  }
+
+  state.SetItemsProcessed(state.iterations() *
+                          static_cast<std::int64_t>(keys.size()));
+  set_size_counter(state, "size", tree_size);
+  state.counters["B/key"] =
+      static_cast<double>(tree_size) / static_cast<double>(keys.size());
+}
+
 }  // namespace unodb::benchmark
 
 #endif  // UNODB_DETAIL_MICRO_BENCHMARK_NODE_UTILS_HPP
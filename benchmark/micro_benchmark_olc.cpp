@@ -2,6 +2,14 @@
 
 #include "global.hpp"  // IWYU pragma: keep
 
+#ifdef UNODB_DETAIL_OLC_RESTART_STATS
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#endif
+
+#include <memory>
+
 #include <benchmark/benchmark.h>
 
 #include "micro_benchmark_concurrency.hpp"
@@ -14,10 +22,21 @@ namespace {
 class [[nodiscard]] concurrent_benchmark_olc final
     : public unodb::benchmark::concurrent_benchmark<unodb::olc_db,
                                                     unodb::qsbr_thread> {
+ public:
+  explicit concurrent_benchmark_olc(
+      unodb::olc_db::root_node root_node_kind_) noexcept
+      : root_node_kind{root_node_kind_} {}
+
+  explicit concurrent_benchmark_olc(unsigned direct_mapped_key_bytes_) noexcept
+      : direct_mapped_key_bytes{direct_mapped_key_bytes_} {}
+
  private:
   void setup() override {
     unodb::qsbr::instance().assert_idle();
     unodb::qsbr::instance().reset_stats();
+#ifdef UNODB_DETAIL_OLC_RESTART_STATS
+    unodb::olc_db::reset_restart_counts();
+#endif
   }
 
   void end_workload_in_main_thread() override {
@@ -25,9 +44,22 @@ class [[nodiscard]] concurrent_benchmark_olc final
   }
 
   void teardown() noexcept override { unodb::qsbr::instance().assert_idle(); }
+
+  [[nodiscard]] std::unique_ptr<unodb::olc_db> make_db() const override {
+    return direct_mapped_key_bytes == 0
+               ? std::make_unique<unodb::olc_db>(root_node_kind)
+               : std::make_unique<unodb::olc_db>(direct_mapped_key_bytes);
+  }
+
+  const unodb::olc_db::root_node root_node_kind{
+      unodb::olc_db::root_node::DYNAMIC};
+  const unsigned direct_mapped_key_bytes{0};
 };
 
-concurrent_benchmark_olc benchmark_fixture;
+concurrent_benchmark_olc benchmark_fixture{unodb::olc_db::root_node::DYNAMIC};
+concurrent_benchmark_olc permanent_root_benchmark_fixture{
+    unodb::olc_db::root_node::PERMANENT_I256};
+concurrent_benchmark_olc direct_mapped_benchmark_fixture{2U};
 
 void set_common_qsbr_counters(benchmark::State &state) {
   state.counters["epoch changes"] = unodb::benchmark::to_counter(
@@ -37,30 +69,108 @@ void set_common_qsbr_counters(benchmark::State &state) {
           .get_mean_quiescent_states_per_thread_between_epoch_changes());
 }
 
+#ifdef UNODB_DETAIL_OLC_RESTART_STATS
+
+void set_olc_restart_counters(benchmark::State &state) {
+  static constexpr std::array<const char *, unodb::detail::olc_op_count>
+      op_labels{"get restarts", "insert restarts", "remove restarts"};
+  static constexpr std::array<const char *,
+                              unodb::detail::olc_restart_cause_count>
+      cause_labels{"version change restarts", "obsolete restarts",
+                   "write-locked restarts"};
+  static constexpr std::array<const char *,
+                              unodb::detail::olc_restart_location_count>
+      location_labels{"L restarts", "4 restarts", "16 restarts",
+                      "48 restarts", "256 restarts", "root restarts"};
+
+  const auto restart_counts{unodb::olc_db::get_restart_counts()};
+
+  std::array<std::uint64_t, unodb::detail::olc_op_count> op_totals{};
+  std::array<std::uint64_t, unodb::detail::olc_restart_cause_count>
+      cause_totals{};
+  std::array<std::uint64_t, unodb::detail::olc_restart_location_count>
+      location_totals{};
+
+  for (std::size_t op = 0; op < op_totals.size(); ++op)
+    for (std::size_t cause = 0; cause < cause_totals.size(); ++cause)
+      for (std::size_t location = 0; location < location_totals.size();
+           ++location) {
+        const auto count{restart_counts[op][cause][location]};
+        op_totals[op] += count;
+        cause_totals[cause] += count;
+        location_totals[location] += count;
+      }
+
+  for (std::size_t op = 0; op < op_totals.size(); ++op)
+    state.counters[op_labels[op]] = unodb::benchmark::to_counter(op_totals[op]);
+  for (std::size_t cause = 0; cause < cause_totals.size(); ++cause)
+    state.counters[cause_labels[cause]] =
+        unodb::benchmark::to_counter(cause_totals[cause]);
+  for (std::size_t location = 0; location < location_totals.size();
+       ++location)
+    state.counters[location_labels[location]] =
+        unodb::benchmark::to_counter(location_totals[location]);
+}
+
+#endif
+
+void set_common_olc_counters(benchmark::State &state) {
+  set_common_qsbr_counters(state);
+#ifdef UNODB_DETAIL_OLC_RESTART_STATS
+  set_olc_restart_counters(state);
+#endif
+}
+
 void parallel_get(benchmark::State &state) {
   benchmark_fixture.parallel_get(state);
 
-  set_common_qsbr_counters(state);
+  set_common_olc_counters(state);
 }
 
-void parallel_insert_disjoint_ranges(benchmark::State &state) {
-  benchmark_fixture.parallel_insert_disjoint_ranges(state);
+void parallel_get_direct_mapped(benchmark::State &state) {
+  direct_mapped_benchmark_fixture.parallel_get(state);
 
+  set_common_olc_counters(state);
+}
+
+void set_parallel_insert_counters(benchmark::State &state) {
   state.counters["QSBR callback count max"] = unodb::benchmark::to_counter(
       unodb::qsbr::instance().get_epoch_callback_count_max());
   state.counters["callback count variance"] = benchmark::Counter(
       unodb::qsbr::instance().get_epoch_callback_count_variance());
-  set_common_qsbr_counters(state);
+  set_common_olc_counters(state);
 }
 
-void parallel_delete_disjoint_ranges(benchmark::State &state) {
-  benchmark_fixture.parallel_delete_disjoint_ranges(state);
-
+void set_parallel_delete_counters(benchmark::State &state) {
   state.counters["max backlog bytes"] = unodb::benchmark::to_counter(
       unodb::qsbr::instance().get_max_backlog_bytes());
   state.counters["mean backlog bytes"] =
       benchmark::Counter(unodb::qsbr::instance().get_mean_backlog_bytes());
-  set_common_qsbr_counters(state);
+  set_common_olc_counters(state);
+}
+
+void parallel_insert_disjoint_ranges(benchmark::State &state) {
+  benchmark_fixture.parallel_insert_disjoint_ranges(state);
+
+  set_parallel_insert_counters(state);
+}
+
+void parallel_delete_disjoint_ranges(benchmark::State &state) {
+  benchmark_fixture.parallel_delete_disjoint_ranges(state);
+
+  set_parallel_delete_counters(state);
+}
+
+void parallel_insert_disjoint_ranges_permanent_root(benchmark::State &state) {
+  permanent_root_benchmark_fixture.parallel_insert_disjoint_ranges(state);
+
+  set_parallel_insert_counters(state);
+}
+
+void parallel_delete_disjoint_ranges_permanent_root(benchmark::State &state) {
+  permanent_root_benchmark_fixture.parallel_delete_disjoint_ranges(state);
+
+  set_parallel_delete_counters(state);
 }
 
 }  // namespace
@@ -72,6 +182,11 @@ BENCHMARK(parallel_get)
     ->Unit(benchmark::kMillisecond)
     ->MeasureProcessCPUTime()
     ->UseRealTime();
+BENCHMARK(parallel_get_direct_mapped)
+    ->Apply(unodb::benchmark::concurrency_ranges16)
+    ->Unit(benchmark::kMillisecond)
+    ->MeasureProcessCPUTime()
+    ->UseRealTime();
 BENCHMARK(parallel_insert_disjoint_ranges)
     ->Apply(unodb::benchmark::concurrency_ranges32)
     ->Unit(benchmark::kMillisecond)
@@ -82,5 +197,15 @@ BENCHMARK(parallel_delete_disjoint_ranges)
     ->Unit(benchmark::kMillisecond)
     ->MeasureProcessCPUTime()
     ->UseRealTime();
+BENCHMARK(parallel_insert_disjoint_ranges_permanent_root)
+    ->Apply(unodb::benchmark::concurrency_ranges32)
+    ->Unit(benchmark::kMillisecond)
+    ->MeasureProcessCPUTime()
+    ->UseRealTime();
+BENCHMARK(parallel_delete_disjoint_ranges_permanent_root)
+    ->Apply(unodb::benchmark::concurrency_ranges32)
+    ->Unit(benchmark::kMillisecond)
+    ->MeasureProcessCPUTime()
+    ->UseRealTime();
 
 UNODB_BENCHMARK_MAIN();
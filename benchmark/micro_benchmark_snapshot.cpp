@@ -0,0 +1,152 @@
+// Copyright 2022 Laurynas Biveinis
+
+#include "global.hpp"  // IWYU pragma: keep
+
+#include <cstddef>
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+#include "art.hpp"
+#include "art_common.hpp"
+#include "micro_benchmark_node_utils.hpp"
+#include "micro_benchmark_utils.hpp"
+#include "mutex_art.hpp"
+#include "olc_art.hpp"
+#include "snapshot.hpp"
+
+namespace {
+
+// Keys spread over the whole key space, so that the tree has inodes of several
+// types and key prefixes at every level, unlike a dense key range
+[[nodiscard]] constexpr unodb::key spread_key(std::uint64_t i) noexcept {
+  return i * 0x9E3779B97F4A7C15ULL;
+}
+
+template <class Db>
+[[nodiscard]] std::string make_snapshot(std::uint64_t key_count) {
+  Db source_db;
+  for (std::uint64_t i = 0; i < key_count; ++i)
+    unodb::benchmark::insert_key(source_db, spread_key(i),
+                                 unodb::value_view{unodb::benchmark::value10});
+  std::ostringstream snapshot;
+  source_db.save(snapshot);
+  return snapshot.str();
+}
+
+template <class Db>
+void snapshot_save(benchmark::State &state) {
+  const auto key_count = static_cast<std::uint64_t>(state.range(0));
+  Db test_db;
+  for (std::uint64_t i = 0; i < key_count; ++i)
+    unodb::benchmark::insert_key(test_db, spread_key(i),
+                                 unodb::value_view{unodb::benchmark::value10});
+  std::size_t snapshot_size = 0;
+
+  for (const auto _ : state) {
+    std::ostringstream snapshot;
+    test_db.save(snapshot);
+
+    state.PauseTiming();
+    snapshot_size = snapshot.str().size();
+    state.ResumeTiming();
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  unodb::benchmark::set_size_counter(state, "snapshot size", snapshot_size);
+}
+
+template <class Db>
+void snapshot_load(benchmark::State &state) {
+  const auto snapshot = make_snapshot<Db>(
+      static_cast<std::uint64_t>(state.range(0)));
+  std::size_t tree_size = 0;
+
+  for (const auto _ : state) {
+    state.PauseTiming();
+    Db test_db;
+    std::istringstream in{snapshot};
+    benchmark::ClobberMemory();
+    state.ResumeTiming();
+
+    test_db.load(in);
+
+    state.PauseTiming();
+    tree_size = test_db.get_current_memory_use();
+    unodb::benchmark::destroy_tree(test_db, state);
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  unodb::benchmark::set_size_counter(state, "size", tree_size);
+}
+
+// The baseline for snapshot_load: decode the same snapshot and insert every
+// key, as a restart without bulk loading would do
+template <class Db>
+void snapshot_insert_rebuild(benchmark::State &state) {
+  const auto snapshot = make_snapshot<Db>(
+      static_cast<std::uint64_t>(state.range(0)));
+  std::size_t tree_size = 0;
+
+  for (const auto _ : state) {
+    state.PauseTiming();
+    Db test_db;
+    std::istringstream in{snapshot};
+    benchmark::ClobberMemory();
+    state.ResumeTiming();
+
+    unodb::detail::snapshot_reader reader{in};
+    while (reader.next())
+      unodb::benchmark::insert_key(test_db, reader.get_key(),
+                                   reader.get_value());
+
+    state.PauseTiming();
+    tree_size = test_db.get_current_memory_use();
+    unodb::benchmark::destroy_tree(test_db, state);
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  unodb::benchmark::set_size_counter(state, "size", tree_size);
+}
+
+void snapshot_args(benchmark::internal::Benchmark *b) {
+  b->Arg(100000)->Arg(1000000)->Arg(10000000)->Arg(100000000);
+}
+
+}  // namespace
+
+UNODB_START_BENCHMARKS()
+
+BENCHMARK_TEMPLATE(snapshot_save, unodb::db)
+    ->Apply(snapshot_args)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(snapshot_save, unodb::mutex_db)
+    ->Apply(snapshot_args)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(snapshot_save, unodb::olc_db)
+    ->Apply(snapshot_args)
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_TEMPLATE(snapshot_load, unodb::db)
+    ->Apply(snapshot_args)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(snapshot_load, unodb::mutex_db)
+    ->Apply(snapshot_args)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(snapshot_load, unodb::olc_db)
+    ->Apply(snapshot_args)
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_TEMPLATE(snapshot_insert_rebuild, unodb::db)
+    ->Apply(snapshot_args)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(snapshot_insert_rebuild, unodb::mutex_db)
+    ->Apply(snapshot_args)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(snapshot_insert_rebuild, unodb::olc_db)
+    ->Apply(snapshot_args)
+    ->Unit(benchmark::kMillisecond);
+
+UNODB_BENCHMARK_MAIN();
@@ -0,0 +1,227 @@
+// Copyright 2022 Laurynas Biveinis
+
+#include "global.hpp"  // IWYU pragma: keep
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <tuple>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "art.hpp"
+#include "art_common.hpp"
+#include "micro_benchmark_utils.hpp"
+#include "olc_art.hpp"
+#include "qsbr.hpp"
+#include "wal.hpp"
+
+namespace {
+
+constexpr auto log_path = "unodb_benchmark_wal";
+
+// The first benchmark argument selects no log if zero, and PER_OPERATION,
+// GROUP, and ASYNC durability if one, two, and three, respectively
+[[nodiscard]] std::unique_ptr<unodb::write_ahead_log> make_log(
+    const benchmark::State &state) {
+  const auto mode = state.range(0);
+  if (mode == 0) return nullptr;
+  return std::make_unique<unodb::write_ahead_log>(
+      log_path, static_cast<unodb::wal_durability>(mode - 1));
+}
+
+void set_sync_counter(benchmark::State &state, std::uint64_t sync_count,
+                      std::uint64_t op_count) {
+  state.counters["syncs/op"] = benchmark::Counter(
+      static_cast<double>(sync_count) / static_cast<double>(op_count));
+}
+
+// Inserts of increasing keys to db, waiting for each to become durable
+void db_logged_insert(benchmark::State &state) {
+  const auto key_count = static_cast<unodb::key>(state.range(1));
+  std::uint64_t sync_count = 0;
+
+  for (const auto _ : state) {
+    state.PauseTiming();
+    unodb::db test_db;
+    auto log = make_log(state);
+    test_db.attach_log(log.get());
+    state.ResumeTiming();
+
+    for (unodb::key k = 0; k < key_count; ++k)
+      unodb::benchmark::insert_key(
+          test_db, k, unodb::value_view{unodb::benchmark::value10});
+
+    state.PauseTiming();
+    if (log != nullptr) {
+      log->sync();
+      sync_count += log->get_sync_count();
+    }
+    test_db.attach_log(nullptr);
+    log.reset();
+    unodb::benchmark::destroy_tree(test_db, state);
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(1));
+  set_sync_counter(state, sync_count,
+                   static_cast<std::uint64_t>(state.iterations()) * key_count);
+  std::remove(log_path);
+}
+
+// Inserts of disjoint key ranges to olc_db by several threads. With GROUP
+// durability, the threads waiting for their records share syncs.
+void olc_logged_parallel_insert(benchmark::State &state) {
+  const auto thread_count = static_cast<std::size_t>(state.range(1));
+  const auto key_count = static_cast<unodb::key>(state.range(2));
+  const auto keys_per_thread = key_count / thread_count;
+  std::uint64_t sync_count = 0;
+
+  for (const auto _ : state) {
+    state.PauseTiming();
+    unodb::qsbr::instance().assert_idle();
+    unodb::olc_db test_db;
+    auto log = make_log(state);
+    test_db.attach_log(log.get());
+    unodb::this_thread().qsbr_pause();
+    std::vector<unodb::qsbr_thread> threads;
+    threads.reserve(thread_count);
+    state.ResumeTiming();
+
+    for (std::size_t i = 0; i < thread_count; ++i) {
+      threads.emplace_back([&test_db, i, keys_per_thread] {
+        const auto start = i * keys_per_thread;
+        for (auto k = start; k < start + keys_per_thread; ++k)
+          unodb::benchmark::insert_key(
+              test_db, k, unodb::value_view{unodb::benchmark::value10});
+      });
+    }
+    for (auto &t : threads) t.join();
+
+    state.PauseTiming();
+    unodb::this_thread().qsbr_resume();
+    if (log != nullptr) {
+      log->sync();
+      sync_count += log->get_sync_count();
+    }
+    test_db.attach_log(nullptr);
+    log.reset();
+    unodb::this_thread().quiescent();
+    unodb::benchmark::destroy_tree(test_db, state);
+  }
+
+  state.SetItemsProcessed(state.iterations() *
+                          static_cast<std::int64_t>(keys_per_thread *
+                                                    thread_count));
+  set_sync_counter(
+      state, sync_count,
+      static_cast<std::uint64_t>(state.iterations()) * keys_per_thread *
+          thread_count);
+  std::remove(log_path);
+}
+
+// Inserts of disjoint key ranges to olc_db by several threads, after ten times
+// as many keys were inserted, while another thread checkpoints the tree
+// repeatedly if the first argument is one, to measure the slowdown of the
+// writers by the checkpoints
+void olc_insert_during_checkpoint(benchmark::State &state) {
+  const auto checkpointing = state.range(0) != 0;
+  const auto thread_count = static_cast<std::size_t>(state.range(1));
+  const auto key_count = static_cast<unodb::key>(state.range(2));
+  const auto keys_per_thread = key_count / thread_count;
+  std::uint64_t checkpoint_count = 0;
+
+  for (const auto _ : state) {
+    state.PauseTiming();
+    unodb::qsbr::instance().assert_idle();
+    unodb::olc_db test_db;
+    for (auto k = key_count; k < 11 * key_count; ++k)
+      unodb::benchmark::insert_key(
+          test_db, k, unodb::value_view{unodb::benchmark::value10});
+    unodb::this_thread().qsbr_pause();
+    std::atomic<bool> writers_done{false};
+    std::optional<unodb::qsbr_thread> checkpoint_thread;
+    std::vector<unodb::qsbr_thread> threads;
+    threads.reserve(thread_count);
+    state.ResumeTiming();
+
+    if (checkpointing) {
+      checkpoint_thread.emplace([&test_db, &writers_done, &checkpoint_count] {
+        do {
+          std::stringstream checkpoint;
+          std::ignore = test_db.checkpoint(checkpoint);
+          ++checkpoint_count;
+        } while (!writers_done.load(std::memory_order_acquire));
+      });
+    }
+    for (std::size_t i = 0; i < thread_count; ++i) {
+      threads.emplace_back([&test_db, i, keys_per_thread] {
+        const auto start = i * keys_per_thread;
+        for (auto k = start; k < start + keys_per_thread; ++k)
+          unodb::benchmark::insert_key(
+              test_db, k, unodb::value_view{unodb::benchmark::value10});
+      });
+    }
+    for (auto &t : threads) t.join();
+
+    state.PauseTiming();
+    writers_done.store(true, std::memory_order_release);
+    if (checkpoint_thread) checkpoint_thread->join();
+    unodb::this_thread().qsbr_resume();
+    unodb::this_thread().quiescent();
+    unodb::benchmark::destroy_tree(test_db, state);
+  }
+
+  state.SetItemsProcessed(state.iterations() *
+                          static_cast<std::int64_t>(keys_per_thread *
+                                                    thread_count));
+  state.counters["checkpoints"] =
+      benchmark::Counter(static_cast<double>(checkpoint_count),
+                         benchmark::Counter::kAvgIterations);
+}
+
+void db_args(benchmark::internal::Benchmark *b) {
+  for (const auto mode : {0, 1, 2, 3})
+    for (const auto key_count : {1000, 10000}) b->Args({mode, key_count});
+}
+
+void olc_args(benchmark::internal::Benchmark *b) {
+  for (const auto mode : {0, 1, 2, 3})
+    for (const auto thread_count : {1, 2, 4, 8})
+      for (const auto key_count : {1000, 8000})
+        b->Args({mode, thread_count, key_count});
+}
+
+void checkpoint_args(benchmark::internal::Benchmark *b) {
+  for (const auto checkpointing : {0, 1})
+    for (const auto thread_count : {1, 2, 4})
+      for (const auto key_count : {1000, 8000})
+        b->Args({checkpointing, thread_count, key_count});
+}
+
+}  // namespace
+
+UNODB_START_BENCHMARKS()
+
+BENCHMARK(db_logged_insert)
+    ->Apply(db_args)
+    ->ArgNames({"log", ""})
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(olc_logged_parallel_insert)
+    ->Apply(olc_args)
+    ->ArgNames({"log", "threads", ""})
+    ->Unit(benchmark::kMillisecond)
+    ->MeasureProcessCPUTime()
+    ->UseRealTime();
+BENCHMARK(olc_insert_during_checkpoint)
+    ->Apply(checkpoint_args)
+    ->ArgNames({"checkpoint", "threads", ""})
+    ->Unit(benchmark::kMillisecond)
+    ->MeasureProcessCPUTime()
+    ->UseRealTime();
+
+UNODB_BENCHMARK_MAIN();
@@ -0,0 +1,311 @@
+// Copyright 2022 Laurynas Biveinis
+
+#include "global.hpp"  // IWYU pragma: keep
+
+#include "compact_art.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "art.hpp"
+#include "assert.hpp"
+#include "node_type.hpp"
+#include "portability_builtins.hpp"
+
+namespace {
+
+// An inode is:
+// - a header byte with the key prefix length in the low nibble and the inode
+//   kind in the high one
+// - a byte with the children count less one
+// - the key prefix bytes
+// - for SORTED inodes, the children key bytes in increasing order, for BITMAP
+//   ones, a 256-bit bitmap of the present children key bytes, followed by the
+//   number of children before each of its 64-bit words
+// - the child references in key byte order
+// A leaf is the key bytes below its parent inode, a LEB128 varint value size,
+// and the value bytes. No field is aligned.
+enum class inode_kind : std::uint8_t { SORTED, BITMAP };
+
+constexpr unsigned max_sorted_children = 16;
+constexpr std::size_t bitmap_words = 256 / 64;
+constexpr std::size_t bitmap_size = bitmap_words * sizeof(std::uint64_t);
+constexpr std::size_t bitmap_lookup_size = bitmap_size + bitmap_words;
+
+constexpr std::size_t inode_header_size = 2;
+
+[[nodiscard]] constexpr std::uint8_t key_byte_at(unodb::key k,
+                                                 unsigned depth) noexcept {
+  return static_cast<std::uint8_t>(k >> (56U - depth * 8U));
+}
+
+template <typename T>
+[[nodiscard]] T read(const std::byte *from) noexcept {
+  T result;
+  std::memcpy(&result, from, sizeof(result));
+  return result;
+}
+
+[[nodiscard]] constexpr std::size_t varint_size(std::uint64_t value) noexcept {
+  std::size_t result = 1;
+  while (value >= 0x80U) {
+    value >>= 7U;
+    ++result;
+  }
+  return result;
+}
+
+// Computes the layout of a compact tree and, unless the output is null,
+// writes it
+class [[nodiscard]] tree_layout final {
+ public:
+  using entry_vector = std::vector<std::pair<unodb::key, unodb::value_view>>;
+
+  tree_layout(const entry_vector &entries_, unsigned ref_size_,
+              std::uint64_t leaves_start_, std::byte *out_) noexcept
+      : entries{entries_},
+        ref_size{ref_size_},
+        leaves_start{leaves_start_},
+        out{out_} {}
+
+  // Lay out the subtree of entries [begin, end), which share their first depth
+  // key bytes, and return its reference
+  [[nodiscard]] std::uint64_t add_node(std::size_t begin, std::size_t end,
+                                       unsigned depth) noexcept;
+
+  [[nodiscard]] constexpr auto get_inodes_size() const noexcept {
+    return inodes_size;
+  }
+
+  [[nodiscard]] constexpr auto get_leaves_size() const noexcept {
+    return leaves_size;
+  }
+
+ private:
+  [[nodiscard]] std::uint64_t add_leaf(std::size_t i, unsigned depth) noexcept;
+
+  void write_ref(std::byte *to, std::uint64_t ref) const noexcept {
+    if (ref_size == sizeof(std::uint32_t)) {
+      const auto ref32 = static_cast<std::uint32_t>(ref);
+      std::memcpy(to, &ref32, sizeof(ref32));
+    } else {
+      std::memcpy(to, &ref, sizeof(ref));
+    }
+  }
+
+  const entry_vector &entries;
+  const unsigned ref_size;
+  const std::uint64_t leaves_start;
+  std::byte *const out;
+
+  std::uint64_t inodes_size{0};
+  std::uint64_t leaves_size{0};
+};
+
+std::uint64_t tree_layout::add_leaf(std::size_t i, unsigned depth) noexcept {
+  const auto [k, v] = entries[i];
+  const auto offset = leaves_start + leaves_size;
+  leaves_size += sizeof(unodb::key) - depth + varint_size(v.size()) + v.size();
+  if (out == nullptr) return offset;
+
+  auto *dest = out + offset;
+  for (auto d = depth; d < sizeof(unodb::key); ++d)
+    *dest++ = static_cast<std::byte>(key_byte_at(k, d));
+  auto value_size = v.size();
+  while (value_size >= 0x80U) {
+    *dest++ = static_cast<std::byte>((value_size & 0x7FU) | 0x80U);
+    value_size >>= 7U;
+  }
+  *dest++ = static_cast<std::byte>(value_size);
+  if (!v.empty()) std::memcpy(dest, v.data(), v.size());
+  return offset;
+}
+
+std::uint64_t tree_layout::add_node(std::size_t begin, std::size_t end,
+                                    unsigned depth) noexcept {
+  UNODB_DETAIL_ASSERT(begin < end);
+
+  if (end - begin == 1) return add_leaf(begin, depth);
+
+  // The entries are sorted, so the first and the last ones differ at the
+  // first key byte where any of them do
+  const auto first_key = entries[begin].first;
+  const auto last_key = entries[end - 1].first;
+  auto split_depth = depth;
+  while (key_byte_at(first_key, split_depth) ==
+         key_byte_at(last_key, split_depth))
+    ++split_depth;
+  UNODB_DETAIL_ASSERT(split_depth < sizeof(unodb::key));
+
+  unsigned children_count = 1;
+  for (auto i = begin + 1; i < end; ++i) {
+    if (key_byte_at(entries[i].first, split_depth) !=
+        key_byte_at(entries[i - 1].first, split_depth))
+      ++children_count;
+  }
+
+  const auto key_prefix_len = split_depth - depth;
+  const auto kind = (children_count <= max_sorted_children)
+                        ? inode_kind::SORTED
+                        : inode_kind::BITMAP;
+  const auto lookup_size =
+      (kind == inode_kind::SORTED) ? children_count : bitmap_lookup_size;
+  const auto refs_start = inode_header_size + key_prefix_len + lookup_size;
+
+  const auto offset = inodes_size;
+  inodes_size += refs_start + children_count * ref_size;
+
+  std::byte *node = nullptr;
+  std::array<std::uint64_t, bitmap_words> bitmap{};
+  if (out != nullptr) {
+    node = out + offset;
+    node[0] = static_cast<std::byte>(
+        key_prefix_len | (static_cast<unsigned>(kind) << 4U));
+    node[1] = static_cast<std::byte>(children_count - 1);
+    for (unsigned i = 0; i < key_prefix_len; ++i) {
+      node[inode_header_size + i] =
+          static_cast<std::byte>(key_byte_at(first_key, depth + i));
+    }
+  }
+
+  unsigned child_i = 0;
+  auto child_begin = begin;
+  while (child_begin < end) {
+    const auto key_byte = key_byte_at(entries[child_begin].first, split_depth);
+    auto child_end = child_begin + 1;
+    while (child_end < end &&
+           key_byte_at(entries[child_end].first, split_depth) == key_byte)
+      ++child_end;
+
+    const auto child_ref = add_node(child_begin, child_end, split_depth + 1);
+
+    if (node != nullptr) {
+      if (kind == inode_kind::SORTED) {
+        node[inode_header_size + key_prefix_len + child_i] =
+            static_cast<std::byte>(key_byte);
+      } else {
+        bitmap[key_byte / 64U] |= 1ULL << (key_byte % 64U);
+      }
+      write_ref(node + refs_start + child_i * ref_size, child_ref);
+    }
+
+    ++child_i;
+    child_begin = child_end;
+  }
+  UNODB_DETAIL_ASSERT(child_i == children_count);
+
+  if (node != nullptr && kind == inode_kind::BITMAP) {
+    auto *const lookup = node + inode_header_size + key_prefix_len;
+    std::memcpy(lookup, bitmap.data(), bitmap_size);
+    unsigned rank = 0;
+    for (std::size_t i = 0; i < bitmap_words; ++i) {
+      lookup[bitmap_size + i] = static_cast<std::byte>(rank);
+      rank += unodb::detail::popcount64(bitmap[i]);
+    }
+  }
+
+  return offset;
+}
+
+}  // namespace
+
+namespace unodb {
+
+compact_db::compact_db(const db &source)
+    : key_count{source.get_node_count<node_type::LEAF>()} {
+  detail::compact_tree_source tree_source{key_count};
+  source.for_each_key_value(tree_source);
+  if (empty()) return;
+
+  const auto &entries = tree_source.get_entries();
+  const auto layout_sizes = [&entries](unsigned layout_ref_size) {
+    tree_layout sizes{entries, layout_ref_size, 0, nullptr};
+    std::ignore = sizes.add_node(0, entries.size(), 0);
+    return std::make_pair(sizes.get_inodes_size(), sizes.get_leaves_size());
+  };
+
+  auto [inodes_size, leaves_size] = layout_sizes(ref_size);
+  if (inodes_size + leaves_size > std::numeric_limits<std::uint32_t>::max()) {
+    ref_size = sizeof(std::uint64_t);
+    std::tie(inodes_size, leaves_size) = layout_sizes(ref_size);
+  }
+
+  leaves_start = inodes_size;
+  nodes.resize(inodes_size + leaves_size);
+  tree_layout layout{entries, ref_size, leaves_start, nodes.data()};
+  root_ref = layout.add_node(0, entries.size(), 0);
+}
+
+std::uint64_t compact_db::read_child_ref(const std::byte *refs,
+                                         unsigned i) const noexcept {
+  return (ref_size == sizeof(std::uint32_t))
+             ? read<std::uint32_t>(refs + i * sizeof(std::uint32_t))
+             : read<std::uint64_t>(refs + i * sizeof(std::uint64_t));
+}
+
+compact_db::get_result compact_db::get(key search_key) const noexcept {
+  if (UNODB_DETAIL_UNLIKELY(empty())) return {};
+
+  const auto *const base = nodes.data();
+  auto ref = root_ref;
+  unsigned depth = 0;
+  while (ref < leaves_start) {
+    const auto *node = base + ref;
+    const auto header = static_cast<unsigned>(node[0]);
+    const auto key_prefix_len = header & 0xFU;
+    const auto children_count = static_cast<unsigned>(node[1]) + 1;
+    node += inode_header_size;
+
+    for (unsigned i = 0; i < key_prefix_len; ++i) {
+      if (static_cast<std::uint8_t>(node[i]) !=
+          key_byte_at(search_key, depth + i))
+        return {};
+    }
+    depth += key_prefix_len;
+    node += key_prefix_len;
+
+    const auto key_byte = key_byte_at(search_key, depth);
+    unsigned child_i;
+    if (static_cast<inode_kind>(header >> 4U) == inode_kind::SORTED) {
+      child_i = 0;
+      while (child_i < children_count &&
+             static_cast<std::uint8_t>(node[child_i]) != key_byte)
+        ++child_i;
+      if (child_i == children_count) return {};
+      node += children_count;
+    } else {
+      const auto word_i = key_byte / 64U;
+      const auto bit = 1ULL << (key_byte % 64U);
+      const auto word =
+          read<std::uint64_t>(node + word_i * sizeof(std::uint64_t));
+      if ((word & bit) == 0) return {};
+      child_i = static_cast<unsigned>(node[bitmap_size + word_i]) +
+                detail::popcount64(word & (bit - 1));
+      node += bitmap_lookup_size;
+    }
+
+    ref = read_child_ref(node, child_i);
+    ++depth;
+  }
+
+  const auto *leaf = base + ref;
+  for (auto d = depth; d < sizeof(key); ++d) {
+    if (static_cast<std::uint8_t>(*leaf++) != key_byte_at(search_key, d))
+      return {};
+  }
+  std::size_t value_size = 0;
+  for (unsigned shift = 0;; shift += 7) {
+    const auto byte = static_cast<std::size_t>(*leaf++);
+    value_size |= (byte & 0x7FU) << shift;
+    if ((byte & 0x80U) == 0) break;
+  }
+  return value_view{leaf, value_size};
+}
+
+}  // namespace unodb
@@ -0,0 +1,96 @@
+// Copyright 2022 Laurynas Biveinis
+#ifndef UNODB_DETAIL_COMPACT_ART_HPP
+#define UNODB_DETAIL_COMPACT_ART_HPP
+
+#include "global.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "art_common.hpp"
+
+namespace unodb {
+
+class db;
+
+namespace detail {
+
+// Collects the keys and values of a db in increasing key order for building
+// a compact_db
+class [[nodiscard]] compact_tree_source final {
+ public:
+  explicit compact_tree_source(std::uint64_t key_count) {
+    entries.reserve(key_count);
+  }
+
+  void add(key k, value_view v) { entries.emplace_back(k, v); }
+
+  [[nodiscard]] constexpr const auto &get_entries() const noexcept {
+    return entries;
+  }
+
+ private:
+  std::vector<std::pair<key, value_view>> entries;
+};
+
+}  // namespace detail
+
+// A read-only copy of a db tree in a single allocation. Each inode takes only
+// as much memory as its children need, and leaves hold only the key bytes not
+// on their path and the value. The inodes are laid out in depth-first order,
+// followed by the leaves in key order.
+class compact_db final {
+ public:
+  using get_result = std::optional<value_view>;
+
+  explicit compact_db(const db &source);
+
+  compact_db(const compact_db &) = delete;
+  compact_db(compact_db &&) = delete;
+  compact_db &operator=(const compact_db &) = delete;
+  compact_db &operator=(compact_db &&) = delete;
+
+  // Querying
+  [[nodiscard, gnu::pure]] get_result get(key search_key) const noexcept;
+
+  [[nodiscard, gnu::pure]] constexpr auto empty() const noexcept {
+    return key_count == 0;
+  }
+
+  // Stats
+
+  // Return the memory use by the tree nodes in bytes
+  [[nodiscard, gnu::pure]] auto get_current_memory_use() const noexcept {
+    return nodes.size();
+  }
+
+  [[nodiscard, gnu::pure]] constexpr auto get_key_count() const noexcept {
+    return key_count;
+  }
+
+  // Public utils
+  [[nodiscard, gnu::const]] static constexpr auto key_found(
+      const get_result &result) noexcept {
+    return static_cast<bool>(result);
+  }
+
+ private:
+  [[nodiscard, gnu::pure]] std::uint64_t read_child_ref(
+      const std::byte *refs, unsigned i) const noexcept;
+
+  std::vector<std::byte> nodes;
+
+  // Child references are offsets in nodes, of ref_size bytes. The ones at
+  // leaves_start and above are leaves.
+  std::uint64_t leaves_start{0};
+  std::uint64_t root_ref{0};
+  std::uint64_t key_count{0};
+  unsigned ref_size{sizeof(std::uint32_t)};
+};
+
+}  // namespace unodb
+
+#endif  // UNODB_DETAIL_COMPACT_ART_HPP
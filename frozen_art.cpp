@@ -0,0 +1,416 @@
+// Copyright 2022 Laurynas Biveinis
+
+#include "global.hpp"  // IWYU pragma: keep
+
+#include "frozen_art.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <stdexcept>
+#include <vector>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "art.hpp"
+#include "assert.hpp"
+#include "node_type.hpp"
+
+namespace {
+
+// The image starts with a header, padded to an inode alignment boundary,
+// followed by the nodes in depth-first order. Node offsets are from the image
+// start, zero stands for no node. All the fields are in the host byte order.
+constexpr std::array<char, 8> frozen_magic{'u', 'n', 'o', 'd',
+                                           'b', 'f', 'r', 'z'};
+
+constexpr std::uint32_t frozen_version = 1;
+
+// Reads differently in the other byte order
+constexpr std::uint32_t byte_order_mark = 0x01020304U;
+
+struct [[nodiscard]] frozen_header final {
+  std::array<char, 8> magic;
+  std::uint32_t version;
+  std::uint32_t byte_order;
+  std::uint64_t image_size;
+  std::uint64_t key_count;
+  std::uint64_t root_offset;
+};
+
+// Inodes start at cache line boundaries of the image
+constexpr std::size_t inode_alignment = 64;
+constexpr std::size_t leaf_alignment = 8;
+
+constexpr std::size_t header_size = inode_alignment;
+static_assert(sizeof(frozen_header) <= header_size);
+
+enum class frozen_node_kind : std::uint8_t { LEAF, SORTED, INDEXED, FULL };
+
+// Followed by the value bytes
+struct [[nodiscard]] frozen_leaf final {
+  frozen_node_kind kind;
+  std::array<std::uint8_t, 3> unused;
+  std::uint32_t value_size;
+  unodb::key k;
+};
+
+static_assert(sizeof(frozen_leaf) == 16);
+
+// Followed by the child lookup structure of the kind:
+// - SORTED: up to max_sorted_children key bytes in increasing order, padded
+//   to max_sorted_children, and the child offsets in the same order
+// - INDEXED: child indexes by key byte, empty_child_index if none, and the
+//   child offsets by child index
+// - FULL: child offsets by key byte
+struct [[nodiscard]] frozen_inode final {
+  frozen_node_kind kind;
+  std::uint8_t key_prefix_len;
+  std::uint16_t children_count;
+  std::array<std::uint8_t, 4> unused;
+  // The key prefix bytes as a number, the first byte the most significant
+  std::uint64_t key_prefix;
+};
+
+static_assert(sizeof(frozen_inode) == 16);
+
+constexpr unsigned max_sorted_children = 16;
+constexpr unsigned max_indexed_children = 48;
+constexpr std::uint8_t empty_child_index = 0xFF;
+
+constexpr std::size_t sorted_key_bytes_size = max_sorted_children;
+constexpr std::size_t child_indexes_size = 256;
+
+[[nodiscard]] constexpr std::uint8_t key_byte_at(unodb::key k,
+                                                 unsigned depth) noexcept {
+  return static_cast<std::uint8_t>(k >> (56U - depth * 8U));
+}
+
+template <typename T>
+[[nodiscard]] T read(const std::byte *from) noexcept {
+  T result;
+  std::memcpy(&result, from, sizeof(result));
+  return result;
+}
+
+[[nodiscard]] std::uint64_t read_child(const std::byte *children,
+                                       std::size_t i) noexcept {
+  return read<std::uint64_t>(children + i * sizeof(std::uint64_t));
+}
+
+[[noreturn, gnu::cold]] UNODB_DETAIL_NOINLINE void throw_not_an_image() {
+  throw std::runtime_error("Not a unodb frozen image");
+}
+
+class [[nodiscard]] image_builder final {
+ public:
+  using entry_vector = std::vector<std::pair<unodb::key, unodb::value_view>>;
+
+  explicit image_builder(const entry_vector &entries_) : entries{entries_} {}
+
+  // Lay out the subtree of entries [begin, end), which share their first depth
+  // key bytes, and return its offset
+  [[nodiscard]] std::uint64_t add_node(std::size_t begin, std::size_t end,
+                                       unsigned depth);
+
+  [[nodiscard]] std::vector<std::byte> &get_image() noexcept { return image; }
+
+ private:
+  [[nodiscard]] std::size_t append(std::size_t size, std::size_t alignment) {
+    const auto offset = (image.size() + alignment - 1) / alignment * alignment;
+    image.resize(offset + size);
+    return offset;
+  }
+
+  template <typename T>
+  void store(std::size_t offset, const T &value) noexcept {
+    std::memcpy(image.data() + offset, &value, sizeof(value));
+  }
+
+  const entry_vector &entries;
+
+  std::vector<std::byte> image = std::vector<std::byte>(header_size);
+};
+
+std::uint64_t image_builder::add_node(std::size_t begin, std::size_t end,
+                                      unsigned depth) {
+  UNODB_DETAIL_ASSERT(begin < end);
+
+  if (end - begin == 1) {
+    const auto [k, v] = entries[begin];
+    const auto offset = append(sizeof(frozen_leaf) + v.size(), leaf_alignment);
+    const frozen_leaf leaf{frozen_node_kind::LEAF, {},
+                           static_cast<std::uint32_t>(v.size()), k};
+    store(offset, leaf);
+    if (!v.empty())
+      std::memcpy(image.data() + offset + sizeof(leaf), v.data(), v.size());
+    return offset;
+  }
+
+  // The entries are sorted, so the first and the last ones differ at the
+  // first key byte where any of them do
+  const auto first_key = entries[begin].first;
+  const auto last_key = entries[end - 1].first;
+  auto split_depth = depth;
+  while (key_byte_at(first_key, split_depth) ==
+         key_byte_at(last_key, split_depth))
+    ++split_depth;
+  UNODB_DETAIL_ASSERT(split_depth < sizeof(unodb::key));
+
+  unsigned children_count = 1;
+  for (auto i = begin + 1; i < end; ++i) {
+    if (key_byte_at(entries[i].first, split_depth) !=
+        key_byte_at(entries[i - 1].first, split_depth))
+      ++children_count;
+  }
+
+  frozen_inode inode{};
+  inode.key_prefix_len = static_cast<std::uint8_t>(split_depth - depth);
+  inode.children_count = static_cast<std::uint16_t>(children_count);
+  if (inode.key_prefix_len > 0) {
+    inode.key_prefix =
+        (first_key << (depth * 8U)) >> (64U - inode.key_prefix_len * 8U);
+  }
+
+  std::size_t lookup_size;
+  std::size_t children_start;
+  if (children_count <= max_sorted_children) {
+    inode.kind = frozen_node_kind::SORTED;
+    lookup_size = sorted_key_bytes_size;
+    children_start = sizeof(inode) + lookup_size;
+  } else if (children_count <= max_indexed_children) {
+    inode.kind = frozen_node_kind::INDEXED;
+    lookup_size = child_indexes_size;
+    children_start = sizeof(inode) + lookup_size;
+  } else {
+    inode.kind = frozen_node_kind::FULL;
+    lookup_size = 0;
+    children_start = sizeof(inode);
+  }
+  const auto children_size =
+      ((inode.kind == frozen_node_kind::FULL) ? 256 : children_count) *
+      sizeof(std::uint64_t);
+
+  const auto offset =
+      append(sizeof(inode) + lookup_size + children_size, inode_alignment);
+  store(offset, inode);
+  if (inode.kind == frozen_node_kind::INDEXED) {
+    std::memset(image.data() + offset + sizeof(inode), empty_child_index,
+                child_indexes_size);
+  }
+
+  unsigned child_i = 0;
+  auto child_begin = begin;
+  while (child_begin < end) {
+    const auto key_byte = key_byte_at(entries[child_begin].first, split_depth);
+    auto child_end = child_begin + 1;
+    while (child_end < end &&
+           key_byte_at(entries[child_end].first, split_depth) == key_byte)
+      ++child_end;
+
+    // Children are laid out after their parent and may reallocate the image
+    const auto child_offset = add_node(child_begin, child_end, split_depth + 1);
+
+    switch (inode.kind) {
+      case frozen_node_kind::SORTED:
+        store(offset + sizeof(inode) + child_i, key_byte);
+        store(offset + children_start + child_i * sizeof(child_offset),
+              child_offset);
+        break;
+      case frozen_node_kind::INDEXED:
+        store(offset + sizeof(inode) + key_byte,
+              static_cast<std::uint8_t>(child_i));
+        store(offset + children_start + child_i * sizeof(child_offset),
+              child_offset);
+        break;
+      case frozen_node_kind::FULL:
+        store(offset + children_start + key_byte * sizeof(child_offset),
+              child_offset);
+        break;
+      // LCOV_EXCL_START
+      case frozen_node_kind::LEAF:
+        UNODB_DETAIL_CANNOT_HAPPEN();
+        // LCOV_EXCL_STOP
+    }
+
+    ++child_i;
+    child_begin = child_end;
+  }
+  UNODB_DETAIL_ASSERT(child_i == children_count);
+
+  return offset;
+}
+
+}  // namespace
+
+namespace unodb::detail {
+
+frozen_image_writer::frozen_image_writer(std::uint64_t key_count) {
+  entries.reserve(key_count);
+}
+
+void frozen_image_writer::add(key k, value_view v) {
+  UNODB_DETAIL_ASSERT(entries.empty() || k > entries.back().first);
+  entries.emplace_back(k, v);
+}
+
+void frozen_image_writer::write(std::ostream &os) const {
+  image_builder builder{entries};
+  const auto root_offset =
+      entries.empty() ? 0 : builder.add_node(0, entries.size(), 0);
+  auto &image = builder.get_image();
+
+  const frozen_header header{frozen_magic, frozen_version, byte_order_mark,
+                             image.size(), entries.size(), root_offset};
+  std::memcpy(image.data(), &header, sizeof(header));
+
+  os.write(reinterpret_cast<const char *>(image.data()),
+           static_cast<std::streamsize>(image.size()));
+}
+
+}  // namespace unodb::detail
+
+namespace unodb {
+
+void frozen_db::write(const db &source, std::ostream &os) {
+  detail::frozen_image_writer writer{
+      source.get_node_count<node_type::LEAF>()};
+  source.for_each_key_value(writer);
+  writer.write(os);
+}
+
+frozen_db::frozen_db(value_view image_) : image{image_} { check_header(); }
+
+#ifndef _WIN32
+
+frozen_db::frozen_db(const char *path) {
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-vararg,hicpp-vararg)
+  const auto fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (UNODB_DETAIL_UNLIKELY(fd == -1))
+    throw std::system_error{errno, std::generic_category(), path};
+
+  struct stat file_stat;
+  if (UNODB_DETAIL_UNLIKELY(fstat(fd, &file_stat) != 0)) {
+    const auto fstat_errno = errno;
+    close(fd);
+    throw std::system_error{fstat_errno, std::generic_category(), path};
+  }
+  const auto size = static_cast<std::size_t>(file_stat.st_size);
+  if (UNODB_DETAIL_UNLIKELY(size < header_size)) {
+    close(fd);
+    throw_not_an_image();
+  }
+
+  // The mapping stays valid after closing the file
+  void *const mem = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  const auto mmap_errno = errno;
+  close(fd);
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-cstyle-cast,performance-no-int-to-ptr)
+  if (UNODB_DETAIL_UNLIKELY(mem == MAP_FAILED))
+    throw std::system_error{mmap_errno, std::generic_category(), path};
+
+  image = value_view{static_cast<const std::byte *>(mem), size};
+  mapped = true;
+  try {
+    check_header();
+  } catch (...) {
+    munmap(mem, size);
+    throw;
+  }
+}
+
+#endif  // #ifndef _WIN32
+
+frozen_db::~frozen_db() noexcept {
+#ifndef _WIN32
+  if (mapped) {
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+    munmap(const_cast<std::byte *>(image.data()), image.size());
+  }
+#endif
+}
+
+void frozen_db::check_header() {
+  if (image.size() < header_size) throw_not_an_image();
+
+  const auto header = read<frozen_header>(image.data());
+  if (header.magic != frozen_magic) throw_not_an_image();
+  if (header.byte_order != byte_order_mark)
+    throw std::runtime_error("unodb frozen image of another byte order");
+  if (header.version != frozen_version)
+    throw std::runtime_error("Unsupported unodb frozen image version");
+  if (header.image_size != image.size() ||
+      (header.root_offset == 0) != (header.key_count == 0) ||
+      header.root_offset >= image.size())
+    throw std::runtime_error("Truncated or corrupt unodb frozen image");
+
+  root_offset = header.root_offset;
+  key_count = header.key_count;
+}
+
+frozen_db::get_result frozen_db::get(key search_key) const noexcept {
+  if (UNODB_DETAIL_UNLIKELY(empty())) return {};
+
+  const auto *const base = image.data();
+  auto offset = root_offset;
+  unsigned depth = 0;
+  while (true) {
+    const auto *const node = base + offset;
+
+    if (static_cast<frozen_node_kind>(*node) == frozen_node_kind::LEAF) {
+      const auto leaf = read<frozen_leaf>(node);
+      if (leaf.k != search_key) return {};
+      return value_view{node + sizeof(leaf), leaf.value_size};
+    }
+
+    const auto inode = read<frozen_inode>(node);
+    if (inode.key_prefix_len > 0) {
+      const auto key_prefix =
+          (search_key << (depth * 8U)) >> (64U - inode.key_prefix_len * 8U);
+      if (key_prefix != inode.key_prefix) return {};
+      depth += inode.key_prefix_len;
+    }
+
+    const auto key_byte = key_byte_at(search_key, depth);
+    const auto *const lookup = node + sizeof(inode);
+    switch (inode.kind) {
+      case frozen_node_kind::SORTED: {
+        const auto *const children = lookup + sorted_key_bytes_size;
+        unsigned i = 0;
+        while (i < inode.children_count &&
+               static_cast<std::uint8_t>(lookup[i]) != key_byte)
+          ++i;
+        if (i == inode.children_count) return {};
+        offset = read_child(children, i);
+        break;
+      }
+      case frozen_node_kind::INDEXED: {
+        const auto child_i = static_cast<std::uint8_t>(lookup[key_byte]);
+        if (child_i == empty_child_index) return {};
+        offset = read_child(lookup + child_indexes_size, child_i);
+        break;
+      }
+      case frozen_node_kind::FULL:
+        offset = read_child(lookup, key_byte);
+        if (offset == 0) return {};
+        break;
+      // LCOV_EXCL_START
+      case frozen_node_kind::LEAF:
+        UNODB_DETAIL_CANNOT_HAPPEN();
+        // LCOV_EXCL_STOP
+    }
+    ++depth;
+  }
+}
+
+}  // namespace unodb
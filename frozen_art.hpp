@@ -0,0 +1,113 @@
+// Copyright 2022 Laurynas Biveinis
+#ifndef UNODB_DETAIL_FROZEN_ART_HPP
+#define UNODB_DETAIL_FROZEN_ART_HPP
+
+#include "global.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "art_common.hpp"
+
+namespace unodb {
+
+class db;
+
+namespace detail {
+
+// Lays out the frozen image of the keys and values added in increasing key
+// order
+class [[nodiscard]] frozen_image_writer final {
+ public:
+  explicit frozen_image_writer(std::uint64_t key_count);
+
+  // The value must stay valid until write returns
+  void add(key k, value_view v);
+
+  void write(std::ostream &os) const;
+
+  frozen_image_writer(const frozen_image_writer &) = delete;
+  frozen_image_writer(frozen_image_writer &&) = delete;
+  frozen_image_writer &operator=(const frozen_image_writer &) = delete;
+  frozen_image_writer &operator=(frozen_image_writer &&) = delete;
+
+ private:
+  std::vector<std::pair<key, value_view>> entries;
+};
+
+}  // namespace detail
+
+// A read-only image of a db tree that is queried in place. It contains no
+// pointers, only offsets from its start, so that it can be written to a file
+// and mapped at any address by any number of processes, which then share its
+// pages in the page cache. The image is in the host byte order.
+class frozen_db final {
+ public:
+  using get_result = std::optional<value_view>;
+
+  // Write the frozen image of source to os. Stream errors are left in the
+  // stream state.
+  static void write(const db &source, std::ostream &os);
+
+  // Query an image in memory written by write, which must stay unmodified
+  // while this object lives. Throws std::runtime_error if it does not start
+  // with a valid header. The nodes are not validated, thus images must come
+  // from a trusted source. For cache line-aligned nodes, the image should be
+  // aligned to 64 bytes.
+  explicit frozen_db(value_view image_);
+
+#ifndef _WIN32
+  // Map a file with an image written by write read-only. Throws
+  // std::system_error if the file cannot be mapped and std::runtime_error as
+  // the constructor above.
+  explicit frozen_db(const char *path);
+#endif
+
+  ~frozen_db() noexcept;
+
+  frozen_db(const frozen_db &) = delete;
+  frozen_db(frozen_db &&) = delete;
+  frozen_db &operator=(const frozen_db &) = delete;
+  frozen_db &operator=(frozen_db &&) = delete;
+
+  // Querying. The returned values point into the image.
+  [[nodiscard, gnu::pure]] get_result get(key search_key) const noexcept;
+
+  [[nodiscard, gnu::pure]] constexpr auto empty() const noexcept {
+    return root_offset == 0;
+  }
+
+  // Stats
+  [[nodiscard, gnu::pure]] constexpr auto get_key_count() const noexcept {
+    return key_count;
+  }
+
+  [[nodiscard, gnu::pure]] constexpr auto get_image_size() const noexcept {
+    return image.size();
+  }
+
+  // Public utils
+  [[nodiscard, gnu::const]] static constexpr auto key_found(
+      const get_result &result) noexcept {
+    return static_cast<bool>(result);
+  }
+
+ private:
+  void check_header();
+
+  value_view image;
+
+  std::uint64_t root_offset{0};
+  std::uint64_t key_count{0};
+
+  // Whether the image is a file mapping owned by this object
+  bool mapped{false};
+};
+
+}  // namespace unodb
+
+#endif  // UNODB_DETAIL_FROZEN_ART_HPP
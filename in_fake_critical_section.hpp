@@ -15,6 +15,10 @@ namespace unodb {
 template <typename T>
 class [[nodiscard]] in_fake_critical_section final {
  public:
+  // No other thread accesses the value, so it may be stored together with its
+  // neighbours by wider, i.e. vector, stores.
+  static constexpr bool concurrent_access = false;
+
   constexpr in_fake_critical_section() noexcept = default;
   // NOLINTNEXTLINE(google-explicit-constructor,hicpp-explicit-conversions)
   constexpr in_fake_critical_section(T value_) noexcept : value{value_} {}
@@ -4,6 +4,7 @@
 
 #include "global.hpp"
 
+#include <cstdint>
 #include <mutex>
 #include <utility>
 
@@ -23,6 +24,8 @@ class mutex_db final {
   // Creation and destruction
   mutex_db() noexcept = default;
 
+  explicit mutex_db(shrink_policy policy) noexcept : db_{policy} {}
+
   // Querying
   [[nodiscard]] auto get(key k) const {
     std::unique_lock guard{mutex};
@@ -56,6 +59,37 @@ class mutex_db final {
     db_.clear();
   }
 
+  // Logging
+
+  // As db::attach_log. The operations wait for the log to become durable with
+  // the tree mutex held.
+  void attach_log(write_ahead_log *log) {
+    const std::lock_guard guard{mutex};
+    db_.attach_log(log);
+  }
+
+  // Snapshots
+  void save(std::ostream &os) const {
+    const std::lock_guard guard{mutex};
+    db_.save(os);
+  }
+
+  void load(std::istream &is) {
+    const std::lock_guard guard{mutex};
+    db_.load(is);
+  }
+
+  void replay(std::istream &log_is) {
+    const std::lock_guard guard{mutex};
+    db_.replay(log_is);
+  }
+
+  void replay(std::istream &checkpoint_is, std::istream &log_is,
+              std::uint64_t start_lsn) {
+    const std::lock_guard guard{mutex};
+    db_.replay(checkpoint_is, log_is, start_lsn);
+  }
+
   // Stats
   [[nodiscard]] auto get_current_memory_use() const {
     const std::lock_guard guard{mutex};
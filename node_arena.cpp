@@ -0,0 +1,200 @@
+// Copyright 2022 Laurynas Biveinis
+
+#include "global.hpp"  // IWYU pragma: keep
+
+#include "node_arena.hpp"
+
+#ifdef UNODB_DETAIL_COMPRESSED_NODE_PTRS
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <new>
+
+#include <sys/mman.h>
+
+#include "assert.hpp"
+#include "portability_arch.hpp"
+
+namespace unodb::detail {
+
+namespace {
+
+constexpr std::size_t slab_size = 64 * 1024;
+constexpr std::size_t slab_count = node_arena::capacity / slab_size;
+constexpr std::size_t page_size = 4096;
+
+// Blocks of up to this many granules share slabs, larger ones take whole slabs
+constexpr std::size_t max_small_granules = 512;
+static_assert(max_small_granules * node_arena::granule * 4 <= slab_size);
+
+// Set in the slab info of the first slab of a large block, together with the
+// slab count. Small block slabs have their block size in granules instead.
+constexpr std::uint32_t large_block_flag = 1U << 31U;
+
+// Written at the start of a free large block
+struct free_large_block final {
+  std::uint64_t next_offset;
+  std::uint64_t slab_count;
+};
+
+class arena_state final {
+ public:
+  arena_state() {
+    void *const mem =
+        mmap(nullptr, node_arena::capacity, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-cstyle-cast,performance-no-int-to-ptr)
+    if (UNODB_DETAIL_UNLIKELY(mem == MAP_FAILED)) throw std::bad_alloc{};
+    node_arena::base = static_cast<std::byte *>(mem);
+  }
+
+  [[nodiscard]] void *allocate(std::size_t size, std::size_t alignment) {
+    UNODB_DETAIL_ASSERT(alignment <= hardware_constructive_interference_size);
+
+    // Blocks are aligned to their size within a slab
+    const auto alignment_granules =
+        (alignment + node_arena::granule - 1) / node_arena::granule;
+    auto granules = (size + node_arena::granule - 1) / node_arena::granule;
+    granules = (granules + alignment_granules - 1) / alignment_granules *
+               alignment_granules;
+
+    const std::lock_guard guard{lock};
+    return node_arena::base +
+           ((granules <= max_small_granules)
+                ? allocate_small(granules)
+                : allocate_large((size + slab_size - 1) / slab_size));
+  }
+
+  void free(void *ptr) noexcept {
+    const auto offset =
+        static_cast<std::uint64_t>(static_cast<std::byte *>(ptr) -
+                                   node_arena::base);
+    const auto slab = offset / slab_size;
+
+    const std::lock_guard guard{lock};
+    const auto info = slab_info[slab];
+    UNODB_DETAIL_ASSERT(info != 0);
+
+    if ((info & large_block_flag) == 0) {
+      UNODB_DETAIL_ASSERT(info <= max_small_granules);
+      std::memcpy(ptr, &small_free_lists[info], sizeof(std::uint64_t));
+      small_free_lists[info] = offset;
+      return;
+    }
+
+    UNODB_DETAIL_ASSERT(offset % slab_size == 0);
+    const std::uint64_t block_slab_count = info & ~large_block_flag;
+    // Keep the first page for the free list link
+    const auto result UNODB_DETAIL_USED_IN_DEBUG =
+        madvise(static_cast<std::byte *>(ptr) + page_size,
+                block_slab_count * slab_size - page_size, MADV_DONTNEED);
+    UNODB_DETAIL_ASSERT(result == 0);
+    const free_large_block free_block{large_free_list, block_slab_count};
+    std::memcpy(ptr, &free_block, sizeof(free_block));
+    large_free_list = offset;
+  }
+
+ private:
+  [[nodiscard]] std::uint64_t allocate_small(std::size_t granules) {
+    auto &free_list = small_free_lists[granules];
+    if (free_list != 0) {
+      const auto result = free_list;
+      std::memcpy(&free_list, node_arena::base + result, sizeof(free_list));
+      return result;
+    }
+
+    const auto block_size = granules * node_arena::granule;
+    if (bump_offsets[granules] == bump_ends[granules]) {
+      const auto slab = new_slabs(1);
+      slab_info[slab] = static_cast<std::uint32_t>(granules);
+      bump_offsets[granules] = slab * slab_size;
+      bump_ends[granules] =
+          bump_offsets[granules] + slab_size / block_size * block_size;
+    }
+    const auto result = bump_offsets[granules];
+    bump_offsets[granules] += block_size;
+    return result;
+  }
+
+  [[nodiscard]] std::uint64_t allocate_large(std::uint64_t block_slab_count) {
+    // Reuse an exact size match, large blocks are not split nor merged
+    std::uint64_t prev_offset = 0;
+    auto offset = large_free_list;
+    while (offset != 0) {
+      free_large_block free_block;
+      std::memcpy(&free_block, node_arena::base + offset, sizeof(free_block));
+      if (free_block.slab_count == block_slab_count) {
+        if (prev_offset == 0) {
+          large_free_list = free_block.next_offset;
+        } else {
+          std::memcpy(node_arena::base + prev_offset, &free_block.next_offset,
+                      sizeof(free_block.next_offset));
+        }
+        break;
+      }
+      prev_offset = offset;
+      offset = free_block.next_offset;
+    }
+
+    if (offset == 0) offset = new_slabs(block_slab_count) * slab_size;
+    slab_info[offset / slab_size] =
+        large_block_flag | static_cast<std::uint32_t>(block_slab_count);
+    return offset;
+  }
+
+  [[nodiscard]] std::uint64_t new_slabs(std::uint64_t count) {
+    if (UNODB_DETAIL_UNLIKELY(count > slab_count - next_slab))
+      throw std::bad_alloc{};
+    const auto result = next_slab;
+    next_slab += count;
+    return result;
+  }
+
+  std::mutex lock;
+
+  // Zero is never allocated, so that it can be the null node pointer
+  std::uint64_t next_slab{1};
+
+  // Offsets of the first free blocks of each size, zero if none. Each free
+  // block starts with the offset of the next one.
+  std::array<std::uint64_t, max_small_granules + 1> small_free_lists{};
+  std::uint64_t large_free_list{0};
+
+  // The unallocated space in the last slab of each small block size
+  std::array<std::uint64_t, max_small_granules + 1> bump_offsets{};
+  std::array<std::uint64_t, max_small_granules + 1> bump_ends{};
+
+  std::array<std::uint32_t, slab_count> slab_info{};
+};
+
+[[nodiscard]] arena_state &state() {
+  // Never destroyed, as trees in static storage may still free their nodes.
+  // Constructed in place so that the first node allocation does not make an
+  // extra heap allocation, which would be seen by the allocation failure
+  // injector.
+  alignas(arena_state) static std::array<std::byte, sizeof(arena_state)>
+      storage;
+  static auto *const instance = new (storage.data()) arena_state{};
+  return *instance;
+}
+
+}  // namespace
+
+void *node_arena::allocate(std::size_t size, std::size_t alignment) {
+#ifndef NDEBUG
+  unodb::test::allocation_failure_injector::maybe_fail();
+#endif
+  return state().allocate(size, alignment);
+}
+
+void node_arena::free(void *ptr) noexcept {
+  UNODB_DETAIL_ASSERT(contains(ptr));
+  state().free(ptr);
+}
+
+}  // namespace unodb::detail
+
+#endif  // #ifdef UNODB_DETAIL_COMPRESSED_NODE_PTRS
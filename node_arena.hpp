@@ -0,0 +1,70 @@
+// Copyright 2022 Laurynas Biveinis
+#ifndef UNODB_DETAIL_NODE_ARENA_HPP
+#define UNODB_DETAIL_NODE_ARENA_HPP
+
+#include "global.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+#include "heap.hpp"
+
+namespace unodb::detail {
+
+#ifdef UNODB_DETAIL_COMPRESSED_NODE_PTRS
+
+// With compressed node pointers, all tree nodes of all trees are allocated from
+// one reserved virtual address range, so that a node pointer is a 32-bit
+// offset from its base. The range is reserved on the first allocation and only
+// the pages in use are backed by memory. Nodes are carved from 64KB slabs of
+// same-sized blocks, and blocks larger than that take whole slabs. Freed blocks
+// are reused for the same sizes, freed large blocks are returned to the OS.
+class node_arena final {
+ public:
+  // The allocation unit, which leaves the low offset bits free for node type
+  // tags
+  static constexpr std::size_t granule = 32;
+
+  // 32-bit offsets in granule / 8 units, with three bits for the tag
+  static constexpr std::uint64_t capacity = 16ULL * 1024 * 1024 * 1024;
+
+  // Alignment up to a cache line is supported
+  [[nodiscard]] static void *allocate(std::size_t size, std::size_t alignment);
+
+  static void free(void *ptr) noexcept;
+
+  [[nodiscard]] static bool contains(const void *ptr) noexcept {
+    const auto offset = reinterpret_cast<std::uintptr_t>(ptr) -
+                        reinterpret_cast<std::uintptr_t>(base);
+    return base != nullptr && offset < capacity;
+  }
+
+  // Null until the first allocation. Not behind an accessor function, as every
+  // node pointer dereference adds it.
+  // NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+  inline static std::byte *base{nullptr};
+
+  node_arena() = delete;
+};
+
+[[nodiscard]] inline void *allocate_node(std::size_t size,
+                                         std::size_t alignment) {
+  return node_arena::allocate(size, alignment);
+}
+
+inline void free_node(void *ptr) noexcept { node_arena::free(ptr); }
+
+#else  // #ifdef UNODB_DETAIL_COMPRESSED_NODE_PTRS
+
+[[nodiscard]] inline void *allocate_node(std::size_t size,
+                                         std::size_t alignment) {
+  return allocate_aligned(size, alignment);
+}
+
+inline void free_node(void *ptr) noexcept { free_aligned(ptr); }
+
+#endif  // #ifdef UNODB_DETAIL_COMPRESSED_NODE_PTRS
+
+}  // namespace unodb::detail
+
+#endif  // UNODB_DETAIL_NODE_ARENA_HPP
@@ -12,14 +12,25 @@
 
 namespace unodb {
 
-enum class [[nodiscard]] node_type : std::uint8_t{LEAF, I4, I16, I48, I256};
+enum class [[nodiscard]] node_type : std::uint8_t{LEAF, I4,  I16,
+                                                  I32,  I48, I256};
+
+// When a delete replaces an inode with the next smaller inode type
+enum class [[nodiscard]] shrink_policy : std::uint8_t {
+  // As soon as the remaining children fit into the smaller type
+  EAGER,
+  // Only once the smaller type would be at most three quarters full, so that
+  // a node whose children count goes back and forth across a type capacity
+  // is not reallocated on every insert and delete. Node4 is not affected.
+  HYSTERESIS
+};
 
 namespace detail {
 
 // C++ has five value categories and IIRC thousands of ways to initialize but no
 // way to count the number of enum elements.
-constexpr std::size_t node_type_count{5};
-constexpr std::size_t inode_type_count{4};
+constexpr std::size_t node_type_count{6};
+constexpr std::size_t inode_type_count{5};
 
 template <node_type NodeType>
 void is_internal_static_assert() noexcept {
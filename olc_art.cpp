@@ -5,9 +5,14 @@
 
 #include "olc_art.hpp"
 
+#include <array>
 #include <cstddef>
+#include <cstdint>
 #include <iostream>
 #include <memory>       // IWYU pragma: keep
+#include <mutex>        // IWYU pragma: keep
+#include <optional>
+#include <stdexcept>
 #include <type_traits>  // IWYU pragma: keep
 #include <utility>      // IWYU pragma: keep
 
@@ -16,17 +21,26 @@
 #include "node_type.hpp"
 #include "optimistic_lock.hpp"
 #include "qsbr.hpp"
+#include "snapshot.hpp"
+#include "wal.hpp"
 
 namespace unodb::detail {
 
-struct [[nodiscard]] olc_node_header {
+// Leaves are immutable after creation, so they have no lock. A leaf is accessed
+// only through a pointer read in its parent critical section, which validates
+// it, and QSBR keeps it alive until no thread can be accessing it.
+struct [[nodiscard]] olc_node_header {};
+
+static_assert(std::is_empty_v<olc_node_header>);
+
+struct [[nodiscard]] olc_inode_header : olc_node_header {
   [[nodiscard]] constexpr optimistic_lock &lock() const noexcept {
     return m_lock;
   }
 
 #ifndef NDEBUG
   static void check_on_dealloc(const void *ptr) noexcept {
-    static_cast<const olc_node_header *>(ptr)->m_lock.check_on_dealloc();
+    static_cast<const olc_inode_header *>(ptr)->m_lock.check_on_dealloc();
   }
 #endif
 
@@ -34,7 +48,7 @@ struct [[nodiscard]] olc_node_header {
   mutable optimistic_lock m_lock;
 };
 
-static_assert(std::is_standard_layout_v<olc_node_header>);
+static_assert(std::is_standard_layout_v<olc_inode_header>);
 
 template <class Header, class Db>
 class db_leaf_qsbr_deleter {
@@ -51,7 +65,7 @@ class db_leaf_qsbr_deleter {
     this_thread().on_next_epoch_deallocate(to_delete, leaf_size
 #ifndef NDEBUG
                                            ,
-                                           olc_node_header::check_on_dealloc
+                                           nullptr
 #endif
     );
 
@@ -86,7 +100,7 @@ class db_inode_qsbr_deleter : public db_inode_qsbr_deleter_parent<INode> {
     this_thread().on_next_epoch_deallocate(inode_ptr, sizeof(INode)
 #ifndef NDEBUG
                                                           ,
-                                           olc_node_header::check_on_dealloc
+                                           olc_inode_header::check_on_dealloc
 #endif
     );
 
@@ -102,11 +116,13 @@ namespace {
 class olc_inode;
 class olc_inode_4;
 class olc_inode_16;
+class olc_inode_32;
 class olc_inode_48;
 class olc_inode_256;
 
 using olc_inode_defs =
-    unodb::detail::basic_inode_def<olc_inode, olc_inode_4, olc_inode_16,
+    unodb::detail::basic_inode_def<unodb::detail::olc_inode_header, olc_inode,
+                                   olc_inode_4, olc_inode_16, olc_inode_32,
                                    olc_inode_48, olc_inode_256>;
 
 using olc_art_policy =
@@ -123,19 +139,15 @@ using olc_inode_base = unodb::detail::basic_inode_impl<olc_art_policy>;
 
 class olc_inode : public olc_inode_base {};
 
+using olc_sorted_tree_builder =
+    unodb::detail::basic_sorted_tree_builder<olc_art_policy>;
+
 [[nodiscard]] auto &node_ptr_lock(
     const unodb::detail::olc_node_ptr &node) noexcept {
-  return node.ptr<unodb::detail::olc_node_header *>()->lock();
-}
-
-#ifndef NDEBUG
-
-[[nodiscard]] auto &node_ptr_lock(const leaf *const node) noexcept {
-  return node->lock();
+  UNODB_DETAIL_ASSERT(node.type() != unodb::node_type::LEAF);
+  return node.ptr<unodb::detail::olc_inode_header *>()->lock();
 }
 
-#endif
-
 template <class INode>
 [[nodiscard]] constexpr auto &lock(const INode &inode) noexcept {
   return inode.lock();
@@ -154,11 +166,140 @@ template <class T>
   return t;
 }
 
-[[nodiscard]] inline auto obsolete_child_by_index(
-    std::uint8_t child, unodb::optimistic_lock::write_guard &guard) noexcept {
-  guard.unlock_and_obsolete();
+#ifdef UNODB_DETAIL_OLC_RESTART_STATS
+
+// Restart counters of a single thread. Only the owning thread writes them, thus
+// increments are not atomic read-modify-writes, but the counters are atomic
+// for the readers summing them. The instances are linked into an intrusive list
+// so that counting a restart never allocates memory.
+class [[nodiscard]] thread_restart_counters final {
+ public:
+  thread_restart_counters() noexcept;
+
+  ~thread_restart_counters() noexcept;
+
+  void increment(unodb::olc_op op, unodb::olc_restart_cause cause,
+                 std::size_t location) noexcept {
+    auto &counter = counters[static_cast<std::size_t>(op)]
+                            [static_cast<std::size_t>(cause)][location];
+    counter.store(counter.load(std::memory_order_relaxed) + 1,
+                  std::memory_order_relaxed);
+  }
+
+  void add_to(unodb::olc_restart_counter_array &result) const noexcept {
+    for (std::size_t op = 0; op < unodb::detail::olc_op_count; ++op)
+      for (std::size_t cause = 0;
+           cause < unodb::detail::olc_restart_cause_count; ++cause)
+        for (std::size_t location = 0;
+             location < unodb::detail::olc_restart_location_count; ++location)
+          result[op][cause][location] +=
+              counters[op][cause][location].load(std::memory_order_relaxed);
+  }
+
+  void reset() noexcept {
+    for (auto &op_counters : counters)
+      for (auto &cause_counters : op_counters)
+        for (auto &counter : cause_counters)
+          counter.store(0, std::memory_order_relaxed);
+  }
+
+  thread_restart_counters(const thread_restart_counters &) = delete;
+  thread_restart_counters(thread_restart_counters &&) = delete;
+  thread_restart_counters &operator=(const thread_restart_counters &) = delete;
+  thread_restart_counters &operator=(thread_restart_counters &&) = delete;
+
+ private:
+  std::array<
+      std::array<std::array<std::atomic<std::uint64_t>,
+                            unodb::detail::olc_restart_location_count>,
+                 unodb::detail::olc_restart_cause_count>,
+      unodb::detail::olc_op_count>
+      counters{};
+
+  thread_restart_counters *prev{nullptr};
+  thread_restart_counters *next{nullptr};
+
+  friend class restart_counter_registry;
+};
+
+// The running threads, and the totals of the exited ones
+class [[nodiscard]] restart_counter_registry final {
+ public:
+  [[nodiscard]] static restart_counter_registry &instance() noexcept {
+    static restart_counter_registry registry;
+    return registry;
+  }
+
+  void add(thread_restart_counters &thread_counters) noexcept {
+    const std::lock_guard guard{lock};
+    thread_counters.next = head;
+    if (head != nullptr) head->prev = &thread_counters;
+    head = &thread_counters;
+  }
+
+  void remove(thread_restart_counters &thread_counters) noexcept {
+    const std::lock_guard guard{lock};
+    thread_counters.add_to(exited_thread_counts);
+    if (thread_counters.prev != nullptr)
+      thread_counters.prev->next = thread_counters.next;
+    else
+      head = thread_counters.next;
+    if (thread_counters.next != nullptr)
+      thread_counters.next->prev = thread_counters.prev;
+  }
+
+  [[nodiscard]] unodb::olc_restart_counter_array get() {
+    const std::lock_guard guard{lock};
+    auto result{exited_thread_counts};
+    for (const auto *i = head; i != nullptr; i = i->next) i->add_to(result);
+    return result;
+  }
+
+  void reset() {
+    const std::lock_guard guard{lock};
+    exited_thread_counts = {};
+    for (auto *i = head; i != nullptr; i = i->next) i->reset();
+  }
+
+ private:
+  std::mutex lock;
+  thread_restart_counters *head{nullptr};
+  unodb::olc_restart_counter_array exited_thread_counts{};
+};
 
-  return child;
+thread_restart_counters::thread_restart_counters() noexcept {
+  restart_counter_registry::instance().add(*this);
+}
+
+thread_restart_counters::~thread_restart_counters() noexcept {
+  restart_counter_registry::instance().remove(*this);
+}
+
+[[gnu::cold]] UNODB_DETAIL_NOINLINE void count_restart(
+    unodb::olc_op op, unodb::olc_restart_cause cause,
+    std::size_t location) noexcept {
+  thread_local thread_restart_counters current_thread_counters;
+  current_thread_counters.increment(op, cause, location);
+}
+
+#endif  // UNODB_DETAIL_OLC_RESTART_STATS
+
+// Every OLC algorithm restart goes through these, so that it can be counted.
+template <unodb::olc_op Op, unodb::olc_restart_cause Cause>
+[[nodiscard]] inline std::nullopt_t restart_at_root_pointer() noexcept {
+#ifdef UNODB_DETAIL_OLC_RESTART_STATS
+  count_restart(Op, Cause, unodb::olc_root_pointer_restart_location);
+#endif
+  return std::nullopt;
+}
+
+template <unodb::olc_op Op, unodb::olc_restart_cause Cause>
+[[nodiscard]] inline std::nullopt_t restart(
+    unodb::node_type type UNODB_DETAIL_UNUSED) noexcept {
+#ifdef UNODB_DETAIL_OLC_RESTART_STATS
+  count_restart(Op, Cause, static_cast<std::size_t>(type));
+#endif
+  return std::nullopt;
 }
 
 }  // namespace
@@ -223,24 +364,23 @@ class [[nodiscard]] olc_inode_4 final
 
   void init(db &db_instance, olc_inode_16 &source_node,
             unodb::optimistic_lock::write_guard &source_node_guard,
-            std::uint8_t child_to_delete,
-            unodb::optimistic_lock::write_guard &child_guard);
+            std::uint8_t child_to_delete);
 
   UNODB_DETAIL_DISABLE_MSVC_WARNING(26434)
 
   void init(unodb::detail::art_key k1, unodb::detail::art_key shifted_k2,
             unodb::detail::tree_depth depth, leaf *child1,
             olc_db_leaf_unique_ptr &&child2) noexcept {
-    UNODB_DETAIL_ASSERT(node_ptr_lock(child1).is_write_locked());
-
     parent_class::init(k1, shifted_k2, depth, child1, std::move(child2));
   }
 
   void init(unodb::detail::olc_node_ptr source_node, unsigned len,
-            unodb::detail::tree_depth depth, olc_db_leaf_unique_ptr &&child1) {
+            unodb::detail::tree_depth depth, olc_db_leaf_unique_ptr &&child1,
+            unodb::detail::art_key shifted_leaf_key) {
     UNODB_DETAIL_ASSERT(node_ptr_lock(source_node).is_write_locked());
 
-    parent_class::init(source_node, len, depth, std::move(child1));
+    parent_class::init(source_node, len, depth, std::move(child1),
+                       shifted_leaf_key);
   }
 
   UNODB_DETAIL_RESTORE_MSVC_WARNINGS()
@@ -268,8 +408,6 @@ class [[nodiscard]] olc_inode_4 final
   [[nodiscard]] auto leave_last_child(std::uint8_t child_to_delete,
                                       unodb::olc_db &db_instance) noexcept {
     UNODB_DETAIL_ASSERT(::lock(*this).is_obsoleted_by_this_thread());
-    UNODB_DETAIL_ASSERT(node_ptr_lock(children[child_to_delete].load())
-                            .is_obsoleted_by_this_thread());
 
     return basic_inode_4::leave_last_child(child_to_delete, db_instance);
   }
@@ -283,20 +421,26 @@ class [[nodiscard]] olc_inode_4 final
   UNODB_DETAIL_RESTORE_MSVC_WARNINGS()
 };
 
-// 48 (or 56) == sizeof(inode_4)
-#ifndef _MSC_VER
+// 48 (or 56, or 32 with compressed node pointers) == sizeof(inode_4)
+#ifdef UNODB_DETAIL_COMPRESSED_NODE_PTRS
+#ifdef NDEBUG
+static_assert(sizeof(olc_inode_4) == 32 + 8);
+#else
+static_assert(sizeof(olc_inode_4) == 32 + 24);
+#endif
+#elif !defined(_MSC_VER)
 #ifdef NDEBUG
 static_assert(sizeof(olc_inode_4) == 48 + 8);
 #else
 static_assert(sizeof(olc_inode_4) == 48 + 24);
 #endif
-#else  // #ifndef _MSC_VER
+#else  // MSVC
 #ifdef NDEBUG
 static_assert(sizeof(olc_inode_4) == 56 + 8);
 #else
 static_assert(sizeof(olc_inode_4) == 56 + 24);
 #endif
-#endif  // #ifndef _MSC_VER
+#endif  // #ifdef UNODB_DETAIL_COMPRESSED_NODE_PTRS
 
 class [[nodiscard]] olc_inode_16 final
     : public unodb::detail::basic_inode_16<olc_art_policy> {
@@ -317,10 +461,9 @@ class [[nodiscard]] olc_inode_16 final
     UNODB_DETAIL_ASSERT_INACTIVE(source_node_guard);
   }
 
-  void init(db &db_instance, olc_inode_48 &source_node,
+  void init(db &db_instance, olc_inode_32 &source_node,
             unodb::optimistic_lock::write_guard &source_node_guard,
-            std::uint8_t child_to_delete,
-            unodb::optimistic_lock::write_guard &child_guard) noexcept;
+            std::uint8_t child_to_delete) noexcept;
 
   UNODB_DETAIL_RESTORE_MSVC_WARNINGS()
 
@@ -366,26 +509,127 @@ class [[nodiscard]] olc_inode_16 final
 };
 
 // 160 == sizeof(inode_16)
+#ifdef UNODB_DETAIL_COMPRESSED_NODE_PTRS
+#ifdef NDEBUG
+static_assert(sizeof(olc_inode_16) == 96 + 16);
+#else   // #ifdef NDEBUG
+static_assert(sizeof(olc_inode_16) == 96 + 32);
+#endif  // #ifdef NDEBUG
+#else   // #ifdef UNODB_DETAIL_COMPRESSED_NODE_PTRS
 #ifdef NDEBUG
 static_assert(sizeof(olc_inode_16) == 160 + 16);
 #else   // #ifdef NDEBUG
 static_assert(sizeof(olc_inode_16) == 160 + 32);
 #endif  // #ifdef NDEBUG
+#endif  // #ifdef UNODB_DETAIL_COMPRESSED_NODE_PTRS
 
 UNODB_DETAIL_DISABLE_MSVC_WARNING(26434)
 
 void olc_inode_4::init(db &db_instance, olc_inode_16 &source_node,
                        unodb::optimistic_lock::write_guard &source_node_guard,
-                       std::uint8_t child_to_delete,
-                       unodb::optimistic_lock::write_guard &child_guard) {
+                       std::uint8_t child_to_delete) {
+  UNODB_DETAIL_ASSERT(source_node_guard.guards(::lock(source_node)));
+
+  parent_class::init(db_instance, obsolete(source_node, source_node_guard),
+                     child_to_delete);
+
+  UNODB_DETAIL_ASSERT_INACTIVE(source_node_guard);
+}
+
+UNODB_DETAIL_RESTORE_MSVC_WARNINGS()
+
+class [[nodiscard]] olc_inode_32 final
+    : public unodb::detail::basic_inode_32<olc_art_policy> {
+  using parent_class = basic_inode_32<olc_art_policy>;
+
+ public:
+  using parent_class::parent_class;
+
+  UNODB_DETAIL_DISABLE_MSVC_WARNING(26434)
+
+  void init(db &db_instance, olc_inode_16 &source_node,
+            unodb::optimistic_lock::write_guard &source_node_guard,
+            olc_db_leaf_unique_ptr &&child,
+            unodb::detail::tree_depth depth) noexcept {
+    UNODB_DETAIL_ASSERT(source_node_guard.guards(::lock(source_node)));
+    parent_class::init(db_instance, obsolete(source_node, source_node_guard),
+                       std::move(child), depth);
+    UNODB_DETAIL_ASSERT_INACTIVE(source_node_guard);
+  }
+
+  void init(db &db_instance, olc_inode_48 &source_node,
+            unodb::optimistic_lock::write_guard &source_node_guard,
+            std::uint8_t child_to_delete) noexcept;
+
+  UNODB_DETAIL_RESTORE_MSVC_WARNINGS()
+
+  template <typename... Args>
+  [[nodiscard]] auto add_or_choose_subtree(Args &&...args) {
+    return unodb::detail::olc_impl_helpers::add_or_choose_subtree(
+        *this, std::forward<Args>(args)...);
+  }
+
+  template <typename... Args>
+  [[nodiscard]] auto remove_or_choose_subtree(Args &&...args) {
+    return unodb::detail::olc_impl_helpers::remove_or_choose_subtree(
+        *this, std::forward<Args>(args)...);
+  }
+
+  UNODB_DETAIL_DISABLE_MSVC_WARNING(26434)
+
+  void remove(std::uint8_t child_index, unodb::olc_db &db_instance) noexcept {
+    UNODB_DETAIL_ASSERT(::lock(*this).is_write_locked());
+
+    basic_inode_32::remove(child_index, db_instance);
+  }
+
+  [[nodiscard]] find_result find_child(std::byte key_byte) noexcept {
+#ifdef UNODB_DETAIL_THREAD_SANITIZER
+    const auto children_count_ = this->get_children_count();
+    for (unsigned i = 0; i < children_count_; ++i)
+      if (keys.byte_array[i] == key_byte)
+        return std::make_pair(i, &children[i]);
+    return parent_class::child_not_found;
+#else
+    return basic_inode_32::find_child(key_byte);
+#endif
+  }
+
+  [[gnu::cold]] UNODB_DETAIL_NOINLINE void dump(std::ostream &os) const {
+    os << ", ";
+    ::lock(*this).dump(os);
+    basic_inode_32::dump(os);
+  }
+
+  UNODB_DETAIL_RESTORE_MSVC_WARNINGS()
+};
+
+// 304 == sizeof(inode_32)
+#ifdef UNODB_DETAIL_COMPRESSED_NODE_PTRS
+#ifdef NDEBUG
+static_assert(sizeof(olc_inode_32) == 176 + 16);
+#else   // #ifdef NDEBUG
+static_assert(sizeof(olc_inode_32) == 176 + 32);
+#endif  // #ifdef NDEBUG
+#else   // #ifdef UNODB_DETAIL_COMPRESSED_NODE_PTRS
+#ifdef NDEBUG
+static_assert(sizeof(olc_inode_32) == 304 + 16);
+#else   // #ifdef NDEBUG
+static_assert(sizeof(olc_inode_32) == 304 + 32);
+#endif  // #ifdef NDEBUG
+#endif  // #ifdef UNODB_DETAIL_COMPRESSED_NODE_PTRS
+
+UNODB_DETAIL_DISABLE_MSVC_WARNING(26434)
+
+void olc_inode_16::init(db &db_instance, olc_inode_32 &source_node,
+                        unodb::optimistic_lock::write_guard &source_node_guard,
+                        std::uint8_t child_to_delete) noexcept {
   UNODB_DETAIL_ASSERT(source_node_guard.guards(::lock(source_node)));
-  UNODB_DETAIL_ASSERT(child_guard.active());
 
   parent_class::init(db_instance, obsolete(source_node, source_node_guard),
-                     obsolete_child_by_index(child_to_delete, child_guard));
+                     child_to_delete);
 
   UNODB_DETAIL_ASSERT_INACTIVE(source_node_guard);
-  UNODB_DETAIL_ASSERT_INACTIVE(child_guard);
 }
 
 UNODB_DETAIL_RESTORE_MSVC_WARNINGS()
@@ -399,7 +643,7 @@ class [[nodiscard]] olc_inode_48 final
 
   UNODB_DETAIL_DISABLE_MSVC_WARNING(26434)
 
-  void init(db &db_instance, olc_inode_16 &source_node,
+  void init(db &db_instance, olc_inode_32 &source_node,
             unodb::optimistic_lock::write_guard &source_node_guard,
             olc_db_leaf_unique_ptr &&child,
             unodb::detail::tree_depth depth) noexcept {
@@ -411,8 +655,7 @@ class [[nodiscard]] olc_inode_48 final
 
   void init(db &db_instance, olc_inode_256 &source_node,
             unodb::optimistic_lock::write_guard &source_node_guard,
-            std::uint8_t child_to_delete,
-            unodb::optimistic_lock::write_guard &child_guard) noexcept;
+            std::uint8_t child_to_delete) noexcept;
 
   UNODB_DETAIL_RESTORE_MSVC_WARNINGS()
 
@@ -445,33 +688,32 @@ class [[nodiscard]] olc_inode_48 final
   UNODB_DETAIL_RESTORE_MSVC_WARNINGS()
 };
 
-// sizeof(inode_48) == 672 on AVX2, 656 otherwise
+// sizeof(inode_48) == 664
+#ifdef UNODB_DETAIL_COMPRESSED_NODE_PTRS
 #ifdef NDEBUG
-// AVX2 too. Padding?
-static_assert(sizeof(olc_inode_48) == 656 + 16);
-#else  // #ifdef NDEBUG
-#if defined(UNODB_DETAIL_AVX2)
-static_assert(sizeof(olc_inode_48) == 672 + 32);
+static_assert(sizeof(olc_inode_48) == 472 + 8);
 #else
-static_assert(sizeof(olc_inode_48) == 656 + 32);
+static_assert(sizeof(olc_inode_48) == 472 + 24);
 #endif
-#endif  // #ifdef NDEBUG
+#else  // #ifdef UNODB_DETAIL_COMPRESSED_NODE_PTRS
+#ifdef NDEBUG
+static_assert(sizeof(olc_inode_48) == 664 + 8);
+#else
+static_assert(sizeof(olc_inode_48) == 664 + 24);
+#endif
+#endif  // #ifdef UNODB_DETAIL_COMPRESSED_NODE_PTRS
 
 UNODB_DETAIL_DISABLE_MSVC_WARNING(26434)
 
-void olc_inode_16::init(
-    db &db_instance, olc_inode_48 &source_node,
-    unodb::optimistic_lock::write_guard &source_node_guard,
-    std::uint8_t child_to_delete,
-    unodb::optimistic_lock::write_guard &child_guard) noexcept {
+void olc_inode_32::init(db &db_instance, olc_inode_48 &source_node,
+                        unodb::optimistic_lock::write_guard &source_node_guard,
+                        std::uint8_t child_to_delete) noexcept {
   UNODB_DETAIL_ASSERT(source_node_guard.guards(::lock(source_node)));
-  UNODB_DETAIL_ASSERT(child_guard.active());
 
   parent_class::init(db_instance, obsolete(source_node, source_node_guard),
-                     obsolete_child_by_index(child_to_delete, child_guard));
+                     child_to_delete);
 
   UNODB_DETAIL_ASSERT_INACTIVE(source_node_guard);
-  UNODB_DETAIL_ASSERT_INACTIVE(child_guard);
 }
 
 UNODB_DETAIL_RESTORE_MSVC_WARNINGS()
@@ -526,28 +768,32 @@ class [[nodiscard]] olc_inode_256 final
   UNODB_DETAIL_RESTORE_MSVC_WARNINGS()
 };
 
-// 2064 == sizeof(inode_256)
+// 2096 == sizeof(inode_256)
+#ifdef UNODB_DETAIL_COMPRESSED_NODE_PTRS
+#ifdef NDEBUG
+static_assert(sizeof(olc_inode_256) == 1072 + 8);
+#else
+static_assert(sizeof(olc_inode_256) == 1072 + 24);
+#endif
+#else  // #ifdef UNODB_DETAIL_COMPRESSED_NODE_PTRS
 #ifdef NDEBUG
-static_assert(sizeof(olc_inode_256) == 2064 + 8);
+static_assert(sizeof(olc_inode_256) == 2096 + 8);
 #else
-static_assert(sizeof(olc_inode_256) == 2064 + 24);
+static_assert(sizeof(olc_inode_256) == 2096 + 24);
 #endif
+#endif  // #ifdef UNODB_DETAIL_COMPRESSED_NODE_PTRS
 
 UNODB_DETAIL_DISABLE_MSVC_WARNING(26434)
 
-void olc_inode_48::init(
-    db &db_instance, olc_inode_256 &source_node,
-    unodb::optimistic_lock::write_guard &source_node_guard,
-    std::uint8_t child_to_delete,
-    unodb::optimistic_lock::write_guard &child_guard) noexcept {
+void olc_inode_48::init(db &db_instance, olc_inode_256 &source_node,
+                        unodb::optimistic_lock::write_guard &source_node_guard,
+                        std::uint8_t child_to_delete) noexcept {
   UNODB_DETAIL_ASSERT(source_node_guard.guards(::lock(source_node)));
-  UNODB_DETAIL_ASSERT(child_guard.active());
 
   parent_class::init(db_instance, obsolete(source_node, source_node_guard),
-                     obsolete_child_by_index(child_to_delete, child_guard));
+                     child_to_delete);
 
   UNODB_DETAIL_ASSERT_INACTIVE(source_node_guard);
-  UNODB_DETAIL_ASSERT_INACTIVE(child_guard);
 }
 
 UNODB_DETAIL_RESTORE_MSVC_WARNINGS()
@@ -564,6 +810,309 @@ void create_leaf_if_needed(olc_db_leaf_unique_ptr &cached_leaf,
   }
 }
 
+// The key of any leaf below node, shifted to depth. It has all the key prefix
+// bytes of node, including the ones that are not stored. Nothing if node, read
+// locked by node_critical_section, has changed meanwhile. The nodes below are
+// not locked: each leaf reachable through them while node is unchanged has its
+// key prefix, and QSBR keeps them allocated.
+[[nodiscard]] std::optional<unodb::detail::art_key> shifted_leaf_key_below(
+    unodb::detail::olc_node_ptr node, unodb::detail::tree_depth depth,
+    unodb::optimistic_lock::read_critical_section
+        &node_critical_section) noexcept {
+  do {
+    node = node.ptr<olc_inode *>()->any_child(node.type());
+    if (UNODB_DETAIL_UNLIKELY(node == nullptr)) return {};  // LCOV_EXCL_LINE
+  } while (node.type() != unodb::node_type::LEAF);
+
+  auto result{node.ptr<leaf *>()->get_key()};
+  if (UNODB_DETAIL_UNLIKELY(!node_critical_section.check())) return {};
+  result.shift_right(depth);
+  return result;
+}
+
+// Writes the leaves of olc_db subtrees to a snapshot in increasing key order
+// while other threads modify them. The nodes are read optimistically, coupling
+// the lock of each node with that of its parent, and a version change restarts
+// the walk at the subtree root, continuing after the last written key. Every
+// leaves_per_pause leaves the walk unwinds completely, so that the thread can
+// pass through a quiescent state and not hold back the reclamation of the
+// nodes the writers free meanwhile.
+class [[nodiscard]] checkpoint_walker final {
+ public:
+  checkpoint_walker(unodb::detail::snapshot_writer &writer_,
+                    unsigned start_depth_) noexcept
+      : writer{writer_}, start_depth{start_depth_} {}
+
+  // Write the leaves below the root slot that are after the ones written so far
+  void write_subtree(unodb::detail::olc_root_slot &slot) {
+    cursor_in_subtree = false;
+    while (true) {
+      const auto result = try_write_subtree(slot);
+      if (result == walk_result::DONE) return;
+      if (result == walk_result::RESTART) unodb::spin_wait_loop_body();
+      unodb::this_thread().quiescent();
+    }
+  }
+
+  checkpoint_walker(const checkpoint_walker &) = delete;
+  checkpoint_walker(checkpoint_walker &&) = delete;
+  checkpoint_walker &operator=(const checkpoint_walker &) = delete;
+  checkpoint_walker &operator=(checkpoint_walker &&) = delete;
+
+ private:
+  enum class [[nodiscard]] walk_result : std::uint8_t { DONE, PAUSE, RESTART };
+
+  static constexpr unsigned leaves_per_pause = 1024;
+
+  [[nodiscard]] walk_result try_write_subtree(
+      unodb::detail::olc_root_slot &slot) {
+    auto slot_critical_section = slot.lock.try_read_lock();
+    if (UNODB_DETAIL_UNLIKELY(slot_critical_section.must_restart()))
+      return walk_result::RESTART;  // LCOV_EXCL_LINE
+
+    const auto node{slot.node.load()};
+    if (UNODB_DETAIL_UNLIKELY(!slot_critical_section.check()))
+      return walk_result::RESTART;  // LCOV_EXCL_LINE
+    if (node == nullptr) return walk_result::DONE;
+
+    return walk(node, slot_critical_section,
+                unodb::detail::tree_depth{start_depth}, cursor_in_subtree);
+  }
+
+  // Write the leaves below node, which parent_critical_section has validated.
+  // If on_cursor_path, the keys of node share the depth leading bytes with the
+  // cursor, and the subtree parts before the cursor are skipped.
+  [[nodiscard]] walk_result walk(
+      unodb::detail::olc_node_ptr node,
+      unodb::optimistic_lock::read_critical_section &parent_critical_section,
+      unodb::detail::tree_depth depth, bool on_cursor_path) {
+    if (node.type() == unodb::node_type::LEAF)
+      return write_leaf(*node.ptr<const leaf *>());
+
+    auto node_critical_section = node_ptr_lock(node).try_read_lock();
+    if (UNODB_DETAIL_UNLIKELY(node_critical_section.must_restart()))
+      return walk_result::RESTART;
+    if (UNODB_DETAIL_UNLIKELY(!parent_critical_section.check()))
+      return walk_result::RESTART;  // LCOV_EXCL_LINE
+
+    const auto *const inode{node.ptr<const olc_inode *>()};
+    const auto key_prefix_length{inode->get_key_prefix().length()};
+
+    std::array<std::uint8_t, 256> child_key_bytes;
+    std::array<unodb::detail::olc_node_ptr, 256> children;
+    unsigned children_count = 0;
+    const auto copy_child = [&](unsigned key_byte,
+                                unodb::detail::olc_node_ptr child) noexcept {
+      child_key_bytes[children_count] = static_cast<std::uint8_t>(key_byte);
+      children[children_count] = child;
+      ++children_count;
+    };
+    switch (node.type()) {
+      case unodb::node_type::I4:
+        node.ptr<const olc_inode_4 *>()->for_each_child(copy_child);
+        break;
+      case unodb::node_type::I16:
+        node.ptr<const olc_inode_16 *>()->for_each_child(copy_child);
+        break;
+      case unodb::node_type::I32:
+        node.ptr<const olc_inode_32 *>()->for_each_child(copy_child);
+        break;
+      case unodb::node_type::I48:
+        node.ptr<const olc_inode_48 *>()->for_each_child(copy_child);
+        break;
+      case unodb::node_type::I256:
+        node.ptr<const olc_inode_256 *>()->for_each_child(copy_child);
+        break;
+      // LCOV_EXCL_START
+      case unodb::node_type::LEAF:
+        UNODB_DETAIL_CANNOT_HAPPEN();
+        // LCOV_EXCL_STOP
+    }
+    if (UNODB_DETAIL_UNLIKELY(!node_critical_section.check()))
+      return walk_result::RESTART;
+
+    if (on_cursor_path) {
+      // The key prefix bytes that are not stored are compared too
+      const auto shifted_leaf_key{
+          shifted_leaf_key_below(node, depth, node_critical_section)};
+      if (UNODB_DETAIL_UNLIKELY(!shifted_leaf_key))
+        return walk_result::RESTART;  // LCOV_EXCL_LINE
+      for (unsigned i = 0; i < key_prefix_length; ++i) {
+        const auto prefix_byte = (*shifted_leaf_key)[i];
+        const auto cursor_byte = cursor[depth + i];
+        // The whole subtree is before the cursor
+        if (prefix_byte < cursor_byte) return walk_result::DONE;
+        if (prefix_byte > cursor_byte) {
+          on_cursor_path = false;
+          break;
+        }
+      }
+    }
+    depth += key_prefix_length;
+
+    const auto cursor_byte =
+        on_cursor_path ? static_cast<std::uint8_t>(cursor[depth]) : 0;
+    for (unsigned i = 0; i < children_count; ++i) {
+      if (child_key_bytes[i] < cursor_byte) continue;
+      UNODB_DETAIL_ASSERT(children[i] != nullptr);
+      const auto result =
+          walk(children[i], node_critical_section,
+               unodb::detail::tree_depth{depth + 1},
+               on_cursor_path && child_key_bytes[i] == cursor_byte);
+      if (result != walk_result::DONE) return result;
+    }
+    return walk_result::DONE;
+  }
+
+  // The leaf is immutable, and QSBR keeps it allocated even if it has been
+  // removed since its parent was read. In that case its key is written
+  // nevertheless, the log records of the concurrent operations correct it.
+  [[nodiscard]] walk_result write_leaf(const leaf &l) {
+    const auto k{l.get_key()};
+    const auto original_key{k.original_key()};
+    if (has_cursor && original_key <= cursor.original_key())
+      return walk_result::DONE;
+
+    writer.add(original_key, l.get_value_view());
+    cursor = k;
+    has_cursor = true;
+    cursor_in_subtree = true;
+
+    ++leaves_since_pause;
+    if (leaves_since_pause < leaves_per_pause) return walk_result::DONE;
+    leaves_since_pause = 0;
+    return walk_result::PAUSE;
+  }
+
+  unodb::detail::snapshot_writer &writer;
+  const unsigned start_depth;
+
+  // The last written key
+  unodb::detail::art_key cursor;
+  bool has_cursor{false};
+  // Whether the last written key is below the current root slot, sharing its
+  // leading key bytes
+  bool cursor_in_subtree{false};
+
+  unsigned leaves_since_pause{0};
+};
+
+// Write-lock the lock, waiting for any writer holding it, and obsolete it
+void write_lock_and_obsolete(unodb::optimistic_lock &lock) noexcept {
+  while (true) {
+    auto critical_section = lock.try_read_lock();
+    // The nodes are only obsoleted by writers holding the lock of their parent
+    UNODB_DETAIL_ASSERT(!critical_section.must_restart());
+    unodb::optimistic_lock::write_guard guard{std::move(critical_section)};
+    if (UNODB_DETAIL_LIKELY(!guard.must_restart())) {
+      guard.unlock_and_obsolete();
+      return;
+    }
+    unodb::spin_wait_loop_body();  // LCOV_EXCL_LINE
+  }
+}
+
+// Retires the old contents of a tree after olc_db::exchange_root has unlinked
+// them, while other threads may still operate on them. Each inode is obsoleted
+// before its children are read, thus the writers either have finished with it
+// or will restart, and the children are final. A node is retired after its
+// children, so that the thread may pass through a quiescent state every
+// leaves_per_quiescent_state leaves without dereferencing retired nodes later.
+class [[nodiscard]] subtree_retirer final {
+ public:
+  explicit subtree_retirer(unodb::olc_db &db_) noexcept : db_instance{db_} {}
+
+  void retire(unodb::detail::olc_node_ptr node) {
+    if (node.type() == unodb::node_type::LEAF) {
+      const auto r{olc_art_policy::reclaim_leaf_on_scope_exit(
+          node.ptr<leaf *>(), db_instance)};
+      ++leaves_since_quiescent_state;
+      if (leaves_since_quiescent_state < leaves_per_quiescent_state) return;
+      leaves_since_quiescent_state = 0;
+      unodb::this_thread().quiescent();
+      return;
+    }
+
+    write_lock_and_obsolete(node_ptr_lock(node));
+
+    std::array<unodb::detail::olc_node_ptr, 256> children;
+    unsigned children_count = 0;
+    const auto copy_child = [&children, &children_count](
+                                unsigned,
+                                unodb::detail::olc_node_ptr child) noexcept {
+      children[children_count] = child;
+      ++children_count;
+    };
+    switch (node.type()) {
+      case unodb::node_type::I4:
+        node.ptr<const olc_inode_4 *>()->for_each_child(copy_child);
+        break;
+      case unodb::node_type::I16:
+        node.ptr<const olc_inode_16 *>()->for_each_child(copy_child);
+        break;
+      case unodb::node_type::I32:
+        node.ptr<const olc_inode_32 *>()->for_each_child(copy_child);
+        break;
+      case unodb::node_type::I48:
+        node.ptr<const olc_inode_48 *>()->for_each_child(copy_child);
+        break;
+      case unodb::node_type::I256:
+        node.ptr<const olc_inode_256 *>()->for_each_child(copy_child);
+        break;
+      // LCOV_EXCL_START
+      case unodb::node_type::LEAF:
+        UNODB_DETAIL_CANNOT_HAPPEN();
+        // LCOV_EXCL_STOP
+    }
+
+    for (unsigned i = 0; i < children_count; ++i) retire(children[i]);
+
+    switch (node.type()) {
+      case unodb::node_type::I4: {
+        const auto r{olc_art_policy::make_db_inode_reclaimable_ptr(
+            node.ptr<olc_inode_4 *>(), db_instance)};
+        return;
+      }
+      case unodb::node_type::I16: {
+        const auto r{olc_art_policy::make_db_inode_reclaimable_ptr(
+            node.ptr<olc_inode_16 *>(), db_instance)};
+        return;
+      }
+      case unodb::node_type::I32: {
+        const auto r{olc_art_policy::make_db_inode_reclaimable_ptr(
+            node.ptr<olc_inode_32 *>(), db_instance)};
+        return;
+      }
+      case unodb::node_type::I48: {
+        const auto r{olc_art_policy::make_db_inode_reclaimable_ptr(
+            node.ptr<olc_inode_48 *>(), db_instance)};
+        return;
+      }
+      case unodb::node_type::I256: {
+        const auto r{olc_art_policy::make_db_inode_reclaimable_ptr(
+            node.ptr<olc_inode_256 *>(), db_instance)};
+        return;
+      }
+      // LCOV_EXCL_START
+      case unodb::node_type::LEAF:
+        UNODB_DETAIL_CANNOT_HAPPEN();
+        // LCOV_EXCL_STOP
+    }
+  }
+
+  subtree_retirer(const subtree_retirer &) = delete;
+  subtree_retirer(subtree_retirer &&) = delete;
+  subtree_retirer &operator=(const subtree_retirer &) = delete;
+  subtree_retirer &operator=(subtree_retirer &&) = delete;
+
+ private:
+  static constexpr unsigned leaves_per_quiescent_state = 1024;
+
+  unodb::olc_db &db_instance;
+
+  unsigned leaves_since_quiescent_state{0};
+};
+
 }  // namespace
 
 namespace unodb::detail {
@@ -592,12 +1141,19 @@ olc_impl_helpers::add_or_choose_subtree(
         {
           const optimistic_lock::write_guard write_unlock_on_exit{
               std::move(parent_critical_section)};
-          if (UNODB_DETAIL_UNLIKELY(write_unlock_on_exit.must_restart()))
-            return {};  // LCOV_EXCL_LINE
+          if (UNODB_DETAIL_UNLIKELY(write_unlock_on_exit.must_restart())) {
+            // LCOV_EXCL_START
+            return restart<olc_op::INSERT, olc_restart_cause::WRITE_LOCKED>(
+                INode::type);
+            // LCOV_EXCL_STOP
+          }
 
           optimistic_lock::write_guard node_write_guard{
               std::move(node_critical_section)};
-          if (UNODB_DETAIL_UNLIKELY(node_write_guard.must_restart())) return {};
+          if (UNODB_DETAIL_UNLIKELY(node_write_guard.must_restart())) {
+            return restart<olc_op::INSERT, olc_restart_cause::WRITE_LOCKED>(
+                INode::type);
+          }
 
           larger_node->init(db_instance, inode, node_write_guard,
                             std::move(cached_leaf), depth);
@@ -615,10 +1171,17 @@ olc_impl_helpers::add_or_choose_subtree(
 
     const optimistic_lock::write_guard write_unlock_on_exit{
         std::move(node_critical_section)};
-    if (UNODB_DETAIL_UNLIKELY(write_unlock_on_exit.must_restart())) return {};
+    if (UNODB_DETAIL_UNLIKELY(write_unlock_on_exit.must_restart())) {
+      return restart<olc_op::INSERT, olc_restart_cause::WRITE_LOCKED>(
+          INode::type);
+    }
 
-    if (UNODB_DETAIL_UNLIKELY(!parent_critical_section.try_read_unlock()))
-      return {};  // LCOV_EXCL_LINE
+    if (UNODB_DETAIL_UNLIKELY(!parent_critical_section.try_read_unlock())) {
+      // LCOV_EXCL_START
+      return restart<olc_op::INSERT, olc_restart_cause::VERSION_CHANGED>(
+          INode::type);
+      // LCOV_EXCL_STOP
+    }
 
     inode.add_to_nonfull(std::move(cached_leaf), depth, children_count);
   }
@@ -639,58 +1202,87 @@ template <class INode>
   const auto [child_i, found_child]{inode.find_child(key_byte)};
 
   if (found_child == nullptr) {
-    if (UNODB_DETAIL_UNLIKELY(!parent_critical_section.try_read_unlock()))
-      return {};  // LCOV_EXCL_LINE
-    if (UNODB_DETAIL_UNLIKELY(!node_critical_section.try_read_unlock()))
-      return {};  // LCOV_EXCL_LINE
+    if (UNODB_DETAIL_UNLIKELY(!parent_critical_section.try_read_unlock())) {
+      // LCOV_EXCL_START
+      return restart<olc_op::REMOVE, olc_restart_cause::VERSION_CHANGED>(
+          INode::type);
+      // LCOV_EXCL_STOP
+    }
+    if (UNODB_DETAIL_UNLIKELY(!node_critical_section.try_read_unlock())) {
+      // LCOV_EXCL_START
+      return restart<olc_op::REMOVE, olc_restart_cause::VERSION_CHANGED>(
+          INode::type);
+      // LCOV_EXCL_STOP
+    }
 
     return false;
   }
 
   *child = found_child->load();
 
-  if (UNODB_DETAIL_UNLIKELY(!node_critical_section.check())) return {};
-
-  auto &child_lock{node_ptr_lock(*child)};
-  *child_critical_section = child_lock.try_read_lock();
-  if (UNODB_DETAIL_UNLIKELY(child_critical_section->must_restart())) return {};
+  if (UNODB_DETAIL_UNLIKELY(!node_critical_section.check())) {
+    return restart<olc_op::REMOVE, olc_restart_cause::VERSION_CHANGED>(
+        INode::type);
+  }
 
   *child_type = child->type();
 
   if (*child_type != node_type::LEAF) {
+    auto &child_lock{node_ptr_lock(*child)};
+    *child_critical_section = child_lock.try_read_lock();
+    if (UNODB_DETAIL_UNLIKELY(child_critical_section->must_restart())) {
+      return restart<olc_op::REMOVE, olc_restart_cause::OBSOLETE>(*child_type);
+    }
+
     *child_in_parent = found_child;
-    if (UNODB_DETAIL_UNLIKELY(!parent_critical_section.try_read_unlock()))
-      return {};  // LCOV_EXCL_LINE
+    if (UNODB_DETAIL_UNLIKELY(!parent_critical_section.try_read_unlock())) {
+      // LCOV_EXCL_START
+      return restart<olc_op::REMOVE, olc_restart_cause::VERSION_CHANGED>(
+          INode::type);
+      // LCOV_EXCL_STOP
+    }
     return true;
   }
 
   const auto *const leaf{child->ptr<::leaf *>()};
   if (!leaf->matches(k)) {
-    if (UNODB_DETAIL_UNLIKELY(!parent_critical_section.try_read_unlock()))
-      return {};  // LCOV_EXCL_LINE
-    if (UNODB_DETAIL_UNLIKELY(!node_critical_section.try_read_unlock()))
-      return {};  // LCOV_EXCL_LINE
-    if (UNODB_DETAIL_UNLIKELY(!child_critical_section->try_read_unlock()))
-      return {};  // LCOV_EXCL_LINE
+    if (UNODB_DETAIL_UNLIKELY(!parent_critical_section.try_read_unlock())) {
+      // LCOV_EXCL_START
+      return restart<olc_op::REMOVE, olc_restart_cause::VERSION_CHANGED>(
+          INode::type);
+      // LCOV_EXCL_STOP
+    }
+    if (UNODB_DETAIL_UNLIKELY(!node_critical_section.try_read_unlock())) {
+      // LCOV_EXCL_START
+      return restart<olc_op::REMOVE, olc_restart_cause::VERSION_CHANGED>(
+          INode::type);
+      // LCOV_EXCL_STOP
+    }
 
     return false;
   }
 
-  const auto is_node_min_size{inode.is_min_size()};
+  auto is_node_min_size{inode.is_min_size(db_instance.node_shrink_policy)};
+  if constexpr (std::is_same_v<INode, olc_inode_256>) {
+    // The permanent root node never shrinks
+    is_node_min_size =
+        is_node_min_size && !db_instance.is_permanent_root(node_in_parent);
+  }
 
   if (UNODB_DETAIL_LIKELY(!is_node_min_size)) {
-    if (UNODB_DETAIL_UNLIKELY(!parent_critical_section.try_read_unlock()))
-      return {};  // LCOV_EXCL_LINE
+    if (UNODB_DETAIL_UNLIKELY(!parent_critical_section.try_read_unlock())) {
+      // LCOV_EXCL_START
+      return restart<olc_op::REMOVE, olc_restart_cause::VERSION_CHANGED>(
+          INode::type);
+      // LCOV_EXCL_STOP
+    }
 
     const optimistic_lock::write_guard node_guard{
         std::move(node_critical_section)};
-    if (UNODB_DETAIL_UNLIKELY(node_guard.must_restart())) return {};
-
-    optimistic_lock::write_guard child_guard{
-        std::move(*child_critical_section)};
-    if (UNODB_DETAIL_UNLIKELY(child_guard.must_restart())) return {};
-
-    child_guard.unlock_and_obsolete();
+    if (UNODB_DETAIL_UNLIKELY(node_guard.must_restart())) {
+      return restart<olc_op::REMOVE, olc_restart_cause::WRITE_LOCKED>(
+          INode::type);
+    }
 
     inode.remove(child_i, db_instance);
 
@@ -703,23 +1295,23 @@ template <class INode>
   if constexpr (std::is_same_v<INode, olc_inode_4>) {
     const optimistic_lock::write_guard parent_guard{
         std::move(parent_critical_section)};
-    if (UNODB_DETAIL_UNLIKELY(parent_guard.must_restart())) return {};
+    if (UNODB_DETAIL_UNLIKELY(parent_guard.must_restart())) {
+      return restart<olc_op::REMOVE, olc_restart_cause::WRITE_LOCKED>(
+          INode::type);
+    }
 
     optimistic_lock::write_guard node_guard{std::move(node_critical_section)};
-    if (UNODB_DETAIL_UNLIKELY(node_guard.must_restart())) return {};
-
-    optimistic_lock::write_guard child_guard{
-        std::move(*child_critical_section)};
-    if (UNODB_DETAIL_UNLIKELY(child_guard.must_restart())) return {};
+    if (UNODB_DETAIL_UNLIKELY(node_guard.must_restart())) {
+      return restart<olc_op::REMOVE, olc_restart_cause::WRITE_LOCKED>(
+          INode::type);
+    }
 
     auto current_node{
         olc_art_policy::make_db_inode_reclaimable_ptr(&inode, db_instance)};
     node_guard.unlock_and_obsolete();
-    child_guard.unlock_and_obsolete();
     *node_in_parent = current_node->leave_last_child(child_i, db_instance);
 
     UNODB_DETAIL_ASSERT_INACTIVE(node_guard);
-    UNODB_DETAIL_ASSERT_INACTIVE(child_guard);
 
     *child_in_parent = nullptr;
   } else {
@@ -727,21 +1319,22 @@ template <class INode>
 
     const optimistic_lock::write_guard parent_guard{
         std::move(parent_critical_section)};
-    if (UNODB_DETAIL_UNLIKELY(parent_guard.must_restart())) return {};
+    if (UNODB_DETAIL_UNLIKELY(parent_guard.must_restart())) {
+      return restart<olc_op::REMOVE, olc_restart_cause::WRITE_LOCKED>(
+          INode::type);
+    }
 
     optimistic_lock::write_guard node_guard{std::move(node_critical_section)};
-    if (UNODB_DETAIL_UNLIKELY(node_guard.must_restart())) return {};
-
-    optimistic_lock::write_guard child_guard{
-        std::move(*child_critical_section)};
-    if (UNODB_DETAIL_UNLIKELY(child_guard.must_restart())) return {};
+    if (UNODB_DETAIL_UNLIKELY(node_guard.must_restart())) {
+      return restart<olc_op::REMOVE, olc_restart_cause::WRITE_LOCKED>(
+          INode::type);
+    }
 
-    smaller_node->init(db_instance, inode, node_guard, child_i, child_guard);
+    smaller_node->init(db_instance, inode, node_guard, child_i);
     *node_in_parent = detail::olc_node_ptr{smaller_node.release(),
                                            INode::smaller_derived_type::type};
 
     UNODB_DETAIL_ASSERT_INACTIVE(node_guard);
-    UNODB_DETAIL_ASSERT_INACTIVE(child_guard);
 
     *child_in_parent = nullptr;
   }
@@ -784,6 +1377,27 @@ constexpr void olc_db::account_shrinking_inode() noexcept {
       1, std::memory_order_relaxed);
 }
 
+olc_db::olc_db(root_node root_node_kind)
+    : has_permanent_root{root_node_kind == root_node::PERMANENT_I256} {
+  if (has_permanent_root) {
+    root.node = detail::olc_node_ptr{
+        olc_inode_256::create(*this).release(), node_type::I256};
+  }
+}
+
+olc_db::olc_db(unsigned direct_mapped_key_bytes_)
+    : direct_mapped_key_bytes{
+          detail::checked_direct_mapped_key_bytes(direct_mapped_key_bytes_)},
+      direct_map{direct_mapped_key_bytes == 0
+                     ? nullptr
+                     : std::make_unique<detail::olc_root_slot[]>(
+                           detail::direct_map_size(direct_mapped_key_bytes))} {}
+
+olc_db::olc_db(shrink_policy policy) noexcept
+    : node_shrink_policy{policy} {}
+
+olc_db::olc_db(olc_db &&other) noexcept { swap(other); }
+
 olc_db::~olc_db() noexcept {
   UNODB_DETAIL_ASSERT(
       qsbr_state::single_thread_mode(qsbr::instance().get_state()));
@@ -791,6 +1405,151 @@ olc_db::~olc_db() noexcept {
   delete_root_subtree();
 }
 
+olc_db &olc_db::operator=(olc_db &&other) noexcept {
+  olc_db taken{std::move(other)};
+  swap(taken);
+  return *this;
+}
+
+namespace {
+
+template <class AtomicArray>
+void swap_atomic_arrays(AtomicArray &a, AtomicArray &b) noexcept {
+  for (std::size_t i = 0; i < a.size(); ++i) {
+    b[i].store(a[i].exchange(b[i].load(std::memory_order_relaxed),
+                             std::memory_order_relaxed),
+               std::memory_order_relaxed);
+  }
+}
+
+template <class AtomicArray>
+void add_and_reset_atomic_array(AtomicArray &to, AtomicArray &from) noexcept {
+  for (std::size_t i = 0; i < to.size(); ++i) {
+    to[i].fetch_add(from[i].exchange(0, std::memory_order_relaxed),
+                    std::memory_order_relaxed);
+  }
+}
+
+}  // namespace
+
+void olc_db::swap(olc_db &other) noexcept {
+  UNODB_DETAIL_ASSERT(
+      qsbr_state::single_thread_mode(qsbr::instance().get_state()));
+
+  using std::swap;
+
+  const auto other_root{other.root.node.load()};
+  other.root.node = root.node.load();
+  root.node = other_root;
+  swap(has_permanent_root, other.has_permanent_root);
+  swap(node_shrink_policy, other.node_shrink_policy);
+  swap(direct_mapped_key_bytes, other.direct_mapped_key_bytes);
+  swap(direct_map, other.direct_map);
+  swap(log, other.log);
+
+  other.current_memory_use.store(
+      current_memory_use.exchange(
+          other.current_memory_use.load(std::memory_order_relaxed),
+          std::memory_order_relaxed),
+      std::memory_order_relaxed);
+  other.key_prefix_splits.store(
+      key_prefix_splits.exchange(
+          other.key_prefix_splits.load(std::memory_order_relaxed),
+          std::memory_order_relaxed),
+      std::memory_order_relaxed);
+  swap_atomic_arrays(node_counts, other.node_counts);
+  swap_atomic_arrays(growing_inode_counts, other.growing_inode_counts);
+  swap_atomic_arrays(shrinking_inode_counts, other.shrinking_inode_counts);
+}
+
+void olc_db::exchange_root(olc_db &replacement) {
+  UNODB_DETAIL_ASSERT(&replacement != this);
+
+  if (UNODB_DETAIL_UNLIKELY(
+          replacement.has_permanent_root != has_permanent_root ||
+          replacement.direct_mapped_key_bytes != direct_mapped_key_bytes)) {
+    throw std::invalid_argument(
+        "Replacement tree must have the same root node kind and direct-mapped "
+        "top-level table");
+  }
+
+  const auto slot_count{direct_map == nullptr
+                            ? std::size_t{1}
+                            : detail::direct_map_size(direct_mapped_key_bytes)};
+  const auto slot_at = [](olc_db &db_instance,
+                          std::size_t i) noexcept -> detail::olc_root_slot & {
+    return db_instance.direct_map == nullptr ? db_instance.root
+                                             : db_instance.direct_map[i];
+  };
+
+  // Allocate first, so that nothing is changed if it throws
+  auto guards{std::make_unique<std::optional<optimistic_lock::write_guard>[]>(
+      slot_count)};
+  detail::olc_node_ptr new_replacement_root{nullptr};
+  if (has_permanent_root) {
+    new_replacement_root = detail::olc_node_ptr{
+        olc_inode_256::create(replacement).release(), node_type::I256};
+  }
+
+  // The stats of the new contents are added before the old nodes are retired,
+  // subtracting theirs, so that they never underflow
+  const auto new_replacement_root_size{
+      has_permanent_root ? sizeof(olc_inode_256) : 0};
+  current_memory_use.fetch_add(
+      replacement.current_memory_use.exchange(new_replacement_root_size,
+                                              std::memory_order_relaxed) -
+          new_replacement_root_size,
+      std::memory_order_relaxed);
+  key_prefix_splits.fetch_add(
+      replacement.key_prefix_splits.exchange(0, std::memory_order_relaxed),
+      std::memory_order_relaxed);
+  add_and_reset_atomic_array(node_counts, replacement.node_counts);
+  add_and_reset_atomic_array(growing_inode_counts,
+                             replacement.growing_inode_counts);
+  add_and_reset_atomic_array(shrinking_inode_counts,
+                             replacement.shrinking_inode_counts);
+  if (has_permanent_root) {
+    node_counts[as_i<node_type::I256>].fetch_sub(1, std::memory_order_relaxed);
+    replacement.node_counts[as_i<node_type::I256>].store(
+        1, std::memory_order_relaxed);
+  }
+
+  // Publish the new contents with all the root pointers write-locked, leaving
+  // the old ones in replacement
+  for (std::size_t i = 0; i < slot_count; ++i) {
+    auto &lock{slot_at(*this, i).lock};
+    while (true) {
+      auto critical_section = lock.try_read_lock();
+      // The root pointer locks are never obsoleted
+      UNODB_DETAIL_ASSERT(!critical_section.must_restart());
+      guards[i].emplace(std::move(critical_section));
+      if (UNODB_DETAIL_LIKELY(!guards[i]->must_restart())) break;
+      // LCOV_EXCL_START
+      guards[i].reset();
+      spin_wait_loop_body();
+      // LCOV_EXCL_STOP
+    }
+  }
+  for (std::size_t i = 0; i < slot_count; ++i) {
+    auto &slot{slot_at(*this, i)};
+    auto &replacement_slot{slot_at(replacement, i)};
+    const auto old_node{slot.node.load()};
+    slot.node = replacement_slot.node.load();
+    replacement_slot.node = old_node;
+  }
+  guards.reset();
+
+  subtree_retirer retirer{*this};
+  for (std::size_t i = 0; i < slot_count; ++i) {
+    auto &replacement_slot{slot_at(replacement, i)};
+    const auto old_node{replacement_slot.node.load()};
+    if (old_node == nullptr) continue;
+    retirer.retire(old_node);
+    replacement_slot.node = detail::olc_node_ptr{nullptr};
+  }
+  if (has_permanent_root) replacement.root.node = new_replacement_root;
+}
+
 olc_db::get_result olc_db::get(key search_key) const noexcept {
   try_get_result_type result;
   const detail::art_key bin_comparable_key{search_key};
@@ -804,95 +1563,146 @@ olc_db::get_result olc_db::get(key search_key) const noexcept {
 }
 
 olc_db::try_get_result_type olc_db::try_get(detail::art_key k) const noexcept {
-  auto parent_critical_section = root_pointer_lock.try_read_lock();
+  auto &root_slot{root_slot_for(k)};
+  auto parent_critical_section = root_slot.lock.try_read_lock();
   if (UNODB_DETAIL_UNLIKELY(parent_critical_section.must_restart())) {
     // LCOV_EXCL_START
     spin_wait_loop_body();
-    return {};
+    return restart_at_root_pointer<olc_op::GET, olc_restart_cause::OBSOLETE>();
     // LCOV_EXCL_STOP
   }
 
-  auto node{root.load()};
+  auto node{root_slot.node.load()};
 
   if (UNODB_DETAIL_UNLIKELY(node == nullptr)) {
     if (UNODB_DETAIL_UNLIKELY(!parent_critical_section.try_read_unlock())) {
       // LCOV_EXCL_START
       spin_wait_loop_body();
-      return {};
+      return restart_at_root_pointer<olc_op::GET,
+                                     olc_restart_cause::VERSION_CHANGED>();
       // LCOV_EXCL_STOP
     }
     return std::make_optional<get_result>(std::nullopt);
   }
 
   auto remaining_key{k};
+  remaining_key.shift_right(direct_mapped_key_bytes);
 
   if (UNODB_DETAIL_UNLIKELY(!parent_critical_section.check())) {
     // LCOV_EXCL_START
     spin_wait_loop_body();
-    return {};
+    return restart_at_root_pointer<olc_op::GET,
+                                   olc_restart_cause::VERSION_CHANGED>();
     // LCOV_EXCL_STOP
   }
 
   while (true) {
-    auto node_critical_section = node_ptr_lock(node).try_read_lock();
-    if (UNODB_DETAIL_UNLIKELY(node_critical_section.must_restart())) return {};
-
-    if (UNODB_DETAIL_UNLIKELY(!parent_critical_section.try_read_unlock()))
-      return {};  // LCOV_EXCL_LINE
-
     const auto node_type = node.type();
 
     if (node_type == node_type::LEAF) {
+      // The parent critical section has validated the leaf pointer, and the
+      // leaf is immutable.
       const auto *const leaf{node.ptr<::leaf *>()};
       if (leaf->matches(k)) {
         const auto val_view{leaf->get_value_view()};
-        if (UNODB_DETAIL_UNLIKELY(!node_critical_section.try_read_unlock()))
-          return {};  // LCOV_EXCL_LINE
+        if (UNODB_DETAIL_UNLIKELY(!parent_critical_section.try_read_unlock())) {
+          // LCOV_EXCL_START
+          return restart<olc_op::GET, olc_restart_cause::VERSION_CHANGED>(
+              node_type);
+          // LCOV_EXCL_STOP
+        }
         return qsbr_ptr_span<const std::byte>{val_view};
       }
-      if (UNODB_DETAIL_UNLIKELY(!node_critical_section.try_read_unlock()))
-        return {};  // LCOV_EXCL_LINE
+      if (UNODB_DETAIL_UNLIKELY(!parent_critical_section.try_read_unlock())) {
+        // LCOV_EXCL_START
+        return restart<olc_op::GET, olc_restart_cause::VERSION_CHANGED>(
+            node_type);
+        // LCOV_EXCL_STOP
+      }
       return std::make_optional<get_result>(std::nullopt);
     }
 
+    auto node_critical_section = node_ptr_lock(node).try_read_lock();
+    if (UNODB_DETAIL_UNLIKELY(node_critical_section.must_restart())) {
+      return restart<olc_op::GET, olc_restart_cause::OBSOLETE>(node_type);
+    }
+
+    if (UNODB_DETAIL_UNLIKELY(!parent_critical_section.try_read_unlock())) {
+      // LCOV_EXCL_START
+      return restart<olc_op::GET, olc_restart_cause::VERSION_CHANGED>(
+          node_type);
+      // LCOV_EXCL_STOP
+    }
+
     auto *const inode{node.ptr<olc_inode *>()};
     const auto &key_prefix{inode->get_key_prefix()};
     const auto key_prefix_length{key_prefix.length()};
+    // Only the stored key prefix bytes are checked, the leaf key check covers
+    // the rest
     const auto shared_key_prefix_length{
         key_prefix.get_shared_length(remaining_key)};
 
-    if (shared_key_prefix_length < key_prefix_length) {
-      if (UNODB_DETAIL_UNLIKELY(!node_critical_section.try_read_unlock()))
-        return {};  // LCOV_EXCL_LINE
+    if (shared_key_prefix_length < key_prefix.stored_length()) {
+      if (UNODB_DETAIL_UNLIKELY(!node_critical_section.try_read_unlock())) {
+        // LCOV_EXCL_START
+        return restart<olc_op::GET, olc_restart_cause::VERSION_CHANGED>(
+            node_type);
+        // LCOV_EXCL_STOP
+      }
       return std::make_optional<get_result>(std::nullopt);
     }
 
-    UNODB_DETAIL_ASSERT(shared_key_prefix_length == key_prefix_length);
-
     remaining_key.shift_right(key_prefix_length);
 
     const auto *const child_in_parent{
         inode->find_child(node_type, remaining_key[0]).second};
 
     if (child_in_parent == nullptr) {
-      if (UNODB_DETAIL_UNLIKELY(!node_critical_section.try_read_unlock()))
-        return {};  // LCOV_EXCL_LINE
+      if (UNODB_DETAIL_UNLIKELY(!node_critical_section.try_read_unlock())) {
+        // LCOV_EXCL_START
+        return restart<olc_op::GET, olc_restart_cause::VERSION_CHANGED>(
+            node_type);
+        // LCOV_EXCL_STOP
+      }
       return std::make_optional<get_result>(std::nullopt);
     }
 
     const auto child = child_in_parent->load();
+#ifdef UNODB_DETAIL_PREFETCH_CHILDREN
+    // Safe even if the child is being reclaimed, the check below fetches the
+    // current node version while the child lines are in flight.
+    if (child != nullptr)
+      olc_inode::prefetch_for_lookup(child, remaining_key[1]);
+#endif
 
     parent_critical_section = std::move(node_critical_section);
     node = child;
     remaining_key.shift_right(1);
 
-    if (UNODB_DETAIL_UNLIKELY(!parent_critical_section.check())) return {};
+    if (UNODB_DETAIL_UNLIKELY(!parent_critical_section.check())) {
+      return restart<olc_op::GET, olc_restart_cause::VERSION_CHANGED>(
+          node.type());
+    }
   }
 }
 
 bool olc_db::insert(key insert_key, value_view v) {
   const auto bin_comparable_key = detail::art_key{insert_key};
+  if (UNODB_DETAIL_LIKELY(log == nullptr))
+    return insert_internal(bin_comparable_key, v);
+
+  std::uint64_t lsn;
+  {
+    const std::lock_guard key_order_guard{log->key_order_mutex(insert_key)};
+    if (!insert_internal(bin_comparable_key, v)) return false;
+    lsn = log->append_insert(insert_key, v);
+  }
+  log->commit(lsn);
+  return true;
+}
 
+bool olc_db::insert_internal(detail::art_key bin_comparable_key,
+                             value_view v) {
   try_update_result_type result;
   olc_db_leaf_unique_ptr cached_leaf{
       nullptr,
@@ -906,15 +1716,17 @@ bool olc_db::insert(key insert_key, value_view v) {
 
 olc_db::try_update_result_type olc_db::try_insert(
     detail::art_key k, value_view v, olc_db_leaf_unique_ptr &cached_leaf) {
-  auto parent_critical_section = root_pointer_lock.try_read_lock();
+  auto &root_slot{root_slot_for(k)};
+  auto parent_critical_section = root_slot.lock.try_read_lock();
   if (UNODB_DETAIL_UNLIKELY(parent_critical_section.must_restart())) {
     // LCOV_EXCL_START
     spin_wait_loop_body();
-    return {};
+    return restart_at_root_pointer<olc_op::INSERT,
+                                   olc_restart_cause::OBSOLETE>();
     // LCOV_EXCL_STOP
   }
 
-  auto node{root.load()};
+  auto node{root_slot.node.load()};
 
   if (UNODB_DETAIL_UNLIKELY(node == nullptr)) {
     create_leaf_if_needed(cached_leaf, k, v, *this);
@@ -923,38 +1735,43 @@ olc_db::try_update_result_type olc_db::try_insert(
         std::move(parent_critical_section)};
     if (UNODB_DETAIL_UNLIKELY(write_unlock_on_exit.must_restart())) {
       // Do not call spin_wait_loop_body here - creating the leaf took some time
-      return {};  // LCOV_EXCL_LINE
+      // LCOV_EXCL_START
+      return restart_at_root_pointer<olc_op::INSERT,
+                                     olc_restart_cause::WRITE_LOCKED>();
+      // LCOV_EXCL_STOP
     }
 
-    root = detail::olc_node_ptr{cached_leaf.release(), node_type::LEAF};
+    root_slot.node =
+        detail::olc_node_ptr{cached_leaf.release(), node_type::LEAF};
     return true;
   }
 
-  auto *node_in_parent{&root};
-  detail::tree_depth depth{};
+  auto *node_in_parent{&root_slot.node};
+  detail::tree_depth depth{direct_mapped_key_bytes};
   auto remaining_key{k};
+  remaining_key.shift_right(direct_mapped_key_bytes);
 
   if (UNODB_DETAIL_UNLIKELY(!parent_critical_section.check())) {
     // LCOV_EXCL_START
     spin_wait_loop_body();
-    return {};
+    return restart_at_root_pointer<olc_op::INSERT,
+                                   olc_restart_cause::VERSION_CHANGED>();
     // LCOV_EXCL_STOP
   }
 
   while (true) {
-    auto node_critical_section = node_ptr_lock(node).try_read_lock();
-    if (UNODB_DETAIL_UNLIKELY(node_critical_section.must_restart())) return {};
-
     const auto node_type = node.type();
 
     if (node_type == node_type::LEAF) {
       auto *const leaf{node.ptr<::leaf *>()};
       const auto existing_key{leaf->get_key()};
       if (UNODB_DETAIL_UNLIKELY(k == existing_key)) {
-        if (UNODB_DETAIL_UNLIKELY(!parent_critical_section.try_read_unlock()))
-          return {};  // LCOV_EXCL_LINE
-        if (UNODB_DETAIL_UNLIKELY(!node_critical_section.try_read_unlock()))
-          return {};  // LCOV_EXCL_LINE
+        if (UNODB_DETAIL_UNLIKELY(!parent_critical_section.try_read_unlock())) {
+          // LCOV_EXCL_START
+          return restart<olc_op::INSERT, olc_restart_cause::VERSION_CHANGED>(
+              node_type);
+          // LCOV_EXCL_STOP
+        }
 
         if (UNODB_DETAIL_UNLIKELY(cached_leaf != nullptr)) {
           cached_leaf.reset();  // LCOV_EXCL_LINE
@@ -967,13 +1784,13 @@ olc_db::try_update_result_type olc_db::try_insert(
           olc_inode_4::create(*this, existing_key, remaining_key, depth)};
 
       {
+        // The leaf is not modified, it is enough to lock its parent
         const optimistic_lock::write_guard parent_guard{
             std::move(parent_critical_section)};
-        if (UNODB_DETAIL_UNLIKELY(parent_guard.must_restart())) return {};
-
-        const optimistic_lock::write_guard node_guard{
-            std::move(node_critical_section)};
-        if (UNODB_DETAIL_UNLIKELY(node_guard.must_restart())) return {};
+        if (UNODB_DETAIL_UNLIKELY(parent_guard.must_restart())) {
+          return restart<olc_op::INSERT, olc_restart_cause::WRITE_LOCKED>(
+              node_type);
+        }
 
         new_node->init(existing_key, remaining_key, depth, leaf,
                        std::move(cached_leaf));
@@ -987,11 +1804,31 @@ olc_db::try_update_result_type olc_db::try_insert(
     UNODB_DETAIL_ASSERT(node_type != node_type::LEAF);
     UNODB_DETAIL_ASSERT(depth < detail::art_key::size);
 
+    auto node_critical_section = node_ptr_lock(node).try_read_lock();
+    if (UNODB_DETAIL_UNLIKELY(node_critical_section.must_restart())) {
+      return restart<olc_op::INSERT, olc_restart_cause::OBSOLETE>(node_type);
+    }
+
     auto *const inode{node.ptr<olc_inode *>()};
     const auto &key_prefix{inode->get_key_prefix()};
     const auto key_prefix_length{key_prefix.length()};
-    const auto shared_prefix_length{
-        key_prefix.get_shared_length(remaining_key)};
+    auto shared_prefix_length{key_prefix.get_shared_length(remaining_key)};
+    // The key of any leaf below has the key prefix bytes that are not stored,
+    // and the ones past the split
+    std::optional<detail::art_key> shifted_leaf_key;
+
+    if (!key_prefix.is_complete() || shared_prefix_length < key_prefix_length) {
+      shifted_leaf_key =
+          shifted_leaf_key_below(node, depth, node_critical_section);
+      if (UNODB_DETAIL_UNLIKELY(!shifted_leaf_key)) {
+        // LCOV_EXCL_START
+        return restart<olc_op::INSERT, olc_restart_cause::VERSION_CHANGED>(
+            node_type);
+        // LCOV_EXCL_STOP
+      }
+      shared_prefix_length =
+          key_prefix.get_shared_length(remaining_key, *shifted_leaf_key);
+    }
 
     if (shared_prefix_length < key_prefix_length) {
       create_leaf_if_needed(cached_leaf, k, v, *this);
@@ -1000,14 +1837,20 @@ olc_db::try_update_result_type olc_db::try_insert(
       {
         const optimistic_lock::write_guard parent_guard{
             std::move(parent_critical_section)};
-        if (UNODB_DETAIL_UNLIKELY(parent_guard.must_restart())) return {};
+        if (UNODB_DETAIL_UNLIKELY(parent_guard.must_restart())) {
+          return restart<olc_op::INSERT, olc_restart_cause::WRITE_LOCKED>(
+              node_type);
+        }
 
         const optimistic_lock::write_guard node_guard{
             std::move(node_critical_section)};
-        if (UNODB_DETAIL_UNLIKELY(node_guard.must_restart())) return {};
+        if (UNODB_DETAIL_UNLIKELY(node_guard.must_restart())) {
+          return restart<olc_op::INSERT, olc_restart_cause::WRITE_LOCKED>(
+              node_type);
+        }
 
         new_node->init(node, shared_prefix_length, depth,
-                       std::move(cached_leaf));
+                       std::move(cached_leaf), *shifted_leaf_key);
         *node_in_parent =
             detail::olc_node_ptr{new_node.release(), node_type::I4};
       }
@@ -1033,8 +1876,12 @@ olc_db::try_update_result_type olc_db::try_insert(
     auto *const child_in_parent = *add_result;
     if (child_in_parent == nullptr) return true;
 
-    if (UNODB_DETAIL_UNLIKELY(!parent_critical_section.try_read_unlock()))
-      return {};  // LCOV_EXCL_LINE
+    if (UNODB_DETAIL_UNLIKELY(!parent_critical_section.try_read_unlock())) {
+      // LCOV_EXCL_START
+      return restart<olc_op::INSERT, olc_restart_cause::VERSION_CHANGED>(
+          node_type);
+      // LCOV_EXCL_STOP
+    }
 
     const auto child = child_in_parent->load();
 
@@ -1044,13 +1891,29 @@ olc_db::try_update_result_type olc_db::try_insert(
     ++depth;
     remaining_key.shift_right(1);
 
-    if (UNODB_DETAIL_UNLIKELY(!parent_critical_section.check())) return {};
+    if (UNODB_DETAIL_UNLIKELY(!parent_critical_section.check())) {
+      return restart<olc_op::INSERT, olc_restart_cause::VERSION_CHANGED>(
+          node.type());
+    }
   }
 }
 
 bool olc_db::remove(key remove_key) {
   const auto bin_comparable_key = detail::art_key{remove_key};
+  if (UNODB_DETAIL_LIKELY(log == nullptr))
+    return remove_internal(bin_comparable_key);
+
+  std::uint64_t lsn;
+  {
+    const std::lock_guard key_order_guard{log->key_order_mutex(remove_key)};
+    if (!remove_internal(bin_comparable_key)) return false;
+    lsn = log->append_remove(remove_key);
+  }
+  log->commit(lsn);
+  return true;
+}
 
+bool olc_db::remove_internal(detail::art_key bin_comparable_key) {
   try_update_result_type result;
   do {
     result = try_remove(bin_comparable_key);
@@ -1060,33 +1923,28 @@ bool olc_db::remove(key remove_key) {
 }
 
 olc_db::try_update_result_type olc_db::try_remove(detail::art_key k) {
-  auto parent_critical_section = root_pointer_lock.try_read_lock();
+  auto &root_slot{root_slot_for(k)};
+  auto parent_critical_section = root_slot.lock.try_read_lock();
   if (UNODB_DETAIL_UNLIKELY(parent_critical_section.must_restart())) {
     // LCOV_EXCL_START
     spin_wait_loop_body();
-    return {};
+    return restart_at_root_pointer<olc_op::REMOVE,
+                                   olc_restart_cause::OBSOLETE>();
     // LCOV_EXCL_STOP
   }
 
-  auto node{root.load()};
+  auto node{root_slot.node.load()};
 
   if (UNODB_DETAIL_UNLIKELY(!parent_critical_section.check())) {
     // LCOV_EXCL_START
     spin_wait_loop_body();
-    return {};
+    return restart_at_root_pointer<olc_op::REMOVE,
+                                   olc_restart_cause::VERSION_CHANGED>();
     // LCOV_EXCL_STOP
   }
 
   if (UNODB_DETAIL_UNLIKELY(node == nullptr)) return false;
 
-  auto node_critical_section = node_ptr_lock(node).try_read_lock();
-  if (UNODB_DETAIL_UNLIKELY(node_critical_section.must_restart())) {
-    // LCOV_EXCL_START
-    spin_wait_loop_body();
-    return {};
-    // LCOV_EXCL_STOP
-  }
-
   auto node_type = node.type();
 
   if (node_type == node_type::LEAF) {
@@ -1094,29 +1952,39 @@ olc_db::try_update_result_type olc_db::try_remove(detail::art_key k) {
     if (leaf->matches(k)) {
       const optimistic_lock::write_guard parent_guard{
           std::move(parent_critical_section)};
-      // Do not call spin_wait_loop_body from this point on - assume the above
-      // took enough time
-      if (UNODB_DETAIL_UNLIKELY(parent_guard.must_restart())) return {};
-
-      optimistic_lock::write_guard node_guard{std::move(node_critical_section)};
-      if (UNODB_DETAIL_UNLIKELY(node_guard.must_restart())) return {};
-
-      node_guard.unlock_and_obsolete();
+      if (UNODB_DETAIL_UNLIKELY(parent_guard.must_restart())) {
+        return restart_at_root_pointer<olc_op::REMOVE,
+                                       olc_restart_cause::WRITE_LOCKED>();
+      }
 
       const auto r{olc_art_policy::reclaim_leaf_on_scope_exit(leaf, *this)};
-      root = detail::olc_node_ptr{nullptr};
+      root_slot.node = detail::olc_node_ptr{nullptr};
       return true;
     }
 
-    if (UNODB_DETAIL_UNLIKELY(!node_critical_section.try_read_unlock()))
-      return {};  // LCOV_EXCL_LINE
+    if (UNODB_DETAIL_UNLIKELY(!parent_critical_section.try_read_unlock())) {
+      // LCOV_EXCL_START
+      spin_wait_loop_body();
+      return restart_at_root_pointer<olc_op::REMOVE,
+                                     olc_restart_cause::VERSION_CHANGED>();
+      // LCOV_EXCL_STOP
+    }
 
     return false;
   }
 
-  auto *node_in_parent{&root};
-  detail::tree_depth depth{};
+  auto node_critical_section = node_ptr_lock(node).try_read_lock();
+  if (UNODB_DETAIL_UNLIKELY(node_critical_section.must_restart())) {
+    // LCOV_EXCL_START
+    spin_wait_loop_body();
+    return restart<olc_op::REMOVE, olc_restart_cause::OBSOLETE>(node_type);
+    // LCOV_EXCL_STOP
+  }
+
+  auto *node_in_parent{&root_slot.node};
+  detail::tree_depth depth{direct_mapped_key_bytes};
   auto remaining_key{k};
+  remaining_key.shift_right(direct_mapped_key_bytes);
 
   while (true) {
     UNODB_DETAIL_ASSERT(node_type != node_type::LEAF);
@@ -1125,19 +1993,28 @@ olc_db::try_update_result_type olc_db::try_remove(detail::art_key k) {
     auto *const inode{node.ptr<olc_inode *>()};
     const auto &key_prefix{inode->get_key_prefix()};
     const auto key_prefix_length{key_prefix.length()};
+    // As in get, the leaf key check covers the key prefix bytes that are not
+    // stored
     const auto shared_prefix_length{
         key_prefix.get_shared_length(remaining_key)};
 
-    if (shared_prefix_length < key_prefix_length) {
-      if (UNODB_DETAIL_UNLIKELY(!parent_critical_section.try_read_unlock()))
-        return {};  // LCOV_EXCL_LINE
-      if (UNODB_DETAIL_UNLIKELY(!node_critical_section.try_read_unlock()))
-        return {};  // LCOV_EXCL_LINE
+    if (shared_prefix_length < key_prefix.stored_length()) {
+      if (UNODB_DETAIL_UNLIKELY(!parent_critical_section.try_read_unlock())) {
+        // LCOV_EXCL_START
+        return restart<olc_op::REMOVE, olc_restart_cause::VERSION_CHANGED>(
+            node_type);
+        // LCOV_EXCL_STOP
+      }
+      if (UNODB_DETAIL_UNLIKELY(!node_critical_section.try_read_unlock())) {
+        // LCOV_EXCL_START
+        return restart<olc_op::REMOVE, olc_restart_cause::VERSION_CHANGED>(
+            node_type);
+        // LCOV_EXCL_STOP
+      }
 
       return false;
     }
 
-    UNODB_DETAIL_ASSERT(shared_prefix_length == key_prefix_length);
     depth += key_prefix_length;
     remaining_key.shift_right(key_prefix_length);
 
@@ -1174,7 +2051,17 @@ void olc_db::delete_root_subtree() noexcept {
   UNODB_DETAIL_ASSERT(
       qsbr_state::single_thread_mode(qsbr::instance().get_state()));
 
-  if (root != nullptr) olc_art_policy::delete_subtree(root, *this);
+  if (root.node != nullptr) olc_art_policy::delete_subtree(root.node, *this);
+
+  if (direct_map != nullptr) {
+    const auto size{detail::direct_map_size(direct_mapped_key_bytes)};
+    for (std::size_t i = 0; i < size; ++i) {
+      if (direct_map[i].node == nullptr) continue;
+      olc_art_policy::delete_subtree(direct_map[i].node, *this);
+      direct_map[i].node = detail::olc_node_ptr{nullptr};
+    }
+  }
+
   // It is possible to reset the counter to zero instead of decrementing it for
   // each leaf, but not sure the savings will be significant.
   UNODB_DETAIL_ASSERT(
@@ -1185,15 +2072,24 @@ void olc_db::clear() noexcept {
   UNODB_DETAIL_ASSERT(
       qsbr_state::single_thread_mode(qsbr::instance().get_state()));
 
-  delete_root_subtree();
+  if (has_permanent_root) {
+    root.node.load().ptr<olc_inode_256 *>()->delete_children(*this);
+    UNODB_DETAIL_ASSERT(node_counts[as_i<node_type::LEAF>].load(
+                            std::memory_order_relaxed) == 0);
+  } else {
+    delete_root_subtree();
+    root.node = detail::olc_node_ptr{nullptr};
+  }
 
-  root = detail::olc_node_ptr{nullptr};
-  current_memory_use.store(0, std::memory_order_relaxed);
+  current_memory_use.store(has_permanent_root ? sizeof(olc_inode_256) : 0,
+                           std::memory_order_relaxed);
 
   node_counts[as_i<node_type::I4>].store(0, std::memory_order_relaxed);
   node_counts[as_i<node_type::I16>].store(0, std::memory_order_relaxed);
+  node_counts[as_i<node_type::I32>].store(0, std::memory_order_relaxed);
   node_counts[as_i<node_type::I48>].store(0, std::memory_order_relaxed);
-  node_counts[as_i<node_type::I256>].store(0, std::memory_order_relaxed);
+  node_counts[as_i<node_type::I256>].store(has_permanent_root ? 1 : 0,
+                                           std::memory_order_relaxed);
 }
 
 UNODB_DETAIL_DISABLE_GCC_WARNING("-Wsuggest-attribute=cold")
@@ -1214,9 +2110,162 @@ void olc_db::decrease_memory_use(std::size_t delta) noexcept {
   current_memory_use.fetch_sub(delta, std::memory_order_relaxed);
 }
 
+#ifdef UNODB_DETAIL_OLC_RESTART_STATS
+
+olc_restart_counter_array olc_db::get_restart_counts() {
+  return restart_counter_registry::instance().get();
+}
+
+void olc_db::reset_restart_counts() {
+  restart_counter_registry::instance().reset();
+}
+
+#endif
+
+void olc_db::save(std::ostream &os) const {
+  detail::snapshot_writer writer{
+      os, node_counts[as_i<node_type::LEAF>].load(std::memory_order_relaxed)};
+  const auto write_leaf = [&writer](const leaf &l) {
+    writer.add(l.get_key().original_key(), l.get_value_view());
+  };
+
+  if (direct_map == nullptr) {
+    const auto root_ptr{root.node.load()};
+    if (root_ptr != nullptr)
+      olc_art_policy::for_each_leaf(root_ptr, write_leaf);
+    return;
+  }
+
+  const auto size{detail::direct_map_size(direct_mapped_key_bytes)};
+  for (std::size_t i = 0; i < size; ++i) {
+    const auto slot_root{direct_map[i].node.load()};
+    if (slot_root == nullptr) continue;
+    olc_art_policy::for_each_leaf(slot_root, write_leaf);
+  }
+}
+
+std::uint64_t olc_db::checkpoint(std::ostream &os) {
+  // The operations are logged after being applied, thus all the records up to
+  // here are of the operations applied before the walk
+  const auto start_lsn = (log == nullptr) ? 0 : log->get_appended_lsn();
+
+  detail::snapshot_writer writer{os};
+  checkpoint_walker walker{writer, direct_mapped_key_bytes};
+  if (direct_map == nullptr) {
+    walker.write_subtree(root);
+  } else {
+    const auto size{detail::direct_map_size(direct_mapped_key_bytes)};
+    for (std::size_t i = 0; i < size; ++i) walker.write_subtree(direct_map[i]);
+  }
+  writer.finish();
+
+  // The walk may have seen operations logged after start_lsn, whose records
+  // must survive a crash together with the checkpoint
+  if (log != nullptr) log->sync();
+  return start_lsn;
+}
+
+template <class Reader>
+void olc_db::build_from(Reader &reader) {
+  if (has_permanent_root) {
+    // Build the subtree of each permanent root child separately
+    auto *const root_inode{root.node.load().ptr<olc_inode_256 *>()};
+    olc_sorted_tree_builder builder{*this, detail::tree_depth{1}};
+    std::uint8_t child = 0;
+    while (reader.next()) {
+      const detail::art_key k{reader.get_key()};
+      const auto key_child = static_cast<std::uint8_t>(k[0]);
+      if (key_child != child) {
+        const auto subtree{builder.finish()};
+        if (subtree != nullptr) root_inode->add_subtree(child, subtree);
+        child = key_child;
+      }
+      builder.add(k, reader.get_value());
+    }
+    const auto subtree{builder.finish()};
+    if (subtree != nullptr) root_inode->add_subtree(child, subtree);
+    return;
+  }
+
+  olc_sorted_tree_builder builder{*this,
+                                  detail::tree_depth{direct_mapped_key_bytes}};
+
+  if (direct_map == nullptr) {
+    while (reader.next())
+      builder.add(detail::art_key{reader.get_key()}, reader.get_value());
+    root.node = builder.finish();
+    return;
+  }
+
+  // The keys of each direct-mapped table slot are consecutive
+  std::size_t slot = 0;
+  while (reader.next()) {
+    const detail::art_key k{reader.get_key()};
+    const auto key_slot = detail::direct_map_index(k, direct_mapped_key_bytes);
+    if (key_slot != slot) {
+      direct_map[slot].node = builder.finish();
+      slot = key_slot;
+    }
+    builder.add(k, reader.get_value());
+  }
+  direct_map[slot].node = builder.finish();
+}
+
+void olc_db::load(std::istream &is) {
+  clear();
+
+  try {
+    detail::snapshot_reader reader{is};
+    build_from(reader);
+  } catch (...) {
+    clear();
+    throw;
+  }
+}
+
+void olc_db::replay(std::istream &log_is) {
+  clear();
+
+  try {
+    detail::wal_replay_reader reader{log_is};
+    build_from(reader);
+  } catch (...) {
+    clear();
+    throw;
+  }
+}
+
+void olc_db::replay(std::istream &checkpoint_is, std::istream &log_is,
+                    std::uint64_t start_lsn) {
+  clear();
+
+  try {
+    detail::wal_replay_reader reader{checkpoint_is, log_is, start_lsn};
+    build_from(reader);
+  } catch (...) {
+    clear();
+    throw;
+  }
+}
+
 void olc_db::dump(std::ostream &os) const {
   os << "olc_db dump, currently used = " << get_current_memory_use() << '\n';
-  olc_art_policy::dump_node(os, root.load());
+  if (direct_map == nullptr) {
+    olc_art_policy::dump_node(os, root.node.load());
+    return;
+  }
+
+  os << "direct-mapped top-level table, key bytes = " << direct_mapped_key_bytes
+     << '\n';
+  const auto size{detail::direct_map_size(direct_mapped_key_bytes)};
+  for (std::size_t i = 0; i < size; ++i) {
+    const auto slot_root{direct_map[i].node.load()};
+    if (slot_root == nullptr) continue;
+    os << "slot " << i << ": ";
+    direct_map[i].lock.dump(os);
+    os << '\n';
+    olc_art_policy::dump_node(os, slot_root);
+  }
 }
 
 }  // namespace unodb
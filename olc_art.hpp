@@ -9,6 +9,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <iostream>
+#include <memory>
 #include <optional>
 
 #include "art_common.hpp"
@@ -23,6 +24,8 @@ namespace unodb {
 
 class olc_db;
 
+class write_ahead_log;  // IWYU pragma: keep
+
 namespace detail {
 
 template <class, template <class> class, class, class, template <class> class,
@@ -42,6 +45,9 @@ class db_leaf_qsbr_deleter;  // IWYU pragma: keep
 template <class Header, class Db>
 [[nodiscard]] auto make_db_leaf_ptr(art_key, value_view, Db &);
 
+template <class>
+class basic_sorted_tree_builder;  // IWYU pragma: keep
+
 struct olc_impl_helpers;
 
 template <class AtomicArray>
@@ -61,10 +67,56 @@ inline non_atomic_array<T> copy_atomic_to_nonatomic(T &atomic_array) noexcept {
 using olc_leaf_unique_ptr =
     detail::basic_db_leaf_unique_ptr<detail::olc_node_header, olc_db>;
 
+// A root pointer, of the whole tree or of a direct-mapped top-level table slot,
+// together with its lock
+struct [[nodiscard]] olc_root_slot final {
+  optimistic_lock lock;
+  in_critical_section<olc_node_ptr> node{olc_node_ptr{nullptr}};
+};
+
 }  // namespace detail
 
 using qsbr_value_view = qsbr_ptr_span<const std::byte>;
 
+// Optimistic lock coupling restart instrumentation. The enums are always
+// declared, the counters are compiled in only with OLC_RESTART_STATS CMake
+// option.
+
+enum class [[nodiscard]] olc_op : std::uint8_t { GET, INSERT, REMOVE };
+
+// - VERSION_CHANGED: a read critical section failed its version check
+// - OBSOLETE: a read lock attempt found the node obsolete
+// - WRITE_LOCKED: upgrading a read critical section to a write lock failed
+enum class [[nodiscard]] olc_restart_cause : std::uint8_t {
+  VERSION_CHANGED,
+  OBSOLETE,
+  WRITE_LOCKED
+};
+
+#ifdef UNODB_DETAIL_OLC_RESTART_STATS
+
+namespace detail {
+
+constexpr std::size_t olc_op_count{3};
+constexpr std::size_t olc_restart_cause_count{3};
+// A restart is attributed to the type of the node the operation was at, or to
+// the root pointer if no node was reached yet
+constexpr std::size_t olc_restart_location_count{node_type_count + 1};
+
+}  // namespace detail
+
+inline constexpr auto olc_root_pointer_restart_location{
+    detail::node_type_count};
+
+// Indexed by olc_op, olc_restart_cause, and node_type or
+// olc_root_pointer_restart_location
+using olc_restart_counter_array = std::array<
+    std::array<std::array<std::uint64_t, detail::olc_restart_location_count>,
+               detail::olc_restart_cause_count>,
+    detail::olc_op_count>;
+
+#endif
+
 // A concurrent Adaptive Radix Tree that is synchronized using optimistic lock
 // coupling. At any time, at most two directly-related tree nodes can be
 // write-locked by the insert algorithm and three by the delete algorithm. The
@@ -75,25 +127,123 @@ class olc_db final {
  public:
   using get_result = std::optional<qsbr_value_view>;
 
+  enum class [[nodiscard]] root_node : std::uint8_t {
+    // The root node changes as the tree grows and shrinks
+    DYNAMIC,
+    // The root node is a Node256 without key prefix, created together with
+    // the tree and never replaced nor shrunk. The root pointer lock is then
+    // never write-locked, and the writers contend on the 256 root child slots
+    // instead. It is the better choice for dense key spaces. The root node is
+    // included in the memory use and node count stats, even if the tree is
+    // empty.
+    PERMANENT_I256
+  };
+
   // Creation and destruction
   olc_db() noexcept = default;
 
+  explicit olc_db(root_node root_node_kind);
+
+  // Create a tree whose top direct_mapped_key_bytes key bytes (at most two)
+  // index a flat table of subtree roots instead of tree nodes, which is
+  // beneficial for dense key spaces. Each table slot has its own lock. Zero
+  // disables the table. The table is not included in the memory use stats.
+  explicit olc_db(unsigned direct_mapped_key_bytes);
+
+  // Create a tree whose inodes shrink on deletes according to policy
+  explicit olc_db(shrink_policy policy) noexcept;
+
+  // Take over the tree of other, together with its stats, root node kind,
+  // direct-mapped top-level table, and log attachment. Other is left empty,
+  // with a dynamic root node and without the table. Only legal in
+  // single-threaded context, as clear.
+  olc_db(olc_db &&other) noexcept;
+
   ~olc_db() noexcept;
 
+  // Replace the tree with the one of other, as the move constructor
+  olc_db &operator=(olc_db &&other) noexcept;
+
+  // Exchange the trees, together with everything the move constructor takes
+  // over. Only legal in single-threaded context, as clear.
+  void swap(olc_db &other) noexcept;
+
   // Querying
   [[nodiscard]] get_result get(key search_key) const noexcept;
 
-  [[nodiscard]] auto empty() const noexcept { return root == nullptr; }
+  [[nodiscard]] auto empty() const noexcept {
+    return UNODB_DETAIL_LIKELY(!has_permanent_root && direct_map == nullptr)
+               ? root.node == nullptr
+               : node_counts[as_i<node_type::LEAF>].load(
+                     std::memory_order_relaxed) == 0;
+  }
 
   // Modifying
   // Cannot be called during stack unwinding with std::uncaught_exceptions() > 0
+  // If a log is attached, the successful inserts and removes are logged as by
+  // db. The modifications of the same key are serialized then, so that they
+  // are logged in the order they were applied, and those of different keys
+  // only rarely, on log stripe collisions. The threads waiting for the log to
+  // become durable do not hold any tree locks, so one sync may cover many.
   [[nodiscard]] bool insert(key insert_key, value_view v);
 
   [[nodiscard]] bool remove(key remove_key);
 
-  // Only legal in single-threaded context, as destructor
+  // Only legal in single-threaded context, as destructor. Not logged.
   void clear() noexcept;
 
+  // Replace the tree contents with those of replacement, which must have the
+  // same root node kind and direct-mapped top-level table size, or
+  // std::invalid_argument is thrown. Replacement is left empty. Other threads
+  // may keep operating on this tree meanwhile, but not on replacement. The new
+  // contents are published atomically, with all the root pointers write-locked
+  // together. The operations that have reached the old nodes restart, as the
+  // old nodes are obsoleted one by one, waiting for any writers in them, and
+  // retired to QSBR. The stats are adjusted to match. The calling thread passes
+  // through quiescent states regularly while retiring, thus it must not hold
+  // any get results. Not logged, a checkpoint should follow if logging.
+  void exchange_root(olc_db &replacement);
+
+  // Logging
+
+  // Log all the following successful inserts and removes to log, or stop
+  // logging if it is nullptr. Only legal in single-threaded context, as clear.
+  // The log must outlive the tree or be detached.
+  void attach_log(write_ahead_log *log_) noexcept { log = log_; }
+
+  // Snapshots
+
+  // Write all the keys and values to os in the format of db::save. Only legal
+  // if no other thread modifies the tree meanwhile, concurrent gets are fine.
+  void save(std::ostream &os) const;
+
+  // Replace the tree contents with a snapshot, as db::load. Only legal in
+  // single-threaded context, as clear.
+  void load(std::istream &is);
+
+  // Replace the tree contents with the result of replaying a write-ahead log,
+  // as db::replay. Only legal in single-threaded context, as clear.
+  void replay(std::istream &log_is);
+
+  // Replace the tree contents with a checkpoint and the records of the log
+  // after its start LSN, as db::replay. Only legal in single-threaded context,
+  // as clear.
+  void replay(std::istream &checkpoint_is, std::istream &log_is,
+              std::uint64_t start_lsn);
+
+  // Write a fuzzy checkpoint of the tree to os, in the snapshot format, while
+  // other threads keep modifying it. The tree is walked with optimistic reads,
+  // so that the writers are never blocked, and the keys modified during the
+  // walk may be written in their old or new state. The rest of the recovery
+  // point is in the attached log: return the LSN after which its records must
+  // be replayed over the checkpoint, having made the records appended during
+  // the walk durable. Without a log, return zero, and the checkpoint is only
+  // consistent if no thread modifies the tree meanwhile. The calling thread
+  // passes through quiescent states regularly during the walk, thus it must
+  // not hold any get results. The stream must be seekable, for the key count
+  // is written at the end.
+  [[nodiscard]] std::uint64_t checkpoint(std::ostream &os);
+
   // Stats
 
   // Return current memory use by tree nodes in bytes
@@ -134,6 +284,15 @@ class olc_db final {
     return key_prefix_splits.load(std::memory_order_relaxed);
   }
 
+#ifdef UNODB_DETAIL_OLC_RESTART_STATS
+  // Restarts are counted per thread for all olc_db instances together, and
+  // summed over the running and the exited threads here.
+  [[nodiscard]] static olc_restart_counter_array get_restart_counts();
+
+  // Only legal if no other thread is running olc_db operations
+  static void reset_restart_counts();
+#endif
+
   // Public utils
   [[nodiscard]] static constexpr auto key_found(
       const get_result &result) noexcept {
@@ -144,9 +303,7 @@ class olc_db final {
   [[gnu::cold]] UNODB_DETAIL_NOINLINE void dump(std::ostream &os) const;
 
   olc_db(const olc_db &) noexcept = delete;
-  olc_db(olc_db &&) noexcept = delete;
   olc_db &operator=(const olc_db &) noexcept = delete;
-  olc_db &operator=(olc_db &&) noexcept = delete;
 
  private:
   // If get_result is not present, the search was interrupted. Yes, this
@@ -164,8 +321,31 @@ class olc_db final {
 
   [[nodiscard]] try_update_result_type try_remove(detail::art_key k);
 
+  [[nodiscard]] bool insert_internal(detail::art_key k, value_view v);
+
+  [[nodiscard]] bool remove_internal(detail::art_key k);
+
   void delete_root_subtree() noexcept;
 
+  // Build the tree bottom-up from the keys and values of reader, given in
+  // increasing key order
+  template <class Reader>
+  void build_from(Reader &reader);
+
+  [[nodiscard]] bool is_permanent_root(
+      const in_critical_section<detail::olc_node_ptr> *node_in_parent)
+      const noexcept {
+    return has_permanent_root && node_in_parent == &root.node;
+  }
+
+  [[nodiscard]] detail::olc_root_slot &root_slot_for(
+      detail::art_key k) const noexcept {
+    return UNODB_DETAIL_LIKELY(direct_map == nullptr)
+               ? root
+               : direct_map[detail::direct_map_index(
+                     k, direct_mapped_key_bytes)];
+  }
+
   void increase_memory_use(std::size_t delta) noexcept;
   void decrease_memory_use(std::size_t delta) noexcept;
 
@@ -197,13 +377,23 @@ class olc_db final {
   template <node_type NodeType>
   constexpr void account_shrinking_inode() noexcept;
 
-  alignas(
-      detail::hardware_destructive_interference_size) mutable optimistic_lock
-      root_pointer_lock;
+  alignas(detail::hardware_destructive_interference_size) mutable detail::
+      olc_root_slot root;
+
+  bool has_permanent_root{false};
+
+  shrink_policy node_shrink_policy{shrink_policy::EAGER};
 
-  in_critical_section<detail::olc_node_ptr> root{detail::olc_node_ptr{nullptr}};
+  unsigned direct_mapped_key_bytes{0};
 
-  static_assert(sizeof(root_pointer_lock) + sizeof(root) <=
+  std::unique_ptr<detail::olc_root_slot[]> direct_map;
+
+  write_ahead_log *log{nullptr};
+
+  static_assert(sizeof(root) + sizeof(has_permanent_root) +
+                    sizeof(node_shrink_policy) +
+                    sizeof(direct_mapped_key_bytes) + sizeof(direct_map) +
+                    sizeof(log) <=
                 detail::hardware_constructive_interference_size);
 
   // Current logically allocated memory that is not scheduled to be reclaimed.
@@ -246,9 +436,14 @@ class olc_db final {
   template <class, class>
   friend class detail::basic_db_inode_deleter;
 
+  template <class>
+  friend class detail::basic_sorted_tree_builder;
+
   friend struct detail::olc_impl_helpers;
 };
 
+inline void swap(olc_db &a, olc_db &b) noexcept { a.swap(b); }
+
 }  // namespace unodb
 
 #endif  // UNODB_DETAIL_OLC_ART_HPP
@@ -347,6 +347,10 @@ static_assert(sizeof(optimistic_lock) == 24);
 template <typename T>
 class [[nodiscard]] in_critical_section final {
  public:
+  // Readers may load the value concurrently with it being stored, so it must be
+  // stored on its own.
+  static constexpr bool concurrent_access = true;
+
   constexpr in_critical_section() noexcept = default;
 
   // NOLINTNEXTLINE(google-explicit-constructor,hicpp-explicit-conversions)
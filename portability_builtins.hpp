@@ -57,6 +57,16 @@ template <typename T>
   }
 }
 
+// Hint that the cache line at ptr will be read soon. Never faults, ptr may be
+// invalid.
+inline void prefetch(const void *ptr) noexcept {
+#ifndef UNODB_DETAIL_MSVC
+  __builtin_prefetch(ptr);
+#else
+  _mm_prefetch(static_cast<const char *>(ptr), _MM_HINT_T0);
+#endif
+}
+
 [[nodiscard, gnu::pure]] UNODB_DETAIL_CONSTEXPR_NOT_MSVC unsigned popcount(
     unsigned x) noexcept {
 #ifndef UNODB_DETAIL_MSVC
@@ -66,6 +76,15 @@ template <typename T>
 #endif
 }
 
+[[nodiscard, gnu::pure]] UNODB_DETAIL_CONSTEXPR_NOT_MSVC unsigned popcount64(
+    std::uint64_t x) noexcept {
+#ifndef UNODB_DETAIL_MSVC
+  return static_cast<unsigned>(__builtin_popcountll(x));
+#else
+  return static_cast<unsigned>(__popcnt64(x));
+#endif
+}
+
 }  // namespace unodb::detail
 
 #endif
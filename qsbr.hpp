@@ -38,6 +38,7 @@
 
 #include "assert.hpp"
 #include "heap.hpp"
+#include "node_arena.hpp"
 #include "portability_arch.hpp"
 
 namespace unodb {
@@ -649,6 +650,12 @@ class qsbr final {
       ) noexcept {
 #ifndef NDEBUG
     if (debug_callback != nullptr) debug_callback(pointer);
+#endif
+#ifdef UNODB_DETAIL_COMPRESSED_NODE_PTRS
+    if (detail::node_arena::contains(pointer)) {
+      detail::node_arena::free(pointer);
+      return;
+    }
 #endif
     detail::free_aligned(pointer);
   }
@@ -0,0 +1,171 @@
+// Copyright 2022 Laurynas Biveinis
+
+#include "global.hpp"
+
+#include "simd_kernels.hpp"
+
+#include <cstdint>
+
+#ifdef UNODB_DETAIL_X86_64
+#include <immintrin.h>
+#ifdef UNODB_DETAIL_MSVC
+#include <intrin.h>
+#endif
+#endif
+
+#include <gsl/util>
+
+#include "assert.hpp"
+#include "portability_builtins.hpp"
+
+namespace unodb::detail {
+
+#ifdef UNODB_DETAIL_X86_64
+
+namespace {
+
+#ifndef UNODB_DETAIL_MSVC
+#define UNODB_DETAIL_TARGET(x) __attribute__((target(x)))
+#else
+// MSVC allows any intrinsic without target attributes
+#define UNODB_DETAIL_TARGET(x)
+#endif
+
+#define UNODB_DETAIL_TARGET_AVX512 \
+  UNODB_DETAIL_TARGET("avx512f,avx512bw,avx512vl")
+
+UNODB_DETAIL_TARGET_AVX512
+[[nodiscard]] std::uint8_t n16_insert_pos_avx512(
+    const void *keys, std::uint8_t key_byte,
+    std::uint8_t children_count) noexcept {
+  UNODB_DETAIL_ASSERT(children_count < 16);
+  const auto key_vec = _mm_load_si128(static_cast<const __m128i *>(keys));
+  const auto present_keys = static_cast<__mmask16>((1U << children_count) - 1);
+  const auto lesser_keys = _mm_mask_cmplt_epu8_mask(
+      present_keys, key_vec, _mm_set1_epi8(static_cast<char>(key_byte)));
+  return gsl::narrow_cast<std::uint8_t>(detail::popcount(lesser_keys));
+}
+
+UNODB_DETAIL_TARGET_AVX512
+void n16_remove_avx512(void *keys, void *children, std::uint8_t child_index,
+                       std::uint8_t children_count) noexcept {
+  UNODB_DETAIL_ASSERT(child_index < children_count);
+  UNODB_DETAIL_ASSERT(children_count <= 16);
+
+  // Byte compression needs VBMI2, shuffle the keys down instead
+  auto *const key_vec_ptr = static_cast<__m128i *>(keys);
+  const auto identity = _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12,
+                                      13, 14, 15);
+  const auto moved_down = _mm_cmpge_epu8_mask(
+      identity, _mm_set1_epi8(static_cast<char>(child_index)));
+  const auto shuffle =
+      _mm_mask_add_epi8(identity, moved_down, identity, _mm_set1_epi8(1));
+  _mm_store_si128(key_vec_ptr,
+                  _mm_shuffle_epi8(_mm_load_si128(key_vec_ptr), shuffle));
+
+  const auto kept = ((1U << children_count) - 1) & ~(1U << child_index);
+#ifdef UNODB_DETAIL_COMPRESSED_NODE_PTRS
+  // All 16 32-bit child references fit in one vector
+  auto *const pointers = static_cast<std::uint32_t *>(children);
+  const auto kept_vec = _mm512_maskz_compress_epi32(
+      static_cast<__mmask16>(kept), _mm512_loadu_si512(pointers));
+  _mm512_mask_storeu_epi32(
+      pointers, static_cast<__mmask16>((1U << detail::popcount(kept)) - 1),
+      kept_vec);
+#else
+  auto *const pointers = static_cast<std::uint64_t *>(children);
+  const auto kept_lo = static_cast<__mmask8>(kept & 0xFFU);
+  const auto kept_hi = static_cast<__mmask8>(kept >> 8U);
+  const auto lo_vec =
+      _mm512_maskz_compress_epi64(kept_lo, _mm512_loadu_si512(pointers));
+  const auto hi_vec =
+      _mm512_maskz_compress_epi64(kept_hi, _mm512_loadu_si512(pointers + 8));
+  const auto lo_count = detail::popcount(kept_lo);
+  const auto hi_count = detail::popcount(kept_hi);
+  _mm512_mask_storeu_epi64(pointers,
+                           static_cast<__mmask8>((1U << lo_count) - 1), lo_vec);
+  _mm512_mask_storeu_epi64(pointers + lo_count,
+                           static_cast<__mmask8>((1U << hi_count) - 1), hi_vec);
+#endif
+}
+
+#undef UNODB_DETAIL_TARGET_AVX512
+#undef UNODB_DETAIL_TARGET
+
+}  // namespace
+
+const char *simd_level_name(simd_level level) noexcept {
+  switch (level) {
+    case simd_level::SSE2:
+      return "SSE2";
+    case simd_level::SSE4_2:
+      return "SSE4.2";
+    case simd_level::AVX2:
+      return "AVX2";
+    case simd_level::AVX512:
+      return "AVX-512";
+  }
+  UNODB_DETAIL_CANNOT_HAPPEN();
+}
+
+simd_level detect_simd_level() noexcept {
+#ifndef UNODB_DETAIL_MSVC
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+      __builtin_cpu_supports("avx512vl"))
+    return simd_level::AVX512;
+  if (__builtin_cpu_supports("avx2")) return simd_level::AVX2;
+  if (__builtin_cpu_supports("sse4.2")) return simd_level::SSE4_2;
+#else
+  int regs[4];
+  __cpuid(regs, 0);
+  const auto max_leaf = regs[0];
+  __cpuid(regs, 1);
+  const auto leaf1_ecx = static_cast<unsigned>(regs[2]);
+  const auto has_sse4_2 = (leaf1_ecx & (1U << 20U)) != 0;
+  // AVX state must be enabled by the OS too
+  const auto has_os_avx = (leaf1_ecx & (1U << 27U)) != 0 &&
+                          (leaf1_ecx & (1U << 28U)) != 0 &&
+                          (_xgetbv(0) & 0x6U) == 0x6U;
+  if (has_os_avx && max_leaf >= 7) {
+    __cpuidex(regs, 7, 0);
+    const auto leaf7_ebx = static_cast<unsigned>(regs[1]);
+    // AVX-512 F, BW, and VL, with the opmask and ZMM state enabled by the OS
+    constexpr auto avx512_bits = (1U << 16U) | (1U << 30U) | (1U << 31U);
+    if ((leaf7_ebx & avx512_bits) == avx512_bits &&
+        (_xgetbv(0) & 0xE0U) == 0xE0U)
+      return simd_level::AVX512;
+    if ((leaf7_ebx & (1U << 5U)) != 0) return simd_level::AVX2;
+  }
+  if (has_sse4_2) return simd_level::SSE4_2;
+#endif
+  return simd_level::SSE2;
+}
+
+simd_kernels get_simd_kernels(simd_level level) noexcept {
+  switch (level) {
+    case simd_level::SSE2:
+    case simd_level::SSE4_2:
+    case simd_level::AVX2:
+      return {nullptr, nullptr, level};
+    case simd_level::AVX512:
+      return {n16_insert_pos_avx512, n16_remove_avx512, level};
+  }
+  UNODB_DETAIL_CANNOT_HAPPEN();
+}
+
+const char *simd_kernels_name() noexcept {
+  return simd_level_name(selected_simd_kernels().level);
+}
+
+#elif defined(__aarch64__)
+
+const char *simd_kernels_name() noexcept { return "NEON"; }
+
+#else
+
+const char *simd_kernels_name() noexcept { return "scalar"; }
+
+#endif  // #ifdef UNODB_DETAIL_X86_64
+
+}  // namespace unodb::detail
@@ -0,0 +1,86 @@
+// Copyright 2022 Laurynas Biveinis
+#ifndef UNODB_DETAIL_SIMD_KERNELS_HPP
+#define UNODB_DETAIL_SIMD_KERNELS_HPP
+
+#include "global.hpp"
+
+#include <cstdint>
+
+#ifdef UNODB_DETAIL_X86_64
+#include <emmintrin.h>
+#endif
+
+#include "portability_builtins.hpp"
+
+namespace unodb::detail {
+
+// Name of the node SIMD kernel set in use, for reporting
+[[nodiscard]] const char *simd_kernels_name() noexcept;
+
+#ifdef UNODB_DETAIL_X86_64
+
+// Node kernels that can use instructions beyond the x86_64 baseline are
+// compiled for every level below, and the best level the CPU supports is picked
+// once at startup. The node layout is the same for all of them. The kernels on
+// the lookup path need nothing beyond SSE2 and are inlined into the nodes
+// instead.
+enum class simd_level : std::uint8_t { SSE2, SSE4_2, AVX2, AVX512 };
+
+inline constexpr auto simd_level_count =
+    static_cast<std::uint8_t>(simd_level::AVX512) + 1;
+
+[[nodiscard, gnu::const]] const char *simd_level_name(
+    simd_level level) noexcept;
+
+struct [[nodiscard]] simd_kernels final {
+  // Return the position to insert key_byte at among children_count sorted
+  // Node16 keys starting at 16-byte aligned keys. Null if the inline
+  // n16_insert_pos_sse2 is as good.
+  std::uint8_t (*n16_insert_pos)(const void *keys, std::uint8_t key_byte,
+                                 std::uint8_t children_count) noexcept;
+
+  // Remove the child at child_index from children_count Node16 keys and
+  // pointers by moving the following ones down. Null if there is no vector
+  // variant, in which case the nodes move them one by one.
+  void (*n16_remove)(void *keys, void *children, std::uint8_t child_index,
+                     std::uint8_t children_count) noexcept;
+
+  simd_level level;
+};
+
+// Idea from https://stackoverflow.com/a/32945715/80458
+[[nodiscard, gnu::const]] inline auto _mm_cmple_epu8(__m128i x,
+                                                     __m128i y) noexcept {
+  return _mm_cmpeq_epi8(_mm_max_epu8(y, x), y);
+}
+
+[[nodiscard]] inline std::uint8_t n16_insert_pos_sse2(
+    const void *keys, std::uint8_t key_byte,
+    std::uint8_t children_count) noexcept {
+  const auto replicated_insert_key =
+      _mm_set1_epi8(static_cast<char>(key_byte));
+  const auto key_vec = _mm_load_si128(static_cast<const __m128i *>(keys));
+  const auto lesser_key_positions =
+      _mm_cmple_epu8(replicated_insert_key, key_vec);
+  const auto mask = (1U << children_count) - 1;
+  const auto bit_field =
+      static_cast<unsigned>(_mm_movemask_epi8(lesser_key_positions)) & mask;
+  return (bit_field != 0) ? detail::ctz(bit_field) : children_count;
+}
+
+// The highest level this CPU supports
+[[nodiscard]] simd_level detect_simd_level() noexcept;
+
+[[nodiscard, gnu::const]] simd_kernels get_simd_kernels(
+    simd_level level) noexcept;
+
+[[nodiscard]] inline const simd_kernels &selected_simd_kernels() noexcept {
+  static const simd_kernels kernels{get_simd_kernels(detect_simd_level())};
+  return kernels;
+}
+
+#endif  // #ifdef UNODB_DETAIL_X86_64
+
+}  // namespace unodb::detail
+
+#endif  // UNODB_DETAIL_SIMD_KERNELS_HPP
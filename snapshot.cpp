@@ -0,0 +1,156 @@
+// Copyright 2022 Laurynas Biveinis
+
+#include "global.hpp"  // IWYU pragma: keep
+
+#include "snapshot.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <stdexcept>
+#include <streambuf>
+#include <tuple>
+
+#include "assert.hpp"
+
+namespace unodb::detail {
+
+namespace {
+
+constexpr std::array<char, 8> snapshot_magic{'u', 'n', 'o', 'd',
+                                             'b', 's', 'n', 'p'};
+
+constexpr std::size_t header_size =
+    snapshot_magic.size() + sizeof(snapshot_version) + sizeof(std::uint64_t);
+
+// A LEB128 varint of a 64-bit value takes at most ten bytes
+constexpr std::size_t max_varint_size = 10;
+
+[[nodiscard]] char *put_varint(char *out, std::uint64_t value) noexcept {
+  while (value >= 0x80U) {
+    *out++ = static_cast<char>((value & 0x7FU) | 0x80U);
+    value >>= 7U;
+  }
+  *out++ = static_cast<char>(value);
+  return out;
+}
+
+[[noreturn, gnu::cold]] UNODB_DETAIL_NOINLINE void throw_corrupt() {
+  throw std::runtime_error("Truncated or corrupt unodb snapshot");
+}
+
+}  // namespace
+
+snapshot_writer::snapshot_writer(std::ostream &os_, std::uint64_t key_count)
+    : os{os_}, remaining_count{key_count} {
+  std::array<char, header_size> header;
+  auto *out = std::copy(snapshot_magic.cbegin(), snapshot_magic.cend(),
+                        header.begin());
+  out = put_little_endian(out, snapshot_version);
+  out = put_little_endian(out, key_count);
+  UNODB_DETAIL_ASSERT(out == header.end());
+  os.write(header.data(), header.size());
+}
+
+snapshot_writer::snapshot_writer(std::ostream &os_)
+    : snapshot_writer{os_, 0} {
+  header_pos = static_cast<std::streamoff>(os.tellp()) -
+               static_cast<std::streamoff>(header_size);
+}
+
+void snapshot_writer::add(key k, value_view v) {
+  UNODB_DETAIL_ASSERT(header_pos != -1 || remaining_count > 0);
+  UNODB_DETAIL_ASSERT(first_key || k > previous_key);
+
+  std::array<char, 2 * max_varint_size> prefix;
+  auto *out = put_varint(prefix.data(), first_key ? k : k - previous_key - 1);
+  out = put_varint(out, v.size());
+  os.write(prefix.data(), out - prefix.data());
+  if (!v.empty()) {
+    os.write(reinterpret_cast<const char *>(v.data()),
+             static_cast<std::streamsize>(v.size()));
+  }
+  previous_key = k;
+  first_key = false;
+  if (header_pos == -1) --remaining_count;
+  ++added_count;
+}
+
+void snapshot_writer::finish() {
+  UNODB_DETAIL_ASSERT(header_pos != -1);
+
+  std::array<char, sizeof(added_count)> key_count;
+  std::ignore = put_little_endian(key_count.data(), added_count);
+  const auto end_pos = os.tellp();
+  os.seekp(header_pos + static_cast<std::streamoff>(header_size -
+                                                     key_count.size()));
+  os.write(key_count.data(), key_count.size());
+  os.seekp(end_pos);
+}
+
+snapshot_reader::snapshot_reader(std::istream &is_) : is{is_} {
+  std::array<char, header_size> header;
+  is.read(header.data(), header.size());
+  if (is.gcount() != static_cast<std::streamsize>(header.size()) ||
+      !std::equal(snapshot_magic.cbegin(), snapshot_magic.cend(),
+                  header.cbegin())) {
+    throw std::runtime_error("Not a unodb snapshot");
+  }
+  const auto *in = header.data() + snapshot_magic.size();
+  if (get_little_endian<std::uint32_t>(in) != snapshot_version)
+    throw std::runtime_error("Unsupported unodb snapshot version");
+  key_count = get_little_endian<std::uint64_t>(in + sizeof(snapshot_version));
+}
+
+bool snapshot_reader::next() {
+  if (read_count == key_count) return false;
+
+  const auto key_or_delta = read_varint();
+  if (read_count == 0) {
+    current_key = key_or_delta;
+  } else {
+    if (UNODB_DETAIL_UNLIKELY(key_or_delta >=
+                              std::numeric_limits<key>::max() - current_key))
+      throw_corrupt();
+    current_key += key_or_delta + 1;
+  }
+
+  const auto size = read_varint();
+  if (UNODB_DETAIL_UNLIKELY(size > std::numeric_limits<std::uint32_t>::max()))
+    throw_corrupt();
+  value_size = static_cast<std::size_t>(size);
+  if (value_buffer.size() < value_size) value_buffer.resize(value_size);
+  if (value_size > 0) {
+    is.read(reinterpret_cast<char *>(value_buffer.data()),
+            static_cast<std::streamsize>(value_size));
+    if (UNODB_DETAIL_UNLIKELY(is.gcount() !=
+                              static_cast<std::streamsize>(value_size)))
+      throw_corrupt();
+  }
+
+  ++read_count;
+  return true;
+}
+
+std::uint64_t snapshot_reader::read_varint() {
+  auto &buf = *is.rdbuf();
+  std::uint64_t result = 0;
+  for (unsigned shift = 0; shift < 64; shift += 7) {
+    const auto c = buf.sbumpc();
+    if (UNODB_DETAIL_UNLIKELY(c == std::streambuf::traits_type::eof())) {
+      is.setstate(std::ios_base::eofbit | std::ios_base::failbit);
+      throw_corrupt();
+    }
+    const auto byte = static_cast<std::uint64_t>(static_cast<unsigned char>(
+        std::streambuf::traits_type::to_char_type(c)));
+    result |= (byte & 0x7FU) << shift;
+    if ((byte & 0x80U) == 0) return result;
+  }
+  throw_corrupt();
+}
+
+}  // namespace unodb::detail
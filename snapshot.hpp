@@ -0,0 +1,115 @@
+// Copyright 2022 Laurynas Biveinis
+#ifndef UNODB_DETAIL_SNAPSHOT_HPP
+#define UNODB_DETAIL_SNAPSHOT_HPP
+
+#include "global.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <ios>
+#include <vector>
+
+#include "art_common.hpp"
+
+namespace unodb::detail {
+
+// The binary snapshot format written by save and read by load of the ART
+// classes:
+// - 8 magic bytes "unodbsnp"
+// - format version, 4 bytes, little-endian
+// - key count, 8 bytes, little-endian
+// - for each key in increasing order: the first key itself, and every next one
+//   as its difference from the previous one less one, followed by the value
+//   size and the value bytes. The keys and the sizes are LEB128 varints.
+inline constexpr std::uint32_t snapshot_version = 1;
+
+// The fixed-size integer fields of the snapshot and write-ahead log formats
+// are little-endian regardless of the host byte order
+template <typename T>
+[[nodiscard]] char *put_little_endian(char *out, T value) noexcept {
+  for (std::size_t i = 0; i < sizeof(T); ++i) {
+    *out++ = static_cast<char>(value & 0xFFU);
+    value >>= 8U;
+  }
+  return out;
+}
+
+template <typename T>
+[[nodiscard]] T get_little_endian(const char *in) noexcept {
+  T result = 0;
+  for (std::size_t i = sizeof(T); i > 0; --i)
+    result = (result << 8U) | static_cast<unsigned char>(in[i - 1]);
+  return result;
+}
+
+class [[nodiscard]] snapshot_writer final {
+ public:
+  snapshot_writer(std::ostream &os_, std::uint64_t key_count);
+
+  // Start a snapshot whose key count is not known in advance. It is written by
+  // finish, seeking back to the header, thus os must be seekable.
+  explicit snapshot_writer(std::ostream &os_);
+
+  // Keys must be written in increasing order, as many as the key count given
+  // at construction, if any. Stream errors are left in the stream state.
+  void add(key k, value_view v);
+
+  // Write the number of the added keys to the header of a snapshot started
+  // without a key count, leaving the stream positioned at its end
+  void finish();
+
+  snapshot_writer(const snapshot_writer &) = delete;
+  snapshot_writer(snapshot_writer &&) = delete;
+  snapshot_writer &operator=(const snapshot_writer &) = delete;
+  snapshot_writer &operator=(snapshot_writer &&) = delete;
+
+ private:
+  std::ostream &os;
+  std::uint64_t remaining_count;
+  std::uint64_t added_count{0};
+  // The stream position of the snapshot header, if the key count is to be
+  // written by finish
+  std::streamoff header_pos{-1};
+  key previous_key{0};
+  bool first_key{true};
+};
+
+class [[nodiscard]] snapshot_reader final {
+ public:
+  // Throws std::runtime_error if the stream does not start with a snapshot
+  // header of a supported version
+  explicit snapshot_reader(std::istream &is_);
+
+  // Read the next key and value, returning false after the last one. Throws
+  // std::runtime_error on a truncated or corrupt snapshot.
+  [[nodiscard]] bool next();
+
+  [[nodiscard]] constexpr key get_key() const noexcept { return current_key; }
+
+  [[nodiscard]] value_view get_value() const noexcept {
+    return value_view{value_buffer.data(), value_size};
+  }
+
+  [[nodiscard]] constexpr std::uint64_t get_key_count() const noexcept {
+    return key_count;
+  }
+
+  snapshot_reader(const snapshot_reader &) = delete;
+  snapshot_reader(snapshot_reader &&) = delete;
+  snapshot_reader &operator=(const snapshot_reader &) = delete;
+  snapshot_reader &operator=(snapshot_reader &&) = delete;
+
+ private:
+  [[nodiscard]] std::uint64_t read_varint();
+
+  std::istream &is;
+  std::uint64_t key_count;
+  std::uint64_t read_count{0};
+  key current_key{0};
+  std::size_t value_size{0};
+  std::vector<std::byte> value_buffer;
+};
+
+}  // namespace unodb::detail
+
+#endif  // UNODB_DETAIL_SNAPSHOT_HPP
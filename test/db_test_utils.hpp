@@ -10,6 +10,7 @@
 #include <cstdint>
 #include <initializer_list>
 #include <iostream>
+#include <sstream>
 #include <thread>
 #include <tuple>
 #include <type_traits>  // IWYU pragma: keep
@@ -192,6 +193,11 @@ class [[nodiscard]] tree_verifier final {
     assert_shrinking_inodes({0, 0, 0, 0});
     assert_key_prefix_splits(0);
   }
+
+  explicit tree_verifier(unodb::shrink_policy policy)
+      : test_db{policy}, parallel_test{false} {
+    assert_empty();
+  }
   UNODB_DETAIL_RESTORE_MSVC_WARNINGS()
 
   UNODB_DETAIL_DISABLE_MSVC_WARNING(6326)
@@ -373,6 +379,18 @@ class [[nodiscard]] tree_verifier final {
     values.clear();
   }
 
+  // Replace the tree with the contents of a snapshot of the source one
+  void load_snapshot_of(const tree_verifier &source) {
+    std::stringstream snapshot;
+    source.test_db.save(snapshot);
+    test_db.load(snapshot);
+
+    values = source.values;
+    UNODB_ASSERT_EQ(test_db.template get_node_count<unodb::node_type::LEAF>(),
+                    values.size());
+    check_present_values();
+  }
+
   [[nodiscard, gnu::pure]] constexpr Db &get_db() noexcept { return test_db; }
 
  private:
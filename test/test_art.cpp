@@ -2,9 +2,11 @@
 
 #include "global.hpp"
 
+#include <array>
 #include <cstddef>
 #include <cstdint>
 #include <limits>
+#include <sstream>
 #include <stdexcept>
 #include <tuple>
 
@@ -15,7 +17,9 @@
 #include "db_test_utils.hpp"
 #include "gtest_utils.hpp"
 #include "mutex_art.hpp"  // IWYU pragma: keep
+#include "node_type.hpp"
 #include "olc_art.hpp"    // IWYU pragma: keep
+#include "simd_kernels.hpp"
 #include "test_utils.hpp"
 #include "thread_sync.hpp"
 
@@ -39,8 +43,8 @@ TYPED_TEST(ARTCorrectnessTest, SingleNodeTreeEmptyValue) {
   unodb::test::tree_verifier<TypeParam> verifier;
   verifier.check_absent_keys({1});
   verifier.insert(1, {});
-  verifier.assert_node_counts({1, 0, 0, 0, 0});
-  verifier.assert_growing_inodes({0, 0, 0, 0});
+  verifier.assert_node_counts({1, 0, 0, 0, 0, 0});
+  verifier.assert_growing_inodes({0, 0, 0, 0, 0});
 
   verifier.check_present_values();
   verifier.check_absent_keys({0});
@@ -49,8 +53,8 @@ TYPED_TEST(ARTCorrectnessTest, SingleNodeTreeEmptyValue) {
 TYPED_TEST(ARTCorrectnessTest, SingleNodeTreeNonemptyValue) {
   unodb::test::tree_verifier<TypeParam> verifier;
   verifier.insert(1, unodb::test::test_values[2]);
-  verifier.assert_node_counts({1, 0, 0, 0, 0});
-  verifier.assert_growing_inodes({0, 0, 0, 0});
+  verifier.assert_node_counts({1, 0, 0, 0, 0, 0});
+  verifier.assert_growing_inodes({0, 0, 0, 0, 0});
 
   verifier.check_present_values();
   verifier.check_absent_keys({0, 2});
@@ -71,7 +75,7 @@ TYPED_TEST(ARTCorrectnessTest, TooLongValue) {
 
   verifier.check_absent_keys({1});
   verifier.assert_empty();
-  verifier.assert_growing_inodes({0, 0, 0, 0});
+  verifier.assert_growing_inodes({0, 0, 0, 0, 0});
 }
 UNODB_DETAIL_RESTORE_MSVC_WARNINGS()
 
@@ -79,12 +83,12 @@ TYPED_TEST(ARTCorrectnessTest, ExpandLeafToNode4) {
   unodb::test::tree_verifier<TypeParam> verifier;
 
   verifier.insert(0, unodb::test::test_values[1]);
-  verifier.assert_node_counts({1, 0, 0, 0, 0});
-  verifier.assert_growing_inodes({0, 0, 0, 0});
+  verifier.assert_node_counts({1, 0, 0, 0, 0, 0});
+  verifier.assert_growing_inodes({0, 0, 0, 0, 0});
 
   verifier.insert(1, unodb::test::test_values[2]);
-  verifier.assert_node_counts({2, 1, 0, 0, 0});
-  verifier.assert_growing_inodes({1, 0, 0, 0});
+  verifier.assert_node_counts({2, 1, 0, 0, 0, 0});
+  verifier.assert_growing_inodes({1, 0, 0, 0, 0});
 
   verifier.check_present_values();
   verifier.check_absent_keys({2});
@@ -95,7 +99,7 @@ TYPED_TEST(ARTCorrectnessTest, DuplicateKey) {
   unodb::test::tree_verifier<TypeParam> verifier;
 
   verifier.insert(0, unodb::test::test_values[0]);
-  verifier.assert_node_counts({1, 0, 0, 0, 0});
+  verifier.assert_node_counts({1, 0, 0, 0, 0, 0});
 
   const auto mem_use_before = verifier.get_db().get_current_memory_use();
   unodb::test::must_not_allocate([&verifier] {
@@ -104,8 +108,8 @@ TYPED_TEST(ARTCorrectnessTest, DuplicateKey) {
   });
   UNODB_ASSERT_EQ(mem_use_before, verifier.get_db().get_current_memory_use());
 
-  verifier.assert_node_counts({1, 0, 0, 0, 0});
-  verifier.assert_growing_inodes({0, 0, 0, 0});
+  verifier.assert_node_counts({1, 0, 0, 0, 0, 0});
+  verifier.assert_growing_inodes({0, 0, 0, 0, 0});
   verifier.check_present_values();
 }
 UNODB_DETAIL_RESTORE_MSVC_WARNINGS()
@@ -114,8 +118,8 @@ TYPED_TEST(ARTCorrectnessTest, InsertToFullNode4) {
   unodb::test::tree_verifier<TypeParam> verifier;
 
   verifier.insert_key_range(0, 4);
-  verifier.assert_node_counts({4, 1, 0, 0, 0});
-  verifier.assert_growing_inodes({1, 0, 0, 0});
+  verifier.assert_node_counts({4, 1, 0, 0, 0, 0});
+  verifier.assert_growing_inodes({1, 0, 0, 0, 0});
 
   verifier.check_present_values();
   verifier.check_absent_keys({5, 4});
@@ -126,8 +130,8 @@ TYPED_TEST(ARTCorrectnessTest, Node4InsertFFByte) {
 
   verifier.insert_key_range(0xFC, 4);
 
-  verifier.assert_node_counts({4, 1, 0, 0, 0});
-  verifier.assert_growing_inodes({1, 0, 0, 0});
+  verifier.assert_node_counts({4, 1, 0, 0, 0, 0});
+  verifier.assert_growing_inodes({1, 0, 0, 0, 0});
   verifier.check_present_values();
   verifier.check_absent_keys({0, 0xFB});
 }
@@ -137,12 +141,12 @@ TYPED_TEST(ARTCorrectnessTest, TwoNode4) {
 
   verifier.insert(1, unodb::test::test_values[0]);
   verifier.insert(3, unodb::test::test_values[2]);
-  verifier.assert_growing_inodes({1, 0, 0, 0});
+  verifier.assert_growing_inodes({1, 0, 0, 0, 0});
 
   // Insert a value that does not share full prefix with the current Node4
   verifier.insert(0xFF01, unodb::test::test_values[3]);
-  verifier.assert_node_counts({3, 2, 0, 0, 0});
-  verifier.assert_growing_inodes({2, 0, 0, 0});
+  verifier.assert_node_counts({3, 2, 0, 0, 0, 0});
+  verifier.assert_growing_inodes({2, 0, 0, 0, 0});
   verifier.assert_key_prefix_splits(1);
 
   verifier.check_present_values();
@@ -156,14 +160,14 @@ TYPED_TEST(ARTCorrectnessTest, DbInsertNodeRecursion) {
   verifier.insert(3, unodb::test::test_values[2]);
   // Insert a value that does not share full prefix with the current Node4
   verifier.insert(0xFF0001, unodb::test::test_values[3]);
-  verifier.assert_growing_inodes({2, 0, 0, 0});
+  verifier.assert_growing_inodes({2, 0, 0, 0, 0});
   verifier.assert_key_prefix_splits(1);
 
   // Then insert a value that shares full prefix with the above node and will
   // ask for a recursive insertion there
   verifier.insert(0xFF0101, unodb::test::test_values[1]);
-  verifier.assert_node_counts({4, 3, 0, 0, 0});
-  verifier.assert_growing_inodes({3, 0, 0, 0});
+  verifier.assert_node_counts({4, 3, 0, 0, 0, 0});
+  verifier.assert_growing_inodes({3, 0, 0, 0, 0});
   verifier.assert_key_prefix_splits(1);
 
   verifier.check_present_values();
@@ -176,8 +180,8 @@ TYPED_TEST(ARTCorrectnessTest, Node16) {
   verifier.insert_key_range(0, 4);
   verifier.check_present_values();
   verifier.insert(5, unodb::test::test_values[0]);
-  verifier.assert_node_counts({5, 0, 1, 0, 0});
-  verifier.assert_growing_inodes({1, 1, 0, 0});
+  verifier.assert_node_counts({5, 0, 1, 0, 0, 0});
+  verifier.assert_growing_inodes({1, 1, 0, 0, 0});
 
   verifier.check_present_values();
   verifier.check_absent_keys({6, 0x0100, 0xFFFFFFFFFFFFFFFFULL});
@@ -187,8 +191,8 @@ TYPED_TEST(ARTCorrectnessTest, FullNode16) {
   unodb::test::tree_verifier<TypeParam> verifier;
 
   verifier.insert_key_range(0, 16);
-  verifier.assert_node_counts({16, 0, 1, 0, 0});
-  verifier.assert_growing_inodes({1, 1, 0, 0});
+  verifier.assert_node_counts({16, 0, 1, 0, 0, 0});
+  verifier.assert_growing_inodes({1, 1, 0, 0, 0});
 
   verifier.check_absent_keys({16});
   verifier.check_present_values();
@@ -201,8 +205,8 @@ TYPED_TEST(ARTCorrectnessTest, Node16KeyPrefixSplit) {
 
   // Insert a value that does share full prefix with the current Node16
   verifier.insert(0x1020, unodb::test::test_values[0]);
-  verifier.assert_node_counts({6, 1, 1, 0, 0});
-  verifier.assert_growing_inodes({2, 1, 0, 0});
+  verifier.assert_node_counts({6, 1, 1, 0, 0, 0});
+  verifier.assert_growing_inodes({2, 1, 0, 0, 0});
   verifier.assert_key_prefix_splits(1);
 
   verifier.check_present_values();
@@ -218,7 +222,7 @@ TYPED_TEST(ARTCorrectnessTest, Node16KeyInsertOrderDescending) {
   verifier.insert(2, unodb::test::test_values[3]);
   verifier.insert(1, unodb::test::test_values[4]);
   verifier.insert(0, unodb::test::test_values[0]);
-  verifier.assert_node_counts({6, 0, 1, 0, 0});
+  verifier.assert_node_counts({6, 0, 1, 0, 0, 0});
 
   verifier.check_present_values();
   verifier.check_absent_keys({6});
@@ -228,34 +232,84 @@ TYPED_TEST(ARTCorrectnessTest, Node16ConstructWithFFKeyByte) {
   unodb::test::tree_verifier<TypeParam> verifier;
 
   verifier.insert_key_range(0xFB, 4);
-  verifier.assert_node_counts({4, 1, 0, 0, 0});
+  verifier.assert_node_counts({4, 1, 0, 0, 0, 0});
 
   verifier.insert(0xFF, unodb::test::test_values[0]);
 
-  verifier.assert_node_counts({5, 0, 1, 0, 0});
-  verifier.assert_growing_inodes({1, 1, 0, 0});
+  verifier.assert_node_counts({5, 0, 1, 0, 0, 0});
+  verifier.assert_growing_inodes({1, 1, 0, 0, 0});
 
   verifier.check_present_values();
   verifier.check_absent_keys({0, 0xFA});
 }
 
-TYPED_TEST(ARTCorrectnessTest, Node48) {
+TYPED_TEST(ARTCorrectnessTest, Node32) {
   unodb::test::tree_verifier<TypeParam> verifier;
 
   verifier.insert_key_range(0, 17);
-  verifier.assert_node_counts({17, 0, 0, 1, 0});
-  verifier.assert_growing_inodes({1, 1, 1, 0});
+  verifier.assert_node_counts({17, 0, 0, 1, 0, 0});
+  verifier.assert_growing_inodes({1, 1, 1, 0, 0});
 
   verifier.check_present_values();
   verifier.check_absent_keys({17});
 }
 
+TYPED_TEST(ARTCorrectnessTest, FullNode32) {
+  unodb::test::tree_verifier<TypeParam> verifier;
+
+  verifier.insert_key_range(0, 32);
+  verifier.assert_node_counts({32, 0, 0, 1, 0, 0});
+  verifier.assert_growing_inodes({1, 1, 1, 0, 0});
+
+  verifier.check_present_values();
+  verifier.check_absent_keys({32});
+}
+
+TYPED_TEST(ARTCorrectnessTest, Node32KeyPrefixSplit) {
+  unodb::test::tree_verifier<TypeParam> verifier;
+
+  verifier.insert_key_range(10, 17);
+  verifier.assert_node_counts({17, 0, 0, 1, 0, 0});
+  verifier.assert_key_prefix_splits(0);
+
+  // Insert a value that does share full prefix with the current Node32
+  verifier.insert(0x100020, unodb::test::test_values[0]);
+  verifier.assert_node_counts({18, 1, 0, 1, 0, 0});
+  verifier.assert_growing_inodes({2, 1, 1, 0, 0});
+  verifier.assert_key_prefix_splits(1);
+
+  verifier.check_present_values();
+  verifier.check_absent_keys({9, 27, 0x100019, 0x100100, 0x110000});
+}
+
+TYPED_TEST(ARTCorrectnessTest, Node32KeyInsertOrderDescending) {
+  unodb::test::tree_verifier<TypeParam> verifier;
+
+  for (unodb::key k = 0xFF; k >= 0xFF - 31; --k)
+    verifier.insert(k, unodb::test::test_values[k % 5]);
+  verifier.assert_node_counts({32, 0, 0, 1, 0, 0});
+
+  verifier.check_present_values();
+  verifier.check_absent_keys({0, 0xFF - 32, 0x100});
+}
+
+TYPED_TEST(ARTCorrectnessTest, Node48) {
+  unodb::test::tree_verifier<TypeParam> verifier;
+
+  verifier.insert_key_range(0, 33);
+  verifier.assert_node_counts({33, 0, 0, 0, 1, 0});
+  verifier.assert_growing_inodes({1, 1, 1, 1, 0});
+
+  verifier.check_present_values();
+  verifier.check_absent_keys({33});
+}
+
 TYPED_TEST(ARTCorrectnessTest, FullNode48) {
   unodb::test::tree_verifier<TypeParam> verifier;
 
   verifier.insert_key_range(0, 48);
-  verifier.assert_node_counts({48, 0, 0, 1, 0});
-  verifier.assert_growing_inodes({1, 1, 1, 0});
+  verifier.assert_node_counts({48, 0, 0, 0, 1, 0});
+  verifier.assert_growing_inodes({1, 1, 1, 1, 0});
 
   verifier.check_present_values();
   verifier.check_absent_keys({49});
@@ -264,27 +318,27 @@ TYPED_TEST(ARTCorrectnessTest, FullNode48) {
 TYPED_TEST(ARTCorrectnessTest, Node48KeyPrefixSplit) {
   unodb::test::tree_verifier<TypeParam> verifier;
 
-  verifier.insert_key_range(10, 17);
-  verifier.assert_node_counts({17, 0, 0, 1, 0});
-  verifier.assert_growing_inodes({1, 1, 1, 0});
+  verifier.insert_key_range(10, 33);
+  verifier.assert_node_counts({33, 0, 0, 0, 1, 0});
+  verifier.assert_growing_inodes({1, 1, 1, 1, 0});
   verifier.assert_key_prefix_splits(0);
 
   // Insert a value that does share full prefix with the current Node48
   verifier.insert(0x100020, unodb::test::test_values[0]);
-  verifier.assert_node_counts({18, 1, 0, 1, 0});
-  verifier.assert_growing_inodes({2, 1, 1, 0});
+  verifier.assert_node_counts({34, 1, 0, 0, 1, 0});
+  verifier.assert_growing_inodes({2, 1, 1, 1, 0});
   verifier.assert_key_prefix_splits(1);
 
   verifier.check_present_values();
-  verifier.check_absent_keys({9, 27, 0x100019, 0x100100, 0x110000});
+  verifier.check_absent_keys({9, 43, 0x100019, 0x100100, 0x110000});
 }
 
 TYPED_TEST(ARTCorrectnessTest, Node256) {
   unodb::test::tree_verifier<TypeParam> verifier;
 
   verifier.insert_key_range(1, 49);
-  verifier.assert_node_counts({49, 0, 0, 0, 1});
-  verifier.assert_growing_inodes({1, 1, 1, 1});
+  verifier.assert_node_counts({49, 0, 0, 0, 0, 1});
+  verifier.assert_growing_inodes({1, 1, 1, 1, 1});
 
   verifier.check_present_values();
   verifier.check_absent_keys({50});
@@ -294,8 +348,8 @@ TYPED_TEST(ARTCorrectnessTest, FullNode256) {
   unodb::test::tree_verifier<TypeParam> verifier;
 
   verifier.insert_key_range(0, 256);
-  verifier.assert_node_counts({256, 0, 0, 0, 1});
-  verifier.assert_growing_inodes({1, 1, 1, 1});
+  verifier.assert_node_counts({256, 0, 0, 0, 0, 1});
+  verifier.assert_growing_inodes({1, 1, 1, 1, 1});
 
   verifier.check_present_values();
   verifier.check_absent_keys({256});
@@ -305,14 +359,14 @@ TYPED_TEST(ARTCorrectnessTest, Node256KeyPrefixSplit) {
   unodb::test::tree_verifier<TypeParam> verifier;
 
   verifier.insert_key_range(20, 49);
-  verifier.assert_node_counts({49, 0, 0, 0, 1});
-  verifier.assert_growing_inodes({1, 1, 1, 1});
+  verifier.assert_node_counts({49, 0, 0, 0, 0, 1});
+  verifier.assert_growing_inodes({1, 1, 1, 1, 1});
   verifier.assert_key_prefix_splits(0);
 
   // Insert a value that does share full prefix with the current Node256
   verifier.insert(0x100020, unodb::test::test_values[0]);
-  verifier.assert_node_counts({50, 1, 0, 0, 1});
-  verifier.assert_growing_inodes({2, 1, 1, 1});
+  verifier.assert_node_counts({50, 1, 0, 0, 0, 1});
+  verifier.assert_growing_inodes({2, 1, 1, 1, 1});
   verifier.assert_key_prefix_splits(1);
 
   verifier.check_present_values();
@@ -352,7 +406,7 @@ TYPED_TEST(ARTCorrectnessTest, SingleNodeTreeAttemptDeleteAbsent) {
   });
 
   verifier.check_present_values();
-  verifier.assert_node_counts({1, 0, 0, 0, 0});
+  verifier.assert_node_counts({1, 0, 0, 0, 0, 0});
   verifier.check_absent_keys({1, 3, 0xFF02});
 }
 
@@ -365,7 +419,7 @@ TYPED_TEST(ARTCorrectnessTest, Node4AttemptDeleteAbsent) {
     verifier.attempt_remove_missing_keys({0, 6, 0xFF000001});
   });
 
-  verifier.assert_node_counts({4, 1, 0, 0, 0});
+  verifier.assert_node_counts({4, 1, 0, 0, 0, 0});
 
   verifier.check_absent_keys({0, 6, 0xFF00000});
 }
@@ -387,7 +441,7 @@ TYPED_TEST(ARTCorrectnessTest, Node4FullDeleteMiddleAndBeginning) {
   verifier.check_present_values();
   verifier.check_absent_keys({1, 0, 2, 5});
 
-  verifier.assert_node_counts({2, 1, 0, 0, 0});
+  verifier.assert_node_counts({2, 1, 0, 0, 0, 0});
 }
 
 TYPED_TEST(ARTCorrectnessTest, Node4FullDeleteEndAndMiddle) {
@@ -407,21 +461,21 @@ TYPED_TEST(ARTCorrectnessTest, Node4FullDeleteEndAndMiddle) {
   verifier.check_present_values();
   verifier.check_absent_keys({2, 4, 0, 5});
 
-  verifier.assert_node_counts({2, 1, 0, 0, 0});
+  verifier.assert_node_counts({2, 1, 0, 0, 0, 0});
 }
 
 TYPED_TEST(ARTCorrectnessTest, Node4ShrinkToSingleLeaf) {
   unodb::test::tree_verifier<TypeParam> verifier;
 
   verifier.insert_key_range(1, 2);
-  verifier.assert_shrinking_inodes({0, 0, 0, 0});
+  verifier.assert_shrinking_inodes({0, 0, 0, 0, 0});
 
   unodb::test::must_not_allocate([&verifier] { verifier.remove(1); });
 
-  verifier.assert_shrinking_inodes({1, 0, 0, 0});
+  verifier.assert_shrinking_inodes({1, 0, 0, 0, 0});
   verifier.check_present_values();
   verifier.check_absent_keys({1});
-  verifier.assert_node_counts({1, 0, 0, 0, 0});
+  verifier.assert_node_counts({1, 0, 0, 0, 0, 0});
 }
 
 TYPED_TEST(ARTCorrectnessTest, Node4DeleteLowerNode) {
@@ -430,18 +484,18 @@ TYPED_TEST(ARTCorrectnessTest, Node4DeleteLowerNode) {
   verifier.insert_key_range(0, 2);
   // Insert a value that does not share full prefix with the current Node4
   verifier.insert(0xFF00, unodb::test::test_values[3]);
-  verifier.assert_shrinking_inodes({0, 0, 0, 0});
+  verifier.assert_shrinking_inodes({0, 0, 0, 0, 0});
   verifier.assert_key_prefix_splits(1);
 
   // Make the lower Node4 shrink to a single value leaf
   unodb::test::must_not_allocate([&verifier] { verifier.remove(0); });
 
-  verifier.assert_shrinking_inodes({1, 0, 0, 0});
+  verifier.assert_shrinking_inodes({1, 0, 0, 0, 0});
   verifier.assert_key_prefix_splits(1);
 
   verifier.check_present_values();
   verifier.check_absent_keys({0, 2, 0xFF01});
-  verifier.assert_node_counts({2, 1, 0, 0, 0});
+  verifier.assert_node_counts({2, 1, 0, 0, 0, 0});
 }
 
 TYPED_TEST(ARTCorrectnessTest, Node4DeleteKeyPrefixMerge) {
@@ -451,14 +505,14 @@ TYPED_TEST(ARTCorrectnessTest, Node4DeleteKeyPrefixMerge) {
   // Insert a value that does not share full prefix with the current Node4
   verifier.insert(0x90AA, unodb::test::test_values[3]);
   verifier.assert_key_prefix_splits(1);
-  verifier.assert_node_counts({3, 2, 0, 0, 0});
+  verifier.assert_node_counts({3, 2, 0, 0, 0, 0});
 
   // And delete it
   unodb::test::must_not_allocate([&verifier] { verifier.remove(0x90AA); });
 
   verifier.assert_key_prefix_splits(1);
-  verifier.assert_node_counts({2, 1, 0, 0, 0});
-  verifier.assert_shrinking_inodes({1, 0, 0, 0});
+  verifier.assert_node_counts({2, 1, 0, 0, 0, 0});
+  verifier.assert_shrinking_inodes({1, 0, 0, 0, 0});
   verifier.check_present_values();
   verifier.check_absent_keys({0x90AA, 0x8003});
 }
@@ -478,6 +532,57 @@ TYPED_TEST(ARTCorrectnessTest, Node4DeleteKeyPrefixMerge2) {
   verifier.check_present_values();
 }
 
+TYPED_TEST(ARTCorrectnessTest, LongKeyPrefixSplit) {
+  unodb::test::tree_verifier<TypeParam> verifier;
+
+  verifier.insert(0x0102030405060708, unodb::test::test_values[0]);
+  verifier.insert(0x0102030405060709, unodb::test::test_values[1]);
+  // A single Node4 with the longest key prefix, even if not all of it is
+  // stored
+  verifier.assert_node_counts({2, 1, 0, 0, 0, 0});
+
+  // Split the key prefix past its first bytes
+  verifier.insert(0x0102030405FF0708, unodb::test::test_values[2]);
+  verifier.assert_node_counts({3, 2, 0, 0, 0, 0});
+  verifier.assert_growing_inodes({2, 0, 0, 0, 0});
+  verifier.assert_key_prefix_splits(1);
+
+  verifier.check_present_values();
+  verifier.check_absent_keys({0x0102030405060707, 0x0102030405060608,
+                              0x0102030404060708, 0x01020304FF060708,
+                              0x0102030405FF0709, 0xFF02030405060708});
+  unodb::test::must_not_allocate([&verifier] {
+    verifier.attempt_remove_missing_keys(
+        {0x0102030405060608, 0x01020304FF060708, 0x0102030405FF0607});
+  });
+}
+
+TYPED_TEST(ARTCorrectnessTest, LongKeyPrefixMergeThenSplit) {
+  unodb::test::tree_verifier<TypeParam> verifier;
+
+  verifier.insert(0x0102030405060708, unodb::test::test_values[0]);
+  verifier.insert(0x0102030405060709, unodb::test::test_values[1]);
+  verifier.insert(0x0102FF0405060708, unodb::test::test_values[2]);
+  verifier.assert_key_prefix_splits(1);
+  verifier.assert_node_counts({3, 2, 0, 0, 0, 0});
+
+  // Merge the key prefixes back into the longest one
+  unodb::test::must_not_allocate(
+      [&verifier] { verifier.remove(0x0102FF0405060708); });
+  verifier.assert_node_counts({2, 1, 0, 0, 0, 0});
+  verifier.assert_shrinking_inodes({1, 0, 0, 0, 0});
+
+  // And split it again at a different byte
+  verifier.insert(0x01020304050607FF, unodb::test::test_values[3]);
+  verifier.insert(0x010203040506FF08, unodb::test::test_values[2]);
+  verifier.assert_node_counts({4, 2, 0, 0, 0, 0});
+  verifier.assert_key_prefix_splits(2);
+
+  verifier.check_present_values();
+  verifier.check_absent_keys({0x0102FF0405060708, 0x010203040506FF09,
+                              0x0102030405FF0708});
+}
+
 TYPED_TEST(ARTCorrectnessTest, Node16DeleteBeginningMiddleEnd) {
   unodb::test::tree_verifier<TypeParam> verifier;
 
@@ -491,18 +596,18 @@ TYPED_TEST(ARTCorrectnessTest, Node16DeleteBeginningMiddleEnd) {
 
   verifier.check_present_values();
   verifier.check_absent_keys({0, 1, 5, 16, 17});
-  verifier.assert_node_counts({13, 0, 1, 0, 0});
+  verifier.assert_node_counts({13, 0, 1, 0, 0, 0});
 }
 
 TYPED_TEST(ARTCorrectnessTest, Node16ShrinkToNode4DeleteMiddle) {
   unodb::test::tree_verifier<TypeParam> verifier;
 
   verifier.insert_key_range(1, 5);
-  verifier.assert_node_counts({5, 0, 1, 0, 0});
+  verifier.assert_node_counts({5, 0, 1, 0, 0, 0});
 
   verifier.remove(2);
-  verifier.assert_shrinking_inodes({0, 1, 0, 0});
-  verifier.assert_node_counts({4, 1, 0, 0, 0});
+  verifier.assert_shrinking_inodes({0, 1, 0, 0, 0});
+  verifier.assert_node_counts({4, 1, 0, 0, 0, 0});
 
   verifier.check_present_values();
   verifier.check_absent_keys({0, 2, 6});
@@ -512,11 +617,11 @@ TYPED_TEST(ARTCorrectnessTest, Node16ShrinkToNode4DeleteBeginning) {
   unodb::test::tree_verifier<TypeParam> verifier;
 
   verifier.insert_key_range(1, 5);
-  verifier.assert_node_counts({5, 0, 1, 0, 0});
+  verifier.assert_node_counts({5, 0, 1, 0, 0, 0});
 
   verifier.remove(1);
-  verifier.assert_shrinking_inodes({0, 1, 0, 0});
-  verifier.assert_node_counts({4, 1, 0, 0, 0});
+  verifier.assert_shrinking_inodes({0, 1, 0, 0, 0});
+  verifier.assert_node_counts({4, 1, 0, 0, 0, 0});
 
   verifier.check_present_values();
   verifier.check_absent_keys({0, 1, 6});
@@ -526,11 +631,11 @@ TYPED_TEST(ARTCorrectnessTest, Node16ShrinkToNode4DeleteEnd) {
   unodb::test::tree_verifier<TypeParam> verifier;
 
   verifier.insert_key_range(1, 5);
-  verifier.assert_node_counts({5, 0, 1, 0, 0});
+  verifier.assert_node_counts({5, 0, 1, 0, 0, 0});
 
   verifier.remove(5);
-  verifier.assert_shrinking_inodes({0, 1, 0, 0});
-  verifier.assert_node_counts({4, 1, 0, 0, 0});
+  verifier.assert_shrinking_inodes({0, 1, 0, 0, 0});
+  verifier.assert_node_counts({4, 1, 0, 0, 0, 0});
 
   verifier.check_present_values();
   verifier.check_absent_keys({0, 5, 6});
@@ -542,94 +647,171 @@ TYPED_TEST(ARTCorrectnessTest, Node16KeyPrefixMerge) {
   verifier.insert_key_range(10, 5);
   // Insert a value that does not share full prefix with the current Node16
   verifier.insert(0x1020, unodb::test::test_values[0]);
-  verifier.assert_node_counts({6, 1, 1, 0, 0});
+  verifier.assert_node_counts({6, 1, 1, 0, 0, 0});
   verifier.assert_key_prefix_splits(1);
 
   // And delete it, so that upper level Node4 key prefix gets merged with
   // Node16 one
   unodb::test::must_not_allocate([&verifier] { verifier.remove(0x1020); });
 
-  verifier.assert_shrinking_inodes({1, 0, 0, 0});
-  verifier.assert_node_counts({5, 0, 1, 0, 0});
+  verifier.assert_shrinking_inodes({1, 0, 0, 0, 0});
+  verifier.assert_node_counts({5, 0, 1, 0, 0, 0});
   verifier.check_present_values();
   verifier.check_absent_keys({9, 16, 0x1020});
 }
 
-TYPED_TEST(ARTCorrectnessTest, Node48DeleteBeginningMiddleEnd) {
+TYPED_TEST(ARTCorrectnessTest, Node32DeleteBeginningMiddleEnd) {
   unodb::test::tree_verifier<TypeParam> verifier;
 
-  verifier.insert_key_range(1, 48);
+  verifier.insert_key_range(1, 32);
 
   unodb::test::must_not_allocate([&verifier] {
-    verifier.remove(30);
-    verifier.remove(48);
+    verifier.remove(20);
+    verifier.remove(32);
     verifier.remove(1);
   });
 
   verifier.check_present_values();
-  verifier.check_absent_keys({0, 1, 30, 48, 49});
-  verifier.assert_node_counts({45, 0, 0, 1, 0});
+  verifier.check_absent_keys({0, 1, 20, 32, 33});
+  verifier.assert_node_counts({29, 0, 0, 1, 0, 0});
 }
 
-TYPED_TEST(ARTCorrectnessTest, Node48ShrinkToNode16DeleteMiddle) {
+TYPED_TEST(ARTCorrectnessTest, Node32ShrinkToNode16DeleteMiddle) {
   unodb::test::tree_verifier<TypeParam> verifier;
 
   verifier.insert_key_range(0x80, 17);
-  verifier.assert_node_counts({17, 0, 0, 1, 0});
+  verifier.assert_node_counts({17, 0, 0, 1, 0, 0});
 
   verifier.remove(0x85);
-  verifier.assert_shrinking_inodes({0, 0, 1, 0});
-  verifier.assert_node_counts({16, 0, 1, 0, 0});
+  verifier.assert_shrinking_inodes({0, 0, 1, 0, 0});
+  verifier.assert_node_counts({16, 0, 1, 0, 0, 0});
 
   verifier.check_present_values();
   verifier.check_absent_keys({0x7F, 0x85, 0x91});
 }
 
-TYPED_TEST(ARTCorrectnessTest, Node48ShrinkToNode16DeleteBeginning) {
+TYPED_TEST(ARTCorrectnessTest, Node32ShrinkToNode16DeleteBeginning) {
   unodb::test::tree_verifier<TypeParam> verifier;
 
   verifier.insert_key_range(1, 17);
-  verifier.assert_node_counts({17, 0, 0, 1, 0});
+  verifier.assert_node_counts({17, 0, 0, 1, 0, 0});
 
   verifier.remove(1);
-  verifier.assert_shrinking_inodes({0, 0, 1, 0});
-  verifier.assert_node_counts({16, 0, 1, 0, 0});
+  verifier.assert_shrinking_inodes({0, 0, 1, 0, 0});
+  verifier.assert_node_counts({16, 0, 1, 0, 0, 0});
 
   verifier.check_present_values();
   verifier.check_absent_keys({0, 1, 18});
 }
 
-TYPED_TEST(ARTCorrectnessTest, Node48ShrinkToNode16DeleteEnd) {
+TYPED_TEST(ARTCorrectnessTest, Node32ShrinkToNode16DeleteEnd) {
   unodb::test::tree_verifier<TypeParam> verifier;
 
   verifier.insert_key_range(1, 17);
-  verifier.assert_node_counts({17, 0, 0, 1, 0});
+  verifier.assert_node_counts({17, 0, 0, 1, 0, 0});
 
   verifier.remove(17);
-  verifier.assert_shrinking_inodes({0, 0, 1, 0});
-  verifier.assert_node_counts({16, 0, 1, 0, 0});
+  verifier.assert_shrinking_inodes({0, 0, 1, 0, 0});
+  verifier.assert_node_counts({16, 0, 1, 0, 0, 0});
 
   verifier.check_present_values();
   verifier.check_absent_keys({0, 17, 18});
 }
 
-TYPED_TEST(ARTCorrectnessTest, Node48KeyPrefixMerge) {
+TYPED_TEST(ARTCorrectnessTest, Node32KeyPrefixMerge) {
   unodb::test::tree_verifier<TypeParam> verifier;
 
   verifier.insert_key_range(10, 17);
+  // Insert a value that does not share full prefix with the current Node32
+  verifier.insert(0x2010, unodb::test::test_values[1]);
+  verifier.assert_node_counts({18, 1, 0, 1, 0, 0});
+
+  // And delete it, so that upper level Node4 key prefix gets merged with
+  // Node32 one
+  unodb::test::must_not_allocate([&verifier] { verifier.remove(0x2010); });
+
+  verifier.assert_shrinking_inodes({1, 0, 0, 0, 0});
+  verifier.assert_node_counts({17, 0, 0, 1, 0, 0});
+
+  verifier.check_present_values();
+  verifier.check_absent_keys({9, 0x2010, 28});
+}
+
+TYPED_TEST(ARTCorrectnessTest, Node48DeleteBeginningMiddleEnd) {
+  unodb::test::tree_verifier<TypeParam> verifier;
+
+  verifier.insert_key_range(1, 48);
+
+  unodb::test::must_not_allocate([&verifier] {
+    verifier.remove(30);
+    verifier.remove(48);
+    verifier.remove(1);
+  });
+
+  verifier.check_present_values();
+  verifier.check_absent_keys({0, 1, 30, 48, 49});
+  verifier.assert_node_counts({45, 0, 0, 0, 1, 0});
+}
+
+TYPED_TEST(ARTCorrectnessTest, Node48ShrinkToNode32DeleteMiddle) {
+  unodb::test::tree_verifier<TypeParam> verifier;
+
+  verifier.insert_key_range(0x80, 33);
+  verifier.assert_node_counts({33, 0, 0, 0, 1, 0});
+
+  verifier.remove(0x85);
+  verifier.assert_shrinking_inodes({0, 0, 0, 1, 0});
+  verifier.assert_node_counts({32, 0, 0, 1, 0, 0});
+
+  verifier.check_present_values();
+  verifier.check_absent_keys({0x7F, 0x85, 0xA1});
+}
+
+TYPED_TEST(ARTCorrectnessTest, Node48ShrinkToNode32DeleteBeginning) {
+  unodb::test::tree_verifier<TypeParam> verifier;
+
+  verifier.insert_key_range(1, 33);
+  verifier.assert_node_counts({33, 0, 0, 0, 1, 0});
+
+  verifier.remove(1);
+  verifier.assert_shrinking_inodes({0, 0, 0, 1, 0});
+  verifier.assert_node_counts({32, 0, 0, 1, 0, 0});
+
+  verifier.check_present_values();
+  verifier.check_absent_keys({0, 1, 34});
+}
+
+TYPED_TEST(ARTCorrectnessTest, Node48ShrinkToNode32DeleteEnd) {
+  unodb::test::tree_verifier<TypeParam> verifier;
+
+  verifier.insert_key_range(1, 33);
+  verifier.assert_node_counts({33, 0, 0, 0, 1, 0});
+
+  verifier.remove(33);
+  verifier.assert_shrinking_inodes({0, 0, 0, 1, 0});
+  verifier.assert_node_counts({32, 0, 0, 1, 0, 0});
+
+  verifier.check_present_values();
+  verifier.check_absent_keys({0, 33, 34});
+}
+
+TYPED_TEST(ARTCorrectnessTest, Node48KeyPrefixMerge) {
+  unodb::test::tree_verifier<TypeParam> verifier;
+
+  verifier.insert_key_range(10, 33);
   // Insert a value that does not share full prefix with the current Node48
   verifier.insert(0x2010, unodb::test::test_values[1]);
-  verifier.assert_node_counts({18, 1, 0, 1, 0});
+  verifier.assert_node_counts({34, 1, 0, 0, 1, 0});
 
   // And delete it, so that upper level Node4 key prefix gets merged with
   // Node48 one
   unodb::test::must_not_allocate([&verifier] { verifier.remove(0x2010); });
 
-  verifier.assert_shrinking_inodes({1, 0, 0, 0});
-  verifier.assert_node_counts({17, 0, 0, 1, 0});
+  verifier.assert_shrinking_inodes({1, 0, 0, 0, 0});
+  verifier.assert_node_counts({33, 0, 0, 0, 1, 0});
 
   verifier.check_present_values();
-  verifier.check_absent_keys({9, 0x2010, 28});
+  verifier.check_absent_keys({9, 0x2010, 44});
 }
 
 TYPED_TEST(ARTCorrectnessTest, Node256DeleteBeginningMiddleEnd) {
@@ -645,18 +827,18 @@ TYPED_TEST(ARTCorrectnessTest, Node256DeleteBeginningMiddleEnd) {
 
   verifier.check_present_values();
   verifier.check_absent_keys({0, 1, 180, 256});
-  verifier.assert_node_counts({253, 0, 0, 0, 1});
+  verifier.assert_node_counts({253, 0, 0, 0, 0, 1});
 }
 
 TYPED_TEST(ARTCorrectnessTest, Node256ShrinkToNode48DeleteMiddle) {
   unodb::test::tree_verifier<TypeParam> verifier;
 
   verifier.insert_key_range(1, 49);
-  verifier.assert_node_counts({49, 0, 0, 0, 1});
+  verifier.assert_node_counts({49, 0, 0, 0, 0, 1});
 
   verifier.remove(25);
-  verifier.assert_shrinking_inodes({0, 0, 0, 1});
-  verifier.assert_node_counts({48, 0, 0, 1, 0});
+  verifier.assert_shrinking_inodes({0, 0, 0, 0, 1});
+  verifier.assert_node_counts({48, 0, 0, 0, 1, 0});
 
   verifier.check_present_values();
   verifier.check_absent_keys({0, 25, 50});
@@ -666,11 +848,11 @@ TYPED_TEST(ARTCorrectnessTest, Node256ShrinkToNode48DeleteBeginning) {
   unodb::test::tree_verifier<TypeParam> verifier;
 
   verifier.insert_key_range(1, 49);
-  verifier.assert_node_counts({49, 0, 0, 0, 1});
+  verifier.assert_node_counts({49, 0, 0, 0, 0, 1});
 
   verifier.remove(1);
-  verifier.assert_shrinking_inodes({0, 0, 0, 1});
-  verifier.assert_node_counts({48, 0, 0, 1, 0});
+  verifier.assert_shrinking_inodes({0, 0, 0, 0, 1});
+  verifier.assert_node_counts({48, 0, 0, 0, 1, 0});
 
   verifier.check_present_values();
   verifier.check_absent_keys({0, 1, 50});
@@ -680,30 +862,169 @@ TYPED_TEST(ARTCorrectnessTest, Node256ShrinkToNode48DeleteEnd) {
   unodb::test::tree_verifier<TypeParam> verifier;
 
   verifier.insert_key_range(1, 49);
-  verifier.assert_node_counts({49, 0, 0, 0, 1});
+  verifier.assert_node_counts({49, 0, 0, 0, 0, 1});
 
   verifier.remove(49);
-  verifier.assert_shrinking_inodes({0, 0, 0, 1});
-  verifier.assert_node_counts({48, 0, 0, 1, 0});
+  verifier.assert_shrinking_inodes({0, 0, 0, 0, 1});
+  verifier.assert_node_counts({48, 0, 0, 0, 1, 0});
 
   verifier.check_present_values();
   verifier.check_absent_keys({0, 49, 50});
 }
 
+TYPED_TEST(ARTCorrectnessTest, Node256ShrinkToNode48ThenRefill) {
+  unodb::test::tree_verifier<TypeParam> verifier;
+
+  verifier.insert_key_range(1, 49);
+  verifier.remove(25);
+  verifier.remove(2);
+  verifier.remove(49);
+  verifier.assert_node_counts({46, 0, 0, 0, 1, 0});
+
+  // The freed slots of the shrunk node must be reused before growing again
+  verifier.insert(100, test_values[0]);
+  verifier.insert(2, test_values[1]);
+  verifier.assert_node_counts({48, 0, 0, 0, 1, 0});
+  verifier.insert(25, test_values[2]);
+  verifier.assert_node_counts({49, 0, 0, 0, 0, 1});
+
+  verifier.check_present_values();
+  verifier.check_absent_keys({0, 49, 50, 99});
+}
+
+TYPED_TEST(ARTCorrectnessTest, HysteresisNoChurnAtNode16Capacity) {
+  unodb::test::tree_verifier<TypeParam> verifier{
+      unodb::shrink_policy::HYSTERESIS};
+
+  verifier.insert_key_range(0, 16);
+  for (auto i = 0; i < 3; ++i) {
+    verifier.insert(16, test_values[0]);
+    verifier.assert_node_counts({17, 0, 0, 1, 0, 0});
+    verifier.remove(16);
+    verifier.assert_node_counts({16, 0, 0, 1, 0, 0});
+  }
+  verifier.assert_growing_inodes({1, 1, 1, 0, 0});
+  verifier.assert_shrinking_inodes({0, 0, 0, 0, 0});
+
+  verifier.check_present_values();
+  verifier.check_absent_keys({16, 17});
+}
+
+TYPED_TEST(ARTCorrectnessTest, HysteresisShrinkNode16) {
+  unodb::test::tree_verifier<TypeParam> verifier{
+      unodb::shrink_policy::HYSTERESIS};
+
+  verifier.insert_key_range(1, 5);
+  verifier.remove(3);
+  verifier.assert_node_counts({4, 0, 1, 0, 0, 0});
+  verifier.assert_shrinking_inodes({0, 0, 0, 0, 0});
+
+  verifier.remove(2);
+  verifier.assert_node_counts({3, 1, 0, 0, 0, 0});
+  verifier.assert_shrinking_inodes({0, 1, 0, 0, 0});
+
+  verifier.check_present_values();
+  verifier.check_absent_keys({0, 2, 3, 6});
+}
+
+TYPED_TEST(ARTCorrectnessTest, HysteresisShrinkNode32) {
+  unodb::test::tree_verifier<TypeParam> verifier{
+      unodb::shrink_policy::HYSTERESIS};
+
+  verifier.insert_key_range(1, 17);
+  for (unodb::key k = 2; k < 10; k += 2) verifier.remove(k);
+  verifier.assert_node_counts({13, 0, 0, 1, 0, 0});
+  verifier.assert_shrinking_inodes({0, 0, 0, 0, 0});
+
+  verifier.remove(17);
+  verifier.assert_node_counts({12, 0, 1, 0, 0, 0});
+  verifier.assert_shrinking_inodes({0, 0, 1, 0, 0});
+
+  verifier.insert(4, test_values[0]);
+  verifier.assert_node_counts({13, 0, 1, 0, 0, 0});
+
+  verifier.check_present_values();
+  verifier.check_absent_keys({0, 2, 6, 8, 17});
+}
+
+TYPED_TEST(ARTCorrectnessTest, HysteresisShrinkNode48) {
+  unodb::test::tree_verifier<TypeParam> verifier{
+      unodb::shrink_policy::HYSTERESIS};
+
+  verifier.insert_key_range(1, 33);
+  for (unodb::key k = 1; k < 17; k += 2) verifier.remove(k);
+  verifier.assert_node_counts({25, 0, 0, 0, 1, 0});
+  verifier.assert_shrinking_inodes({0, 0, 0, 0, 0});
+
+  // Add to a Node48 below its eager minimum size
+  verifier.insert(1, test_values[0]);
+  verifier.remove(1);
+  verifier.assert_node_counts({25, 0, 0, 0, 1, 0});
+
+  verifier.remove(20);
+  verifier.assert_node_counts({24, 0, 0, 1, 0, 0});
+  verifier.assert_shrinking_inodes({0, 0, 0, 1, 0});
+
+  verifier.check_present_values();
+  verifier.check_absent_keys({0, 1, 15, 20, 34});
+}
+
+TYPED_TEST(ARTCorrectnessTest, HysteresisShrinkNode256) {
+  unodb::test::tree_verifier<TypeParam> verifier{
+      unodb::shrink_policy::HYSTERESIS};
+
+  verifier.insert_key_range(1, 49);
+  for (unodb::key k = 49; k > 37; --k) verifier.remove(k);
+  verifier.assert_node_counts({37, 0, 0, 0, 0, 1});
+  verifier.assert_shrinking_inodes({0, 0, 0, 0, 0});
+
+  verifier.remove(10);
+  verifier.assert_node_counts({36, 0, 0, 0, 1, 0});
+  verifier.assert_shrinking_inodes({0, 0, 0, 0, 1});
+
+  verifier.insert_key_range(100, 12);
+  verifier.assert_node_counts({48, 0, 0, 0, 1, 0});
+  verifier.insert(10, test_values[0]);
+  verifier.assert_node_counts({49, 0, 0, 0, 0, 1});
+
+  verifier.check_present_values();
+  verifier.check_absent_keys({0, 38, 49, 99, 112});
+}
+
+TYPED_TEST(ARTCorrectnessTest, SparseNode256) {
+  unodb::test::tree_verifier<TypeParam> verifier;
+
+  verifier.insert_key_range(0, 256);
+  for (unodb::key k = 0; k < 256; k += 3) verifier.remove(k);
+  for (unodb::key k = 1; k < 256; k += 3) verifier.remove(k);
+  verifier.assert_node_counts({85, 0, 0, 0, 0, 1});
+  verifier.check_present_values();
+  verifier.check_absent_keys({0, 1, 3, 253, 255});
+
+  for (unodb::key k = 2; k < 2 + 36 * 3; k += 3) verifier.remove(k);
+  verifier.assert_node_counts({49, 0, 0, 0, 0, 1});
+  verifier.remove(254);
+  verifier.assert_shrinking_inodes({0, 0, 0, 0, 1});
+  verifier.assert_node_counts({48, 0, 0, 0, 1, 0});
+  verifier.check_present_values();
+
+  verifier.clear();
+}
+
 TYPED_TEST(ARTCorrectnessTest, Node256KeyPrefixMerge) {
   unodb::test::tree_verifier<TypeParam> verifier;
 
   verifier.insert_key_range(10, 49);
   // Insert a value that does not share full prefix with the current Node256
   verifier.insert(0x2010, unodb::test::test_values[1]);
-  verifier.assert_node_counts({50, 1, 0, 0, 1});
+  verifier.assert_node_counts({50, 1, 0, 0, 0, 1});
 
   // And delete it, so that upper level Node4 key prefix gets merged with
   // Node256 one
   unodb::test::must_not_allocate([&verifier] { verifier.remove(0x2010); });
 
-  verifier.assert_shrinking_inodes({1, 0, 0, 0});
-  verifier.assert_node_counts({49, 0, 0, 0, 1});
+  verifier.assert_shrinking_inodes({1, 0, 0, 0, 0});
+  verifier.assert_node_counts({49, 0, 0, 0, 0, 1});
   verifier.check_present_values();
   verifier.check_absent_keys({9, 0x2010, 60});
 }
@@ -770,7 +1091,41 @@ TYPED_TEST(ARTCorrectnessTest, Node48InsertIntoDeletedSlot) {
   verifier.insert(0, test_values[0]);
 
   verifier.check_present_values();
-  verifier.assert_node_counts({18, 0, 0, 1, 0});
+  verifier.assert_node_counts({18, 0, 0, 1, 0, 0});
+}
+
+TYPED_TEST(ARTCorrectnessTest, IncreasingKeysInterleavedWithOtherSubtrees) {
+  unodb::test::tree_verifier<TypeParam> verifier;
+
+  verifier.insert_key_range(0, 600);
+  // Grow the root node while the last insert was under one of its children
+  verifier.insert_key_range(0x10000, 4);
+  verifier.insert_key_range(600, 300);
+  // Split the key prefix of the root node
+  verifier.insert(0x0100000000000000ULL, test_values[1]);
+  verifier.insert_key_range(900, 300);
+  // Split the key prefix of the node the last insert went to
+  verifier.insert(0x00000000FF000000ULL, test_values[2]);
+  verifier.insert_key_range(1200, 300);
+
+  verifier.check_present_values();
+  verifier.check_absent_keys({1500, 0x10004, 0x0100000000000001ULL});
+}
+
+TYPED_TEST(ARTCorrectnessTest, IncreasingKeysInterleavedWithDeletes) {
+  unodb::test::tree_verifier<TypeParam> verifier;
+
+  verifier.insert_key_range(0, 520);
+  // Shrink the node the last insert went to, and then free it
+  for (unodb::key k = 512; k < 520; ++k) verifier.remove(k);
+  verifier.insert_key_range(520, 10);
+  for (unodb::key k = 520; k < 530; ++k) verifier.remove(k);
+  verifier.insert_key_range(530, 300);
+  for (unodb::key k = 0; k < 256; ++k) verifier.remove(k);
+  verifier.insert_key_range(830, 300);
+
+  verifier.check_present_values();
+  verifier.check_absent_keys({0, 255, 512, 529, 1130});
 }
 
 TYPED_TEST(ARTCorrectnessTest, ClearOnEmpty) {
@@ -778,19 +1133,126 @@ TYPED_TEST(ARTCorrectnessTest, ClearOnEmpty) {
 
   unodb::test::must_not_allocate([&verifier] { verifier.clear(); });
 
-  verifier.assert_node_counts({0, 0, 0, 0, 0});
+  verifier.assert_node_counts({0, 0, 0, 0, 0, 0});
 }
 
 TYPED_TEST(ARTCorrectnessTest, Clear) {
   unodb::test::tree_verifier<TypeParam> verifier;
 
   verifier.insert(1, test_values[0]);
-  verifier.assert_node_counts({1, 0, 0, 0, 0});
+  verifier.assert_node_counts({1, 0, 0, 0, 0, 0});
 
   unodb::test::must_not_allocate([&verifier] { verifier.clear(); });
 
   verifier.check_absent_keys({1});
-  verifier.assert_node_counts({0, 0, 0, 0, 0});
+  verifier.assert_node_counts({0, 0, 0, 0, 0, 0});
+}
+
+TYPED_TEST(ARTCorrectnessTest, SnapshotEmpty) {
+  unodb::test::tree_verifier<TypeParam> source;
+  unodb::test::tree_verifier<TypeParam> verifier;
+
+  verifier.load_snapshot_of(source);
+
+  verifier.assert_empty();
+}
+
+TYPED_TEST(ARTCorrectnessTest, SnapshotSingleLeaf) {
+  unodb::test::tree_verifier<TypeParam> source;
+  unodb::test::tree_verifier<TypeParam> verifier;
+  source.insert(0xFFFFFFFFFFFFFFFFULL, test_values[4]);
+
+  verifier.load_snapshot_of(source);
+
+  verifier.assert_node_counts({1, 0, 0, 0, 0, 0});
+  verifier.check_absent_keys({0, 0xFFFFFFFFFFFFFFFEULL});
+}
+
+TYPED_TEST(ARTCorrectnessTest, SnapshotAllNodeTypes) {
+  unodb::test::tree_verifier<TypeParam> source;
+  unodb::test::tree_verifier<TypeParam> verifier;
+  // Full N256s at the bottom, with a key prefix above them
+  source.insert_key_range(0x0102030400000000ULL, 1000);
+  // One of each smaller inode type under the top key bytes
+  source.insert_key_range(0x0200000000000000ULL, 3);
+  source.insert_key_range(0x0300000000000000ULL, 10);
+  source.insert_key_range(0x0400000000000000ULL, 20);
+  source.insert_key_range(0x0500000000000000ULL, 40);
+  source.insert(0, test_values[0]);
+  source.insert(0xFF00000000000000ULL, test_values[1]);
+
+  verifier.load_snapshot_of(source);
+
+  // A tree without deletes has the same shape however it was built
+  UNODB_ASSERT_THAT(verifier.get_db().get_node_counts(),
+                    ::testing::ElementsAreArray(
+                        source.get_db().get_node_counts()));
+  UNODB_ASSERT_THAT(verifier.get_db().get_growing_inode_counts(),
+                    ::testing::ElementsAreArray(
+                        source.get_db().get_growing_inode_counts()));
+  verifier.check_absent_keys({1, 0x0102030400000000ULL + 1000,
+                              0x0200000000000003ULL, 0xFE00000000000000ULL});
+}
+
+TYPED_TEST(ARTCorrectnessTest, SnapshotReplacesContents) {
+  unodb::test::tree_verifier<TypeParam> source;
+  unodb::test::tree_verifier<TypeParam> verifier;
+  source.insert_key_range(100, 50);
+  verifier.insert_key_range(0, 300);
+
+  verifier.load_snapshot_of(source);
+
+  verifier.assert_node_counts({50, 0, 0, 0, 0, 1});
+  verifier.check_absent_keys({0, 99, 150, 299});
+}
+
+TYPED_TEST(ARTCorrectnessTest, ModifyAfterSnapshotLoad) {
+  unodb::test::tree_verifier<TypeParam> source;
+  unodb::test::tree_verifier<TypeParam> verifier;
+  source.insert_key_range(0, 600);
+  source.insert(0x0100000000000000ULL, test_values[2]);
+
+  verifier.load_snapshot_of(source);
+
+  // Grow and split the loaded nodes, then shrink and free them
+  verifier.insert_key_range(600, 100);
+  verifier.insert(0x00000000FF000000ULL, test_values[3]);
+  verifier.insert(0x0100000000000001ULL, test_values[4]);
+  verifier.check_present_values();
+  for (unodb::key k = 0; k < 700; ++k) verifier.remove(k);
+  verifier.remove(0x00000000FF000000ULL);
+  verifier.remove(0x0100000000000000ULL);
+  verifier.remove(0x0100000000000001ULL);
+
+  verifier.assert_empty();
+}
+
+TYPED_TEST(ARTCorrectnessTest, InvalidSnapshot) {
+  unodb::test::tree_verifier<TypeParam> verifier;
+  verifier.insert_key_range(0, 10);
+  auto &test_db = verifier.get_db();
+
+  std::stringstream not_a_snapshot{"definitely not a snapshot"};
+  UNODB_ASSERT_THROW(test_db.load(not_a_snapshot), std::runtime_error);
+  UNODB_ASSERT_TRUE(test_db.empty());
+
+  verifier.clear();
+  verifier.insert_key_range(0, 100);
+  std::stringstream snapshot;
+  test_db.save(snapshot);
+  const auto snapshot_bytes = snapshot.str();
+
+  std::stringstream truncated{
+      snapshot_bytes.substr(0, snapshot_bytes.size() - 1)};
+  UNODB_ASSERT_THROW(test_db.load(truncated), std::runtime_error);
+  UNODB_ASSERT_TRUE(test_db.empty());
+  UNODB_ASSERT_EQ(test_db.get_current_memory_use(), 0);
+
+  std::stringstream header_only{snapshot_bytes.substr(0, 20)};
+  UNODB_ASSERT_THROW(test_db.load(header_only), std::runtime_error);
+  UNODB_ASSERT_TRUE(test_db.empty());
+
+  verifier.clear();
 }
 
 TYPED_TEST(ARTCorrectnessTest, TwoInstances) {
@@ -816,4 +1278,218 @@ TYPED_TEST(ARTCorrectnessTest, TwoInstances) {
 
 UNODB_END_TESTS()
 
+UNODB_START_TESTS()
+
+// OLC leaves have no lock, so they take exactly as much memory as the
+// single-threaded ones.
+TEST(OLCLeaf, SameMemoryUseAsDbLeaf) {
+  unodb::test::tree_verifier<unodb::db> db_verifier;
+  unodb::test::tree_verifier<unodb::olc_db> olc_verifier;
+
+  db_verifier.insert(1, test_values[2]);
+  olc_verifier.insert(1, test_values[2]);
+
+  UNODB_ASSERT_EQ(db_verifier.get_db().get_current_memory_use(),
+                  olc_verifier.get_db().get_current_memory_use());
+}
+
+UNODB_END_TESTS()
+
+UNODB_START_TESTS()
+
+// Puts the low byte of k into the top key byte and its next byte into the
+// second one, so that consecutive keys land in different direct-mapped table
+// slots.
+[[nodiscard]] constexpr unodb::key spread_over_direct_map(
+    unodb::key k) noexcept {
+  return (k << 56U) | ((k & 0xFF00U) << 40U) | (k >> 16U);
+}
+
+void test_direct_map(unsigned key_bytes) {
+  // Enough to put several keys into every slot for one key byte, and to leave
+  // most of the slots empty for two.
+  constexpr unodb::key total_keys = 1024;
+
+  unodb::db test_db{key_bytes};
+  UNODB_ASSERT_TRUE(test_db.empty());
+  UNODB_ASSERT_EQ(test_db.get_current_memory_use(), 0);
+
+  for (unodb::key k = 0; k < total_keys; ++k)
+    UNODB_ASSERT_TRUE(test_db.insert(spread_over_direct_map(k),
+                                     test_values[k % test_values.size()]));
+  UNODB_ASSERT_FALSE(test_db.empty());
+  UNODB_ASSERT_FALSE(
+      test_db.insert(spread_over_direct_map(0), test_values[1]));
+  for (unodb::key k = 0; k < total_keys; ++k)
+    unodb::test::detail::assert_result_eq(
+        test_db, spread_over_direct_map(k),
+        test_values[k % test_values.size()], __FILE__, __LINE__);
+  UNODB_ASSERT_FALSE(
+      unodb::db::key_found(test_db.get(spread_over_direct_map(total_keys))));
+
+  for (unodb::key k = 0; k < total_keys; k += 2)
+    UNODB_ASSERT_TRUE(test_db.remove(spread_over_direct_map(k)));
+  UNODB_ASSERT_FALSE(test_db.remove(spread_over_direct_map(0)));
+  for (unodb::key k = 0; k < total_keys; ++k)
+    UNODB_ASSERT_EQ(
+        unodb::db::key_found(test_db.get(spread_over_direct_map(k))),
+        k % 2 == 1);
+
+  test_db.clear();
+  UNODB_ASSERT_TRUE(test_db.empty());
+  UNODB_ASSERT_EQ(test_db.get_current_memory_use(), 0);
+  UNODB_ASSERT_EQ(test_db.get_node_count<unodb::node_type::LEAF>(), 0);
+  UNODB_ASSERT_FALSE(
+      unodb::db::key_found(test_db.get(spread_over_direct_map(1))));
+
+  for (unodb::key k = 0; k < total_keys; ++k)
+    UNODB_ASSERT_TRUE(
+        test_db.insert(spread_over_direct_map(k), test_values[0]));
+  for (unodb::key k = 0; k < total_keys; ++k)
+    UNODB_ASSERT_TRUE(test_db.remove(spread_over_direct_map(k)));
+  UNODB_ASSERT_TRUE(test_db.empty());
+  UNODB_ASSERT_EQ(test_db.get_current_memory_use(), 0);
+}
+
+TEST(DirectMap, OneKeyByte) { test_direct_map(1); }
+
+TEST(DirectMap, TwoKeyBytes) { test_direct_map(2); }
+
+TEST(DirectMap, ZeroKeyBytesIsPlainDb) {
+  unodb::db test_db{0};
+  UNODB_ASSERT_TRUE(test_db.insert(1, test_values[0]));
+  unodb::test::detail::assert_result_eq(test_db, 1, test_values[0], __FILE__,
+                                        __LINE__);
+  UNODB_ASSERT_TRUE(test_db.remove(1));
+  UNODB_ASSERT_TRUE(test_db.empty());
+}
+
+// Snapshots do not depend on the direct-mapped key bytes of the saving tree
+TEST(DirectMap, Snapshot) {
+  constexpr unodb::key total_keys = 1024;
+
+  unodb::db source{1};
+  for (unodb::key k = 0; k < total_keys; ++k)
+    UNODB_ASSERT_TRUE(source.insert(spread_over_direct_map(k),
+                                    test_values[k % test_values.size()]));
+  std::stringstream snapshot;
+  source.save(snapshot);
+  const auto snapshot_bytes = snapshot.str();
+
+  for (const unsigned key_bytes : {0U, 1U, 2U}) {
+    unodb::db test_db{key_bytes};
+    UNODB_ASSERT_TRUE(test_db.insert(total_keys, test_values[0]));
+    std::stringstream in{snapshot_bytes};
+    test_db.load(in);
+
+    UNODB_ASSERT_EQ(test_db.get_node_count<unodb::node_type::LEAF>(),
+                    total_keys);
+    for (unodb::key k = 0; k < total_keys; ++k)
+      unodb::test::detail::assert_result_eq(
+          test_db, spread_over_direct_map(k),
+          test_values[k % test_values.size()], __FILE__, __LINE__);
+    UNODB_ASSERT_FALSE(unodb::db::key_found(test_db.get(total_keys)));
+
+    std::stringstream resaved;
+    test_db.save(resaved);
+    UNODB_ASSERT_EQ(resaved.str(), snapshot_bytes);
+  }
+}
+
+TEST(DirectMap, TooManyKeyBytes) {
+  UNODB_ASSERT_THROW(unodb::db{3}, std::invalid_argument);
+}
+
+UNODB_END_TESTS()
+
+#ifdef UNODB_DETAIL_X86_64
+
+UNODB_START_TESTS()
+
+TEST(SIMDKernels, AllSupportedLevels) {
+  const auto max_level =
+      static_cast<unsigned>(unodb::detail::detect_simd_level());
+  for (unsigned level = 0; level <= max_level; ++level) {
+    const auto kernels{unodb::detail::get_simd_kernels(
+        static_cast<unodb::detail::simd_level>(level))};
+    UNODB_ASSERT_EQ(static_cast<unsigned>(kernels.level), level);
+  }
+}
+
+TEST(SIMDKernels, N16InsertPosAllLevels) {
+  const auto max_level =
+      static_cast<unsigned>(unodb::detail::detect_simd_level());
+  for (unsigned level = 0; level <= max_level; ++level) {
+    const auto kernels{unodb::detail::get_simd_kernels(
+        static_cast<unodb::detail::simd_level>(level))};
+    if (kernels.n16_insert_pos == nullptr) continue;
+    // Sorted keys 0x10, 0x20, ..., 0xF0, with 0xFF garbage past the count
+    alignas(16) std::array<std::uint8_t, 16> keys{};
+    keys.fill(0xFF);
+    for (std::uint8_t children_count = 0; children_count < 16;
+         ++children_count) {
+      if (children_count > 0)
+        keys[children_count - 1U] =
+            static_cast<std::uint8_t>(children_count * 0x10U);
+      for (unsigned key_byte = 0; key_byte < 256; key_byte += 7) {
+        if (key_byte % 0x10 == 0) continue;
+        UNODB_ASSERT_EQ(kernels.n16_insert_pos(
+                            keys.data(), static_cast<std::uint8_t>(key_byte),
+                            children_count),
+                        unodb::detail::n16_insert_pos_sse2(
+                            keys.data(), static_cast<std::uint8_t>(key_byte),
+                            children_count));
+      }
+    }
+  }
+}
+
+// The width of a node pointer
+#ifdef UNODB_DETAIL_COMPRESSED_NODE_PTRS
+using n16_child = std::uint32_t;
+#else
+using n16_child = std::uint64_t;
+#endif
+
+// Different in both halves of a child, to catch moves of the wrong width
+[[nodiscard]] constexpr n16_child n16_child_val(unsigned i) noexcept {
+  return (n16_child{1} << (sizeof(n16_child) * 4U)) * i + i;
+}
+
+TEST(SIMDKernels, N16RemoveAllLevels) {
+  const auto max_level =
+      static_cast<unsigned>(unodb::detail::detect_simd_level());
+  for (unsigned level = 0; level <= max_level; ++level) {
+    const auto kernels{unodb::detail::get_simd_kernels(
+        static_cast<unodb::detail::simd_level>(level))};
+    if (kernels.n16_remove == nullptr) continue;
+    for (std::uint8_t children_count = 1; children_count <= 16;
+         ++children_count) {
+      for (std::uint8_t child_index = 0; child_index < children_count;
+           ++child_index) {
+        alignas(16) std::array<std::uint8_t, 16> keys{};
+        std::array<n16_child, 16> children{};
+        for (std::uint8_t i = 0; i < 16; ++i) {
+          keys[i] = static_cast<std::uint8_t>(i * 3);
+          children[i] = n16_child_val(i);
+        }
+        kernels.n16_remove(keys.data(), children.data(), child_index,
+                           children_count);
+        for (std::uint8_t i = 0; i + 1U < children_count; ++i) {
+          const auto source = (i < child_index) ? i : i + 1U;
+          UNODB_ASSERT_EQ(keys[i], source * 3);
+          UNODB_ASSERT_EQ(children[i], n16_child_val(source));
+        }
+        // Nothing past the original children may be written
+        for (std::uint8_t i = children_count; i < 16; ++i)
+          UNODB_ASSERT_EQ(children[i], n16_child_val(i));
+      }
+    }
+  }
+}
+
+UNODB_END_TESTS()
+
+#endif  // #ifdef UNODB_DETAIL_X86_64
+
 }  // namespace
@@ -2,9 +2,14 @@
 
 #include "global.hpp"
 
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <cstddef>
+#include <cstdint>
 #include <random>  // IWYU pragma: keep
+#include <stdexcept>
+#include <utility>
 
 #include <gtest/gtest.h>
 
@@ -13,6 +18,7 @@
 #include "db_test_utils.hpp"
 #include "gtest_utils.hpp"
 #include "mutex_art.hpp"  // IWYU pragma: keep
+#include "node_type.hpp"
 #include "olc_art.hpp"    // IWYU pragma: keep
 #include "qsbr.hpp"
 #include "qsbr_test_utils.hpp"
@@ -193,4 +199,354 @@ TYPED_TEST(ARTConcurrencyTest, ParallelRandomInsertDeleteGet) {
 
 UNODB_END_TESTS()
 
+#ifdef UNODB_DETAIL_OLC_RESTART_STATS
+
+UNODB_START_TESTS()
+
+TEST(OLCRestartStats, NoRestartsSingleThreaded) {
+  constexpr auto total_keys = 1024;
+
+  unodb::olc_db::reset_restart_counts();
+  {
+    unodb::test::tree_verifier<unodb::olc_db> verifier;
+    verifier.insert_key_range(0, total_keys);
+    verifier.check_present_values();
+    for (unodb::key k = 0; k < total_keys; ++k) verifier.remove(k);
+    verifier.assert_empty();
+  }
+  unodb::this_thread().quiescent();
+  unodb::test::expect_idle_qsbr();
+
+  UNODB_ASSERT_EQ(unodb::olc_db::get_restart_counts(),
+                  unodb::olc_restart_counter_array{});
+}
+
+UNODB_END_TESTS()
+
+#endif
+
+UNODB_START_TESTS()
+
+// Consecutive keys go to different permanent root node children
+[[nodiscard]] constexpr unodb::key spread_over_root(unodb::key k) noexcept {
+  return (k << 56U) | (k >> 8U);
+}
+
+TEST(OLCPermanentRoot, InsertGetRemoveClear) {
+  // Enough to get both leaf and inode root children, and to go under the root
+  // node minimum size on removal
+  constexpr unodb::key total_keys = 1024;
+
+  {
+    unodb::olc_db test_db{unodb::olc_db::root_node::PERMANENT_I256};
+    UNODB_ASSERT_TRUE(test_db.empty());
+    UNODB_ASSERT_EQ(test_db.get_node_count<unodb::node_type::I256>(), 1);
+    const auto empty_memory_use = test_db.get_current_memory_use();
+    UNODB_ASSERT_GT(empty_memory_use, 0);
+
+    for (unodb::key k = 0; k < total_keys; ++k)
+      UNODB_ASSERT_TRUE(test_db.insert(spread_over_root(k),
+                                       unodb::test::test_values[0]));
+    UNODB_ASSERT_FALSE(test_db.empty());
+    for (unodb::key k = 0; k < total_keys; ++k)
+      UNODB_ASSERT_TRUE(
+          unodb::olc_db::key_found(test_db.get(spread_over_root(k))));
+
+    for (unodb::key k = 0; k < total_keys; ++k)
+      UNODB_ASSERT_TRUE(test_db.remove(spread_over_root(k)));
+    UNODB_ASSERT_TRUE(test_db.empty());
+    UNODB_ASSERT_EQ(test_db.get_current_memory_use(), empty_memory_use);
+    UNODB_ASSERT_EQ(test_db.get_node_count<unodb::node_type::I256>(), 1);
+    UNODB_ASSERT_EQ(test_db.get_node_count<unodb::node_type::LEAF>(), 0);
+
+    for (unodb::key k = 0; k < total_keys; ++k)
+      UNODB_ASSERT_TRUE(test_db.insert(spread_over_root(k),
+                                       unodb::test::test_values[1]));
+    unodb::this_thread().quiescent();
+    test_db.clear();
+    UNODB_ASSERT_TRUE(test_db.empty());
+    UNODB_ASSERT_EQ(test_db.get_current_memory_use(), empty_memory_use);
+    UNODB_ASSERT_EQ(test_db.get_node_count<unodb::node_type::I256>(), 1);
+    UNODB_ASSERT_FALSE(
+        unodb::olc_db::key_found(test_db.get(spread_over_root(0))));
+  }
+  unodb::this_thread().quiescent();
+  unodb::test::expect_idle_qsbr();
+}
+
+TEST(OLCPermanentRoot, ParallelInsertRemove) {
+  constexpr std::size_t thread_count = 4;
+  constexpr unodb::key keys_per_thread = 2000;
+
+  {
+    unodb::olc_db test_db{unodb::olc_db::root_node::PERMANENT_I256};
+
+    unodb::this_thread().qsbr_pause();
+
+    std::array<unodb::test::thread<unodb::olc_db>, thread_count> threads;
+    for (std::size_t i = 0; i < thread_count; ++i) {
+      threads[i] = unodb::test::thread<unodb::olc_db>{[&test_db, i] {
+        const unodb::key start = i * keys_per_thread;
+        for (auto k = start; k < start + keys_per_thread; ++k)
+          UNODB_ASSERT_TRUE(test_db.insert(spread_over_root(k),
+                                           unodb::test::test_values[0]));
+        for (auto k = start; k < start + keys_per_thread; ++k)
+          UNODB_ASSERT_TRUE(
+              unodb::olc_db::key_found(test_db.get(spread_over_root(k))));
+        for (auto k = start; k < start + keys_per_thread; ++k)
+          UNODB_ASSERT_TRUE(test_db.remove(spread_over_root(k)));
+      }};
+    }
+    for (auto &t : threads) t.join();
+
+    unodb::this_thread().qsbr_resume();
+
+    UNODB_ASSERT_TRUE(test_db.empty());
+    UNODB_ASSERT_EQ(test_db.get_node_count<unodb::node_type::I256>(), 1);
+  }
+  unodb::this_thread().quiescent();
+  unodb::test::expect_idle_qsbr();
+}
+
+UNODB_END_TESTS()
+
+UNODB_START_TESTS()
+
+// Puts the low byte of k into the top key byte and its next byte into the
+// second one, so that consecutive keys land in different direct-mapped table
+// slots.
+[[nodiscard]] constexpr unodb::key spread_over_direct_map(
+    unodb::key k) noexcept {
+  return (k << 56U) | ((k & 0xFF00U) << 40U) | (k >> 16U);
+}
+
+void test_parallel_direct_map(unsigned key_bytes) {
+  constexpr std::size_t thread_count = 4;
+  constexpr unodb::key keys_per_thread = 2000;
+
+  {
+    unodb::olc_db test_db{key_bytes};
+    UNODB_ASSERT_TRUE(test_db.empty());
+
+    unodb::this_thread().qsbr_pause();
+
+    std::array<unodb::test::thread<unodb::olc_db>, thread_count> threads;
+    for (std::size_t i = 0; i < thread_count; ++i) {
+      threads[i] = unodb::test::thread<unodb::olc_db>{[&test_db, i] {
+        const unodb::key start = i * keys_per_thread;
+        for (auto k = start; k < start + keys_per_thread; ++k)
+          UNODB_ASSERT_TRUE(test_db.insert(spread_over_direct_map(k),
+                                           unodb::test::test_values[0]));
+        for (auto k = start; k < start + keys_per_thread; ++k)
+          UNODB_ASSERT_TRUE(unodb::olc_db::key_found(
+              test_db.get(spread_over_direct_map(k))));
+        for (auto k = start; k < start + keys_per_thread; k += 2)
+          UNODB_ASSERT_TRUE(test_db.remove(spread_over_direct_map(k)));
+      }};
+    }
+    for (auto &t : threads) t.join();
+
+    unodb::this_thread().qsbr_resume();
+
+    UNODB_ASSERT_FALSE(test_db.empty());
+    UNODB_ASSERT_EQ(test_db.get_node_count<unodb::node_type::LEAF>(),
+                    thread_count * keys_per_thread / 2);
+    for (unodb::key k = 0; k < thread_count * keys_per_thread; ++k)
+      UNODB_ASSERT_EQ(unodb::olc_db::key_found(
+                          test_db.get(spread_over_direct_map(k))),
+                      k % 2 == 1);
+    unodb::this_thread().quiescent();
+
+    test_db.clear();
+    UNODB_ASSERT_TRUE(test_db.empty());
+    UNODB_ASSERT_EQ(test_db.get_current_memory_use(), 0);
+    UNODB_ASSERT_FALSE(
+        unodb::olc_db::key_found(test_db.get(spread_over_direct_map(1))));
+  }
+  unodb::this_thread().quiescent();
+  unodb::test::expect_idle_qsbr();
+}
+
+TEST(OLCDirectMap, ParallelOneKeyByte) { test_parallel_direct_map(1); }
+
+TEST(OLCDirectMap, ParallelTwoKeyBytes) { test_parallel_direct_map(2); }
+
+TEST(OLCDirectMap, TooManyKeyBytes) {
+  UNODB_ASSERT_THROW(unodb::olc_db{3}, std::invalid_argument);
+}
+
+UNODB_END_TESTS()
+
+UNODB_START_TESTS()
+
+void assert_keys(const unodb::olc_db &test_db, unodb::key start,
+                 unodb::key count, unodb::value_view expected) {
+  for (auto k = start; k < start + count; ++k) {
+    const auto result = test_db.get(k);
+    UNODB_ASSERT_TRUE(unodb::olc_db::key_found(result));
+    UNODB_ASSERT_TRUE(std::equal(std::cbegin(*result), std::cend(*result),
+                                 std::cbegin(expected), std::cend(expected)));
+  }
+}
+
+TEST(OLCMove, MoveAndSwap) {
+  {
+    unodb::olc_db source{unodb::olc_db::root_node::PERMANENT_I256};
+    for (unodb::key k = 0; k < 1000; ++k)
+      UNODB_ASSERT_TRUE(
+          source.insert(spread_over_root(k), unodb::test::test_values[0]));
+    const auto memory_use = source.get_current_memory_use();
+
+    unodb::olc_db moved{std::move(source)};
+    UNODB_ASSERT_EQ(moved.get_current_memory_use(), memory_use);
+    UNODB_ASSERT_EQ(moved.get_node_count<unodb::node_type::LEAF>(), 1000);
+    // NOLINTNEXTLINE(bugprone-use-after-move,hicpp-invalid-access-moved)
+    UNODB_ASSERT_TRUE(source.empty());
+    UNODB_ASSERT_EQ(source.get_current_memory_use(), 0);
+    UNODB_ASSERT_TRUE(
+        source.insert(0x100000000ULL, unodb::test::test_values[1]));
+
+    unodb::olc_db direct_mapped{1};
+    UNODB_ASSERT_TRUE(direct_mapped.insert(2, unodb::test::test_values[2]));
+    swap(moved, direct_mapped);
+    assert_keys(moved, 2, 1, unodb::test::test_values[2]);
+    UNODB_ASSERT_EQ(moved.get_node_count<unodb::node_type::LEAF>(), 1);
+    UNODB_ASSERT_EQ(direct_mapped.get_current_memory_use(), memory_use);
+    for (unodb::key k = 0; k < 1000; ++k) {
+      UNODB_ASSERT_TRUE(
+          unodb::olc_db::key_found(direct_mapped.get(spread_over_root(k))));
+    }
+
+    source = std::move(direct_mapped);
+    UNODB_ASSERT_EQ(source.get_node_count<unodb::node_type::LEAF>(), 1000);
+    UNODB_ASSERT_FALSE(unodb::olc_db::key_found(source.get(0x100000000ULL)));
+    unodb::this_thread().quiescent();
+    for (unodb::key k = 0; k < 1000; ++k)
+      UNODB_ASSERT_TRUE(source.remove(spread_over_root(k)));
+    UNODB_ASSERT_TRUE(source.empty());
+    UNODB_ASSERT_EQ(source.get_node_count<unodb::node_type::I256>(), 1);
+  }
+  unodb::this_thread().quiescent();
+  unodb::test::expect_idle_qsbr();
+}
+
+TEST(OLCExchangeRoot, MismatchedTrees) {
+  unodb::olc_db test_db;
+  unodb::olc_db permanent_root{unodb::olc_db::root_node::PERMANENT_I256};
+  unodb::olc_db direct_mapped{1};
+  UNODB_ASSERT_THROW(test_db.exchange_root(permanent_root),
+                     std::invalid_argument);
+  UNODB_ASSERT_THROW(test_db.exchange_root(direct_mapped),
+                     std::invalid_argument);
+  UNODB_ASSERT_EQ(permanent_root.get_node_count<unodb::node_type::I256>(), 1);
+}
+
+void test_exchange_root(unodb::olc_db &&test_db, unodb::olc_db &&replacement) {
+  constexpr unodb::key key_count = 5000;
+
+  {
+    const auto replacement_empty_memory_use =
+        replacement.get_current_memory_use();
+    for (unodb::key k = 0; k < key_count; ++k)
+      UNODB_ASSERT_TRUE(test_db.insert(spread_over_root(k) + 0x100000000ULL,
+                                       unodb::test::test_values[0]));
+    for (unodb::key k = 0; k < key_count; ++k) {
+      UNODB_ASSERT_TRUE(
+          replacement.insert(spread_over_root(k), unodb::test::test_values[1]));
+    }
+    const auto replacement_memory_use = replacement.get_current_memory_use();
+    const auto replacement_node_counts = replacement.get_node_counts();
+
+    test_db.exchange_root(replacement);
+
+    UNODB_ASSERT_EQ(test_db.get_current_memory_use(), replacement_memory_use);
+    UNODB_ASSERT_TRUE(test_db.get_node_counts() == replacement_node_counts);
+    for (unodb::key k = 0; k < key_count; ++k) {
+      assert_keys(test_db, spread_over_root(k), 1, unodb::test::test_values[1]);
+      UNODB_ASSERT_FALSE(unodb::olc_db::key_found(
+          test_db.get(spread_over_root(k) + 0x100000000ULL)));
+    }
+    UNODB_ASSERT_TRUE(replacement.empty());
+    UNODB_ASSERT_EQ(replacement.get_current_memory_use(),
+                    replacement_empty_memory_use);
+    UNODB_ASSERT_TRUE(replacement.insert(1, unodb::test::test_values[2]));
+    assert_keys(replacement, 1, 1, unodb::test::test_values[2]);
+    unodb::this_thread().quiescent();
+    test_db.clear();
+    replacement.clear();
+  }
+  unodb::this_thread().quiescent();
+  unodb::test::expect_idle_qsbr();
+}
+
+TEST(OLCExchangeRoot, DynamicRoot) {
+  test_exchange_root(unodb::olc_db{}, unodb::olc_db{});
+}
+
+TEST(OLCExchangeRoot, PermanentRoot) {
+  test_exchange_root(unodb::olc_db{unodb::olc_db::root_node::PERMANENT_I256},
+                     unodb::olc_db{unodb::olc_db::root_node::PERMANENT_I256});
+}
+
+TEST(OLCExchangeRoot, DirectMapped) {
+  test_exchange_root(unodb::olc_db{1}, unodb::olc_db{1});
+}
+
+// Readers must find every key, in its old or new value, and writers must keep
+// the stats consistent, whether their inserts landed in the old or the new
+// contents
+TEST(OLCExchangeRoot, ConcurrentOperations) {
+  constexpr std::size_t thread_count = 4;
+  constexpr unodb::key key_count = 20000;
+  constexpr unodb::key own_key_base = 1000000;
+  constexpr unodb::key own_keys_per_thread = 2000;
+
+  {
+    unodb::olc_db test_db;
+    for (unodb::key k = 0; k < key_count; ++k)
+      UNODB_ASSERT_TRUE(test_db.insert(k, unodb::test::test_values[0]));
+    unodb::olc_db replacement;
+    for (unodb::key k = 0; k < key_count; ++k)
+      UNODB_ASSERT_TRUE(replacement.insert(k, unodb::test::test_values[1]));
+
+    std::atomic<bool> exchanged{false};
+    std::array<unodb::qsbr_thread, thread_count> threads;
+    for (std::size_t i = 0; i < thread_count; ++i) {
+      threads[i] = unodb::qsbr_thread{[&test_db, &exchanged, i] {
+        unodb::key own_key = own_key_base + i * own_keys_per_thread;
+        do {
+          for (unodb::key k = i; k < key_count; k += 101 * thread_count) {
+            UNODB_ASSERT_TRUE(unodb::olc_db::key_found(test_db.get(k)));
+            if (own_key < own_key_base + (i + 1) * own_keys_per_thread) {
+              UNODB_ASSERT_TRUE(
+                  test_db.insert(own_key, unodb::test::test_values[2]));
+              ++own_key;
+            }
+            unodb::this_thread().quiescent();
+          }
+        } while (!exchanged.load(std::memory_order_acquire));
+      }};
+    }
+
+    test_db.exchange_root(replacement);
+    exchanged.store(true, std::memory_order_release);
+    for (auto &t : threads) t.join();
+
+    assert_keys(test_db, 0, key_count, unodb::test::test_values[1]);
+    std::uint64_t own_keys_present = 0;
+    for (unodb::key k = 0; k < thread_count * own_keys_per_thread; ++k) {
+      if (unodb::olc_db::key_found(test_db.get(own_key_base + k)))
+        ++own_keys_present;
+    }
+    UNODB_ASSERT_EQ(test_db.get_node_count<unodb::node_type::LEAF>(),
+                    key_count + own_keys_present);
+    UNODB_ASSERT_TRUE(replacement.empty());
+    unodb::this_thread().quiescent();
+  }
+  unodb::this_thread().quiescent();
+  unodb::test::expect_idle_qsbr();
+}
+
+UNODB_END_TESTS()
+
 }  // namespace
@@ -0,0 +1,303 @@
+// Copyright 2022 Laurynas Biveinis
+
+#include "global.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "art.hpp"
+#include "art_common.hpp"
+#include "db_test_utils.hpp"
+#include "gtest_utils.hpp"
+
+namespace {
+
+using unodb::test::test_values;
+
+void assert_value(const unodb::db &test_db, unodb::key k,
+                  unodb::value_view expected) {
+  const auto result = test_db.get(k);
+  UNODB_ASSERT_TRUE(unodb::db::key_found(result));
+  UNODB_ASSERT_TRUE(std::equal(std::cbegin(*result), std::cend(*result),
+                               std::cbegin(expected), std::cend(expected)));
+}
+
+void assert_absent(const unodb::db &test_db, unodb::key k) {
+  UNODB_ASSERT_FALSE(unodb::db::key_found(test_db.get(k)));
+}
+
+UNODB_START_TESTS()
+
+TEST(ARTCopy, Empty) {
+  unodb::db source;
+  unodb::db copy{source};
+
+  UNODB_ASSERT_TRUE(copy.empty());
+  UNODB_ASSERT_EQ(copy.get_current_memory_use(), 0);
+  UNODB_ASSERT_TRUE(copy.insert(1, test_values[0]));
+  UNODB_ASSERT_TRUE(source.empty());
+  assert_value(copy, 1, test_values[0]);
+}
+
+TEST(ARTCopy, Independent) {
+  unodb::db source;
+  for (unodb::key k = 0; k < 1000; ++k)
+    UNODB_ASSERT_TRUE(source.insert(k * 7, test_values[k % 5]));
+  unodb::db copy{source};
+
+  for (unodb::key k = 0; k < 1000; k += 2) {
+    UNODB_ASSERT_TRUE(source.remove(k * 7));
+    UNODB_ASSERT_TRUE(copy.insert(k * 7 + 1, test_values[0]));
+  }
+  UNODB_ASSERT_FALSE(source.insert(7, test_values[0]));
+  UNODB_ASSERT_FALSE(copy.remove(5));
+  UNODB_ASSERT_TRUE(source.insert(0x8000000000000000ULL, test_values[1]));
+  UNODB_ASSERT_TRUE(copy.remove(7));
+
+  for (unodb::key k = 0; k < 1000; ++k) {
+    if (k % 2 == 0) {
+      assert_absent(source, k * 7);
+      assert_value(copy, k * 7, test_values[k % 5]);
+      assert_value(copy, k * 7 + 1, test_values[0]);
+    } else {
+      assert_value(source, k * 7, test_values[k % 5]);
+      if (k != 1) assert_value(copy, k * 7, test_values[k % 5]);
+    }
+    assert_absent(source, k * 7 + 1);
+  }
+  assert_value(source, 0x8000000000000000ULL, test_values[1]);
+  assert_absent(copy, 0x8000000000000000ULL);
+  assert_absent(copy, 7);
+}
+
+TEST(ARTCopy, MemoryUse) {
+  unodb::db source;
+  for (unodb::key k = 0; k < 10000; ++k)
+    UNODB_ASSERT_TRUE(source.insert(k, test_values[2]));
+  const auto memory_use = source.get_current_memory_use();
+  UNODB_ASSERT_EQ(source.get_exclusive_memory_use(), memory_use);
+  UNODB_ASSERT_EQ(source.get_shared_memory_use(), 0);
+
+  unodb::db copy{source};
+
+  UNODB_ASSERT_EQ(copy.get_current_memory_use(), memory_use);
+  UNODB_ASSERT_EQ(copy.get_exclusive_memory_use(), 0);
+  UNODB_ASSERT_EQ(copy.get_shared_memory_use(), memory_use);
+  UNODB_ASSERT_EQ(source.get_exclusive_memory_use(), 0);
+
+  // One changed key copies its path of a few nodes only, leaving the original
+  // path nodes to the copy alone
+  UNODB_ASSERT_TRUE(source.remove(5000));
+  UNODB_ASSERT_EQ(copy.get_current_memory_use(), memory_use);
+  UNODB_ASSERT_LT(0, source.get_exclusive_memory_use());
+  UNODB_ASSERT_LT(source.get_exclusive_memory_use(), 5000);
+  UNODB_ASSERT_LT(0, copy.get_exclusive_memory_use());
+  UNODB_ASSERT_LT(copy.get_exclusive_memory_use(), 5000);
+  UNODB_ASSERT_EQ(source.get_exclusive_memory_use() +
+                      source.get_shared_memory_use(),
+                  source.get_current_memory_use());
+
+  copy.clear();
+  UNODB_ASSERT_EQ(source.get_exclusive_memory_use(),
+                  source.get_current_memory_use());
+  UNODB_ASSERT_EQ(copy.get_current_memory_use(), 0);
+  for (unodb::key k = 0; k < 10000; ++k) {
+    if (k == 5000) continue;
+    assert_value(source, k, test_values[2]);
+  }
+}
+
+TEST(ARTCopy, CopyOfCopyOutlivesSource) {
+  auto source = std::make_unique<unodb::db>();
+  for (unodb::key k = 0; k < 300; ++k)
+    UNODB_ASSERT_TRUE(source->insert(k << 8U, test_values[k % 5]));
+  unodb::db copy{*source};
+  const unodb::db copy_of_copy{copy};
+  UNODB_ASSERT_TRUE(copy.remove(0));
+  source.reset();
+  UNODB_ASSERT_TRUE(copy.remove(1U << 8U));
+
+  for (unodb::key k = 0; k < 300; ++k) {
+    assert_value(copy_of_copy, k << 8U, test_values[k % 5]);
+    if (k > 1) assert_value(copy, k << 8U, test_values[k % 5]);
+  }
+  UNODB_ASSERT_EQ(copy_of_copy.get_node_count<unodb::node_type::LEAF>(), 300);
+  UNODB_ASSERT_EQ(copy.get_node_count<unodb::node_type::LEAF>(), 298);
+}
+
+TEST(ARTCopy, DirectMapped) {
+  unodb::db source{2};
+  for (unodb::key k = 0; k < 1000; ++k)
+    UNODB_ASSERT_TRUE(source.insert((k << 48U) | k, test_values[1]));
+  unodb::db copy{source};
+
+  for (unodb::key k = 0; k < 1000; k += 3)
+    UNODB_ASSERT_TRUE(copy.remove((k << 48U) | k));
+  UNODB_ASSERT_TRUE(source.insert(1, test_values[0]));
+
+  for (unodb::key k = 0; k < 1000; ++k) {
+    assert_value(source, (k << 48U) | k, test_values[1]);
+    if (k % 3 == 0)
+      assert_absent(copy, (k << 48U) | k);
+    else
+      assert_value(copy, (k << 48U) | k, test_values[1]);
+  }
+  assert_absent(copy, 1);
+}
+
+// Removing the second last child of a Node4 extends the key prefix of the other
+// one, which must not show in the copy
+TEST(ARTCopy, Node4CollapseWithSharedSibling) {
+  unodb::db source;
+  UNODB_ASSERT_TRUE(source.insert(0x10000, test_values[0]));
+  UNODB_ASSERT_TRUE(source.insert(0x10001, test_values[1]));
+  UNODB_ASSERT_TRUE(source.insert(0x20000, test_values[2]));
+  unodb::db copy{source};
+
+  UNODB_ASSERT_TRUE(source.remove(0x20000));
+
+  assert_value(copy, 0x10000, test_values[0]);
+  assert_value(copy, 0x10001, test_values[1]);
+  assert_value(copy, 0x20000, test_values[2]);
+  assert_value(source, 0x10000, test_values[0]);
+  assert_value(source, 0x10001, test_values[1]);
+  assert_absent(source, 0x20000);
+
+  UNODB_ASSERT_TRUE(copy.remove(0x10000));
+  assert_value(source, 0x10000, test_values[0]);
+  assert_value(copy, 0x10001, test_values[1]);
+}
+
+TEST(ARTCopy, ReadCopyWhileWritingSource) {
+  unodb::db source;
+  for (unodb::key k = 0; k < 10000; ++k)
+    UNODB_ASSERT_TRUE(source.insert(k, test_values[k % 5]));
+  const unodb::db copy{source};
+  std::atomic<bool> writer_done{false};
+
+  std::thread reader{[&copy, &writer_done] {
+    do {
+      for (unodb::key k = 0; k < 10000; k += 97)
+        assert_value(copy, k, test_values[k % 5]);
+      assert_absent(copy, 20000);
+    } while (!writer_done.load(std::memory_order_acquire));
+  }};
+
+  for (unodb::key k = 0; k < 10000; k += 2) {
+    UNODB_ASSERT_TRUE(source.remove(k));
+    UNODB_ASSERT_TRUE(source.insert(k + 20000, test_values[0]));
+  }
+  writer_done.store(true, std::memory_order_release);
+  reader.join();
+
+  for (unodb::key k = 0; k < 10000; ++k) {
+    assert_value(copy, k, test_values[k % 5]);
+    if (k % 2 == 0)
+      assert_absent(source, k);
+    else
+      assert_value(source, k, test_values[k % 5]);
+  }
+}
+
+TEST(ARTCopy, CopyAssign) {
+  unodb::db source;
+  for (unodb::key k = 0; k < 100; ++k)
+    UNODB_ASSERT_TRUE(source.insert(k, test_values[1]));
+  unodb::db target{1};
+  UNODB_ASSERT_TRUE(target.insert(0x0100000000000000ULL, test_values[0]));
+
+  target = source;
+  UNODB_ASSERT_TRUE(source.remove(0));
+
+  UNODB_ASSERT_EQ(target.get_node_count<unodb::node_type::LEAF>(), 100);
+  assert_value(target, 0, test_values[1]);
+  assert_absent(target, 0x0100000000000000ULL);
+  assert_absent(source, 0);
+  UNODB_ASSERT_TRUE(target.insert(0x0100000000000000ULL, test_values[2]));
+  assert_absent(source, 0x0100000000000000ULL);
+}
+
+TEST(ARTMove, MoveConstruct) {
+  unodb::db source{1};
+  for (unodb::key k = 0; k < 1000; ++k)
+    UNODB_ASSERT_TRUE(source.insert((k << 56U) | k, test_values[k % 5]));
+  const auto memory_use = source.get_current_memory_use();
+  const auto node_counts = source.get_node_counts();
+
+  unodb::db moved{std::move(source)};
+
+  UNODB_ASSERT_EQ(moved.get_current_memory_use(), memory_use);
+  UNODB_ASSERT_TRUE(moved.get_node_counts() == node_counts);
+  for (unodb::key k = 0; k < 1000; ++k)
+    assert_value(moved, (k << 56U) | k, test_values[k % 5]);
+
+  // NOLINTNEXTLINE(bugprone-use-after-move,hicpp-invalid-access-moved)
+  UNODB_ASSERT_TRUE(source.empty());
+  UNODB_ASSERT_EQ(source.get_current_memory_use(), 0);
+  UNODB_ASSERT_TRUE(source.insert(5, test_values[0]));
+  assert_value(source, 5, test_values[0]);
+  assert_absent(moved, 5);
+}
+
+TEST(ARTMove, MoveAssign) {
+  unodb::db source;
+  for (unodb::key k = 0; k < 1000; ++k)
+    UNODB_ASSERT_TRUE(source.insert(k, test_values[0]));
+  unodb::db target{2};
+  for (unodb::key k = 0; k < 1000; ++k)
+    UNODB_ASSERT_TRUE(target.insert(k << 48U, test_values[1]));
+  const auto memory_use = source.get_current_memory_use();
+
+  target = std::move(source);
+
+  UNODB_ASSERT_EQ(target.get_current_memory_use(), memory_use);
+  UNODB_ASSERT_EQ(target.get_node_count<unodb::node_type::LEAF>(), 1000);
+  for (unodb::key k = 1; k < 1000; ++k) {
+    assert_value(target, k, test_values[0]);
+    assert_absent(target, k << 48U);
+  }
+  // Continue the increasing key inserts after the move
+  for (unodb::key k = 1000; k < 2000; ++k)
+    UNODB_ASSERT_TRUE(target.insert(k, test_values[2]));
+  assert_value(target, 1999, test_values[2]);
+}
+
+TEST(ARTMove, Swap) {
+  unodb::db a;
+  unodb::db b{1};
+  // Both insert hints point to their tree roots now
+  UNODB_ASSERT_TRUE(a.insert(1, test_values[0]));
+  UNODB_ASSERT_TRUE(b.insert(2, test_values[1]));
+  UNODB_ASSERT_TRUE(b.insert(3, test_values[1]));
+  const auto a_memory_use = a.get_current_memory_use();
+  const auto b_memory_use = b.get_current_memory_use();
+
+  swap(a, b);
+
+  UNODB_ASSERT_EQ(a.get_current_memory_use(), b_memory_use);
+  UNODB_ASSERT_EQ(b.get_current_memory_use(), a_memory_use);
+  UNODB_ASSERT_TRUE(a.insert(4, test_values[2]));
+  UNODB_ASSERT_TRUE(b.insert(5, test_values[3]));
+  assert_value(a, 2, test_values[1]);
+  assert_value(a, 3, test_values[1]);
+  assert_value(a, 4, test_values[2]);
+  assert_absent(a, 1);
+  assert_absent(a, 5);
+  assert_value(b, 1, test_values[0]);
+  assert_value(b, 5, test_values[3]);
+  assert_absent(b, 2);
+  assert_absent(b, 4);
+  UNODB_ASSERT_EQ(a.get_node_count<unodb::node_type::LEAF>(), 3);
+  UNODB_ASSERT_EQ(b.get_node_count<unodb::node_type::LEAF>(), 2);
+}
+
+UNODB_END_TESTS()
+
+}  // namespace
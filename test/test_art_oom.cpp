@@ -5,6 +5,8 @@
 #include "global.hpp"  // IWYU pragma: keep
 
 #include <new>
+#include <sstream>
+#include <string>
 
 #include <gtest/gtest.h>
 
@@ -99,13 +101,13 @@ TYPED_TEST(ARTOOMTest, SingleNodeTreeEmptyValue) {
   oom_insert_test<TypeParam>(
       2,
       [](unodb::test::tree_verifier<TypeParam>& verifier) {
-        verifier.assert_node_counts({0, 0, 0, 0, 0});
-        verifier.assert_growing_inodes({0, 0, 0, 0});
+        verifier.assert_node_counts({0, 0, 0, 0, 0, 0});
+        verifier.assert_growing_inodes({0, 0, 0, 0, 0});
       },
       1, {},
       [](unodb::test::tree_verifier<TypeParam>& verifier) {
-        verifier.assert_node_counts({1, 0, 0, 0, 0});
-        verifier.assert_growing_inodes({0, 0, 0, 0});
+        verifier.assert_node_counts({1, 0, 0, 0, 0, 0});
+        verifier.assert_growing_inodes({0, 0, 0, 0, 0});
       });
 }
 
@@ -113,13 +115,13 @@ TYPED_TEST(ARTOOMTest, SingleNodeTreeNonemptyValue) {
   oom_insert_test<TypeParam>(
       2,
       [](unodb::test::tree_verifier<TypeParam>& verifier) {
-        verifier.assert_node_counts({0, 0, 0, 0, 0});
-        verifier.assert_growing_inodes({0, 0, 0, 0});
+        verifier.assert_node_counts({0, 0, 0, 0, 0, 0});
+        verifier.assert_growing_inodes({0, 0, 0, 0, 0});
       },
       1, unodb::test::test_values[2],
       [](unodb::test::tree_verifier<TypeParam>& verifier) {
-        verifier.assert_node_counts({1, 0, 0, 0, 0});
-        verifier.assert_growing_inodes({0, 0, 0, 0});
+        verifier.assert_node_counts({1, 0, 0, 0, 0, 0});
+        verifier.assert_growing_inodes({0, 0, 0, 0, 0});
       });
 }
 
@@ -128,13 +130,13 @@ TYPED_TEST(ARTOOMTest, ExpandLeafToNode4) {
       3,
       [](unodb::test::tree_verifier<TypeParam>& verifier) {
         verifier.insert(0, unodb::test::test_values[1]);
-        verifier.assert_node_counts({1, 0, 0, 0, 0});
-        verifier.assert_growing_inodes({0, 0, 0, 0});
+        verifier.assert_node_counts({1, 0, 0, 0, 0, 0});
+        verifier.assert_growing_inodes({0, 0, 0, 0, 0});
       },
       1, unodb::test::test_values[2],
       [](unodb::test::tree_verifier<TypeParam>& verifier) {
-        verifier.assert_node_counts({2, 1, 0, 0, 0});
-        verifier.assert_growing_inodes({1, 0, 0, 0});
+        verifier.assert_node_counts({2, 1, 0, 0, 0, 0});
+        verifier.assert_growing_inodes({1, 0, 0, 0, 0});
       });
 }
 
@@ -144,15 +146,15 @@ TYPED_TEST(ARTOOMTest, TwoNode4) {
       [](unodb::test::tree_verifier<TypeParam>& verifier) {
         verifier.insert(1, unodb::test::test_values[0]);
         verifier.insert(3, unodb::test::test_values[2]);
-        verifier.assert_growing_inodes({1, 0, 0, 0});
-        verifier.assert_node_counts({2, 1, 0, 0, 0});
+        verifier.assert_growing_inodes({1, 0, 0, 0, 0});
+        verifier.assert_node_counts({2, 1, 0, 0, 0, 0});
         verifier.assert_key_prefix_splits(0);
       },
       // Insert a value that does not share full prefix with the current Node4
       0xFF01, unodb::test::test_values[3],
       [](unodb::test::tree_verifier<TypeParam>& verifier) {
-        verifier.assert_node_counts({3, 2, 0, 0, 0});
-        verifier.assert_growing_inodes({2, 0, 0, 0});
+        verifier.assert_node_counts({3, 2, 0, 0, 0, 0});
+        verifier.assert_growing_inodes({2, 0, 0, 0, 0});
         verifier.assert_key_prefix_splits(1);
       });
 }
@@ -165,16 +167,16 @@ TYPED_TEST(ARTOOMTest, DbInsertNodeRecursion) {
         verifier.insert(3, unodb::test::test_values[2]);
         // Insert a value that does not share full prefix with the current Node4
         verifier.insert(0xFF0001, unodb::test::test_values[3]);
-        verifier.assert_node_counts({3, 2, 0, 0, 0});
-        verifier.assert_growing_inodes({2, 0, 0, 0});
+        verifier.assert_node_counts({3, 2, 0, 0, 0, 0});
+        verifier.assert_growing_inodes({2, 0, 0, 0, 0});
         verifier.assert_key_prefix_splits(1);
       },
       // Then insert a value that shares full prefix with the above node and
       // will ask for a recursive insertion there
       0xFF0101, unodb::test::test_values[1],
       [](unodb::test::tree_verifier<TypeParam>& verifier) {
-        verifier.assert_node_counts({4, 3, 0, 0, 0});
-        verifier.assert_growing_inodes({3, 0, 0, 0});
+        verifier.assert_node_counts({4, 3, 0, 0, 0, 0});
+        verifier.assert_growing_inodes({3, 0, 0, 0, 0});
       });
 }
 
@@ -183,13 +185,13 @@ TYPED_TEST(ARTOOMTest, Node16) {
       3,
       [](unodb::test::tree_verifier<TypeParam>& verifier) {
         verifier.insert_key_range(0, 4);
-        verifier.assert_node_counts({4, 1, 0, 0, 0});
-        verifier.assert_growing_inodes({1, 0, 0, 0});
+        verifier.assert_node_counts({4, 1, 0, 0, 0, 0});
+        verifier.assert_growing_inodes({1, 0, 0, 0, 0});
       },
       5, unodb::test::test_values[0],
       [](unodb::test::tree_verifier<TypeParam>& verifier) {
-        verifier.assert_node_counts({5, 0, 1, 0, 0});
-        verifier.assert_growing_inodes({1, 1, 0, 0});
+        verifier.assert_node_counts({5, 0, 1, 0, 0, 0});
+        verifier.assert_growing_inodes({1, 1, 0, 0, 0});
       });
 }
 
@@ -198,48 +200,81 @@ TYPED_TEST(ARTOOMTest, Node16KeyPrefixSplit) {
       3,
       [](unodb::test::tree_verifier<TypeParam>& verifier) {
         verifier.insert_key_range(10, 5);
-        verifier.assert_node_counts({5, 0, 1, 0, 0});
-        verifier.assert_growing_inodes({1, 1, 0, 0});
+        verifier.assert_node_counts({5, 0, 1, 0, 0, 0});
+        verifier.assert_growing_inodes({1, 1, 0, 0, 0});
         verifier.assert_key_prefix_splits(0);
       },
       // Insert a value that does share full prefix with the current Node16
       0x1020, unodb::test::test_values[0],
       [](unodb::test::tree_verifier<TypeParam>& verifier) {
-        verifier.assert_node_counts({6, 1, 1, 0, 0});
-        verifier.assert_growing_inodes({2, 1, 0, 0});
+        verifier.assert_node_counts({6, 1, 1, 0, 0, 0});
+        verifier.assert_growing_inodes({2, 1, 0, 0, 0});
         verifier.assert_key_prefix_splits(1);
       });
 }
 
-TYPED_TEST(ARTOOMTest, Node48) {
+TYPED_TEST(ARTOOMTest, Node32) {
   oom_insert_test<TypeParam>(
       3,
       [](unodb::test::tree_verifier<TypeParam>& verifier) {
         verifier.insert_key_range(0, 16);
-        verifier.assert_node_counts({16, 0, 1, 0, 0});
-        verifier.assert_growing_inodes({1, 1, 0, 0});
+        verifier.assert_node_counts({16, 0, 1, 0, 0, 0});
+        verifier.assert_growing_inodes({1, 1, 0, 0, 0});
       },
       16, unodb::test::test_values[0],
       [](unodb::test::tree_verifier<TypeParam>& verifier) {
-        verifier.assert_node_counts({17, 0, 0, 1, 0});
-        verifier.assert_growing_inodes({1, 1, 1, 0});
+        verifier.assert_node_counts({17, 0, 0, 1, 0, 0});
+        verifier.assert_growing_inodes({1, 1, 1, 0, 0});
       });
 }
 
-TYPED_TEST(ARTOOMTest, Node48KeyPrefixSplit) {
+TYPED_TEST(ARTOOMTest, Node32KeyPrefixSplit) {
   oom_insert_test<TypeParam>(
       3,
       [](unodb::test::tree_verifier<TypeParam>& verifier) {
         verifier.insert_key_range(10, 17);
-        verifier.assert_node_counts({17, 0, 0, 1, 0});
-        verifier.assert_growing_inodes({1, 1, 1, 0});
+        verifier.assert_node_counts({17, 0, 0, 1, 0, 0});
+        verifier.assert_growing_inodes({1, 1, 1, 0, 0});
+        verifier.assert_key_prefix_splits(0);
+      },
+      // Insert a value that does share full prefix with the current Node32
+      0x100020, unodb::test::test_values[0],
+      [](unodb::test::tree_verifier<TypeParam>& verifier) {
+        verifier.assert_node_counts({18, 1, 0, 1, 0, 0});
+        verifier.assert_growing_inodes({2, 1, 1, 0, 0});
+        verifier.assert_key_prefix_splits(1);
+      });
+}
+
+TYPED_TEST(ARTOOMTest, Node48) {
+  oom_insert_test<TypeParam>(
+      3,
+      [](unodb::test::tree_verifier<TypeParam>& verifier) {
+        verifier.insert_key_range(0, 32);
+        verifier.assert_node_counts({32, 0, 0, 1, 0, 0});
+        verifier.assert_growing_inodes({1, 1, 1, 0, 0});
+      },
+      32, unodb::test::test_values[0],
+      [](unodb::test::tree_verifier<TypeParam>& verifier) {
+        verifier.assert_node_counts({33, 0, 0, 0, 1, 0});
+        verifier.assert_growing_inodes({1, 1, 1, 1, 0});
+      });
+}
+
+TYPED_TEST(ARTOOMTest, Node48KeyPrefixSplit) {
+  oom_insert_test<TypeParam>(
+      3,
+      [](unodb::test::tree_verifier<TypeParam>& verifier) {
+        verifier.insert_key_range(10, 33);
+        verifier.assert_node_counts({33, 0, 0, 0, 1, 0});
+        verifier.assert_growing_inodes({1, 1, 1, 1, 0});
         verifier.assert_key_prefix_splits(0);
       },
       // Insert a value that does share full prefix with the current Node48
       0x100020, unodb::test::test_values[0],
       [](unodb::test::tree_verifier<TypeParam>& verifier) {
-        verifier.assert_node_counts({18, 1, 0, 1, 0});
-        verifier.assert_growing_inodes({2, 1, 1, 0});
+        verifier.assert_node_counts({34, 1, 0, 0, 1, 0});
+        verifier.assert_growing_inodes({2, 1, 1, 1, 0});
         verifier.assert_key_prefix_splits(1);
       });
 }
@@ -249,13 +284,13 @@ TYPED_TEST(ARTOOMTest, Node256) {
       3,
       [](unodb::test::tree_verifier<TypeParam>& verifier) {
         verifier.insert_key_range(0, 48);
-        verifier.assert_node_counts({48, 0, 0, 1, 0});
-        verifier.assert_growing_inodes({1, 1, 1, 0});
+        verifier.assert_node_counts({48, 0, 0, 0, 1, 0});
+        verifier.assert_growing_inodes({1, 1, 1, 1, 0});
       },
       49, unodb::test::test_values[0],
       [](unodb::test::tree_verifier<TypeParam>& verifier) {
-        verifier.assert_node_counts({49, 0, 0, 0, 1});
-        verifier.assert_growing_inodes({1, 1, 1, 1});
+        verifier.assert_node_counts({49, 0, 0, 0, 0, 1});
+        verifier.assert_growing_inodes({1, 1, 1, 1, 1});
       });
 }
 
@@ -264,15 +299,15 @@ TYPED_TEST(ARTOOMTest, Node256KeyPrefixSplit) {
       3,
       [](unodb::test::tree_verifier<TypeParam>& verifier) {
         verifier.insert_key_range(20, 49);
-        verifier.assert_node_counts({49, 0, 0, 0, 1});
-        verifier.assert_growing_inodes({1, 1, 1, 1});
+        verifier.assert_node_counts({49, 0, 0, 0, 0, 1});
+        verifier.assert_growing_inodes({1, 1, 1, 1, 1});
         verifier.assert_key_prefix_splits(0);
       },
       // Insert a value that does share full prefix with the current Node48
       0x100020, unodb::test::test_values[0],
       [](unodb::test::tree_verifier<TypeParam>& verifier) {
-        verifier.assert_node_counts({50, 1, 0, 0, 1});
-        verifier.assert_growing_inodes({2, 1, 1, 1});
+        verifier.assert_node_counts({50, 1, 0, 0, 0, 1});
+        verifier.assert_growing_inodes({2, 1, 1, 1, 1});
         verifier.assert_key_prefix_splits(1);
       });
 }
@@ -282,28 +317,43 @@ TYPED_TEST(ARTOOMTest, Node16ShrinkToNode4) {
       2,
       [](unodb::test::tree_verifier<TypeParam>& verifier) {
         verifier.insert_key_range(1, 5);
-        verifier.assert_node_counts({5, 0, 1, 0, 0});
-        verifier.assert_shrinking_inodes({0, 0, 0, 0});
+        verifier.assert_node_counts({5, 0, 1, 0, 0, 0});
+        verifier.assert_shrinking_inodes({0, 0, 0, 0, 0});
       },
       2,
       [](unodb::test::tree_verifier<TypeParam>& verifier) {
-        verifier.assert_shrinking_inodes({0, 1, 0, 0});
-        verifier.assert_node_counts({4, 1, 0, 0, 0});
+        verifier.assert_shrinking_inodes({0, 1, 0, 0, 0});
+        verifier.assert_node_counts({4, 1, 0, 0, 0, 0});
       });
 }
 
-TYPED_TEST(ARTOOMTest, Node48ShrinkToNode16) {
+TYPED_TEST(ARTOOMTest, Node32ShrinkToNode16) {
   oom_remove_test<TypeParam>(
       2,
       [](unodb::test::tree_verifier<TypeParam>& verifier) {
         verifier.insert_key_range(0x80, 17);
-        verifier.assert_node_counts({17, 0, 0, 1, 0});
-        verifier.assert_shrinking_inodes({0, 0, 0, 0});
+        verifier.assert_node_counts({17, 0, 0, 1, 0, 0});
+        verifier.assert_shrinking_inodes({0, 0, 0, 0, 0});
+      },
+      0x85,
+      [](unodb::test::tree_verifier<TypeParam>& verifier) {
+        verifier.assert_shrinking_inodes({0, 0, 1, 0, 0});
+        verifier.assert_node_counts({16, 0, 1, 0, 0, 0});
+      });
+}
+
+TYPED_TEST(ARTOOMTest, Node48ShrinkToNode32) {
+  oom_remove_test<TypeParam>(
+      2,
+      [](unodb::test::tree_verifier<TypeParam>& verifier) {
+        verifier.insert_key_range(0x80, 33);
+        verifier.assert_node_counts({33, 0, 0, 0, 1, 0});
+        verifier.assert_shrinking_inodes({0, 0, 0, 0, 0});
       },
       0x85,
       [](unodb::test::tree_verifier<TypeParam>& verifier) {
-        verifier.assert_shrinking_inodes({0, 0, 1, 0});
-        verifier.assert_node_counts({16, 0, 1, 0, 0});
+        verifier.assert_shrinking_inodes({0, 0, 0, 1, 0});
+        verifier.assert_node_counts({32, 0, 0, 1, 0, 0});
       });
 }
 
@@ -312,16 +362,37 @@ TYPED_TEST(ARTOOMTest, Node256ShrinkToNode48) {
       2,
       [](unodb::test::tree_verifier<TypeParam>& verifier) {
         verifier.insert_key_range(1, 49);
-        verifier.assert_node_counts({49, 0, 0, 0, 1});
-        verifier.assert_shrinking_inodes({0, 0, 0, 0});
+        verifier.assert_node_counts({49, 0, 0, 0, 0, 1});
+        verifier.assert_shrinking_inodes({0, 0, 0, 0, 0});
       },
       25,
       [](unodb::test::tree_verifier<TypeParam>& verifier) {
-        verifier.assert_shrinking_inodes({0, 0, 0, 1});
-        verifier.assert_node_counts({48, 0, 0, 1, 0});
+        verifier.assert_shrinking_inodes({0, 0, 0, 0, 1});
+        verifier.assert_node_counts({48, 0, 0, 0, 1, 0});
       });
 }
 
+TYPED_TEST(ARTOOMTest, SnapshotLoad) {
+  unodb::test::tree_verifier<TypeParam> source;
+  source.insert_key_range(0, 300);
+  std::stringstream snapshot;
+  source.get_db().save(snapshot);
+  const auto snapshot_bytes = snapshot.str();
+
+  // A failed load leaves the tree empty, whichever node it failed on
+  for (unsigned fail_n = 1; fail_n < 300; ++fail_n) {
+    unodb::test::tree_verifier<TypeParam> verifier;
+    verifier.insert_key_range(1000, 10);
+    std::stringstream in{snapshot_bytes};
+
+    unodb::test::allocation_failure_injector::fail_on_nth_allocation(fail_n);
+    UNODB_ASSERT_THROW(verifier.get_db().load(in), std::bad_alloc);
+    unodb::test::allocation_failure_injector::reset();
+
+    verifier.clear();
+  }
+}
+
 }  // namespace
 
 #endif  // #ifndef NDEBUG
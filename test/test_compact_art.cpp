@@ -0,0 +1,155 @@
+// Copyright 2022 Laurynas Biveinis
+
+#include "global.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "art.hpp"
+#include "art_common.hpp"
+#include "compact_art.hpp"
+#include "db_test_utils.hpp"
+#include "gtest_utils.hpp"
+
+namespace {
+
+using unodb::test::test_values;
+
+// Check that compact has exactly the keys of source, which are given
+void assert_same_contents(const unodb::db &source,
+                          const unodb::compact_db &compact,
+                          const std::vector<unodb::key> &keys) {
+  UNODB_ASSERT_EQ(compact.get_key_count(), keys.size());
+  for (const auto k : keys) {
+    const auto expected = source.get(k);
+    UNODB_ASSERT_TRUE(unodb::db::key_found(expected));
+    const auto result = compact.get(k);
+    UNODB_ASSERT_TRUE(unodb::compact_db::key_found(result));
+    UNODB_ASSERT_TRUE(std::equal(std::cbegin(*result), std::cend(*result),
+                                 std::cbegin(*expected),
+                                 std::cend(*expected)));
+  }
+}
+
+UNODB_START_TESTS()
+
+TEST(CompactART, Empty) {
+  const unodb::db source;
+  const unodb::compact_db compact{source};
+
+  UNODB_ASSERT_TRUE(compact.empty());
+  UNODB_ASSERT_EQ(compact.get_current_memory_use(), 0);
+  UNODB_ASSERT_FALSE(unodb::compact_db::key_found(compact.get(0)));
+}
+
+TEST(CompactART, SingleLeaf) {
+  unodb::db source;
+  UNODB_ASSERT_TRUE(source.insert(0x8000000000000001ULL, test_values[3]));
+  const unodb::compact_db compact{source};
+
+  UNODB_ASSERT_FALSE(compact.empty());
+  assert_same_contents(source, compact, {0x8000000000000001ULL});
+  UNODB_ASSERT_FALSE(unodb::compact_db::key_found(compact.get(1)));
+  UNODB_ASSERT_FALSE(
+      unodb::compact_db::key_found(compact.get(0x8000000000000000ULL)));
+}
+
+TEST(CompactART, AllNodeKinds) {
+  unodb::db source;
+  std::vector<unodb::key> keys;
+  const auto insert_range = [&source, &keys](unodb::key start,
+                                             std::uint64_t count) {
+    for (auto k = start; k < start + count; ++k) {
+      UNODB_ASSERT_TRUE(
+          source.insert(k, test_values[k % test_values.size()]));
+      keys.push_back(k);
+    }
+  };
+  insert_range(0, 1);
+  insert_range(0x0102030400000000ULL, 1000);
+  insert_range(0x0200000000000000ULL, 3);
+  insert_range(0x0300000000000000ULL, 16);
+  insert_range(0x0400000000000000ULL, 17);
+  insert_range(0x0500000000000000ULL, 200);
+  insert_range(0xFFFFFFFFFFFFFFFFULL, 1);
+
+  const unodb::compact_db compact{source};
+
+  assert_same_contents(source, compact, keys);
+  // Missing child, key prefix mismatch, and leaf key mismatch
+  for (const unodb::key absent_key :
+       {0x0102030400000000ULL + 1000, 0x0102030500000000ULL,
+        0x0200000000000003ULL, 0x0300000000000010ULL, 0x0400000000000011ULL,
+        0x05000000000000C8ULL, 0x0700000000000000ULL, 0x0000000000000001ULL,
+        0xFFFFFFFFFFFFFFFEULL}) {
+    UNODB_ASSERT_FALSE(unodb::compact_db::key_found(compact.get(absent_key)));
+  }
+}
+
+TEST(CompactART, SparseKeys) {
+  unodb::db source;
+  std::vector<unodb::key> keys;
+  for (std::uint64_t i = 0; i < 10000; ++i) {
+    const auto k = i * 0x9E3779B97F4A7C15ULL;
+    UNODB_ASSERT_TRUE(source.insert(k, test_values[i % test_values.size()]));
+    keys.push_back(k);
+  }
+
+  const unodb::compact_db compact{source};
+
+  assert_same_contents(source, compact, keys);
+  for (std::uint64_t i = 0; i < 10000; ++i) {
+    const auto absent_key = i * 0x9E3779B97F4A7C15ULL + 1;
+    UNODB_ASSERT_FALSE(unodb::compact_db::key_found(compact.get(absent_key)));
+  }
+}
+
+TEST(CompactART, LongValue) {
+  unodb::db source;
+  std::array<std::byte, 300> long_value{};
+  long_value[299] = std::byte{0x42};
+  UNODB_ASSERT_TRUE(source.insert(1, unodb::value_view{long_value}));
+  UNODB_ASSERT_TRUE(source.insert(2, test_values[0]));
+
+  const unodb::compact_db compact{source};
+
+  assert_same_contents(source, compact, {1, 2});
+}
+
+TEST(CompactART, DirectMappedSource) {
+  unodb::db source{2};
+  std::vector<unodb::key> keys;
+  for (unodb::key k = 0; k < 1000; ++k) {
+    const auto spread_key = (k << 48U) | k;
+    UNODB_ASSERT_TRUE(source.insert(spread_key, test_values[1]));
+    keys.push_back(spread_key);
+  }
+
+  const unodb::compact_db compact{source};
+
+  assert_same_contents(source, compact, keys);
+}
+
+TEST(CompactART, LessMemoryThanSource) {
+  unodb::db source;
+  std::vector<unodb::key> keys;
+  for (unodb::key k = 0; k < 100000; ++k) {
+    UNODB_ASSERT_TRUE(source.insert(k, test_values[2]));
+    keys.push_back(k);
+  }
+
+  const unodb::compact_db compact{source};
+
+  assert_same_contents(source, compact, keys);
+  UNODB_ASSERT_LE(compact.get_current_memory_use() * 2,
+                  source.get_current_memory_use());
+}
+
+UNODB_END_TESTS()
+
+}  // namespace
@@ -0,0 +1,213 @@
+// Copyright 2022 Laurynas Biveinis
+
+#include "global.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "art.hpp"
+#include "art_common.hpp"
+#include "db_test_utils.hpp"
+#include "frozen_art.hpp"
+#include "gtest_utils.hpp"
+
+namespace {
+
+using unodb::test::test_values;
+
+// A frozen image of a db, kept in memory
+class [[nodiscard]] frozen_image final {
+ public:
+  explicit frozen_image(const unodb::db &source) {
+    std::ostringstream os;
+    unodb::frozen_db::write(source, os);
+    const auto image_str = os.str();
+    bytes.resize(image_str.size());
+    std::memcpy(bytes.data(), image_str.data(), image_str.size());
+  }
+
+  [[nodiscard]] unodb::value_view view() const noexcept {
+    return unodb::value_view{bytes.data(), bytes.size()};
+  }
+
+  [[nodiscard]] std::vector<std::byte> &get_bytes() noexcept { return bytes; }
+
+ private:
+  std::vector<std::byte> bytes;
+};
+
+void assert_frozen_value_eq(const unodb::frozen_db &frozen, unodb::key k,
+                            unodb::value_view expected) {
+  const auto result = frozen.get(k);
+  UNODB_ASSERT_TRUE(unodb::frozen_db::key_found(result));
+  UNODB_ASSERT_TRUE(std::equal(std::cbegin(*result), std::cend(*result),
+                               std::cbegin(expected), std::cend(expected)));
+}
+
+// Check that frozen has exactly the keys of source, which are given
+void assert_same_contents(const unodb::db &source,
+                          const unodb::frozen_db &frozen,
+                          const std::vector<unodb::key> &keys) {
+  UNODB_ASSERT_EQ(frozen.get_key_count(), keys.size());
+  for (const auto k : keys) {
+    const auto expected = source.get(k);
+    UNODB_ASSERT_TRUE(unodb::db::key_found(expected));
+    assert_frozen_value_eq(frozen, k, *expected);
+  }
+}
+
+UNODB_START_TESTS()
+
+TEST(FrozenART, Empty) {
+  const unodb::db source;
+  const frozen_image image{source};
+  const unodb::frozen_db frozen{image.view()};
+
+  UNODB_ASSERT_TRUE(frozen.empty());
+  UNODB_ASSERT_EQ(frozen.get_key_count(), 0);
+  UNODB_ASSERT_FALSE(unodb::frozen_db::key_found(frozen.get(0)));
+}
+
+TEST(FrozenART, SingleLeaf) {
+  unodb::db source;
+  UNODB_ASSERT_TRUE(source.insert(0x8000000000000001ULL, test_values[0]));
+  const frozen_image image{source};
+  const unodb::frozen_db frozen{image.view()};
+
+  UNODB_ASSERT_FALSE(frozen.empty());
+  assert_same_contents(source, frozen, {0x8000000000000001ULL});
+  UNODB_ASSERT_FALSE(unodb::frozen_db::key_found(frozen.get(1)));
+}
+
+TEST(FrozenART, AllNodeKinds) {
+  unodb::db source;
+  std::vector<unodb::key> keys;
+  const auto insert_range = [&source, &keys](unodb::key start,
+                                             std::uint64_t count) {
+    for (auto k = start; k < start + count; ++k) {
+      UNODB_ASSERT_TRUE(
+          source.insert(k, test_values[k % test_values.size()]));
+      keys.push_back(k);
+    }
+  };
+  // Nodes of every child count class below a key prefix, and full nodes at
+  // the bottom
+  insert_range(0, 1);
+  insert_range(0x0102030400000000ULL, 1000);
+  insert_range(0x0200000000000000ULL, 3);
+  insert_range(0x0300000000000000ULL, 16);
+  insert_range(0x0400000000000000ULL, 17);
+  insert_range(0x0500000000000000ULL, 48);
+  insert_range(0x0600000000000000ULL, 49);
+  insert_range(0xFFFFFFFFFFFFFFFFULL, 1);
+
+  const frozen_image image{source};
+  const unodb::frozen_db frozen{image.view()};
+
+  assert_same_contents(source, frozen, keys);
+  // Missing child, key prefix mismatch, and leaf key mismatch
+  for (const unodb::key absent_key :
+       {0x0102030400000000ULL + 1000, 0x0102030500000000ULL,
+        0x0200000000000003ULL, 0x0300000000000010ULL, 0x0400000000000011ULL,
+        0x0500000000000030ULL, 0x0600000000000031ULL, 0x0700000000000000ULL,
+        0x0000000000000001ULL, 0xFFFFFFFFFFFFFFFEULL}) {
+    UNODB_ASSERT_FALSE(unodb::frozen_db::key_found(frozen.get(absent_key)));
+  }
+}
+
+TEST(FrozenART, SparseKeys) {
+  unodb::db source;
+  std::vector<unodb::key> keys;
+  for (std::uint64_t i = 0; i < 10000; ++i) {
+    const auto k = i * 0x9E3779B97F4A7C15ULL;
+    UNODB_ASSERT_TRUE(source.insert(k, test_values[i % test_values.size()]));
+    keys.push_back(k);
+  }
+
+  const frozen_image image{source};
+  const unodb::frozen_db frozen{image.view()};
+
+  assert_same_contents(source, frozen, keys);
+  for (std::uint64_t i = 0; i < 10000; ++i) {
+    const auto absent_key = i * 0x9E3779B97F4A7C15ULL + 1;
+    UNODB_ASSERT_FALSE(unodb::frozen_db::key_found(frozen.get(absent_key)));
+  }
+}
+
+TEST(FrozenART, DirectMappedSource) {
+  unodb::db source{2};
+  std::vector<unodb::key> keys;
+  for (unodb::key k = 0; k < 1000; ++k) {
+    const auto spread_key = (k << 48U) | k;
+    UNODB_ASSERT_TRUE(source.insert(spread_key, test_values[1]));
+    keys.push_back(spread_key);
+  }
+
+  const frozen_image image{source};
+  const unodb::frozen_db frozen{image.view()};
+
+  assert_same_contents(source, frozen, keys);
+}
+
+TEST(FrozenART, InvalidImage) {
+  unodb::db source;
+  UNODB_ASSERT_TRUE(source.insert(1, test_values[0]));
+  UNODB_ASSERT_TRUE(source.insert(2, test_values[1]));
+  frozen_image image{source};
+  auto &bytes = image.get_bytes();
+
+  UNODB_ASSERT_THROW(
+      unodb::frozen_db{unodb::value_view(bytes.data(), 10)},
+      std::runtime_error);
+  UNODB_ASSERT_THROW(
+      unodb::frozen_db{unodb::value_view(bytes.data(), bytes.size() - 1)},
+      std::runtime_error);
+
+  bytes[0] = std::byte{'x'};
+  UNODB_ASSERT_THROW(unodb::frozen_db{image.view()}, std::runtime_error);
+}
+
+#ifndef _WIN32
+
+TEST(FrozenART, MapFile) {
+  unodb::db source;
+  std::vector<unodb::key> keys;
+  for (unodb::key k = 0; k < 300; ++k) {
+    UNODB_ASSERT_TRUE(source.insert(k * 3, test_values[k % 3]));
+    keys.push_back(k * 3);
+  }
+  const auto path = ::testing::TempDir() + "unodb_test_frozen_image";
+  {
+    std::ofstream os{path, std::ios::binary};
+    unodb::frozen_db::write(source, os);
+    UNODB_ASSERT_TRUE(os.good());
+  }
+
+  const unodb::frozen_db frozen{path.c_str()};
+
+  assert_same_contents(source, frozen, keys);
+  UNODB_ASSERT_FALSE(unodb::frozen_db::key_found(frozen.get(1)));
+  std::remove(path.c_str());
+}
+
+TEST(FrozenART, MapMissingFile) {
+  UNODB_ASSERT_THROW(unodb::frozen_db{"/nonexistent/unodb_frozen_image"},
+                     std::system_error);
+}
+
+#endif  // #ifndef _WIN32
+
+UNODB_END_TESTS()
+
+}  // namespace
@@ -0,0 +1,441 @@
+// Copyright 2022 Laurynas Biveinis
+
+#include "global.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <ios>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <tuple>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "art.hpp"
+#include "art_common.hpp"
+#include "db_test_utils.hpp"
+#include "gtest_utils.hpp"
+#include "mutex_art.hpp"
+#include "olc_art.hpp"
+#include "qsbr.hpp"
+#include "wal.hpp"
+
+namespace {
+
+using unodb::test::test_values;
+
+class WALTest : public ::testing::TestWithParam<unodb::wal_durability> {
+ protected:
+  WALTest() = default;
+
+  ~WALTest() override { std::remove(path.c_str()); }
+
+  [[nodiscard]] std::string read_log() const {
+    std::ifstream is{path, std::ios::binary};
+    std::ostringstream contents;
+    contents << is.rdbuf();
+    return contents.str();
+  }
+
+  template <class Db>
+  void replay(Db &target) const {
+    std::istringstream is{read_log()};
+    target.replay(is);
+  }
+
+  const std::string path{::testing::TempDir() + "unodb_test_wal"};
+};
+
+// Check that the trees have exactly the given keys with the same values
+template <class Db>
+void assert_same_contents(const unodb::db &expected, const Db &actual,
+                          const std::vector<unodb::key> &keys) {
+  std::uint64_t expected_count = 0;
+  for (const auto k : keys) {
+    const auto expected_value = expected.get(k);
+    const auto actual_value = actual.get(k);
+    UNODB_ASSERT_EQ(unodb::db::key_found(expected_value),
+                    Db::key_found(actual_value));
+    if (!unodb::db::key_found(expected_value)) continue;
+    ++expected_count;
+    UNODB_ASSERT_TRUE(std::equal(
+        std::cbegin(*expected_value), std::cend(*expected_value),
+        std::cbegin(*actual_value), std::cend(*actual_value)));
+  }
+  UNODB_ASSERT_EQ(actual.template get_node_count<unodb::node_type::LEAF>(),
+                  expected_count);
+}
+
+UNODB_START_TESTS()
+
+TEST_P(WALTest, EmptyLog) {
+  {
+    const unodb::write_ahead_log log{path.c_str(), GetParam()};
+  }
+  unodb::db replayed;
+  UNODB_ASSERT_TRUE(replayed.insert(1, test_values[0]));
+
+  replay(replayed);
+
+  UNODB_ASSERT_TRUE(replayed.empty());
+}
+
+TEST_P(WALTest, ReplayDb) {
+  unodb::db test_db;
+  std::vector<unodb::key> keys;
+  {
+    unodb::write_ahead_log log{path.c_str(), GetParam()};
+    test_db.attach_log(&log);
+    for (unodb::key k = 0; k < 1000; ++k) {
+      UNODB_ASSERT_TRUE(test_db.insert(k * 7, test_values[k % 5]));
+      keys.push_back(k * 7);
+    }
+    // Failed operations are not logged
+    UNODB_ASSERT_FALSE(test_db.insert(0, test_values[1]));
+    UNODB_ASSERT_FALSE(test_db.remove(1));
+    for (unodb::key k = 0; k < 1000; k += 3)
+      UNODB_ASSERT_TRUE(test_db.remove(k * 7));
+    // Reinsert some removed keys with different values
+    for (unodb::key k = 0; k < 1000; k += 9)
+      UNODB_ASSERT_TRUE(test_db.insert(k * 7, test_values[4]));
+
+    if (GetParam() == unodb::wal_durability::PER_OPERATION) {
+      UNODB_ASSERT_EQ(log.get_sync_count(), 1000 + 334 + 112);
+      UNODB_ASSERT_EQ(log.get_durable_lsn(), log.get_appended_lsn());
+    }
+    test_db.attach_log(nullptr);
+    UNODB_ASSERT_TRUE(test_db.insert(1, test_values[0]));
+    UNODB_ASSERT_TRUE(test_db.remove(1));
+  }
+
+  unodb::db replayed;
+  replay(replayed);
+
+  assert_same_contents(test_db, replayed, keys);
+}
+
+TEST_P(WALTest, ReplayDirectMapped) {
+  unodb::db test_db{2};
+  std::vector<unodb::key> keys;
+  {
+    unodb::write_ahead_log log{path.c_str(), GetParam()};
+    test_db.attach_log(&log);
+    for (unodb::key k = 0; k < 500; ++k) {
+      const auto spread_key = (k << 48U) | k;
+      UNODB_ASSERT_TRUE(test_db.insert(spread_key, test_values[k % 5]));
+      keys.push_back(spread_key);
+    }
+  }
+
+  unodb::db replayed{2};
+  replay(replayed);
+
+  assert_same_contents(test_db, replayed, keys);
+}
+
+TEST_P(WALTest, ReplayMutexDb) {
+  {
+    unodb::mutex_db test_db;
+    unodb::write_ahead_log log{path.c_str(), GetParam()};
+    test_db.attach_log(&log);
+    for (unodb::key k = 0; k < 100; ++k)
+      UNODB_ASSERT_TRUE(test_db.insert(k, test_values[k % 5]));
+    UNODB_ASSERT_TRUE(test_db.remove(50));
+  }
+
+  unodb::mutex_db replayed;
+  replay(replayed);
+
+  for (unodb::key k = 0; k < 100; ++k) {
+    const auto result = replayed.get(k);
+    UNODB_ASSERT_EQ(unodb::mutex_db::key_found(result), k != 50);
+  }
+  UNODB_ASSERT_EQ(replayed.get_node_count<unodb::node_type::LEAF>(), 99);
+}
+
+TEST_P(WALTest, ReplayOlcDbConcurrent) {
+  constexpr std::size_t thread_count = 4;
+  constexpr unodb::key keys_per_thread = 500;
+
+  {
+    unodb::olc_db test_db;
+    {
+      unodb::write_ahead_log log{path.c_str(), GetParam()};
+      test_db.attach_log(&log);
+      // Each thread inserts and removes its own keys and a shared key range,
+      // so that the same keys are modified by several threads
+      unodb::this_thread().qsbr_pause();
+      std::array<unodb::qsbr_thread, thread_count> threads;
+      for (std::size_t i = 0; i < thread_count; ++i) {
+        threads[i] = unodb::qsbr_thread{[&test_db, i] {
+          for (unodb::key k = 0; k < keys_per_thread; ++k) {
+            const auto own_key = 1000000 + i * keys_per_thread + k;
+            std::ignore = test_db.insert(own_key, test_values[i]);
+            if (k % 2 == 0) std::ignore = test_db.remove(own_key);
+            std::ignore = test_db.insert(k, test_values[i]);
+            if (k % 3 == 0) std::ignore = test_db.remove(k);
+            unodb::this_thread().quiescent();
+          }
+        }};
+      }
+      for (auto &t : threads) t.join();
+      unodb::this_thread().qsbr_resume();
+    }
+
+    unodb::db expected;
+    std::vector<unodb::key> keys;
+    for (unodb::key k = 0; k < keys_per_thread; ++k) keys.push_back(k);
+    for (unodb::key k = 0; k < thread_count * keys_per_thread; ++k)
+      keys.push_back(1000000 + k);
+    for (const auto k : keys) {
+      const auto value = test_db.get(k);
+      if (!unodb::olc_db::key_found(value)) continue;
+      const std::vector<std::byte> value_copy{std::cbegin(*value),
+                                              std::cend(*value)};
+      UNODB_ASSERT_TRUE(expected.insert(k, unodb::value_view{value_copy}));
+    }
+
+    unodb::db replayed;
+    replay(replayed);
+    assert_same_contents(expected, replayed, keys);
+
+    unodb::olc_db replayed_olc;
+    replay(replayed_olc);
+    assert_same_contents(expected, replayed_olc, keys);
+  }
+  unodb::this_thread().quiescent();
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    WAL, WALTest,
+    ::testing::Values(unodb::wal_durability::PER_OPERATION,
+                      unodb::wal_durability::GROUP,
+                      unodb::wal_durability::ASYNC));
+
+TEST(WAL, ReplayOlcDbPermanentRoot) {
+  const auto path = ::testing::TempDir() + "unodb_test_wal_permanent_root";
+  {
+    unodb::db source;
+    unodb::write_ahead_log log{path.c_str(), unodb::wal_durability::GROUP};
+    source.attach_log(&log);
+    for (unodb::key k = 0; k < 200; ++k)
+      UNODB_ASSERT_TRUE(source.insert(k << 56U | k, test_values[k % 5]));
+  }
+
+  {
+    unodb::olc_db replayed{unodb::olc_db::root_node::PERMANENT_I256};
+    std::ifstream is{path, std::ios::binary};
+    replayed.replay(is);
+
+    UNODB_ASSERT_EQ(replayed.get_node_count<unodb::node_type::LEAF>(), 200);
+    for (unodb::key k = 0; k < 200; ++k)
+      UNODB_ASSERT_TRUE(unodb::olc_db::key_found(replayed.get(k << 56U | k)));
+  }
+  unodb::this_thread().quiescent();
+  std::remove(path.c_str());
+}
+
+// A crash while appending leaves the last record incomplete or damaged
+TEST(WAL, TornTail) {
+  const auto path = ::testing::TempDir() + "unodb_test_wal_torn";
+  {
+    unodb::db source;
+    unodb::write_ahead_log log{path.c_str(),
+                               unodb::wal_durability::PER_OPERATION};
+    source.attach_log(&log);
+    UNODB_ASSERT_TRUE(source.insert(1, test_values[0]));
+    UNODB_ASSERT_TRUE(source.insert(2, test_values[3]));
+  }
+  std::string contents;
+  {
+    std::ifstream is{path, std::ios::binary};
+    std::ostringstream os;
+    os << is.rdbuf();
+    contents = os.str();
+  }
+  std::remove(path.c_str());
+
+  // The last record has the size and hash fields, the type byte, the key, and
+  // the value
+  const auto last_record_size = 17 + test_values[3].size();
+  for (std::size_t cut = 1; cut < last_record_size; ++cut) {
+    std::istringstream is{contents.substr(0, contents.size() - cut)};
+    unodb::db replayed;
+    replayed.replay(is);
+    UNODB_ASSERT_EQ(replayed.get_node_count<unodb::node_type::LEAF>(), 1);
+    UNODB_ASSERT_TRUE(unodb::db::key_found(replayed.get(1)));
+  }
+
+  auto damaged = contents;
+  damaged.back() = static_cast<char>(damaged.back() ^ 1);
+  std::istringstream is{damaged};
+  unodb::db replayed;
+  replayed.replay(is);
+  UNODB_ASSERT_EQ(replayed.get_node_count<unodb::node_type::LEAF>(), 1);
+}
+
+TEST(WAL, InvalidLog) {
+  unodb::db replayed;
+  UNODB_ASSERT_TRUE(replayed.insert(1, test_values[0]));
+  std::istringstream not_a_log{"unodbsnp"};
+
+  UNODB_ASSERT_THROW(replayed.replay(not_a_log), std::runtime_error);
+
+  UNODB_ASSERT_TRUE(replayed.empty());
+}
+
+// Checkpoint a tree while other threads keep modifying it, with the log
+// attached only after the initial keys were inserted, so that the recovery
+// needs both
+TEST(WAL, OlcCheckpointWithConcurrentWriters) {
+  constexpr std::size_t thread_count = 4;
+  constexpr unodb::key initial_key_count = 20000;
+  constexpr unodb::key own_key_base = 1000000;
+  constexpr unodb::key own_keys_per_thread = 1000;
+  const auto path = ::testing::TempDir() + "unodb_test_wal_checkpoint";
+  std::stringstream checkpoint;
+  std::uint64_t start_lsn;
+
+  {
+    unodb::olc_db test_db;
+    for (unodb::key k = 0; k < initial_key_count; ++k)
+      UNODB_ASSERT_TRUE(test_db.insert(k, test_values[k % 5]));
+    {
+      unodb::write_ahead_log log{path.c_str(), unodb::wal_durability::ASYNC};
+      test_db.attach_log(&log);
+
+      // Each thread toggles its own keys and a part of the initial ones until
+      // the checkpoint is done
+      std::atomic<bool> checkpoint_done{false};
+      std::array<unodb::qsbr_thread, thread_count> threads;
+      for (std::size_t i = 0; i < thread_count; ++i) {
+        threads[i] = unodb::qsbr_thread{[&test_db, &checkpoint_done, i] {
+          do {
+            for (unodb::key k = 0; k < own_keys_per_thread; ++k) {
+              const auto own_key = own_key_base + i * own_keys_per_thread + k;
+              if (!test_db.insert(own_key, test_values[i]))
+                std::ignore = test_db.remove(own_key);
+              const auto initial_key =
+                  (k * 7 * thread_count + i) % initial_key_count;
+              if (!test_db.remove(initial_key))
+                std::ignore = test_db.insert(initial_key, test_values[4 - i]);
+              unodb::this_thread().quiescent();
+            }
+          } while (!checkpoint_done.load(std::memory_order_acquire));
+        }};
+      }
+
+      start_lsn = test_db.checkpoint(checkpoint);
+      checkpoint_done.store(true, std::memory_order_release);
+      for (auto &t : threads) t.join();
+
+      UNODB_ASSERT_TRUE(log.get_durable_lsn() >= start_lsn);
+      test_db.attach_log(nullptr);
+    }
+
+    unodb::db expected;
+    std::vector<unodb::key> keys;
+    for (unodb::key k = 0; k < initial_key_count; ++k) keys.push_back(k);
+    for (unodb::key k = 0; k < thread_count * own_keys_per_thread; ++k)
+      keys.push_back(own_key_base + k);
+    for (const auto k : keys) {
+      const auto value = test_db.get(k);
+      if (!unodb::olc_db::key_found(value)) continue;
+      const std::vector<std::byte> value_copy{std::cbegin(*value),
+                                              std::cend(*value)};
+      UNODB_ASSERT_TRUE(expected.insert(k, unodb::value_view{value_copy}));
+    }
+
+    unodb::db replayed;
+    {
+      std::ifstream log_is{path, std::ios::binary};
+      checkpoint.seekg(0);
+      replayed.replay(checkpoint, log_is, start_lsn);
+    }
+    assert_same_contents(expected, replayed, keys);
+
+    unodb::olc_db replayed_olc{unodb::olc_db::root_node::PERMANENT_I256};
+    {
+      std::ifstream log_is{path, std::ios::binary};
+      checkpoint.seekg(0);
+      replayed_olc.replay(checkpoint, log_is, start_lsn);
+    }
+    assert_same_contents(expected, replayed_olc, keys);
+  }
+  unodb::this_thread().quiescent();
+  std::remove(path.c_str());
+}
+
+// Without concurrent writers, a checkpoint is a snapshot
+TEST(WAL, OlcCheckpointDirectMapped) {
+  {
+    unodb::olc_db test_db{1};
+    std::vector<unodb::key> keys;
+    unodb::db expected;
+    for (unodb::key k = 0; k < 3000; ++k) {
+      const auto spread_key = (k << 52U) | (k * 31);
+      UNODB_ASSERT_TRUE(test_db.insert(spread_key, test_values[k % 5]));
+      UNODB_ASSERT_TRUE(expected.insert(spread_key, test_values[k % 5]));
+      keys.push_back(spread_key);
+    }
+    std::stringstream checkpoint;
+
+    UNODB_ASSERT_EQ(test_db.checkpoint(checkpoint), 0);
+
+    checkpoint.seekg(0);
+    unodb::db loaded;
+    loaded.load(checkpoint);
+    assert_same_contents(expected, loaded, keys);
+  }
+  unodb::this_thread().quiescent();
+}
+
+TEST(WAL, CheckpointAfterLogEnd) {
+  const auto path = ::testing::TempDir() + "unodb_test_wal_short";
+  std::stringstream checkpoint;
+  std::uint64_t start_lsn;
+  {
+    unodb::olc_db test_db;
+    unodb::write_ahead_log log{path.c_str(), unodb::wal_durability::GROUP};
+    test_db.attach_log(&log);
+    UNODB_ASSERT_TRUE(test_db.insert(1, test_values[0]));
+    start_lsn = test_db.checkpoint(checkpoint);
+    test_db.attach_log(nullptr);
+  }
+  unodb::this_thread().quiescent();
+
+  std::istringstream empty_log;
+  {
+    std::ifstream is{path, std::ios::binary};
+    std::ostringstream os;
+    os << is.rdbuf();
+    empty_log.str(os.str().substr(0, 16));
+  }
+  std::remove(path.c_str());
+  unodb::db replayed;
+  checkpoint.seekg(0);
+
+  UNODB_ASSERT_THROW(replayed.replay(checkpoint, empty_log, start_lsn),
+                     std::runtime_error);
+
+  UNODB_ASSERT_TRUE(replayed.empty());
+}
+
+TEST(WAL, CreateInMissingDirectory) {
+  UNODB_ASSERT_THROW(
+      (unodb::write_ahead_log{"/nonexistent/unodb_wal",
+                              unodb::wal_durability::GROUP}),
+      std::system_error);
+}
+
+UNODB_END_TESTS()
+
+}  // namespace
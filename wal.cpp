@@ -0,0 +1,404 @@
+// Copyright 2022 Laurynas Biveinis
+
+#include "global.hpp"  // IWYU pragma: keep
+
+#include "wal.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <limits>
+#include <stdexcept>
+#include <system_error>
+#include <tuple>
+
+#include <fcntl.h>
+#ifdef _WIN32
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "assert.hpp"
+#include "snapshot.hpp"
+
+namespace {
+
+constexpr std::array<char, 8> wal_magic{'u', 'n', 'o', 'd',
+                                        'b', 'w', 'a', 'l'};
+
+constexpr std::size_t header_size =
+    wal_magic.size() + sizeof(unodb::write_ahead_log::version) +
+    sizeof(std::uint32_t);
+
+constexpr std::size_t record_header_size = 2 * sizeof(std::uint32_t);
+
+constexpr std::size_t record_fixed_payload_size = 1 + sizeof(unodb::key);
+
+constexpr std::uint8_t insert_record = 1;
+constexpr std::uint8_t remove_record = 2;
+
+// FNV-1a, continuing from hash
+[[nodiscard]] std::uint32_t fnv1a(const std::byte *data, std::size_t size,
+                                  std::uint32_t hash = 2166136261U) noexcept {
+  for (std::size_t i = 0; i < size; ++i) {
+    hash ^= static_cast<std::uint8_t>(data[i]);
+    hash *= 16777619U;
+  }
+  return hash;
+}
+
+[[nodiscard]] int open_log_file(const char *path) noexcept {
+#ifdef _WIN32
+  return _open(path, _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY,
+               _S_IREAD | _S_IWRITE);
+#else
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-vararg,hicpp-vararg)
+  return open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+#endif
+}
+
+void close_log_file(int fd) noexcept {
+#ifdef _WIN32
+  _close(fd);
+#else
+  close(fd);
+#endif
+}
+
+// Write all the data and make it durable, returning the error if any
+[[nodiscard]] std::error_code write_and_sync(int fd, const std::byte *data,
+                                             std::size_t size) noexcept {
+  while (size > 0) {
+#ifdef _WIN32
+    const auto chunk = static_cast<unsigned>(
+        std::min<std::size_t>(size, std::numeric_limits<int>::max()));
+    const auto written = _write(fd, data, chunk);
+#else
+    const auto written = write(fd, data, size);
+#endif
+    if (UNODB_DETAIL_UNLIKELY(written < 0)) {
+      if (errno == EINTR) continue;
+      return {errno, std::generic_category()};
+    }
+    data += written;
+    size -= static_cast<std::size_t>(written);
+  }
+
+#if defined(_WIN32)
+  const auto sync_result = _commit(fd);
+#elif defined(__APPLE__)
+  const auto sync_result = fsync(fd);
+#else
+  const auto sync_result = fdatasync(fd);
+#endif
+  if (UNODB_DETAIL_UNLIKELY(sync_result != 0))
+    return {errno, std::generic_category()};
+  return {};
+}
+
+[[noreturn, gnu::cold]] UNODB_DETAIL_NOINLINE void throw_invalid_log() {
+  throw std::runtime_error("Invalid unodb write-ahead log record");
+}
+
+}  // namespace
+
+namespace unodb {
+
+write_ahead_log::write_ahead_log(const char *path, wal_durability durability_,
+                                 std::chrono::milliseconds async_sync_period_)
+    : durability{durability_},
+      async_sync_period{async_sync_period_},
+      fd{open_log_file(path)},
+      appended_lsn{header_size},
+      durable_lsn{header_size} {
+  if (UNODB_DETAIL_UNLIKELY(fd == -1))
+    throw std::system_error{errno, std::generic_category(), path};
+
+  std::array<char, header_size> header{};
+  auto *out = std::copy(wal_magic.cbegin(), wal_magic.cend(), header.begin());
+  std::ignore = detail::put_little_endian(out, version);
+  const auto error = write_and_sync(
+      fd, reinterpret_cast<const std::byte *>(header.data()), header.size());
+  if (UNODB_DETAIL_UNLIKELY(static_cast<bool>(error))) {
+    close_log_file(fd);
+    throw std::system_error{error, path};
+  }
+
+  if (durability == wal_durability::ASYNC) {
+    try {
+      async_sync_thread = std::thread{[this] { async_sync_loop(); }};
+    } catch (...) {
+      close_log_file(fd);
+      throw;
+    }
+  }
+}
+
+write_ahead_log::~write_ahead_log() noexcept {
+  if (async_sync_thread.joinable()) {
+    {
+      const std::lock_guard guard{mutex};
+      stopping = true;
+    }
+    async_wakeup.notify_one();
+    async_sync_thread.join();
+  }
+
+  try {
+    sync();
+  } catch (...) {  // NOLINT(bugprone-empty-catch)
+  }
+  close_log_file(fd);
+}
+
+std::uint64_t write_ahead_log::append_insert(key k, value_view v) {
+  return append(insert_record, k, v);
+}
+
+std::uint64_t write_ahead_log::append_remove(key k) {
+  return append(remove_record, k, value_view{});
+}
+
+std::uint64_t write_ahead_log::append(std::uint8_t type, key k,
+                                      value_view v) {
+  UNODB_DETAIL_ASSERT(v.size() <= std::numeric_limits<std::uint32_t>::max() -
+                                      record_fixed_payload_size);
+
+  std::array<char, record_header_size + record_fixed_payload_size> fixed;
+  auto *const payload = fixed.data() + record_header_size;
+  payload[0] = static_cast<char>(type);
+  std::ignore = detail::put_little_endian(payload + 1, k);
+  auto hash = fnv1a(reinterpret_cast<const std::byte *>(payload),
+                    record_fixed_payload_size);
+  if (!v.empty()) hash = fnv1a(v.data(), v.size(), hash);
+  auto *out = detail::put_little_endian(
+      fixed.data(),
+      static_cast<std::uint32_t>(record_fixed_payload_size + v.size()));
+  std::ignore = detail::put_little_endian(out, hash);
+
+  const auto *const fixed_bytes =
+      reinterpret_cast<const std::byte *>(fixed.data());
+
+  const std::lock_guard guard{mutex};
+  throw_if_failed();
+
+  buffer.insert(buffer.cend(), fixed_bytes, fixed_bytes + fixed.size());
+  buffer.insert(buffer.cend(), v.cbegin(), v.cend());
+  appended_lsn += fixed.size() + v.size();
+
+  if (durability == wal_durability::PER_OPERATION) {
+    // Keep the mutex for the sync so that it covers this record only
+    const auto error = write_and_sync(fd, buffer.data(), buffer.size());
+    buffer.clear();
+    if (UNODB_DETAIL_UNLIKELY(static_cast<bool>(error))) {
+      write_error = error;
+      throw_if_failed();
+    }
+    durable_lsn = appended_lsn;
+    ++sync_count;
+  }
+
+  return appended_lsn;
+}
+
+void write_ahead_log::commit(std::uint64_t lsn) {
+  if (durability != wal_durability::GROUP) return;
+
+  std::unique_lock lock{mutex};
+  while (durable_lsn < lsn) {
+    throw_if_failed();
+    if (write_in_progress) {
+      // The write in progress may or may not have this record
+      synced.wait(lock);
+    } else {
+      write_buffered(lock);
+    }
+  }
+}
+
+void write_ahead_log::sync() {
+  std::unique_lock lock{mutex};
+  while (durable_lsn < appended_lsn) {
+    throw_if_failed();
+    if (write_in_progress) {
+      synced.wait(lock);
+    } else {
+      write_buffered(lock);
+    }
+  }
+}
+
+void write_ahead_log::write_buffered(std::unique_lock<std::mutex> &lock) {
+  UNODB_DETAIL_ASSERT(lock.owns_lock());
+  UNODB_DETAIL_ASSERT(!write_in_progress);
+
+  write_in_progress = true;
+  write_buffer.clear();
+  write_buffer.swap(buffer);
+  const auto target_lsn = appended_lsn;
+
+  lock.unlock();
+  const auto error =
+      write_and_sync(fd, write_buffer.data(), write_buffer.size());
+  lock.lock();
+
+  write_in_progress = false;
+  if (UNODB_DETAIL_UNLIKELY(static_cast<bool>(error))) {
+    write_error = error;
+  } else {
+    durable_lsn = target_lsn;
+    ++sync_count;
+  }
+  synced.notify_all();
+}
+
+void write_ahead_log::throw_if_failed() const {
+  if (UNODB_DETAIL_UNLIKELY(static_cast<bool>(write_error)))
+    throw std::system_error{write_error, "unodb write-ahead log"};
+}
+
+void write_ahead_log::async_sync_loop() {
+  std::unique_lock lock{mutex};
+  while (!stopping) {
+    async_wakeup.wait_for(lock, async_sync_period);
+    if (!write_in_progress && !write_error && durable_lsn < appended_lsn)
+      write_buffered(lock);
+  }
+}
+
+std::uint64_t write_ahead_log::get_appended_lsn() const {
+  const std::lock_guard guard{mutex};
+  return appended_lsn;
+}
+
+std::uint64_t write_ahead_log::get_durable_lsn() const {
+  const std::lock_guard guard{mutex};
+  return durable_lsn;
+}
+
+std::uint64_t write_ahead_log::get_sync_count() const {
+  const std::lock_guard guard{mutex};
+  return sync_count;
+}
+
+namespace detail {
+
+wal_replay_reader::wal_replay_reader(std::istream &is) {
+  read_log(is, 0);
+  merge_entries();
+}
+
+wal_replay_reader::wal_replay_reader(std::istream &snapshot_is,
+                                     std::istream &log_is,
+                                     std::uint64_t start_lsn) {
+  // The snapshot entries go first, so that the log entries of the same keys
+  // override them
+  snapshot_reader snapshot{snapshot_is};
+  while (snapshot.next()) {
+    const auto v = snapshot.get_value();
+    entries.push_back({snapshot.get_key(), values.size(), v.size(), true});
+    values.insert(values.cend(), v.cbegin(), v.cend());
+  }
+  read_log(log_is, start_lsn);
+  merge_entries();
+}
+
+void wal_replay_reader::read_log(std::istream &is, std::uint64_t start_lsn) {
+  std::array<char, header_size> header;
+  is.read(header.data(), header.size());
+  if (is.gcount() != static_cast<std::streamsize>(header.size()) ||
+      !std::equal(wal_magic.cbegin(), wal_magic.cend(), header.cbegin())) {
+    throw std::runtime_error("Not a unodb write-ahead log");
+  }
+  if (get_little_endian<std::uint32_t>(header.data() + wal_magic.size()) !=
+      write_ahead_log::version)
+    throw std::runtime_error("Unsupported unodb write-ahead log version");
+
+  std::uint64_t lsn = header_size;
+  while (true) {
+    std::array<char, record_header_size> record_header;
+    is.read(record_header.data(), record_header.size());
+    if (is.gcount() != static_cast<std::streamsize>(record_header.size()))
+      break;
+    const auto payload_size =
+        get_little_endian<std::uint32_t>(record_header.data());
+    if (payload_size < record_fixed_payload_size) break;
+
+    // Read the payload in chunks, so that a garbage size at the end of the log
+    // does not allocate more than the log has
+    const auto payload_offset = values.size();
+    std::size_t read_size = 0;
+    while (read_size < payload_size) {
+      constexpr std::size_t max_chunk_size = 1U << 16U;
+      const auto chunk_size =
+          std::min<std::size_t>(payload_size - read_size, max_chunk_size);
+      values.resize(payload_offset + read_size + chunk_size);
+      is.read(reinterpret_cast<char *>(values.data() + payload_offset +
+                                       read_size),
+              static_cast<std::streamsize>(chunk_size));
+      read_size += static_cast<std::size_t>(is.gcount());
+      if (is.gcount() != static_cast<std::streamsize>(chunk_size)) break;
+    }
+
+    const auto *const payload = values.data() + payload_offset;
+    if (read_size != payload_size ||
+        fnv1a(payload, payload_size) !=
+            get_little_endian<std::uint32_t>(record_header.data() +
+                                             sizeof(std::uint32_t))) {
+      values.resize(payload_offset);
+      break;
+    }
+
+    const auto type = static_cast<std::uint8_t>(payload[0]);
+    if (UNODB_DETAIL_UNLIKELY(type != insert_record && type != remove_record))
+      throw_invalid_log();
+    if (UNODB_DETAIL_UNLIKELY(type == remove_record &&
+                              payload_size != record_fixed_payload_size))
+      throw_invalid_log();
+
+    lsn += record_header_size + payload_size;
+    if (lsn <= start_lsn) {
+      values.resize(payload_offset);
+      continue;
+    }
+    const auto k = get_little_endian<key>(
+        reinterpret_cast<const char *>(payload) + 1);
+    entries.push_back({k, payload_offset + record_fixed_payload_size,
+                       payload_size - record_fixed_payload_size,
+                       type == insert_record});
+  }
+
+  if (UNODB_DETAIL_UNLIKELY(lsn < start_lsn))
+    throw std::runtime_error(
+        "unodb write-ahead log ends before its checkpoint");
+}
+
+void wal_replay_reader::merge_entries() {
+  std::stable_sort(
+      entries.begin(), entries.end(),
+      [](const entry &a, const entry &b) noexcept { return a.k < b.k; });
+  std::size_t last_i = 0;
+  for (std::size_t i = 0; i < entries.size(); ++i) {
+    if (i + 1 < entries.size() && entries[i + 1].k == entries[i].k) continue;
+    if (entries[i].present) entries[last_i++] = entries[i];
+  }
+  entries.resize(last_i);
+}
+
+bool wal_replay_reader::next() noexcept {
+  if (started) {
+    ++current;
+  } else {
+    started = true;
+  }
+  return current < entries.size();
+}
+
+}  // namespace detail
+
+}  // namespace unodb
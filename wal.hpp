@@ -0,0 +1,206 @@
+// Copyright 2022 Laurynas Biveinis
+#ifndef UNODB_DETAIL_WAL_HPP
+#define UNODB_DETAIL_WAL_HPP
+
+#include "global.hpp"
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "art_common.hpp"
+#include "portability_arch.hpp"
+
+namespace unodb {
+
+// When the logged operations become durable
+enum class wal_durability : std::uint8_t {
+  // Every operation writes and syncs its own log record before returning
+  PER_OPERATION,
+  // Every operation waits until its log record is synced, and a single sync
+  // covers the records of all the operations waiting meanwhile
+  GROUP,
+  // Operations return as soon as their log records are buffered, and a
+  // background thread writes and syncs them periodically. A crash loses the
+  // operations of the last period.
+  ASYNC
+};
+
+// An append-only redo log of the successful inserts and removes of a tree it is
+// attached to, to recover the tree after a crash by replaying the log. The file
+// format is:
+// - 8 magic bytes "unodbwal"
+// - format version, 4 bytes, little-endian
+// - 4 reserved bytes
+// - for each operation: the payload size and its FNV-1a hash, both 4 bytes,
+//   little-endian, and the payload: the operation type byte, the key, 8 bytes,
+//   little-endian, and, for inserts, the value bytes.
+// A record truncated or damaged by a crash ends the log.
+class write_ahead_log final {
+ public:
+  // The version of the log file format
+  static constexpr std::uint32_t version = 1;
+
+  // Create a new log at path, truncating any existing file. For ASYNC
+  // durability, async_sync_period is the period of the background sync. Throws
+  // std::system_error on file errors.
+  write_ahead_log(const char *path, wal_durability durability_,
+                  std::chrono::milliseconds async_sync_period =
+                      std::chrono::milliseconds{10});
+
+  // Write and sync the remaining records, ignoring any errors
+  ~write_ahead_log() noexcept;
+
+  write_ahead_log(const write_ahead_log &) = delete;
+  write_ahead_log(write_ahead_log &&) = delete;
+  write_ahead_log &operator=(const write_ahead_log &) = delete;
+  write_ahead_log &operator=(write_ahead_log &&) = delete;
+
+  // Append a record of a successful operation, returning its log sequence
+  // number, which is the log size with the record. With PER_OPERATION
+  // durability, also write and sync it. All the appends of the same key must
+  // be serialized with their operations, for example by holding
+  // key_order_mutex. Throws std::system_error if writing the log has failed.
+  [[nodiscard]] std::uint64_t append_insert(key k, value_view v);
+
+  [[nodiscard]] std::uint64_t append_remove(key k);
+
+  // Return once the record of lsn is durable as requested at the construction
+  void commit(std::uint64_t lsn);
+
+  // Write and sync all the appended records
+  void sync();
+
+  // The mutex serializing the operations on the keys that share its stripe
+  // with k, so that their log records are appended in the order the
+  // operations were applied
+  [[nodiscard]] std::mutex &key_order_mutex(key k) noexcept {
+    // Fibonacci hashing of the key to a stripe
+    return key_order_mutexes[(k * 0x9E3779B97F4A7C15ULL) >>
+                             (64U - key_order_stripe_bits)]
+        .mutex;
+  }
+
+  // Stats
+
+  [[nodiscard]] constexpr auto get_durability() const noexcept {
+    return durability;
+  }
+
+  // Return the size of the log, including the records not written yet
+  [[nodiscard]] std::uint64_t get_appended_lsn() const;
+
+  // Return the size of the log part that has been synced
+  [[nodiscard]] std::uint64_t get_durable_lsn() const;
+
+  // Return the number of log file syncs
+  [[nodiscard]] std::uint64_t get_sync_count() const;
+
+ private:
+  static constexpr unsigned key_order_stripe_bits = 6;
+
+  struct alignas(detail::hardware_destructive_interference_size)
+      key_order_stripe {
+    std::mutex mutex;
+  };
+
+  [[nodiscard]] std::uint64_t append(std::uint8_t type, key k, value_view v);
+
+  // Write and sync the buffered records, unlocking the mutex meanwhile, so
+  // that further records are buffered for the next sync. The mutex must be
+  // locked and no other write in progress.
+  void write_buffered(std::unique_lock<std::mutex> &lock);
+
+  void throw_if_failed() const;
+
+  void async_sync_loop();
+
+  const wal_durability durability;
+  const std::chrono::milliseconds async_sync_period;
+
+  int fd;
+
+  mutable std::mutex mutex;
+  std::condition_variable synced;
+  std::condition_variable async_wakeup;
+
+  // The records appended but not yet given to write
+  std::vector<std::byte> buffer;
+  // The records being written, swapped with buffer to reuse their memory
+  std::vector<std::byte> write_buffer;
+  std::uint64_t appended_lsn;
+  std::uint64_t durable_lsn;
+  std::uint64_t sync_count{0};
+  bool write_in_progress{false};
+  bool stopping{false};
+  std::error_code write_error;
+
+  std::array<key_order_stripe, 1U << key_order_stripe_bits> key_order_mutexes;
+
+  std::thread async_sync_thread;
+};
+
+namespace detail {
+
+// Replays a write-ahead log into the final contents of a tree, giving its keys
+// and values in increasing key order, as snapshot_reader
+class [[nodiscard]] wal_replay_reader final {
+ public:
+  // Throws std::runtime_error if the stream does not start with a log header
+  // of a supported version, or contains an invalid record
+  explicit wal_replay_reader(std::istream &is);
+
+  // Replay the log records after start_lsn over the contents of a snapshot.
+  // Throws std::runtime_error as snapshot_reader for the snapshot, as above for
+  // the log, and if the log ends before start_lsn.
+  wal_replay_reader(std::istream &snapshot_is, std::istream &log_is,
+                    std::uint64_t start_lsn);
+
+  [[nodiscard]] bool next() noexcept;
+
+  [[nodiscard]] key get_key() const noexcept { return entries[current].k; }
+
+  [[nodiscard]] value_view get_value() const noexcept {
+    const auto &current_entry = entries[current];
+    return value_view{values.data() + current_entry.value_offset,
+                      current_entry.value_size};
+  }
+
+  wal_replay_reader(const wal_replay_reader &) = delete;
+  wal_replay_reader(wal_replay_reader &&) = delete;
+  wal_replay_reader &operator=(const wal_replay_reader &) = delete;
+  wal_replay_reader &operator=(wal_replay_reader &&) = delete;
+
+ private:
+  struct entry {
+    key k;
+    std::size_t value_offset;
+    std::size_t value_size;
+    bool present;
+  };
+
+  // Append an entry for every record of the log after start_lsn
+  void read_log(std::istream &is, std::uint64_t start_lsn);
+
+  // Keep only the last entry of each key, and only if it is present
+  void merge_entries();
+
+  // The last operation on each key, sorted by key
+  std::vector<entry> entries;
+  std::vector<std::byte> values;
+  std::size_t current{0};
+  bool started{false};
+};
+
+}  // namespace detail
+
+}  // namespace unodb
+
+#endif  // UNODB_DETAIL_WAL_HPP